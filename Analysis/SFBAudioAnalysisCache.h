@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// A persistent store of analysis results
+///
+/// Results are stored per file and per key, where the key identifies the analysis and its settings. A file is
+/// identified by its device, inode, size, and modification date, so results for a file that has been modified are
+/// never returned. When \c identifiesFilesByContent is \c YES files are instead identified by a SHA-256 digest of their
+/// contents, so results follow a file that is copied or replaced with identical contents.
+///
+/// Each result is stored in its own small property list whose location is derived from the file identity and key,
+/// so lookups and stores take constant time regardless of the number of entries. Entries are replaced atomically:
+/// multiple threads and processes may share a cache directory, readers never see partial entries, and the last
+/// writer for a file and key wins.
+/// @note This class is thread safe
+NS_SWIFT_NAME(AudioAnalysisCache) @interface SFBAudioAnalysisCache : NSObject
+
+/// A cache in the user's caches directory, or \c nil if it could not be created
+@property (class, nonatomic, nullable, readonly) SFBAudioAnalysisCache *defaultCache;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Returns an initialized \c SFBAudioAnalysisCache object storing entries in \c url, creating the directory if necessary
+/// @param url The URL of the cache directory
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return An initialized \c SFBAudioAnalysisCache object or \c nil on error
+- (nullable instancetype)initWithDirectoryURL:(NSURL *)url error:(NSError **)error NS_DESIGNATED_INITIALIZER;
+
+/// The URL of the cache directory
+@property (nonatomic, readonly) NSURL *directoryURL;
+
+/// Set to \c YES to identify files by a digest of their contents instead of their file system identity
+/// @note Computing a digest reads the entire file the first time it is seen by this object
+@property (nonatomic) BOOL identifiesFilesByContent;
+
+/// Returns the results stored for \c url and \c key
+/// @param url The URL of the analyzed file
+/// @param key The key identifying the analysis
+/// @return The stored results, or \c nil if there are none or \c url has changed since they were stored
+- (nullable NSDictionary<NSString *, id> *)resultsForURL:(NSURL *)url key:(NSString *)key NS_SWIFT_NAME(results(for:key:));
+
+/// Stores \c results for \c url and \c key, replacing any existing results
+/// @param results The results to store, which must be a valid property list
+/// @param url The URL of the analyzed file
+/// @param key The key identifying the analysis
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return \c YES on success, \c NO otherwise
+- (BOOL)setResults:(NSDictionary<NSString *, id> *)results forURL:(NSURL *)url key:(NSString *)key error:(NSError **)error NS_SWIFT_NAME(setResults(_:for:key:));
+
+/// Removes the results stored for \c url and \c key so the next analysis is performed anew
+/// @param url The URL of the analyzed file
+/// @param key The key identifying the analysis
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return \c YES on success, \c NO otherwise
+- (BOOL)removeResultsForURL:(NSURL *)url key:(NSString *)key error:(NSError **)error NS_SWIFT_NAME(removeResults(for:key:));
+
+/// Removes all results stored for \c url
+/// @param url The URL of the analyzed file
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return \c YES on success, \c NO otherwise
+- (BOOL)removeResultsForURL:(NSURL *)url error:(NSError **)error NS_SWIFT_NAME(removeResults(for:));
+
+/// Removes results stored before \c date, including those for files that have since been modified or deleted
+/// @param date The date before which results are removed
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return \c YES on success, \c NO otherwise
+- (BOOL)removeResultsStoredBeforeDate:(NSDate *)date error:(NSError **)error NS_SWIFT_NAME(removeResults(storedBefore:));
+
+/// Removes all stored results
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return \c YES on success, \c NO otherwise
+- (BOOL)removeAllResultsReturningError:(NSError **)error NS_SWIFT_NAME(removeAllResults());
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+@import os.log;
+
+@import CommonCrypto;
+
+#import <fcntl.h>
+#import <sys/stat.h>
+#import <unistd.h>
+
+#import "SFBAudioAnalysisCache.h"
+
+// Entry dictionary keys
+static NSString * const SFBAudioAnalysisCacheEntryIdentityKey = @"Identity";
+static NSString * const SFBAudioAnalysisCacheEntryKeyKey = @"Key";
+static NSString * const SFBAudioAnalysisCacheEntryResultsKey = @"Results";
+
+#define DIGEST_BUFFER_SIZE (1024 * 1024)
+
+/// Returns the hexadecimal representation of a SHA-256 digest
+static NSString * HexStringForDigest(const unsigned char *digest)
+{
+	char hex [2 * CC_SHA256_DIGEST_LENGTH + 1];
+	for(size_t i = 0; i < CC_SHA256_DIGEST_LENGTH; ++i)
+		snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+	return [NSString stringWithUTF8String:hex];
+}
+
+/// Returns the hexadecimal SHA-256 digest of the UTF-8 representation of \c string
+static NSString * SHA256OfString(NSString *string)
+{
+	const char *utf8 = string.UTF8String;
+	unsigned char digest [CC_SHA256_DIGEST_LENGTH];
+	CC_SHA256(utf8, (CC_LONG)strlen(utf8), digest);
+	return HexStringForDigest(digest);
+}
+
+/// Returns an error for \c errno with \c url as the file URL
+static NSError * POSIXErrorForURL(int code, NSURL *url)
+{
+	return [NSError errorWithDomain:NSPOSIXErrorDomain code:code userInfo:@{ NSURLErrorKey: url }];
+}
+
+@interface SFBAudioAnalysisCache ()
+{
+@private
+	/// Content digests keyed by file system identity
+	NSCache<NSString *, NSString *> *_contentDigests;
+}
+- (nullable NSString *)identityOfURL:(NSURL *)url error:(NSError **)error;
+- (nullable NSString *)contentDigestOfURL:(NSURL *)url error:(NSError **)error;
+- (NSURL *)entryDirectoryURLForIdentity:(NSString *)identity;
+- (BOOL)removeItemAtURL:(NSURL *)url error:(NSError **)error;
+@end
+
+@implementation SFBAudioAnalysisCache
+
++ (SFBAudioAnalysisCache *)defaultCache
+{
+	static SFBAudioAnalysisCache *defaultCache = nil;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		NSError *error = nil;
+		NSURL *cachesURL = [[NSFileManager defaultManager] URLForDirectory:NSCachesDirectory inDomain:NSUserDomainMask appropriateForURL:nil create:YES error:&error];
+		if(cachesURL)
+			defaultCache = [[SFBAudioAnalysisCache alloc] initWithDirectoryURL:[cachesURL URLByAppendingPathComponent:@"org.sbooth.AudioEngine/Analysis" isDirectory:YES] error:&error];
+		if(!defaultCache)
+			os_log_error(OS_LOG_DEFAULT, "Unable to create default analysis cache: %{public}@", error);
+	});
+	return defaultCache;
+}
+
+- (instancetype)initWithDirectoryURL:(NSURL *)url error:(NSError **)error
+{
+	NSParameterAssert(url != nil);
+	NSParameterAssert(url.isFileURL);
+
+	if(![[NSFileManager defaultManager] createDirectoryAtURL:url withIntermediateDirectories:YES attributes:nil error:error])
+		return nil;
+
+	if((self = [super init])) {
+		_directoryURL = url;
+		_contentDigests = [[NSCache alloc] init];
+	}
+	return self;
+}
+
+- (NSDictionary *)resultsForURL:(NSURL *)url key:(NSString *)key
+{
+	NSParameterAssert(url != nil);
+	NSParameterAssert(key != nil);
+
+	NSError *error = nil;
+	NSString *identity = [self identityOfURL:url error:&error];
+	if(!identity) {
+		os_log_debug(OS_LOG_DEFAULT, "Unable to identify %{public}@: %{public}@", url, error);
+		return nil;
+	}
+
+	NSURL *entryURL = [[self entryDirectoryURLForIdentity:identity] URLByAppendingPathComponent:SHA256OfString(key) isDirectory:NO];
+	NSData *data = [NSData dataWithContentsOfURL:entryURL options:0 error:&error];
+	if(!data) {
+		if(!([error.domain isEqualToString:NSCocoaErrorDomain] && error.code == NSFileReadNoSuchFileError))
+			os_log_error(OS_LOG_DEFAULT, "Error reading analysis cache entry %{public}@: %{public}@", entryURL, error);
+		return nil;
+	}
+
+	NSDictionary *entry = [NSPropertyListSerialization propertyListWithData:data options:NSPropertyListImmutable format:NULL error:&error];
+	if(![entry isKindOfClass:[NSDictionary class]]) {
+		os_log_error(OS_LOG_DEFAULT, "Invalid analysis cache entry %{public}@: %{public}@", entryURL, error);
+		return nil;
+	}
+
+	// Guard against digest collisions
+	NSDictionary *results = entry[SFBAudioAnalysisCacheEntryResultsKey];
+	if(![entry[SFBAudioAnalysisCacheEntryIdentityKey] isEqual:identity] || ![entry[SFBAudioAnalysisCacheEntryKeyKey] isEqual:key] || ![results isKindOfClass:[NSDictionary class]])
+		return nil;
+
+	return results;
+}
+
+- (BOOL)setResults:(NSDictionary *)results forURL:(NSURL *)url key:(NSString *)key error:(NSError **)error
+{
+	NSParameterAssert(results != nil);
+	NSParameterAssert(url != nil);
+	NSParameterAssert(key != nil);
+
+	NSString *identity = [self identityOfURL:url error:error];
+	if(!identity)
+		return NO;
+
+	NSDictionary *entry = @{
+		SFBAudioAnalysisCacheEntryIdentityKey: identity,
+		SFBAudioAnalysisCacheEntryKeyKey: key,
+		SFBAudioAnalysisCacheEntryResultsKey: results,
+	};
+
+	NSData *data = [NSPropertyListSerialization dataWithPropertyList:entry format:NSPropertyListBinaryFormat_v1_0 options:0 error:error];
+	if(!data)
+		return NO;
+
+	NSURL *entryDirectoryURL = [self entryDirectoryURLForIdentity:identity];
+	NSURL *entryURL = [entryDirectoryURL URLByAppendingPathComponent:SHA256OfString(key) isDirectory:NO];
+
+	// The entry's directory may be removed by another writer between its creation and the write
+	for(int attempt = 0; ; ++attempt) {
+		if(![[NSFileManager defaultManager] createDirectoryAtURL:entryDirectoryURL withIntermediateDirectories:YES attributes:nil error:error])
+			return NO;
+		NSError *err = nil;
+		if([data writeToURL:entryURL options:NSDataWritingAtomic error:&err])
+			return YES;
+		if(attempt > 0) {
+			if(error)
+				*error = err;
+			return NO;
+		}
+	}
+}
+
+- (BOOL)removeResultsForURL:(NSURL *)url key:(NSString *)key error:(NSError **)error
+{
+	NSParameterAssert(url != nil);
+	NSParameterAssert(key != nil);
+
+	NSString *identity = [self identityOfURL:url error:error];
+	if(!identity)
+		return NO;
+
+	NSURL *entryURL = [[self entryDirectoryURLForIdentity:identity] URLByAppendingPathComponent:SHA256OfString(key) isDirectory:NO];
+	if(unlink(entryURL.fileSystemRepresentation) && errno != ENOENT) {
+		if(error)
+			*error = POSIXErrorForURL(errno, entryURL);
+		return NO;
+	}
+
+	return YES;
+}
+
+- (BOOL)removeResultsForURL:(NSURL *)url error:(NSError **)error
+{
+	NSParameterAssert(url != nil);
+
+	NSString *identity = [self identityOfURL:url error:error];
+	if(!identity)
+		return NO;
+
+	return [self removeItemAtURL:[self entryDirectoryURLForIdentity:identity] error:error];
+}
+
+- (BOOL)removeResultsStoredBeforeDate:(NSDate *)date error:(NSError **)error
+{
+	NSParameterAssert(date != nil);
+
+	NSDirectoryEnumerator *enumerator = [[NSFileManager defaultManager] enumeratorAtURL:_directoryURL includingPropertiesForKeys:@[NSURLIsRegularFileKey, NSURLContentModificationDateKey] options:0 errorHandler:nil];
+	NSMutableArray<NSURL *> *directoryURLs = [NSMutableArray array];
+	for(NSURL *url in enumerator) {
+		NSDictionary *values = [url resourceValuesForKeys:@[NSURLIsRegularFileKey, NSURLContentModificationDateKey] error:nil];
+		if(![values[NSURLIsRegularFileKey] boolValue]) {
+			[directoryURLs addObject:url];
+			continue;
+		}
+
+		NSDate *modificationDate = values[NSURLContentModificationDateKey];
+		if(modificationDate && [modificationDate compare:date] == NSOrderedAscending && unlink(url.fileSystemRepresentation) && errno != ENOENT) {
+			if(error)
+				*error = POSIXErrorForURL(errno, url);
+			return NO;
+		}
+	}
+
+	// Remove directories left empty, deepest first; directories in use are not empty and are left alone
+	for(NSURL *url in directoryURLs.reverseObjectEnumerator)
+		rmdir(url.fileSystemRepresentation);
+
+	return YES;
+}
+
+- (BOOL)removeAllResultsReturningError:(NSError **)error
+{
+	NSArray *urls = [[NSFileManager defaultManager] contentsOfDirectoryAtURL:_directoryURL includingPropertiesForKeys:nil options:0 error:error];
+	if(!urls)
+		return NO;
+
+	for(NSURL *url in urls) {
+		if(![self removeItemAtURL:url error:error])
+			return NO;
+	}
+
+	return YES;
+}
+
+#pragma mark Internal
+
+- (NSString *)identityOfURL:(NSURL *)url error:(NSError **)error
+{
+	NSParameterAssert(url.isFileURL);
+
+	struct stat st;
+	if(stat(url.fileSystemRepresentation, &st)) {
+		if(error)
+			*error = POSIXErrorForURL(errno, url);
+		return nil;
+	}
+
+	NSString *identity = [NSString stringWithFormat:@"%lld:%llu:%lld:%ld.%09ld", (long long)st.st_dev, (unsigned long long)st.st_ino, (long long)st.st_size, (long)st.st_mtimespec.tv_sec, (long)st.st_mtimespec.tv_nsec];
+	if(!_identifiesFilesByContent)
+		return identity;
+
+	// A file's digest is reused until its file system identity changes
+	NSString *digest = [_contentDigests objectForKey:identity];
+	if(!digest) {
+		digest = [self contentDigestOfURL:url error:error];
+		if(!digest)
+			return nil;
+		[_contentDigests setObject:digest forKey:identity];
+	}
+
+	return [@"SHA-256:" stringByAppendingString:digest];
+}
+
+- (NSString *)contentDigestOfURL:(NSURL *)url error:(NSError **)error
+{
+	int fd = open(url.fileSystemRepresentation, O_RDONLY);
+	if(fd == -1) {
+		if(error)
+			*error = POSIXErrorForURL(errno, url);
+		return nil;
+	}
+
+	// The file is read sequentially once so the page cache need not retain it
+	fcntl(fd, F_NOCACHE, 1);
+
+	void *buffer = malloc(DIGEST_BUFFER_SIZE);
+	if(!buffer) {
+		close(fd);
+		if(error)
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+		return nil;
+	}
+
+	CC_SHA256_CTX context;
+	CC_SHA256_Init(&context);
+
+	ssize_t bytesRead;
+	while((bytesRead = read(fd, buffer, DIGEST_BUFFER_SIZE)) > 0)
+		CC_SHA256_Update(&context, buffer, (CC_LONG)bytesRead);
+
+	const int readError = bytesRead == -1 ? errno : 0;
+
+	free(buffer);
+	close(fd);
+
+	unsigned char digest [CC_SHA256_DIGEST_LENGTH];
+	CC_SHA256_Final(digest, &context);
+
+	if(readError) {
+		if(error)
+			*error = POSIXErrorForURL(readError, url);
+		return nil;
+	}
+
+	return HexStringForDigest(digest);
+}
+
+- (NSURL *)entryDirectoryURLForIdentity:(NSString *)identity
+{
+	// Entries are spread over 256 subdirectories to keep directories small
+	NSString *digest = SHA256OfString(identity);
+	NSString *path = [NSString stringWithFormat:@"%@/%@", [digest substringToIndex:2], [digest substringFromIndex:2]];
+	return [_directoryURL URLByAppendingPathComponent:path isDirectory:YES];
+}
+
+- (BOOL)removeItemAtURL:(NSURL *)url error:(NSError **)error
+{
+	// The item is first moved aside so concurrent readers see either all of its entries or none
+	NSURL *removedURL = [_directoryURL URLByAppendingPathComponent:[@".removed-" stringByAppendingString:[NSUUID UUID].UUIDString]];
+	if(rename(url.fileSystemRepresentation, removedURL.fileSystemRepresentation)) {
+		if(errno == ENOENT)
+			return YES;
+		if(error)
+			*error = POSIXErrorForURL(errno, url);
+		return NO;
+	}
+
+	return [[NSFileManager defaultManager] removeItemAtURL:removedURL error:error];
+}
+
+@end
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <Foundation/Foundation.h>
+
+#import <SFBAudioEngine/SFBAudioAnalysisCache.h>
+#import <SFBAudioEngine/SFBAudioAnalysisPlugIn.h>
+#import <SFBAudioEngine/SFBPCMDecoding.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class SFBAudioAnalysisStatistics;
+
+/// Analyzes audio with multiple plug-ins while decoding it once
+///
+/// Each block of audio is decoded, converted to the standard deinterleaved \c float format, and passed to every
+/// registered plug-in. When \c concurrent is \c YES each plug-in runs on its own serial queue while the next block is
+/// decoded, with plug-ins sharing a small pool of read-only buffers.
+/// @note This class is not thread safe
+NS_SWIFT_NAME(AudioAnalysisPipeline) @interface SFBAudioAnalysisPipeline : NSObject
+
+/// Registers \c plugIn to receive audio
+/// @param plugIn The plug-in
+/// @param key The key used for the plug-in's results
+- (void)addPlugIn:(id <SFBAudioAnalysisPlugIn>)plugIn forKey:(NSString *)key NS_SWIFT_NAME(add(_:forKey:));
+
+/// Unregisters the plug-in for \c key
+- (void)removePlugInForKey:(NSString *)key;
+
+/// The registered plug-ins
+@property (nonatomic, readonly) NSDictionary<NSString *, id <SFBAudioAnalysisPlugIn>> *plugIns;
+
+/// Set to \c YES to run plug-ins concurrently with each other and with decoding
+@property (nonatomic, getter=isConcurrent) BOOL concurrent;
+
+/// An optional cache of results
+///
+/// When set, \c -analyzeURL:error: returns stored results for cacheable plug-ins instead of running them, and stores
+/// the new results of those that run. Results are cached by each plug-in's \c cacheKey, which reflects its class and
+/// settings, so the pipeline key does not affect caching. Plug-ins whose results are cached are not run, so their
+/// state is not updated unless they implement \c -restoreFromCachedResults:. The audio is not decoded if the results
+/// of every plug-in are cached.
+@property (nonatomic, nullable) SFBAudioAnalysisCache *cache;
+
+/// Decodes and analyzes the audio in \c url
+/// @param url The URL to analyze
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return A dictionary containing the results of each plug-in or the \c NSError that caused it to fail, keyed by plug-in key, or \c nil on error
+- (nullable NSDictionary<NSString *, id> *)analyzeURL:(NSURL *)url error:(NSError **)error NS_SWIFT_NAME(analyze(_:));
+
+/// Decodes and analyzes the audio from \c decoder
+/// @param decoder The decoder providing the audio to analyze
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return A dictionary containing the results of each plug-in or the \c NSError that caused it to fail, keyed by plug-in key, or \c nil on error
+- (nullable NSDictionary<NSString *, id> *)analyzeAudioFromDecoder:(id <SFBPCMDecoding>)decoder error:(NSError **)error NS_SWIFT_NAME(analyze(_:));
+
+/// Throughput statistics for the most recent analysis or \c nil if unavailable
+@property (nonatomic, nullable, readonly) SFBAudioAnalysisStatistics *statistics;
+
+@end
+
+/// Throughput statistics for an analysis
+NS_SWIFT_NAME(AudioAnalysisPipeline.Statistics) @interface SFBAudioAnalysisStatistics : NSObject
+
+/// The number of frames produced by the decoder
+@property (nonatomic, readonly) AVAudioFramePosition framesDecoded;
+/// The wall time taken by the analysis, in seconds
+@property (nonatomic, readonly) NSTimeInterval elapsedTime;
+
+/// The decoder's throughput in frames per second of decoding time
+@property (nonatomic, readonly) double decodeFramesPerSecond;
+/// The format converter's throughput in frames per second of conversion time, or \c 0 if no conversion was required
+@property (nonatomic, readonly) double conversionFramesPerSecond;
+/// The throughput of each plug-in in frames per second of analysis time, keyed by plug-in key
+@property (nonatomic, readonly) NSDictionary<NSString *, NSNumber *> *analysisFramesPerSecond;
+
+/// The duration of the audio analyzed divided by \c elapsedTime
+@property (nonatomic, readonly) double realtimeFactor;
+
+/// The statistics as a dictionary keyed by property name
+@property (nonatomic, readonly) NSDictionary<NSString *, id> *dictionaryRepresentation;
+
+@end
+
+/// The \c NSErrorDomain used by \c SFBAudioAnalysisPipeline
+extern NSErrorDomain const SFBAudioAnalysisPipelineErrorDomain NS_SWIFT_NAME(AudioAnalysisPipeline.ErrorDomain);
+
+/// Possible \c NSError error codes used by \c SFBAudioAnalysisPipeline
+typedef NS_ERROR_ENUM(SFBAudioAnalysisPipelineErrorDomain, SFBAudioAnalysisPipelineErrorCode) {
+	/// Audio format not supported
+	SFBAudioAnalysisPipelineErrorCodeFormatNotSupported			= 0,
+	/// A plug-in failed without providing an error
+	SFBAudioAnalysisPipelineErrorCodeAnalysisFailed				= 1,
+	/// The decoder failed without providing an error
+	SFBAudioAnalysisPipelineErrorCodeDecodingFailed				= 2,
+} NS_SWIFT_NAME(AudioAnalysisPipeline.ErrorCode);
+
+NS_ASSUME_NONNULL_END
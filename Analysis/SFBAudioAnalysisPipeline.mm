@@ -0,0 +1,378 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <vector>
+
+#import <os/log.h>
+
+#import "SFBAudioAnalysisPipeline.h"
+
+#import "AudioPCMConverter.h"
+#import "SFBAudioDecoder.h"
+
+// NSError domain for SFBAudioAnalysisPipeline
+NSErrorDomain const SFBAudioAnalysisPipelineErrorDomain = @"org.sbooth.AudioEngine.AudioAnalysisPipeline";
+
+#define BUFFER_SIZE_FRAMES 4096
+#define PIPELINE_QUEUE_LENGTH 4
+
+@interface SFBAudioAnalysisStatistics ()
+@property (nonatomic) AVAudioFramePosition framesDecoded;
+@property (nonatomic) NSTimeInterval elapsedTime;
+@property (nonatomic) double decodeFramesPerSecond;
+@property (nonatomic) double conversionFramesPerSecond;
+@property (nonatomic) NSDictionary<NSString *, NSNumber *> *analysisFramesPerSecond;
+@property (nonatomic) double realtimeFactor;
+@end
+
+@implementation SFBAudioAnalysisStatistics
+
+- (NSDictionary<NSString *, id> *)dictionaryRepresentation
+{
+	return @{
+		@"framesDecoded": @(_framesDecoded),
+		@"elapsedTime": @(_elapsedTime),
+		@"decodeFramesPerSecond": @(_decodeFramesPerSecond),
+		@"conversionFramesPerSecond": @(_conversionFramesPerSecond),
+		@"analysisFramesPerSecond": _analysisFramesPerSecond ?: @{},
+		@"realtimeFactor": @(_realtimeFactor),
+	};
+}
+
+@end
+
+namespace {
+
+	/// Returns the number of frames processed per second given a processing time in nanoseconds
+	double FramesPerSecond(AVAudioFramePosition frames, uint64_t nanoseconds)
+	{
+		return nanoseconds > 0 ? static_cast<double>(frames) / (static_cast<double>(nanoseconds) / NSEC_PER_SEC) : 0;
+	}
+
+}
+
+@interface SFBAudioAnalysisPipeline ()
+{
+@private
+	/// Plug-in keys in registration order
+	NSMutableArray<NSString *> *_keys;
+	NSMutableDictionary<NSString *, id <SFBAudioAnalysisPlugIn>> *_plugIns;
+}
+- (nullable NSDictionary *)analyzeAudioFromDecoder:(id <SFBPCMDecoding>)decoder keys:(NSArray<NSString *> *)keys error:(NSError **)error;
+@end
+
+@implementation SFBAudioAnalysisPipeline
+
++ (void)load
+{
+	[NSError setUserInfoValueProviderForDomain:SFBAudioAnalysisPipelineErrorDomain provider:^id(NSError *err, NSErrorUserInfoKey userInfoKey) {
+		if(userInfoKey == NSLocalizedDescriptionKey) {
+			switch(err.code) {
+				case SFBAudioAnalysisPipelineErrorCodeFormatNotSupported:
+					return NSLocalizedString(@"The audio format is not supported.", @"");
+				case SFBAudioAnalysisPipelineErrorCodeAnalysisFailed:
+					return NSLocalizedString(@"The audio could not be analyzed.", @"");
+				case SFBAudioAnalysisPipelineErrorCodeDecodingFailed:
+					return NSLocalizedString(@"The audio could not be decoded.", @"");
+			}
+		}
+		return nil;
+	}];
+}
+
+- (instancetype)init
+{
+	if((self = [super init])) {
+		_keys = [NSMutableArray array];
+		_plugIns = [NSMutableDictionary dictionary];
+	}
+	return self;
+}
+
+- (void)addPlugIn:(id<SFBAudioAnalysisPlugIn>)plugIn forKey:(NSString *)key
+{
+	NSParameterAssert(plugIn != nil);
+	NSParameterAssert(key != nil);
+
+	if(!_plugIns[key])
+		[_keys addObject:key];
+	_plugIns[key] = plugIn;
+}
+
+- (void)removePlugInForKey:(NSString *)key
+{
+	NSParameterAssert(key != nil);
+
+	[_keys removeObject:key];
+	[_plugIns removeObjectForKey:key];
+}
+
+- (NSDictionary<NSString *, id<SFBAudioAnalysisPlugIn>> *)plugIns
+{
+	return [_plugIns copy];
+}
+
+- (NSDictionary *)analyzeURL:(NSURL *)url error:(NSError **)error
+{
+	NSParameterAssert(url != nil);
+
+	SFBAudioAnalysisCache *cache = _cache;
+	if(!cache) {
+		SFBAudioDecoder *decoder = [[SFBAudioDecoder alloc] initWithURL:url error:error];
+		if(!decoder)
+			return nil;
+		return [self analyzeAudioFromDecoder:decoder error:error];
+	}
+
+	NSMutableDictionary *results = [NSMutableDictionary dictionaryWithCapacity:_keys.count];
+	NSMutableArray<NSString *> *keys = [NSMutableArray arrayWithCapacity:_keys.count];
+	NSMutableDictionary<NSString *, NSString *> *cacheKeys = [NSMutableDictionary dictionaryWithCapacity:_keys.count];
+	for(NSString *key in _keys) {
+		id <SFBAudioAnalysisPlugIn> plugIn = _plugIns[key];
+		if([plugIn respondsToSelector:@selector(isCacheable)] && plugIn.isCacheable) {
+			// Results are cached by the plug-in's key, which reflects its class, version, and settings, rather than the pipeline key
+			if(![plugIn respondsToSelector:@selector(cacheKey)]) {
+				os_log_error(OS_LOG_DEFAULT, "Cacheable plug-in %{public}@ does not provide a cache key", plugIn);
+				[keys addObject:key];
+				continue;
+			}
+
+			NSString *cacheKey = plugIn.cacheKey;
+			NSDictionary *result = [cache resultsForURL:url key:cacheKey];
+			if(result && (![plugIn respondsToSelector:@selector(restoreFromCachedResults:)] || [plugIn restoreFromCachedResults:result])) {
+				results[key] = result;
+				continue;
+			}
+			cacheKeys[key] = cacheKey;
+		}
+		[keys addObject:key];
+	}
+
+	if(keys.count == 0) {
+		os_log_debug(OS_LOG_DEFAULT, "Using cached analysis results for %{public}@", url);
+		_statistics = nil;
+		return [results copy];
+	}
+
+	SFBAudioDecoder *decoder = [[SFBAudioDecoder alloc] initWithURL:url error:error];
+	if(!decoder)
+		return nil;
+
+	NSDictionary *analysisResults = [self analyzeAudioFromDecoder:decoder keys:keys error:error];
+	if(!analysisResults)
+		return nil;
+
+	// Failures are not cached so they are retried by the next analysis
+	[analysisResults enumerateKeysAndObjectsUsingBlock:^(NSString *key, id result, BOOL *stop) {
+#pragma unused(stop)
+		NSError *err = nil;
+		NSString *cacheKey = cacheKeys[key];
+		if(cacheKey && [result isKindOfClass:[NSDictionary class]] && ![cache setResults:result forURL:url key:cacheKey error:&err])
+			os_log_error(OS_LOG_DEFAULT, "Error caching analysis results for %{public}@: %{public}@", url, err);
+	}];
+
+	[results addEntriesFromDictionary:analysisResults];
+	return [results copy];
+}
+
+- (NSDictionary *)analyzeAudioFromDecoder:(id<SFBPCMDecoding>)decoder error:(NSError **)error
+{
+	return [self analyzeAudioFromDecoder:decoder keys:[_keys copy] error:error];
+}
+
+#pragma mark Internal
+
+- (NSDictionary *)analyzeAudioFromDecoder:(id<SFBPCMDecoding>)decoder keys:(NSArray<NSString *> *)keys error:(NSError **)error
+{
+	NSParameterAssert(decoder != nil);
+	NSParameterAssert(keys != nil);
+
+	_statistics = nil;
+
+	if(!decoder.isOpen && ![decoder openReturningError:error])
+		return nil;
+
+	const uint64_t startTime = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+
+	AVAudioFormat *inputFormat = decoder.processingFormat;
+
+	// The channel layout is preserved so multichannel audio may be weighted
+	AVAudioFormat *outputFormat = nil;
+	if(inputFormat.channelLayout)
+		outputFormat = [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat32 sampleRate:inputFormat.sampleRate interleaved:NO channelLayout:inputFormat.channelLayout];
+	else
+		outputFormat = [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat32 sampleRate:inputFormat.sampleRate channels:inputFormat.channelCount interleaved:NO];
+
+	SFB::Audio::PCMConverter converter;
+	const BOOL needsConversion = outputFormat && ![inputFormat isEqual:outputFormat];
+	if(!outputFormat || (needsConversion && !converter.Initialize(SFB::Audio::Format(inputFormat.streamDescription), SFB::Audio::Format(outputFormat.streamDescription)))) {
+		os_log_error(OS_LOG_DEFAULT, "Unsupported format for analysis: %{public}@", inputFormat);
+		if(error)
+			*error = [NSError errorWithDomain:SFBAudioAnalysisPipelineErrorDomain code:SFBAudioAnalysisPipelineErrorCodeFormatNotSupported userInfo:nil];
+		return nil;
+	}
+
+	NSMutableArray<id <SFBAudioAnalysisPlugIn>> *plugIns = [NSMutableArray arrayWithCapacity:keys.count];
+
+	// Prepared plug-ins are abandoned if analysis is, so no state is carried into the next analysis
+	void (^abandonAnalysis)(void) = ^{
+		for(id <SFBAudioAnalysisPlugIn> plugIn in plugIns) {
+			if([plugIn respondsToSelector:@selector(abandonAnalysis)])
+				[plugIn abandonAnalysis];
+			else
+				[plugIn finishAnalysisReturningError:nil];
+		}
+	};
+
+	for(NSString *key in keys) {
+		id <SFBAudioAnalysisPlugIn> plugIn = _plugIns[key];
+		if(![plugIn prepareToAnalyzeFormat:outputFormat error:error]) {
+			abandonAnalysis();
+			return nil;
+		}
+		[plugIns addObject:plugIn];
+	}
+
+	// Decoded audio is converted into a pool of buffers shared by all plug-ins. A buffer is reused only after every
+	// plug-in has finished with it, which bounds how far decoding may run ahead of the slowest plug-in.
+	const NSUInteger bufferCount = _concurrent ? PIPELINE_QUEUE_LENGTH : 1;
+	NSMutableArray<AVAudioPCMBuffer *> *buffers = [NSMutableArray arrayWithCapacity:bufferCount];
+	NSMutableArray<dispatch_group_t> *groups = [NSMutableArray arrayWithCapacity:bufferCount];
+	for(NSUInteger i = 0; i < bufferCount; ++i) {
+		AVAudioPCMBuffer *buffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:outputFormat frameCapacity:BUFFER_SIZE_FRAMES];
+		if(!buffer) {
+			abandonAnalysis();
+			if(error)
+				*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+			return nil;
+		}
+		[buffers addObject:buffer];
+		[groups addObject:dispatch_group_create()];
+	}
+
+	AVAudioPCMBuffer *decodeBuffer = nil;
+	if(needsConversion) {
+		decodeBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:inputFormat frameCapacity:BUFFER_SIZE_FRAMES];
+		if(!decodeBuffer) {
+			abandonAnalysis();
+			if(error)
+				*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+			return nil;
+		}
+	}
+
+	// Each plug-in is given a serial queue so it sees buffers in order
+	NSMutableArray<dispatch_queue_t> *queues = nil;
+	if(_concurrent) {
+		queues = [NSMutableArray arrayWithCapacity:plugIns.count];
+		dispatch_queue_attr_t attr = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, qos_class_self(), 0);
+		for(NSUInteger i = 0; i < plugIns.count; ++i)
+			[queues addObject:dispatch_queue_create("org.sbooth.AudioEngine.AudioAnalysisPipeline.PlugIn", attr)];
+	}
+
+	// Each element is only accessed by its plug-in's queue until the buffer groups are waited on
+	std::vector<uint64_t> analysisTimes(plugIns.count, 0);
+	uint64_t * const analysisTime = analysisTimes.data();
+
+	AVAudioFramePosition framesDecoded = 0;
+	uint64_t decodeTime = 0;
+	uint64_t conversionTime = 0;
+	// Decoders are not required to provide an error on failure
+	BOOL decodeFailed = NO;
+	NSError *decodeError = nil;
+
+	for(NSUInteger blockNumber = 0; ; ++blockNumber) {
+		const NSUInteger slot = blockNumber % bufferCount;
+		AVAudioPCMBuffer *buffer = buffers[slot];
+		dispatch_group_t group = groups[slot];
+
+		if(decodeBuffer) {
+			uint64_t t0 = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+			BOOL result = [decoder decodeIntoBuffer:decodeBuffer frameLength:decodeBuffer.frameCapacity error:&decodeError];
+			decodeTime += clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - t0;
+			if(!result) {
+				decodeFailed = YES;
+				break;
+			}
+			if(decodeBuffer.frameLength == 0)
+				break;
+
+			dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+
+			t0 = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+			if(!converter.Convert(decodeBuffer.audioBufferList, buffer.mutableAudioBufferList, decodeBuffer.frameLength)) {
+				os_log_error(OS_LOG_DEFAULT, "Error converting audio to %{public}@", outputFormat);
+				decodeFailed = YES;
+				decodeError = [NSError errorWithDomain:NSPOSIXErrorDomain code:EINVAL userInfo:nil];
+				break;
+			}
+			buffer.frameLength = decodeBuffer.frameLength;
+			conversionTime += clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - t0;
+		}
+		else {
+			dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+
+			const uint64_t t0 = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+			BOOL result = [decoder decodeIntoBuffer:buffer frameLength:buffer.frameCapacity error:&decodeError];
+			decodeTime += clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - t0;
+			if(!result) {
+				decodeFailed = YES;
+				break;
+			}
+			if(buffer.frameLength == 0)
+				break;
+		}
+
+		framesDecoded += buffer.frameLength;
+
+		[plugIns enumerateObjectsUsingBlock:^(id<SFBAudioAnalysisPlugIn> plugIn, NSUInteger idx, BOOL *stop) {
+#pragma unused(stop)
+			dispatch_block_t analyze = ^{
+				const uint64_t t0 = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+				[plugIn analyzeBuffer:buffer];
+				analysisTime[idx] += clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - t0;
+			};
+
+			if(queues)
+				dispatch_group_async(group, queues[idx], analyze);
+			else
+				analyze();
+		}];
+	}
+
+	for(dispatch_group_t group in groups)
+		dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+
+	if(decodeFailed) {
+		abandonAnalysis();
+		if(error)
+			*error = decodeError ?: [NSError errorWithDomain:SFBAudioAnalysisPipelineErrorDomain code:SFBAudioAnalysisPipelineErrorCodeDecodingFailed userInfo:nil];
+		return nil;
+	}
+
+	NSMutableDictionary *results = [NSMutableDictionary dictionaryWithCapacity:keys.count];
+	NSMutableDictionary *analysisFramesPerSecond = [NSMutableDictionary dictionaryWithCapacity:keys.count];
+	[plugIns enumerateObjectsUsingBlock:^(id<SFBAudioAnalysisPlugIn> plugIn, NSUInteger idx, BOOL *stop) {
+#pragma unused(stop)
+		NSError *err = nil;
+		NSDictionary *result = [plugIn finishAnalysisReturningError:&err];
+		results[keys[idx]] = result ?: err ?: [NSError errorWithDomain:SFBAudioAnalysisPipelineErrorDomain code:SFBAudioAnalysisPipelineErrorCodeAnalysisFailed userInfo:nil];
+		analysisFramesPerSecond[keys[idx]] = @(FramesPerSecond(framesDecoded, analysisTime[idx]));
+	}];
+
+	SFBAudioAnalysisStatistics *statistics = [[SFBAudioAnalysisStatistics alloc] init];
+	statistics.framesDecoded = framesDecoded;
+	statistics.elapsedTime = static_cast<double>(clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - startTime) / NSEC_PER_SEC;
+	statistics.decodeFramesPerSecond = FramesPerSecond(framesDecoded, decodeTime);
+	statistics.conversionFramesPerSecond = FramesPerSecond(needsConversion ? framesDecoded : 0, conversionTime);
+	statistics.analysisFramesPerSecond = analysisFramesPerSecond;
+	if(statistics.elapsedTime > 0)
+		statistics.realtimeFactor = (framesDecoded / outputFormat.sampleRate) / statistics.elapsedTime;
+	_statistics = statistics;
+
+	return [results copy];
+}
+
+@end
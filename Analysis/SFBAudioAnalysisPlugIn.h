@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <AVFoundation/AVFoundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// A protocol defining an analyzer that may be driven by \c SFBAudioAnalysisPipeline
+///
+/// A plug-in is prepared once per source, receives every block of decoded audio in order, and is then asked for its
+/// results. If analysis is abandoned because of an error \c -abandonAnalysis is called instead, or
+/// \c -finishAnalysisReturningError: with its results discarded if the plug-in does not implement it. When the pipeline
+/// is concurrent \c -analyzeBuffer: is called on a private serial queue; a plug-in is never called simultaneously from
+/// multiple threads.
+NS_SWIFT_NAME(AudioAnalysisPlugIn) @protocol SFBAudioAnalysisPlugIn <NSObject>
+
+/// Prepares to analyze audio in \c format
+/// @param format The standard deinterleaved \c float format at the source's sample rate and channel layout
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return \c YES on success, \c NO otherwise
+- (BOOL)prepareToAnalyzeFormat:(AVAudioFormat *)format error:(NSError **)error NS_SWIFT_NAME(prepare(format:));
+
+/// Analyzes the audio in \c buffer
+/// @note \c buffer is shared with other plug-ins and must not be modified
+/// @param buffer A buffer in the format passed to \c -prepareToAnalyzeFormat:error:
+- (void)analyzeBuffer:(AVAudioPCMBuffer *)buffer;
+
+/// Completes analysis and returns the results
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return The results of the analysis, or \c nil on error
+- (nullable NSDictionary<NSString *, id> *)finishAnalysisReturningError:(NSError **)error NS_SWIFT_NAME(finishAnalysis());
+
+@optional
+
+/// Discards the audio analyzed since \c -prepareToAnalyzeFormat:error: without completing analysis
+///
+/// Plug-ins that accumulate state across sources, such as album results, implement this method so that an abandoned
+/// source does not contribute to that state.
+- (void)abandonAnalysis;
+
+/// \c YES if the plug-in's results depend only on the audio analyzed and are valid property lists, so they may be
+/// stored in an \c SFBAudioAnalysisCache
+/// @note Plug-ins that do not implement this property are not cached
+/// @note Cacheable plug-ins must also implement \c cacheKey
+@property (nonatomic, readonly, getter=isCacheable) BOOL cacheable;
+
+/// The key identifying the plug-in's results in an \c SFBAudioAnalysisCache
+///
+/// The key must identify the plug-in's class, the version of its results, and every setting affecting its results,
+/// so that plug-ins producing different results never share a cache entry.
+/// @note A cacheable plug-in that does not implement this property is not cached
+@property (nonatomic, readonly) NSString *cacheKey;
+
+/// Restores the plug-in's state from previously cached results
+///
+/// When a plug-in's results are found in an \c SFBAudioAnalysisCache the plug-in is not prepared and does not
+/// analyze any audio, so state other than its results is not updated. A plug-in whose state must reflect the audio
+/// implements this method to restore it from \c results.
+/// @param results The cached results
+/// @return \c YES on success, \c NO if the plug-in should analyze the audio instead
+- (BOOL)restoreFromCachedResults:(NSDictionary<NSString *, id> *)results;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <AVFoundation/AVFoundation.h>
+
+#import <SFBAudioEngine/SFBAudioAnalysisPlugIn.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// A key in a loudness dictionary
+typedef NSString * SFBLoudnessAnalyzerKey NS_TYPED_ENUM NS_SWIFT_NAME(LoudnessAnalyzer.Key);
+
+// Loudness dictionary keys
+/// The gated integrated loudness in LUFS (\c NSNumber)
+extern SFBLoudnessAnalyzerKey const SFBLoudnessAnalyzerIntegratedLoudnessKey;
+/// The loudness range in LU (\c NSNumber)
+extern SFBLoudnessAnalyzerKey const SFBLoudnessAnalyzerLoudnessRangeKey;
+/// The largest momentary loudness in LUFS (\c NSNumber)
+extern SFBLoudnessAnalyzerKey const SFBLoudnessAnalyzerMaximumMomentaryLoudnessKey;
+/// The largest short-term loudness in LUFS (\c NSNumber)
+extern SFBLoudnessAnalyzerKey const SFBLoudnessAnalyzerMaximumShortTermLoudnessKey;
+/// The true peak in dBTP (\c NSNumber)
+extern SFBLoudnessAnalyzerKey const SFBLoudnessAnalyzerTruePeakKey;
+
+
+/// A class that measures loudness as specified in ITU-R BS.1770 and EBU R 128
+///
+/// Audio is K-weighted and channels are weighted by their position, with LFE channels ignored. Any channel count and
+/// sample rate is supported.
+///
+/// Measurements are updated as audio is analyzed so an analyzer may be fed buffers during playback and queried at any
+/// time. Momentary and short-term loudness are updated every 100 ms. Loudness values are \c -HUGE_VAL when too
+/// little audio has been analyzed to measure them.
+///
+/// As an \c SFBAudioAnalysisPlugIn the analyzer returns \c dictionaryRepresentation as its results.
+///
+/// This class is not thread safe.
+/// @see https://tech.ebu.ch/docs/r/r128.pdf
+NS_SWIFT_NAME(LoudnessAnalyzer) @interface SFBLoudnessAnalyzer : NSObject <SFBAudioAnalysisPlugIn>
+
+/// Analyze the loudness of the given URL
+/// @param url The URL to analyze
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return A dictionary of loudness information, or \c nil on error
++ (nullable NSDictionary<SFBLoudnessAnalyzerKey, NSNumber *> *)analyzeURL:(NSURL *)url error:(NSError **)error NS_SWIFT_NAME(analyze(_:));
+
+/// Returns an initialized \c SFBLoudnessAnalyzer object that must be prepared with \c -prepareToAnalyzeFormat:error: before use
+- (instancetype)init NS_DESIGNATED_INITIALIZER;
+
+/// Returns an initialized \c SFBLoudnessAnalyzer object or \c nil on failure
+/// @param format The format of the audio to analyze, which must be in the standard deinterleaved \c float format
+- (nullable instancetype)initWithFormat:(AVAudioFormat *)format;
+
+/// The format of the audio to analyze or \c nil if the analyzer has not been prepared
+@property (nonatomic, nullable, readonly) AVAudioFormat *format;
+
+/// Analyzes the audio in \c buffer
+/// @param buffer A buffer in \c format
+- (void)analyzeBuffer:(AVAudioPCMBuffer *)buffer;
+
+/// Discards all measurements
+- (void)reset;
+
+/// The number of frames analyzed
+@property (nonatomic, readonly) AVAudioFramePosition framesAnalyzed;
+
+/// The loudness of the most recent 400 ms in LUFS
+@property (nonatomic, readonly) double momentaryLoudness;
+/// The loudness of the most recent 3 s in LUFS
+@property (nonatomic, readonly) double shortTermLoudness;
+/// The largest momentary loudness in LUFS
+@property (nonatomic, readonly) double maximumMomentaryLoudness;
+/// The largest short-term loudness in LUFS
+@property (nonatomic, readonly) double maximumShortTermLoudness;
+/// The gated integrated loudness of all audio analyzed in LUFS
+@property (nonatomic, readonly) double integratedLoudness;
+/// The loudness range of all audio analyzed in LU
+@property (nonatomic, readonly) double loudnessRange;
+/// The largest true peak of all audio analyzed in dBTP, as specified in ITU-R BS.1770 Annex 2
+@property (nonatomic, readonly) double truePeak;
+
+/// Returns the current measurements
+@property (nonatomic, readonly) NSDictionary<SFBLoudnessAnalyzerKey, NSNumber *> *dictionaryRepresentation;
+
+@end
+
+/// The \c NSErrorDomain used by \c SFBLoudnessAnalyzer
+extern NSErrorDomain const SFBLoudnessAnalyzerErrorDomain NS_SWIFT_NAME(LoudnessAnalyzer.ErrorDomain);
+
+/// Possible \c NSError error codes used by \c SFBLoudnessAnalyzer
+typedef NS_ERROR_ENUM(SFBLoudnessAnalyzerErrorDomain, SFBLoudnessAnalyzerErrorCode) {
+	/// File format not supported
+	SFBLoudnessAnalyzerErrorCodeFileFormatNotSupported		= 0,
+	/// Insufficient samples in file for analysis
+	SFBLoudnessAnalyzerErrorCodeInsufficientSamples			= 1,
+} NS_SWIFT_NAME(LoudnessAnalyzer.ErrorCode);
+
+NS_ASSUME_NONNULL_END
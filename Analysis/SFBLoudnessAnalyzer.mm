@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <vector>
+
+#import <os/log.h>
+
+#import "SFBLoudnessAnalyzer.h"
+
+#import "AudioLoudnessMeter.h"
+#import "AudioPCMConverter.h"
+#import "AudioTruePeakMeter.h"
+#import "NSError+SFBURLPresentation.h"
+#import "SFBAudioDecoder+Internal.h"
+
+// NSError domain for SFBLoudnessAnalyzer
+NSErrorDomain const SFBLoudnessAnalyzerErrorDomain = @"org.sbooth.AudioEngine.LoudnessAnalyzer";
+
+// Key names for the loudness dictionary
+SFBLoudnessAnalyzerKey const SFBLoudnessAnalyzerIntegratedLoudnessKey = @"Integrated Loudness";
+SFBLoudnessAnalyzerKey const SFBLoudnessAnalyzerLoudnessRangeKey = @"Loudness Range";
+SFBLoudnessAnalyzerKey const SFBLoudnessAnalyzerMaximumMomentaryLoudnessKey = @"Maximum Momentary Loudness";
+SFBLoudnessAnalyzerKey const SFBLoudnessAnalyzerMaximumShortTermLoudnessKey = @"Maximum Short-Term Loudness";
+SFBLoudnessAnalyzerKey const SFBLoudnessAnalyzerTruePeakKey = @"True Peak";
+
+// The key for results in an SFBAudioAnalysisCache; the version must be incremented when results change
+static NSString * const SFBLoudnessAnalyzerCacheKey = @"org.sbooth.AudioEngine.LoudnessAnalyzer.1";
+
+#define BUFFER_SIZE_FRAMES 4096
+
+@interface SFBLoudnessAnalyzer ()
+{
+@private
+	SFB::Audio::LoudnessMeter _meter;
+	SFB::Audio::TruePeakMeter _truePeakMeter;
+}
+@end
+
+@implementation SFBLoudnessAnalyzer
+
++ (void)load
+{
+	[NSError setUserInfoValueProviderForDomain:SFBLoudnessAnalyzerErrorDomain provider:^id(NSError *err, NSErrorUserInfoKey userInfoKey) {
+		if(userInfoKey == NSLocalizedDescriptionKey) {
+			switch(err.code) {
+				case SFBLoudnessAnalyzerErrorCodeFileFormatNotSupported:
+					return NSLocalizedString(@"The file's format is not supported.", @"");
+				case SFBLoudnessAnalyzerErrorCodeInsufficientSamples:
+					return NSLocalizedString(@"The file does not contain sufficient audio samples for analysis.", @"");
+			}
+		}
+		return nil;
+	}];
+}
+
++ (NSDictionary *)analyzeURL:(NSURL *)url error:(NSError **)error
+{
+	NSParameterAssert(url != nil);
+
+	SFBAudioDecoder *decoder = [[SFBAudioDecoder alloc] initWithURL:url error:error];
+	if(!decoder || ![decoder openReturningError:error])
+		return nil;
+
+	AVAudioFormat *inputFormat = decoder.processingFormat;
+
+	// The channel layout is preserved so multichannel audio may be weighted
+	AVAudioFormat *outputFormat = nil;
+	if(inputFormat.channelLayout)
+		outputFormat = [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat32 sampleRate:inputFormat.sampleRate interleaved:NO channelLayout:inputFormat.channelLayout];
+	else
+		outputFormat = [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat32 sampleRate:inputFormat.sampleRate channels:inputFormat.channelCount interleaved:NO];
+
+	SFBLoudnessAnalyzer *analyzer = outputFormat ? [[SFBLoudnessAnalyzer alloc] initWithFormat:outputFormat] : nil;
+	if(!analyzer || !SFB::Audio::PCMConverter::CanConvert(SFB::Audio::Format(inputFormat.streamDescription), SFB::Audio::Format(outputFormat.streamDescription))) {
+		if(error)
+			*error = [NSError SFB_errorWithDomain:SFBLoudnessAnalyzerErrorDomain
+											 code:SFBLoudnessAnalyzerErrorCodeFileFormatNotSupported
+					descriptionFormatStringForURL:NSLocalizedString(@"The format of the file “%@” is not supported.", @"")
+											  url:url
+									failureReason:NSLocalizedString(@"Unsupported file format", @"")
+							   recoverySuggestion:NSLocalizedString(@"The file's format is not supported for loudness analysis.", @"")];
+		return nil;
+	}
+
+	AVAudioPCMBuffer *decodeBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:inputFormat frameCapacity:BUFFER_SIZE_FRAMES];
+	AVAudioPCMBuffer *outputBuffer = decodeBuffer;
+
+	SFB::Audio::PCMConverter converter;
+	if(![inputFormat isEqual:outputFormat]) {
+		converter.Initialize(SFB::Audio::Format(inputFormat.streamDescription), SFB::Audio::Format(outputFormat.streamDescription));
+		outputBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:outputFormat frameCapacity:BUFFER_SIZE_FRAMES];
+	}
+
+	for(;;) {
+		if(![decoder decodeIntoBuffer:decodeBuffer frameLength:decodeBuffer.frameCapacity error:error])
+			return nil;
+
+		if(decodeBuffer.frameLength == 0)
+			break;
+
+		if(outputBuffer != decodeBuffer) {
+			if(!converter.Convert(decodeBuffer.audioBufferList, outputBuffer.mutableAudioBufferList, decodeBuffer.frameLength)) {
+				os_log_error(OS_LOG_DEFAULT, "Error converting audio to %{public}@", outputFormat);
+				if(error)
+					*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EINVAL userInfo:nil];
+				return nil;
+			}
+			outputBuffer.frameLength = decodeBuffer.frameLength;
+		}
+
+		[analyzer analyzeBuffer:outputBuffer];
+	}
+
+	// At least one 400 ms gating block above the absolute gate is required
+	if(analyzer.integratedLoudness == SFB::Audio::LoudnessMeter::kSilence) {
+		if(error)
+			*error = [NSError SFB_errorWithDomain:SFBLoudnessAnalyzerErrorDomain
+											 code:SFBLoudnessAnalyzerErrorCodeInsufficientSamples
+					descriptionFormatStringForURL:NSLocalizedString(@"The file “%@” does not contain sufficient audio for analysis.", @"")
+											  url:url
+									failureReason:NSLocalizedString(@"Insufficient audio samples", @"")
+							   recoverySuggestion:NSLocalizedString(@"The audio is too short or too quiet for loudness analysis.", @"")];
+		return nil;
+	}
+
+	return analyzer.dictionaryRepresentation;
+}
+
+- (instancetype)init
+{
+	return [super init];
+}
+
+- (instancetype)initWithFormat:(AVAudioFormat *)format
+{
+	NSParameterAssert(format != nil);
+
+	if((self = [self init])) {
+		if(![self prepareToAnalyzeFormat:format error:nil])
+			return nil;
+	}
+	return self;
+}
+
+- (BOOL)prepareToAnalyzeFormat:(AVAudioFormat *)format error:(NSError **)error
+{
+	NSParameterAssert(format != nil);
+
+	if(!format.isStandard) {
+		os_log_error(OS_LOG_DEFAULT, "Unsupported format for loudness analysis: %{public}@", format);
+		if(error)
+			*error = [NSError errorWithDomain:SFBLoudnessAnalyzerErrorDomain code:SFBLoudnessAnalyzerErrorCodeFileFormatNotSupported userInfo:nil];
+		return NO;
+	}
+
+	const std::vector<float> channelWeights = SFB::Audio::LoudnessMeter::ChannelWeightsForLayout(format.channelLayout.layout, format.channelCount);
+	if(!_meter.Initialize(format.channelCount, format.sampleRate, channelWeights.data()) || !_truePeakMeter.Initialize(format.channelCount, format.sampleRate)) {
+		os_log_error(OS_LOG_DEFAULT, "Unable to initialize loudness meter for %{public}@", format);
+		if(error)
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+		return NO;
+	}
+
+	_format = format;
+	return YES;
+}
+
+- (NSDictionary *)finishAnalysisReturningError:(NSError **)error
+{
+	// At least one 400 ms gating block above the absolute gate is required
+	if(_meter.IntegratedLoudness() == SFB::Audio::LoudnessMeter::kSilence) {
+		if(error)
+			*error = [NSError errorWithDomain:SFBLoudnessAnalyzerErrorDomain code:SFBLoudnessAnalyzerErrorCodeInsufficientSamples userInfo:nil];
+		return nil;
+	}
+
+	return self.dictionaryRepresentation;
+}
+
+- (BOOL)isCacheable
+{
+	return YES;
+}
+
+- (NSString *)cacheKey
+{
+	return SFBLoudnessAnalyzerCacheKey;
+}
+
+- (void)analyzeBuffer:(AVAudioPCMBuffer *)buffer
+{
+	NSParameterAssert(buffer != nil);
+	NSParameterAssert(_format != nil);
+	NSParameterAssert([buffer.format isEqual:_format]);
+
+	_meter.Process(buffer.floatChannelData, buffer.frameLength);
+	_truePeakMeter.Process(buffer.floatChannelData, buffer.frameLength);
+}
+
+- (void)reset
+{
+	_meter.Reset();
+	_truePeakMeter.Reset();
+}
+
+- (AVAudioFramePosition)framesAnalyzed
+{
+	return static_cast<AVAudioFramePosition>(_meter.FramesProcessed());
+}
+
+- (double)momentaryLoudness
+{
+	return _meter.MomentaryLoudness();
+}
+
+- (double)shortTermLoudness
+{
+	return _meter.ShortTermLoudness();
+}
+
+- (double)maximumMomentaryLoudness
+{
+	return _meter.MaximumMomentaryLoudness();
+}
+
+- (double)maximumShortTermLoudness
+{
+	return _meter.MaximumShortTermLoudness();
+}
+
+- (double)integratedLoudness
+{
+	return _meter.IntegratedLoudness();
+}
+
+- (double)loudnessRange
+{
+	return _meter.LoudnessRange();
+}
+
+- (double)truePeak
+{
+	return SFB::Audio::TruePeakMeter::Decibels(_truePeakMeter.Peak());
+}
+
+- (NSDictionary *)dictionaryRepresentation
+{
+	return @{
+		SFBLoudnessAnalyzerIntegratedLoudnessKey: @(_meter.IntegratedLoudness()),
+		SFBLoudnessAnalyzerLoudnessRangeKey: @(_meter.LoudnessRange()),
+		SFBLoudnessAnalyzerMaximumMomentaryLoudnessKey: @(_meter.MaximumMomentaryLoudness()),
+		SFBLoudnessAnalyzerMaximumShortTermLoudnessKey: @(_meter.MaximumShortTermLoudness()),
+		SFBLoudnessAnalyzerTruePeakKey: @(self.truePeak),
+	};
+}
+
+@end
@@ -1,10 +1,13 @@
 /*
- * Copyright (c) 2011 - 2020 Stephen F. Booth <me@sbooth.org>
+ * Copyright (c) 2011 - 2021 Stephen F. Booth <me@sbooth.org>
  * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
  */
 
 #import <Foundation/Foundation.h>
 
+#import <SFBAudioEngine/SFBAudioAnalysisCache.h>
+#import <SFBAudioEngine/SFBAudioAnalysisPlugIn.h>
+
 NS_ASSUME_NONNULL_BEGIN
 
 /// A key in a replay gain dictionary
@@ -15,11 +18,22 @@ typedef NSString * SFBReplayGainAnalyzerKey NS_TYPED_ENUM NS_SWIFT_NAME(ReplayGa
 extern SFBReplayGainAnalyzerKey const SFBReplayGainAnalyzerGainKey;
 /// The peak value normalized to [-1, 1) (\c NSNumber)
 extern SFBReplayGainAnalyzerKey const SFBReplayGainAnalyzerPeakKey;
+/// The true peak value as specified in ITU-R BS.1770, normalized so full scale is 1 (\c NSNumber)
+///
+/// The true peak accounts for inter-sample peaks and may exceed both the sample peak and full scale.
+extern SFBReplayGainAnalyzerKey const SFBReplayGainAnalyzerTruePeakKey;
 
 
 /// A class that calculates replay gain
+///
+/// Audio with more than two channels is supported; surround channels are weighted and LFE channels are ignored as
+/// specified in ITU-R BS.1770.
+///
+/// As an \c SFBAudioAnalysisPlugIn the analyzer returns the same dictionary as \c -analyzeTrack:error: and accumulates
+/// album state, so one analyzer may be used with a pipeline for every track of an album. A track whose analysis is
+/// abandoned does not contribute to album state.
 /// @see http://wiki.hydrogenaudio.org/index.php?title=ReplayGain_specification
-NS_SWIFT_NAME(ReplayGainAnalyzer) @interface SFBReplayGainAnalyzer : NSObject
+NS_SWIFT_NAME(ReplayGainAnalyzer) @interface SFBReplayGainAnalyzer : NSObject <SFBAudioAnalysisPlugIn>
 
 /// The reference loudness in dB SPL, defined as 89.0 dB
 @property (class, nonatomic, readonly) float referenceLoudness;
@@ -34,16 +48,43 @@ NS_SWIFT_NAME(ReplayGainAnalyzer) @interface SFBReplayGainAnalyzer : NSObject
 /// @return A dictionary of gain and peak information, or \c nil on error
 + (nullable NSDictionary *)analyzeAlbum:(NSArray<NSURL *> *)urls error:(NSError **)error NS_REFINED_FOR_SWIFT;
 
+/// Analyze the given album's replay gain, optionally analyzing multiple tracks simultaneously
+///
+/// When \c concurrently is \c YES each track is analyzed on a separate thread and the per-track results are merged
+/// once analysis completes. The results are identical to those of sequential analysis.
+/// @param urls The URLs to analyze
+/// @param concurrently Whether tracks should be analyzed simultaneously
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return A dictionary of gain and peak information, or \c nil on error
++ (nullable NSDictionary *)analyzeAlbum:(NSArray<NSURL *> *)urls concurrently:(BOOL)concurrently error:(NSError **)error NS_REFINED_FOR_SWIFT;
+
+/// Analyze the given album's replay gain, using cached results for tracks that have not changed
+///
+/// The results are identical to those of \c +analyzeAlbum:concurrently:error: but only uncached tracks are decoded
+/// @param urls The URLs to analyze
+/// @param concurrently Whether tracks should be analyzed simultaneously
+/// @param cache An optional cache of track results
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return A dictionary of gain and peak information, or \c nil on error
++ (nullable NSDictionary *)analyzeAlbum:(NSArray<NSURL *> *)urls concurrently:(BOOL)concurrently cache:(nullable SFBAudioAnalysisCache *)cache error:(NSError **)error NS_REFINED_FOR_SWIFT;
+
+/// An optional cache of track results
+///
+/// When set, \c -analyzeTrack:error: returns stored results for tracks that have not changed instead of decoding them,
+/// and stores the results of tracks it analyzes. The state needed for album gain is stored with each track's results,
+/// so album gain is the same whether or not tracks are cached. To analyze a track anew remove its results from the cache.
+@property (nonatomic, nullable) SFBAudioAnalysisCache *cache;
+
 /// Analyze the given URL's replay gain
 ///
 /// If the URL's sample rate is not natively supported, the replay gain adjustment will be calculated using audio
 /// resampled to an even multiple sample rate
 /// @param url The URL to analyze
 /// @param error An optional pointer to an \c NSError object to receive error information
-/// @return A dictionary containing the track gain in dB (\c SFBReplayGainAnalyzerGainKey) and peak sample value normalized to [-1, 1) (\c SFBReplayGainAnalyzerPeakKey), or \c nil on error
+/// @return A dictionary containing the track gain in dB (\c SFBReplayGainAnalyzerGainKey), peak sample value normalized to [-1, 1) (\c SFBReplayGainAnalyzerPeakKey), and true peak (\c SFBReplayGainAnalyzerTruePeakKey), or \c nil on error
 - (nullable NSDictionary<SFBReplayGainAnalyzerKey, NSNumber *> *)analyzeTrack:(NSURL *)url error:(NSError **)error NS_REFINED_FOR_SWIFT;
 
-/// Returns the album gain in dB (\c SFBReplayGainAnalyzerGainKey) and peak sample value normalized to [-1, 1) (\c SFBReplayGainAnalyzerPeakKey), or \c nil on error
+/// Returns the album gain in dB (\c SFBReplayGainAnalyzerGainKey), peak sample value normalized to [-1, 1) (\c SFBReplayGainAnalyzerPeakKey), and true peak (\c SFBReplayGainAnalyzerTruePeakKey), or \c nil on error
 - (nullable NSDictionary<SFBReplayGainAnalyzerKey, NSNumber *> *)albumGainAndPeakSampleReturningError:(NSError **)error NS_REFINED_FOR_SWIFT;
 
 @end
@@ -57,6 +98,8 @@ typedef NS_ERROR_ENUM(SFBReplayGainAnalyzerErrorDomain, SFBReplayGainAnalyzerErr
 	SFBReplayGainAnalyzerErrorCodeFileFormatNotSupported		= 0,
 	/// Insufficient samples in file for analysis
 	SFBReplayGainAnalyzerErrorCodeInsufficientSamples			= 1,
+	/// Analysis failed without providing an error
+	SFBReplayGainAnalyzerErrorCodeAnalysisFailed				= 2,
 } NS_SWIFT_NAME(ReplayGainAnalyzer.ErrorCode);
 
 NS_ASSUME_NONNULL_END
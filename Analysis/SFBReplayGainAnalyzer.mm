@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2011 - 2020 Stephen F. Booth <me@sbooth.org>
+ * Copyright (c) 2011 - 2021 Stephen F. Booth <me@sbooth.org>
  * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
  */
 
@@ -80,26 +80,25 @@
  */
 
 /*
- *  So here's the main source of potential code confusion:
- *
- *  The filters applied to the incoming samples are IIR filters,
- *  meaning they rely on up to <filter order> number of previous samples
- *  AND up to <filter order> number of previous filtered samples.
- *
- *  I set up the AnalyzeSamples routine to minimize memory usage and interface
- *  complexity. The speed isn't compromised too much (I don't think), but the
- *  internal complexity is higher than it should be for such a relatively
- *  simple routine.
- *
- *  Optimization/clarity suggestions are welcome.
+ *  The equal loudness filters are applied to all channels at once by
+ *  SFB::Audio::IIRFilter, which keeps the state of each channel in its own
+ *  vector lane. Channels beyond stereo are weighted as in ITU-R BS.1770
+ *  before their mean square values are combined.
  */
 
-@import os.log;
+#import <vector>
+
+#import <os/lock.h>
+#import <os/log.h>
 
-@import Accelerate;
+#import <Accelerate/Accelerate.h>
 
 #import "SFBReplayGainAnalyzer.h"
 
+#import "AudioIIRFilter.h"
+#import "AudioLoudnessMeter.h"
+#import "AudioPCMConverter.h"
+#import "AudioTruePeakMeter.h"
 #import "NSError+SFBURLPresentation.h"
 #import "SFBAudioDecoder+Internal.h"
 
@@ -109,6 +108,12 @@ NSErrorDomain const SFBReplayGainAnalyzerErrorDomain = @"org.sbooth.AudioEngine.
 // Key names for the metadata dictionary
 NSString * const SFBReplayGainAnalyzerGainKey = @"Gain";
 NSString * const SFBReplayGainAnalyzerPeakKey = @"Peak";
+NSString * const SFBReplayGainAnalyzerTruePeakKey = @"True Peak";
+
+// The key for track results in an SFBAudioAnalysisCache; the version must be incremented when results change
+static NSString * const SFBReplayGainAnalyzerCacheKey = @"org.sbooth.AudioEngine.ReplayGainAnalyzer.1";
+// The key for a track's encoded loudness histogram in cached results
+static NSString * const SFBReplayGainAnalyzerHistogramKey = @"Histogram";
 
 #define BUFFER_SIZE_FRAMES 2048
 
@@ -120,7 +125,6 @@ NSString * const SFBReplayGainAnalyzerPeakKey = @"Peak";
 #define STEPS_per_dB				100.		/* Table entries per dB */
 #define MAX_dB						120.		/* Table entries for 0...MAX_dB (normal max. values are 70...80 dB) */
 
-#define MAX_ORDER					(BUTTER_ORDER > YULE_ORDER ? BUTTER_ORDER : YULE_ORDER)
 #define PINK_REF					64.82		/* 298640883795 */						/* calibration value */
 
 
@@ -249,27 +253,18 @@ static const struct ReplayGainFilter sReplayGainFilters [] = {
 
 #pragma clang diagnostic pop
 
-/* When calling this procedure, make sure that ip[-order] and op[-order] point to real data! */
-
-static void Filter(const float *input, float *output, size_t nSamples, const float *a, const float *b, size_t order, uint32_t downsample)
-{
-	const float *input_head = input;
-	float *output_head = output;
+namespace {
 
-	for(size_t i = 0; i < nSamples; i++, input_head += downsample, ++output_head) {
-		const float *input_tail = input_head;
-		float *output_tail = output_head;
-
-		double y = *input_head * b[0];
-
-		for(size_t k = 1; k <= order; k++) {
-			input_tail -= downsample;
-			--output_tail;
-			y += *input_tail * b[k] - *output_tail * a[k];
-		}
+	/// Returns the weights applied to the mean square of each channel of audio in \c format
+	std::vector<float> ChannelWeightsForFormat(AVAudioFormat *format)
+	{
+		// Mono audio is analyzed as identical left and right channels
+		if(format.channelCount == 1)
+			return { 2 };
 
-		output[i] = (float)y;
+		return SFB::Audio::LoudnessMeter::ChannelWeightsForLayout(format.channelLayout.layout, format.channelCount);
 	}
+
 }
 
 static float AnalyzeResult(uint32_t *array, size_t len)
@@ -294,22 +289,13 @@ static float AnalyzeResult(uint32_t *array, size_t len)
 @interface SFBReplayGainAnalyzer ()
 {
 @private
-	float			_linprebuf	[MAX_ORDER * 2];
-	float			*_linpre;											/* left input samples, with pre-buffer */
-	float			*_lstepbuf;
-	float			*_lstep;											/* left "first step" (i.e. post first filter) samples */
-	float			*_loutbuf;
-	float			*_lout;												/* left "out" (i.e. post second filter) samples */
-	float			_rinprebuf	[MAX_ORDER * 2];
-	float			*_rinpre;											/* right input samples ... */
-	float			*_rstepbuf;
-	float			*_rstep;
-	float			*_routbuf;
-	float			*_rout;
+	SFB::Audio::IIRFilter	_equalLoudnessFilter;						/* Yule-Walker followed by Butterworth, applied to all channels */
+	std::vector<float>		_channelWeights;							/* weight applied to each channel's mean square */
+	std::vector<float>		_channelPeaks;								/* largest sample magnitude in each channel */
+	SFB::Audio::TruePeakMeter	_truePeakMeter;							/* oversampled peak of all channels */
 	uint32_t		_sampleWindow;										/* number of samples required to reach number of milliseconds required for RMS window */
-	uint64_t		_totsamp;
-	double			_lsum;
-	double			_rsum;
+	uint32_t		_totsamp;
+	double			_sum;												/* weighted sum of squares for the current window */
 	uint32_t		_A			[(size_t)(STEPS_per_dB * MAX_dB)];
 	uint32_t		_B			[(size_t)(STEPS_per_dB * MAX_dB)];
 
@@ -317,6 +303,11 @@ static float AnalyzeResult(uint32_t *array, size_t len)
 
 	float			_trackPeak;
 	float			_albumPeak;
+	float			_trackTruePeak;
+	float			_albumTruePeak;
+
+	AVAudioConverter	*_plugInConverter;								/* resamples audio from the pipeline when the sample rate is unsupported */
+	AVAudioPCMBuffer	*_plugInBuffer;									/* filtered or resampled audio from the pipeline */
 }
 
 @property (class, nonatomic, readonly)  NSInteger maximumSupportedSampleRate;
@@ -327,8 +318,13 @@ static float AnalyzeResult(uint32_t *array, size_t len)
 + (NSInteger)bestReplayGainSampleRateForSampleRate:(NSInteger)sampleRate;
 
 - (void)resetState;
-- (void)setupForAnalysisAtSampleRate:(NSInteger)sampleRate;
-- (BOOL)analyzeLeftSamples:(const float *)leftSamples rightSamples:(const float *)rightSamples sampleCount:(size_t)sampleCount isStereo:(BOOL)stereo;
+- (nullable AVAudioFormat *)analysisFormatForFormat:(AVAudioFormat *)format downsample:(uint32_t *)downsample;
+- (void)setupForAnalysisOfFormat:(AVAudioFormat *)format downsample:(uint32_t)downsample;
+- (void)analyzeAudio:(const float * const *)input frameLength:(AVAudioFrameCount)frameLength filteringInto:(float * const *)output;
+- (nullable NSDictionary *)finishTrackAnalysisForURL:(nullable NSURL *)url error:(NSError **)error;
+- (void)accumulateAlbumStateFromAnalyzer:(SFBReplayGainAnalyzer *)analyzer;
+- (NSData *)encodedTrackHistogram;
+- (nullable NSDictionary *)trackGainAndPeakSampleFromCachedResults:(NSDictionary *)results;
 @end
 
 @implementation SFBReplayGainAnalyzer
@@ -342,6 +338,8 @@ static float AnalyzeResult(uint32_t *array, size_t len)
 					return NSLocalizedString(@"The file's format is not supported.", @"");
 				case SFBReplayGainAnalyzerErrorCodeInsufficientSamples:
 					return NSLocalizedString(@"The file does not contain sufficient audio samples for analysis.", @"");
+				case SFBReplayGainAnalyzerErrorCodeAnalysisFailed:
+					return NSLocalizedString(@"The file could not be analyzed.", @"");
 			}
 		}
 		return nil;
@@ -354,15 +352,65 @@ static float AnalyzeResult(uint32_t *array, size_t len)
 }
 
 + (NSDictionary *)analyzeAlbum:(NSArray<NSURL *> *)urls error:(NSError **)error
+{
+	return [SFBReplayGainAnalyzer analyzeAlbum:urls concurrently:NO error:error];
+}
+
++ (NSDictionary *)analyzeAlbum:(NSArray<NSURL *> *)urls concurrently:(BOOL)concurrently error:(NSError **)error
+{
+	return [SFBReplayGainAnalyzer analyzeAlbum:urls concurrently:concurrently cache:nil error:error];
+}
+
++ (NSDictionary *)analyzeAlbum:(NSArray<NSURL *> *)urls concurrently:(BOOL)concurrently cache:(SFBAudioAnalysisCache *)cache error:(NSError **)error
 {
 	NSMutableDictionary *result = [NSMutableDictionary dictionary];
 
 	SFBReplayGainAnalyzer *analyzer = [[SFBReplayGainAnalyzer alloc] init];
-	for(NSURL *url in urls) {
-		NSDictionary *replayGain = [analyzer analyzeTrack:url error:error];
-		if(!replayGain)
-			return nil;
-		result[url] = replayGain;
+	analyzer.cache = cache;
+
+	if(!concurrently) {
+		for(NSURL *url in urls) {
+			NSDictionary *replayGain = [analyzer analyzeTrack:url error:error];
+			if(!replayGain)
+				return nil;
+			result[url] = replayGain;
+		}
+	}
+	else {
+		// Each track is analyzed by a private analyzer whose album histogram and peak are accumulated
+		// into the shared analyzer as tracks complete. Since the histograms hold integer counts and the peak is a
+		// maximum the order in which tracks finish does not affect the results.
+		NSMutableArray *trackResults = [NSMutableArray arrayWithCapacity:urls.count];
+		for(NSUInteger i = 0; i < urls.count; ++i)
+			[trackResults addObject:[NSNull null]];
+
+		__block os_unfair_lock lock = OS_UNFAIR_LOCK_INIT;
+		dispatch_apply(urls.count, dispatch_get_global_queue(qos_class_self(), 0), ^(size_t i) {
+			SFBReplayGainAnalyzer *trackAnalyzer = [[SFBReplayGainAnalyzer alloc] init];
+			trackAnalyzer.cache = cache;
+			NSError *err = nil;
+			NSDictionary *replayGain = [trackAnalyzer analyzeTrack:urls[i] error:&err];
+
+			os_unfair_lock_lock(&lock);
+			if(replayGain) {
+				trackResults[i] = replayGain;
+				[analyzer accumulateAlbumStateFromAnalyzer:trackAnalyzer];
+			}
+			else
+				trackResults[i] = err ?: [NSError errorWithDomain:SFBReplayGainAnalyzerErrorDomain code:SFBReplayGainAnalyzerErrorCodeAnalysisFailed userInfo:nil];
+			os_unfair_lock_unlock(&lock);
+		});
+
+		// Report the first failure in album order, matching sequential analysis
+		for(NSUInteger i = 0; i < urls.count; ++i) {
+			id trackResult = trackResults[i];
+			if([trackResult isKindOfClass:[NSError class]]) {
+				if(error)
+					*error = trackResult;
+				return nil;
+			}
+			result[urls[i]] = trackResult;
+		}
 	}
 
 	NSDictionary *albumGainAndPeakSample = [analyzer albumGainAndPeakSampleReturningError:error];
@@ -378,31 +426,30 @@ static float AnalyzeResult(uint32_t *array, size_t len)
 	if((self = [super init])) {
 		_trackPeak = -FLT_MAX;
 		_albumPeak = -FLT_MAX;
-		_linpre = _linprebuf + MAX_ORDER;
-		_rinpre = _rinprebuf + MAX_ORDER;
+		_trackTruePeak = -FLT_MAX;
+		_albumTruePeak = -FLT_MAX;
 	}
 	return self;
 }
 
-- (void)dealloc
-{
-	free(_lstepbuf);
-	free(_rstepbuf);
-	free(_loutbuf);
-	free(_routbuf);
-}
-
 - (NSDictionary *)analyzeTrack:(NSURL *)url error:(NSError **)error
 {
 	NSParameterAssert(url != nil);
 
+	if(_cache) {
+		NSDictionary *cachedResults = [_cache resultsForURL:url key:SFBReplayGainAnalyzerCacheKey];
+		NSDictionary *replayGain = cachedResults ? [self trackGainAndPeakSampleFromCachedResults:cachedResults] : nil;
+		if(replayGain)
+			return replayGain;
+	}
+
 	SFBAudioDecoder *decoder = [[SFBAudioDecoder alloc] initWithURL:url error:error];
 	if(!decoder || ![decoder openReturningError:error])
 		return nil;
 
 	const AudioStreamBasicDescription *inputFormat = decoder.processingFormat.streamDescription;
 
-	// Higher sampling rates aren't natively supported but are handled via resampling
+	// Higher sampling rates aren't natively supported but are handled via decimation or resampling
 	NSInteger decoderSampleRate = (NSInteger)inputFormat->mSampleRate;
 
 	bool validSampleRate = [SFBReplayGainAnalyzer evenMultipleSampleRateIsSupported:decoderSampleRate];
@@ -417,23 +464,45 @@ static float AnalyzeResult(uint32_t *array, size_t len)
 		return nil;
 	}
 
-	NSInteger replayGainSampleRate = [SFBReplayGainAnalyzer bestReplayGainSampleRateForSampleRate:decoderSampleRate];
+	uint32_t downsample = 1;
+	AVAudioFormat *outputFormat = [self analysisFormatForFormat:decoder.processingFormat downsample:&downsample];
 
-	if(!(inputFormat->mChannelsPerFrame == 1 || inputFormat->mChannelsPerFrame == 2)) {
-		if(error)
-			*error = [NSError SFB_errorWithDomain:SFBReplayGainAnalyzerErrorDomain
-											 code:SFBReplayGainAnalyzerErrorCodeFileFormatNotSupported
-					descriptionFormatStringForURL:NSLocalizedString(@"The file “%@” does not contain mono or stereo audio.", @"")
-											  url:url
-									failureReason:NSLocalizedString(@"Unsupported number of channels", @"")
-							   recoverySuggestion:NSLocalizedString(@"Only mono and stereo files supported.", @"")];
-		return nil;
-	}
+	// Will NSAssert() if an invalid sample rate is passed
+	[self setupForAnalysisOfFormat:outputFormat downsample:downsample];
 
-	AVAudioFormat *outputFormat = [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat32 sampleRate:replayGainSampleRate channels:inputFormat->mChannelsPerFrame interleaved:NO];
+	// Audio that doesn't require resampling is converted natively
+	if(inputFormat->mSampleRate == outputFormat.sampleRate && SFB::Audio::PCMConverter::CanConvert(SFB::Audio::Format(inputFormat), SFB::Audio::Format(outputFormat.streamDescription))) {
+		AVAudioPCMBuffer *decodeBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:decoder.processingFormat frameCapacity:BUFFER_SIZE_FRAMES * downsample];
+		AVAudioPCMBuffer *outputBuffer = decodeBuffer;
 
-	// Will NSAssert() if an invalid sample rate is passed
-	[self setupForAnalysisAtSampleRate:replayGainSampleRate];
+		SFB::Audio::PCMConverter converter;
+		if(![decoder.processingFormat isEqual:outputFormat]) {
+			converter.Initialize(SFB::Audio::Format(inputFormat), SFB::Audio::Format(outputFormat.streamDescription));
+			outputBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:outputFormat frameCapacity:decodeBuffer.frameCapacity];
+		}
+
+		for(;;) {
+			if(![decoder decodeIntoBuffer:decodeBuffer frameLength:decodeBuffer.frameCapacity error:error])
+				return nil;
+
+			if(decodeBuffer.frameLength == 0)
+				break;
+
+			if(outputBuffer != decodeBuffer) {
+				if(!converter.Convert(decodeBuffer.audioBufferList, outputBuffer.mutableAudioBufferList, decodeBuffer.frameLength)) {
+					os_log_error(OS_LOG_DEFAULT, "Error converting audio to %{public}@", outputFormat);
+					if(error)
+						*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EINVAL userInfo:nil];
+					return nil;
+				}
+				outputBuffer.frameLength = decodeBuffer.frameLength;
+			}
+
+			[self analyzeAudio:outputBuffer.floatChannelData frameLength:outputBuffer.frameLength filteringInto:outputBuffer.floatChannelData];
+		}
+
+		return [self finishTrackAnalysisForURL:url error:error];
+	}
 
 	AVAudioConverter *converter = [[AVAudioConverter alloc] initFromFormat:decoder.processingFormat toFormat:outputFormat];
 	if(!converter) {
@@ -450,8 +519,6 @@ static float AnalyzeResult(uint32_t *array, size_t len)
 	AVAudioPCMBuffer *outputBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:converter.outputFormat frameCapacity:BUFFER_SIZE_FRAMES];
 	AVAudioPCMBuffer *decodeBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:converter.inputFormat frameCapacity:BUFFER_SIZE_FRAMES];
 
-	bool isStereo = (outputFormat.channelCount == 2);
-
 	for(;;) {
 		__block NSError *err = nil;
 		AVAudioConverterOutputStatus status = [converter convertToBuffer:outputBuffer error:error withInputFromBlock:^AVAudioBuffer * _Nullable(AVAudioPacketCount inNumberOfPackets, AVAudioConverterInputStatus * _Nonnull outStatus) {
@@ -475,34 +542,181 @@ static float AnalyzeResult(uint32_t *array, size_t len)
 		else if(status == AVAudioConverterOutputStatus_EndOfStream)
 			break;
 
-		AVAudioFrameCount frameCount = outputBuffer.frameLength;
+		[self analyzeAudio:outputBuffer.floatChannelData frameLength:outputBuffer.frameLength filteringInto:outputBuffer.floatChannelData];
+	}
+
+	return [self finishTrackAnalysisForURL:url error:error];
+}
+
+- (NSDictionary *)albumGainAndPeakSampleReturningError:(NSError **)error
+{
+	float gain = AnalyzeResult(_B, sizeof(_B) / sizeof(*_B));
+
+	float peak = _albumPeak;
+	_albumPeak = 0;
+
+	float truePeak = _albumTruePeak;
+	_albumTruePeak = 0;
+
+	if(gain == SFBReplayGainAnalyzerInsufficientSamples) {
+		if(error)
+			*error = [NSError errorWithDomain:SFBReplayGainAnalyzerErrorDomain
+										 code:SFBReplayGainAnalyzerErrorCodeInsufficientSamples
+									 userInfo:@{
+										 NSLocalizedDescriptionKey: NSLocalizedString(@"The files do not contain sufficient audio for analysis.", @""),
+										 NSLocalizedFailureReasonErrorKey:NSLocalizedString(@"Insufficient audio samples", @""),
+										 NSLocalizedRecoverySuggestionErrorKey:NSLocalizedString(@"The audio is too short for replay gain analysis.", @"")}];
+		return nil;
+	}
+
+	return @{ SFBReplayGainAnalyzerGainKey: @(gain), SFBReplayGainAnalyzerPeakKey: @(peak), SFBReplayGainAnalyzerTruePeakKey: @(truePeak) };
+}
+
+#pragma mark SFBAudioAnalysisPlugIn
+
+- (BOOL)prepareToAnalyzeFormat:(AVAudioFormat *)format error:(NSError **)error
+{
+	NSParameterAssert(format != nil);
+	NSParameterAssert(format.isStandard);
 
-		// Find the peak sample magnitude
-		float lpeak;
-		vDSP_maxmgv(outputBuffer.floatChannelData[0], 1, &lpeak, (vDSP_Length)frameCount);
-		_trackPeak = MAX(_trackPeak, lpeak);
-		if(isStereo) {
-			float rpeak;
-			vDSP_maxmgv(outputBuffer.floatChannelData[1], 1, &rpeak, (vDSP_Length)frameCount);
-			_trackPeak = MAX(_trackPeak, rpeak);
+	uint32_t downsample = 1;
+	AVAudioFormat *analysisFormat = [self analysisFormatForFormat:format downsample:&downsample];
+	if(!analysisFormat) {
+		if(error)
+			*error = [NSError errorWithDomain:SFBReplayGainAnalyzerErrorDomain
+										 code:SFBReplayGainAnalyzerErrorCodeFileFormatNotSupported
+									 userInfo:@{
+										 NSLocalizedDescriptionKey: NSLocalizedString(@"The audio is not at a supported sample rate.", @""),
+										 NSLocalizedFailureReasonErrorKey:NSLocalizedString(@"Unsupported sample rate", @""),
+										 NSLocalizedRecoverySuggestionErrorKey:NSLocalizedString(@"Only sample rates of 8.0 KHz, 11.025 KHz, 12.0 KHz, 16.0 KHz, 22.05 KHz, 24.0 KHz, 32.0 KHz, 44.1 KHz, 48 KHz and multiples are supported.", @"")}];
+		return NO;
+	}
+
+	_plugInConverter = nil;
+	if(analysisFormat.sampleRate != format.sampleRate) {
+		_plugInConverter = [[AVAudioConverter alloc] initFromFormat:format toFormat:analysisFormat];
+		if(!_plugInConverter) {
+			os_log_error(OS_LOG_DEFAULT, "Error creating AVAudioConverter converting from %{public}@ to %{public}@", format, analysisFormat);
+			if(error)
+				*error = [NSError errorWithDomain:SFBReplayGainAnalyzerErrorDomain code:SFBReplayGainAnalyzerErrorCodeFileFormatNotSupported userInfo:nil];
+			return NO;
 		}
+	}
+
+	_plugInBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:analysisFormat frameCapacity:BUFFER_SIZE_FRAMES];
+
+	// Will NSAssert() if an invalid sample rate is passed
+	[self setupForAnalysisOfFormat:analysisFormat downsample:downsample];
+
+	return YES;
+}
 
-		// The replay gain analyzer expects 16-bit sample size passed as floats
-		const float scale = 1u << 15;
-		vDSP_vsmul(outputBuffer.floatChannelData[0], 1, &scale, outputBuffer.floatChannelData[0], 1, (vDSP_Length)frameCount);
-		if(isStereo) {
-			vDSP_vsmul(outputBuffer.floatChannelData[1], 1, &scale, outputBuffer.floatChannelData[1], 1, (vDSP_Length)frameCount);
-			[self analyzeLeftSamples:outputBuffer.floatChannelData[0] rightSamples:outputBuffer.floatChannelData[1] sampleCount:(size_t)frameCount isStereo:YES];
+- (void)analyzeBuffer:(AVAudioPCMBuffer *)buffer
+{
+	NSParameterAssert(buffer != nil);
+	NSParameterAssert(_plugInBuffer != nil);
+
+	// The shared buffer is filtered into a private buffer instead of in place
+	if(!_plugInConverter) {
+		if(_plugInBuffer.frameCapacity < buffer.frameLength)
+			_plugInBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:_plugInBuffer.format frameCapacity:buffer.frameLength];
+		[self analyzeAudio:buffer.floatChannelData frameLength:buffer.frameLength filteringInto:_plugInBuffer.floatChannelData];
+		return;
+	}
+
+	// Resample until the converter has consumed all of buffer
+	__block AVAudioPCMBuffer *input = buffer;
+	for(;;) {
+		NSError *error = nil;
+		AVAudioConverterOutputStatus status = [_plugInConverter convertToBuffer:_plugInBuffer error:&error withInputFromBlock:^AVAudioBuffer * _Nullable(AVAudioPacketCount inNumberOfPackets, AVAudioConverterInputStatus * _Nonnull outStatus) {
+#pragma unused(inNumberOfPackets)
+			if(!input) {
+				*outStatus = AVAudioConverterInputStatus_NoDataNow;
+				return nil;
+			}
+
+			*outStatus = AVAudioConverterInputStatus_HaveData;
+			AVAudioPCMBuffer *result = input;
+			input = nil;
+			return result;
+		}];
+
+		if(status == AVAudioConverterOutputStatus_Error) {
+			os_log_error(OS_LOG_DEFAULT, "Error resampling audio: %{public}@", error);
+			return;
 		}
-		else
-			[self analyzeLeftSamples:outputBuffer.floatChannelData[0] rightSamples:NULL sampleCount:(size_t)frameCount isStereo:NO];
+
+		[self analyzeAudio:_plugInBuffer.floatChannelData frameLength:_plugInBuffer.frameLength filteringInto:_plugInBuffer.floatChannelData];
+
+		if(status != AVAudioConverterOutputStatus_HaveData)
+			break;
 	}
+}
+
+- (NSDictionary *)finishAnalysisReturningError:(NSError **)error
+{
+	// Drain the resampler
+	if(_plugInConverter) {
+		for(;;) {
+			NSError *err = nil;
+			AVAudioConverterOutputStatus status = [_plugInConverter convertToBuffer:_plugInBuffer error:&err withInputFromBlock:^AVAudioBuffer * _Nullable(AVAudioPacketCount inNumberOfPackets, AVAudioConverterInputStatus * _Nonnull outStatus) {
+#pragma unused(inNumberOfPackets)
+				*outStatus = AVAudioConverterInputStatus_EndOfStream;
+				return nil;
+			}];
+
+			if(status == AVAudioConverterOutputStatus_Error) {
+				os_log_error(OS_LOG_DEFAULT, "Error resampling audio: %{public}@", err);
+				break;
+			}
+
+			[self analyzeAudio:_plugInBuffer.floatChannelData frameLength:_plugInBuffer.frameLength filteringInto:_plugInBuffer.floatChannelData];
+
+			if(status != AVAudioConverterOutputStatus_HaveData)
+				break;
+		}
+	}
+
+	_plugInConverter = nil;
+	_plugInBuffer = nil;
+
+	return [self finishTrackAnalysisForURL:nil error:error];
+}
+
+- (void)abandonAnalysis
+{
+	_plugInConverter = nil;
+	_plugInBuffer = nil;
+
+	// The partial track is discarded without contributing to the album
+	memset(_A, 0, sizeof(_A));
+	_channelPeaks.assign(_channelPeaks.size(), 0);
+	[self resetState];
+
+	_trackPeak = 0;
+	_trackTruePeak = 0;
+}
+
+#pragma mark Internal
+
+- (NSDictionary *)finishTrackAnalysisForURL:(NSURL *)url error:(NSError **)error
+{
+	for(float channelPeak : _channelPeaks)
+		_trackPeak = MAX(_trackPeak, channelPeak);
 
 	_albumPeak = MAX(_albumPeak, _trackPeak);
 
+	_trackTruePeak = MAX(_trackTruePeak, _truePeakMeter.Peak());
+	_albumTruePeak = MAX(_albumTruePeak, _trackTruePeak);
+
 	// Calculate track RG
 	float gain = AnalyzeResult(_A, sizeof(_A) / sizeof(*_A));
 
+	// Only results for a URL are cached, and the histogram is saved so a cached track contributes to album gain
+	NSData *histogram = nil;
+	if(url && _cache && gain != SFBReplayGainAnalyzerInsufficientSamples)
+		histogram = [self encodedTrackHistogram];
+
 	for(uint32_t i = 0; i < sizeof(_A) / sizeof(*_A); ++i) {
 		_B[i] += _A[i];
 		_A[i]  = 0;
@@ -513,42 +727,79 @@ static float AnalyzeResult(uint32_t *array, size_t len)
 	float peak = _trackPeak;
 	_trackPeak = 0;
 
+	float truePeak = _trackTruePeak;
+	_trackTruePeak = 0;
+
 	if(gain == SFBReplayGainAnalyzerInsufficientSamples) {
-		if(error)
+		if(error && url)
 			*error = [NSError SFB_errorWithDomain:SFBReplayGainAnalyzerErrorDomain
 											 code:SFBReplayGainAnalyzerErrorCodeFileFormatNotSupported
 					descriptionFormatStringForURL:NSLocalizedString(@"The file “%@” does not contain sufficient audio for analysis.", @"")
 											  url:url
 									failureReason:NSLocalizedString(@"Insufficient audio samples", @"")
 							   recoverySuggestion:NSLocalizedString(@"The audio is too short for replay gain analysis.", @"")];
+		else if(error)
+			*error = [NSError errorWithDomain:SFBReplayGainAnalyzerErrorDomain
+										 code:SFBReplayGainAnalyzerErrorCodeInsufficientSamples
+									 userInfo:@{
+										 NSLocalizedDescriptionKey: NSLocalizedString(@"The audio does not contain sufficient samples for analysis.", @""),
+										 NSLocalizedFailureReasonErrorKey:NSLocalizedString(@"Insufficient audio samples", @""),
+										 NSLocalizedRecoverySuggestionErrorKey:NSLocalizedString(@"The audio is too short for replay gain analysis.", @"")}];
 		return nil;
 	}
 
-	return @{ SFBReplayGainAnalyzerGainKey: @(gain), SFBReplayGainAnalyzerPeakKey: @(peak) };
+	NSDictionary *replayGain = @{ SFBReplayGainAnalyzerGainKey: @(gain), SFBReplayGainAnalyzerPeakKey: @(peak), SFBReplayGainAnalyzerTruePeakKey: @(truePeak) };
+
+	if(histogram) {
+		NSMutableDictionary *cachedResults = [replayGain mutableCopy];
+		cachedResults[SFBReplayGainAnalyzerHistogramKey] = histogram;
+		NSError *err = nil;
+		if(![_cache setResults:cachedResults forURL:url key:SFBReplayGainAnalyzerCacheKey error:&err])
+			os_log_error(OS_LOG_DEFAULT, "Error caching replay gain for %{public}@: %{public}@", url, err);
+	}
+
+	return replayGain;
 }
 
-- (NSDictionary *)albumGainAndPeakSampleReturningError:(NSError **)error
+- (NSData *)encodedTrackHistogram
 {
-	float gain = AnalyzeResult(_B, sizeof(_B) / sizeof(*_B));
+	// Most of the histogram is empty so only occupied entries are stored, as little-endian (index, count) pairs
+	NSMutableData *data = [NSMutableData data];
+	for(uint32_t i = 0; i < sizeof(_A) / sizeof(*_A); ++i) {
+		if(_A[i]) {
+			const uint32_t entry [2] = { OSSwapHostToLittleInt32(i), OSSwapHostToLittleInt32(_A[i]) };
+			[data appendBytes:entry length:sizeof entry];
+		}
+	}
+	return data;
+}
 
-	float peak = _albumPeak;
-	_albumPeak = 0;
+- (NSDictionary *)trackGainAndPeakSampleFromCachedResults:(NSDictionary *)results
+{
+	NSParameterAssert(results != nil);
 
-	if(gain == SFBReplayGainAnalyzerInsufficientSamples) {
-		if(error)
-			*error = [NSError errorWithDomain:SFBReplayGainAnalyzerErrorDomain
-										 code:SFBReplayGainAnalyzerErrorCodeInsufficientSamples
-									 userInfo:@{
-										 NSLocalizedDescriptionKey: NSLocalizedString(@"The files do not contain sufficient audio for analysis.", @""),
-										 NSLocalizedFailureReasonErrorKey:NSLocalizedString(@"Insufficient audio samples", @""),
-										 NSLocalizedRecoverySuggestionErrorKey:NSLocalizedString(@"The audio is too short for replay gain analysis.", @"")}];
+	NSNumber *gain = results[SFBReplayGainAnalyzerGainKey];
+	NSNumber *peak = results[SFBReplayGainAnalyzerPeakKey];
+	NSNumber *truePeak = results[SFBReplayGainAnalyzerTruePeakKey];
+	NSData *histogram = results[SFBReplayGainAnalyzerHistogramKey];
+	if(![gain isKindOfClass:[NSNumber class]] || ![peak isKindOfClass:[NSNumber class]] || ![truePeak isKindOfClass:[NSNumber class]] || ![histogram isKindOfClass:[NSData class]] || histogram.length % (2 * sizeof(uint32_t)))
 		return nil;
+
+	const uint32_t *entries = static_cast<const uint32_t *>(histogram.bytes);
+	const NSUInteger entryCount = histogram.length / (2 * sizeof(uint32_t));
+	for(NSUInteger i = 0; i < entryCount; ++i) {
+		if(OSSwapLittleToHostInt32(entries[2 * i]) >= sizeof(_B) / sizeof(*_B))
+			return nil;
 	}
 
-	return @{ SFBReplayGainAnalyzerGainKey: @(gain), SFBReplayGainAnalyzerPeakKey: @(peak) };
-}
+	for(NSUInteger i = 0; i < entryCount; ++i)
+		_B[OSSwapLittleToHostInt32(entries[2 * i])] += OSSwapLittleToHostInt32(entries[2 * i + 1]);
 
-#pragma mark Internal
+	_albumPeak = MAX(_albumPeak, peak.floatValue);
+	_albumTruePeak = MAX(_albumTruePeak, truePeak.floatValue);
+
+	return @{ SFBReplayGainAnalyzerGainKey: gain, SFBReplayGainAnalyzerPeakKey: peak, SFBReplayGainAnalyzerTruePeakKey: truePeak };
+}
 
 + (NSInteger)maximumSupportedSampleRate
 {
@@ -637,22 +888,60 @@ static float AnalyzeResult(uint32_t *array, size_t len)
 - (void)resetState
 {
 	/* zero out initial values */
-	for(int i = 0; i < MAX_ORDER; ++i)
-		_linprebuf[i] = _lstepbuf[i] = _loutbuf[i] = _rinprebuf[i] = _rstepbuf[i] = _routbuf[i] = 0;
+	_equalLoudnessFilter.Reset();
+	_truePeakMeter.Reset();
 
-	_lsum = _rsum = 0;
+	_sum = 0;
 	_totsamp = 0;
 }
 
-- (void)setupForAnalysisAtSampleRate:(NSInteger)sampleRate
+- (void)accumulateAlbumStateFromAnalyzer:(SFBReplayGainAnalyzer *)analyzer
 {
-	NSParameterAssert([SFBReplayGainAnalyzer sampleRateIsSupported:sampleRate]);
+	NSParameterAssert(analyzer != nil);
+
+	for(uint32_t i = 0; i < sizeof(_B) / sizeof(*_B); ++i)
+		_B[i] += analyzer->_B[i];
+
+	_albumPeak = MAX(_albumPeak, analyzer->_albumPeak);
+	_albumTruePeak = MAX(_albumTruePeak, analyzer->_albumTruePeak);
+}
+
+- (AVAudioFormat *)analysisFormatForFormat:(AVAudioFormat *)format downsample:(uint32_t *)downsample
+{
+	NSParameterAssert(format != nil);
+	NSParameterAssert(downsample != NULL);
+
+	// Higher sampling rates aren't natively supported but are handled via decimation or resampling
+	NSInteger sampleRate = (NSInteger)format.sampleRate;
+	if(![SFBReplayGainAnalyzer evenMultipleSampleRateIsSupported:sampleRate])
+		return nil;
+
+	NSInteger replayGainSampleRate = [SFBReplayGainAnalyzer bestReplayGainSampleRateForSampleRate:sampleRate];
+
+	// Integer multiples of the replay gain sample rate are decimated by the equal loudness filter
+	*downsample = 1;
+	if(sampleRate == format.sampleRate && sampleRate > replayGainSampleRate && sampleRate % replayGainSampleRate == 0 && sampleRate / replayGainSampleRate <= SFB::Audio::IIRFilter::kMaximumDecimation)
+		*downsample = (uint32_t)(sampleRate / replayGainSampleRate);
+
+	// The channel layout is preserved so multichannel audio may be weighted
+	if(format.channelLayout)
+		return [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat32 sampleRate:replayGainSampleRate * *downsample interleaved:NO channelLayout:format.channelLayout];
+	else
+		return [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat32 sampleRate:replayGainSampleRate * *downsample channels:format.channelCount interleaved:NO];
+}
+
+- (void)setupForAnalysisOfFormat:(AVAudioFormat *)format downsample:(uint32_t)downsample
+{
+	NSParameterAssert(downsample > 0);
+	NSParameterAssert([SFBReplayGainAnalyzer sampleRateIsSupported:(NSInteger)format.sampleRate / downsample]);
+
+	const NSInteger sampleRate = (NSInteger)format.sampleRate / downsample;
 
 	memset(&_filter, 0, sizeof(_filter));
 	for(size_t i = 0; i < sizeof(sReplayGainFilters) / sizeof(sReplayGainFilters[0]); ++i) {
 		if(sReplayGainFilters[i].rate == sampleRate) {
 			_filter = sReplayGainFilters[i];
-			_filter.downsample = 1;
+			_filter.downsample = downsample;
 			break;
 		}
 	}
@@ -661,83 +950,64 @@ static float AnalyzeResult(uint32_t *array, size_t len)
 
 	_sampleWindow = (uint32_t)((_filter.rate * RMS_WINDOW_TIME + 1000 - 1) / 1000);
 
-	_lstepbuf = reallocf(_lstepbuf, sizeof(float) * (_sampleWindow + MAX_ORDER));
-	_rstepbuf = reallocf(_rstepbuf, sizeof(float) * (_sampleWindow + MAX_ORDER));
-	_loutbuf  = reallocf(_loutbuf,  sizeof(float) * (_sampleWindow + MAX_ORDER));
-	_routbuf  = reallocf(_routbuf,  sizeof(float) * (_sampleWindow + MAX_ORDER));
+	// The replay gain analyzer expects 16-bit sample size passed as floats, so the scaling is folded into the first section
+	const double scale = 1u << 15;
 
-	_lstep = _lstepbuf + MAX_ORDER;
-	_rstep = _rstepbuf + MAX_ORDER;
-	_lout  = _loutbuf  + MAX_ORDER;
-	_rout  = _routbuf  + MAX_ORDER;
+	double BYule [YULE_ORDER + 1], AYule [YULE_ORDER + 1];
+	for(int i = 0; i <= YULE_ORDER; ++i) {
+		BYule[i] = _filter.BYule[i] * scale;
+		AYule[i] = _filter.AYule[i];
+	}
+
+	double BButter [BUTTER_ORDER + 1], AButter [BUTTER_ORDER + 1];
+	for(int i = 0; i <= BUTTER_ORDER; ++i) {
+		BButter[i] = _filter.BButter[i];
+		AButter[i] = _filter.AButter[i];
+	}
+
+	_equalLoudnessFilter.Initialize(format.channelCount);
+	_equalLoudnessFilter.AddSection(BYule, AYule, YULE_ORDER);
+	_equalLoudnessFilter.AddSection(BButter, AButter, BUTTER_ORDER);
+	_equalLoudnessFilter.SetDecimation(_filter.downsample);
+
+	_channelWeights = ChannelWeightsForFormat(format);
+	_channelPeaks.assign(format.channelCount, 0);
+	_truePeakMeter.Initialize(format.channelCount, format.sampleRate);
 
 	[self resetState];
 
 	memset(_A, 0, sizeof(_A));
 }
 
-- (BOOL)analyzeLeftSamples:(const float *)left_samples rightSamples:(const float *)right_samples sampleCount:(size_t)num_samples isStereo:(BOOL)stereo
+- (void)analyzeAudio:(const float * const *)input frameLength:(AVAudioFrameCount)inputFrameLength filteringInto:(float * const *)channelData
 {
-	uint32_t downsample = _filter.downsample;
-	num_samples /= downsample;
-
-	if(num_samples == 0)
-		return YES;
-
-	const float *curleft;
-	const float *curright;
+	const AVAudioChannelCount channelCount = (AVAudioChannelCount)_channelWeights.size();
 
-	long prebufsamples = MAX_ORDER;
-	long batchsamples = (long)num_samples;
-	long cursamplepos = 0;
+	/* Measure the true peaks before the audio is filtered, possibly in place */
+	_truePeakMeter.Process(input, inputFrameLength);
 
-	if(!stereo)
-		right_samples = left_samples;
+	/* Find the peaks, then scale, filter, and decimate all channels in a single pass */
+	const AVAudioFrameCount frameLength = (AVAudioFrameCount)_equalLoudnessFilter.Process(input, channelData, inputFrameLength, _channelPeaks.data());
 
-	if((size_t)prebufsamples > num_samples)
-		prebufsamples = (long)num_samples;
+	AVAudioFrameCount framesProcessed = 0;
+	while(framesProcessed < frameLength) {
+		const AVAudioFrameCount frameCount = MIN(_sampleWindow - _totsamp, frameLength - framesProcessed);
 
-	for(long i = 0; i < prebufsamples; ++i) {
-		_linprebuf[i + MAX_ORDER] = left_samples [i * downsample];
-		_rinprebuf[i + MAX_ORDER] = right_samples[i * downsample];
-	}
-
-	while(batchsamples > 0) {
-		long cursamples = MIN((long)(_sampleWindow - _totsamp), batchsamples);
-		if(cursamplepos < MAX_ORDER) {
-			downsample = 1;
-			curleft  = _linpre + cursamplepos;
-			curright = _rinpre + cursamplepos;
-			if(cursamples > MAX_ORDER - cursamplepos)
-				cursamples = MAX_ORDER - cursamplepos;
-		}
-		else {
-			downsample = _filter.downsample;
-			curleft  = left_samples  + cursamplepos;
-			curright = right_samples + cursamplepos;
+		/* Get the weighted sum of the squared values */
+		for(AVAudioChannelCount channel = 0; channel < channelCount; ++channel) {
+			if(_channelWeights[channel] == 0)
+				continue;
+			float sum;
+			vDSP_svesq(channelData[channel] + framesProcessed, 1, &sum, frameCount);
+			_sum += (double)_channelWeights[channel] * sum;
 		}
 
-		Filter(curleft , _lstep + _totsamp, (size_t)cursamples, _filter.AYule, _filter.BYule, YULE_ORDER, downsample);
-		Filter(curright, _rstep + _totsamp, (size_t)cursamples, _filter.AYule, _filter.BYule, YULE_ORDER, downsample);
-
-		Filter(_lstep + _totsamp, _lout + _totsamp, (size_t)cursamples, _filter.AButter, _filter.BButter, BUTTER_ORDER, downsample);
-		Filter(_rstep + _totsamp, _rout + _totsamp, (size_t)cursamples, _filter.AButter, _filter.BButter, BUTTER_ORDER, downsample);
-
-		/* Get the squared values */
-		float sum;
-		vDSP_svesq(_lout + _totsamp, 1, &sum, (vDSP_Length)cursamples);
-		_lsum += sum;
-
-		vDSP_svesq(_rout + _totsamp, 1, &sum, (vDSP_Length)cursamples);
-		_rsum += sum;
-
-		batchsamples -= cursamples;
-		cursamplepos += cursamples;
-		_totsamp += (uint32_t)cursamples;
+		framesProcessed += frameCount;
+		_totsamp += frameCount;
 
 		/* Get the Root Mean Square (RMS) for this set of samples */
 		if(_totsamp == _sampleWindow) {
-			double  val  = STEPS_per_dB * 10. * log10((_lsum + _rsum) / _totsamp * 0.5 + 1.e-37);
+			double  val  = STEPS_per_dB * 10. * log10(_sum / _totsamp * 0.5 + 1.e-37);
 			int     ival = (int) val;
 			if(ival < 0)
 				ival = 0;
@@ -745,40 +1015,11 @@ static float AnalyzeResult(uint32_t *array, size_t len)
 				ival = (int)(sizeof(_A)/sizeof(*_A)) - 1;
 
 			_A [ival]++;
-			_lsum = _rsum = 0.;
-
-			memmove(_loutbuf , _loutbuf  + _totsamp, MAX_ORDER * sizeof(float));
-			memmove(_routbuf , _routbuf  + _totsamp, MAX_ORDER * sizeof(float));
-			memmove(_lstepbuf, _lstepbuf + _totsamp, MAX_ORDER * sizeof(float));
-			memmove(_rstepbuf, _rstepbuf + _totsamp, MAX_ORDER * sizeof(float));
 
+			_sum = 0;
 			_totsamp = 0;
 		}
-
-		/* somehow I really screwed up: Error in programming! Contact author about totsamp > sampleWindow */
-		if(_totsamp > _sampleWindow)
-			return NO;
-	}
-
-	if(num_samples < MAX_ORDER) {
-		memmove(_linprebuf,                           _linprebuf + num_samples, (MAX_ORDER - num_samples) * sizeof(float));
-		memmove(_rinprebuf,                           _rinprebuf + num_samples, (MAX_ORDER - num_samples) * sizeof(float));
-		memcpy (_linprebuf + MAX_ORDER - num_samples, left_samples,             num_samples               * sizeof(float));
-		memcpy (_rinprebuf + MAX_ORDER - num_samples, right_samples,            num_samples               * sizeof(float));
-	}
-	else {
-		downsample = _filter.downsample;
-
-		left_samples  += (num_samples - MAX_ORDER) * downsample;
-		right_samples += (num_samples - MAX_ORDER) * downsample;
-
-		for(long i = 0; i < MAX_ORDER; ++i) {
-			_linprebuf[i] = left_samples [i * downsample];
-			_rinprebuf[i] = right_samples[i * downsample];
-		}
 	}
-
-    return YES;
 }
 
 @end
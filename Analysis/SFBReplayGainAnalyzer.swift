@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020 Stephen F. Booth <me@sbooth.org>
+ * Copyright (c) 2020 - 2021 Stephen F. Booth <me@sbooth.org>
  * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
  */
 
@@ -11,33 +11,59 @@ public struct ReplayGain {
 	public let gain: Float
 	/// The  peak sample normalized to [-1, 1)
 	public let peak: Float
+	/// The true peak normalized so full scale is 1
+	public let truePeak: Float
+}
+
+extension ReplayGain {
+	/// Creates replay gain information from a dictionary returned by `ReplayGainAnalyzer`
+	init(_ dictionary: [ReplayGainAnalyzer.Key: NSNumber]) {
+		gain = dictionary[.gainKey]!.floatValue
+		peak = dictionary[.peakKey]!.floatValue
+		truePeak = dictionary[.truePeakKey]!.floatValue
+	}
 }
 
 extension ReplayGainAnalyzer {
 	/// Analyzes the given album's replay gain
 	/// - parameter urls: The URLs to analyze
+	/// - parameter concurrently: Whether tracks should be analyzed simultaneously
+	/// - parameter cache: An optional cache of track results
 	/// - returns: The album's gain and peak information keyed by URL
 	/// - throws: An `NSError` object if an error occurs
-	public class func analyzeAlbum(_ urls: [URL]) throws -> (ReplayGain, [URL: ReplayGain]) {
-		var trackReplayGain = [URL: ReplayGain]()
+	public class func analyzeAlbum(_ urls: [URL], concurrently: Bool = false, cache: AudioAnalysisCache? = nil) throws -> (ReplayGain, [URL: ReplayGain]) {
+		if !concurrently {
+			var trackReplayGain = [URL: ReplayGain]()
+
+			let analyzer = ReplayGainAnalyzer()
+			analyzer.cache = cache
+			for url in urls {
+				trackReplayGain[url] = try analyzer.analyzeTrack(url)
+			}
 
-		let analyzer = ReplayGainAnalyzer()
+			return (try analyzer.albumReplayGain(), trackReplayGain)
+		}
+
+		let result = try __analyzeAlbum(urls, concurrently: true, cache: cache)
+
+		var trackReplayGain = [URL: ReplayGain]()
 		for url in urls {
-			trackReplayGain[url] = try analyzer.analyzeTrack(url)
+			trackReplayGain[url] = ReplayGain(result[url] as! [ReplayGainAnalyzer.Key: NSNumber])
 		}
 
-		return (try analyzer.albumReplayGain(), trackReplayGain)
+		let gain = result[ReplayGainAnalyzer.Key.gainKey.rawValue] as! NSNumber
+		let peak = result[ReplayGainAnalyzer.Key.peakKey.rawValue] as! NSNumber
+		let truePeak = result[ReplayGainAnalyzer.Key.truePeakKey.rawValue] as! NSNumber
+		return (ReplayGain(gain: gain.floatValue, peak: peak.floatValue, truePeak: truePeak.floatValue), trackReplayGain)
 	}
 
-	/// Returns replay gain gain and normalized peak information for `url`
+	/// Returns replay gain gain and normalized peak and true peak information for `url`
 	public func analyzeTrack(_ url: URL) throws -> ReplayGain {
-		let replayGain = try __analyzeTrack(url)
-		return ReplayGain(gain: replayGain[.gainKey]!.floatValue, peak: replayGain[.peakKey]!.floatValue)
+		return ReplayGain(try __analyzeTrack(url))
 	}
 
-	/// Returns replay gain gain and normalized peak information for the album
+	/// Returns replay gain gain and normalized peak and true peak information for the album
 	public func albumReplayGain() throws -> ReplayGain {
-		let replayGain = try __albumGainAndPeakSampleReturningError()
-		return ReplayGain(gain: replayGain[.gainKey]!.floatValue, peak: replayGain[.peakKey]!.floatValue)
+		return ReplayGain(try __albumGainAndPeakSampleReturningError())
 	}
 }
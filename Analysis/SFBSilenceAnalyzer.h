@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <AVFoundation/AVFoundation.h>
+
+#import <SFBAudioEngine/SFBAudioAnalysisPlugIn.h>
+#import <SFBAudioEngine/SFBLoopableRegionDecoder.h>
+#import <SFBAudioEngine/SFBPCMDecoding.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// A key in a silence dictionary
+typedef NSString * SFBSilenceAnalyzerKey NS_TYPED_ENUM NS_SWIFT_NAME(SilenceAnalyzer.Key);
+
+// Silence dictionary keys
+/// The number of silent frames before the first audible frame (\c NSNumber)
+extern SFBSilenceAnalyzerKey const SFBSilenceAnalyzerLeadingSilenceKey;
+/// The number of silent frames after the last audible frame (\c NSNumber)
+extern SFBSilenceAnalyzerKey const SFBSilenceAnalyzerTrailingSilenceKey;
+/// The total number of frames (\c NSNumber)
+extern SFBSilenceAnalyzerKey const SFBSilenceAnalyzerFrameLengthKey;
+
+
+/// A class that finds leading and trailing silence
+///
+/// A frame is audible if the magnitude of any of its samples exceeds \c threshold. Audio that is entirely silent is
+/// reported as leading silence.
+///
+/// When the decoder supports seeking only the leading silence and a window at the end of the audio are decoded, so the
+/// cost of analysis is usually dominated by reading the file. As an \c SFBAudioAnalysisPlugIn all audio is scanned.
+/// @note This class is not thread safe
+NS_SWIFT_NAME(SilenceAnalyzer) @interface SFBSilenceAnalyzer : NSObject <SFBAudioAnalysisPlugIn>
+
+/// Finds the leading and trailing silence in \c url
+/// @param url The URL to analyze
+/// @param threshold The largest sample magnitude considered silent, as a fraction of full scale
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return A dictionary of silence information, or \c nil on error
++ (nullable NSDictionary<SFBSilenceAnalyzerKey, NSNumber *> *)analyzeURL:(NSURL *)url threshold:(float)threshold error:(NSError **)error NS_SWIFT_NAME(analyze(_:threshold:));
+
+/// Finds the leading and trailing silence in the audio from \c decoder
+/// @note Frames are counted from the decoder's position when called, and the decoder is left at an unspecified position
+/// @param decoder The decoder providing the audio to analyze
+/// @param threshold The largest sample magnitude considered silent, as a fraction of full scale
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return A dictionary of silence information, or \c nil on error
++ (nullable NSDictionary<SFBSilenceAnalyzerKey, NSNumber *> *)analyzeDecoder:(id <SFBPCMDecoding>)decoder threshold:(float)threshold error:(NSError **)error NS_SWIFT_NAME(analyze(_:threshold:));
+
+/// Returns a decoder for the audible region of the audio from \c decoder, suitable for gapless playback
+/// @note \c decoder must support seeking
+/// @param decoder The decoder providing the audio to trim
+/// @param threshold The largest sample magnitude considered silent, as a fraction of full scale
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return A decoder or \c nil on error
++ (nullable SFBLoopableRegionDecoder *)audibleRegionDecoderForDecoder:(id <SFBPCMDecoding>)decoder threshold:(float)threshold error:(NSError **)error NS_SWIFT_NAME(audibleRegionDecoder(for:threshold:));
+
+/// Returns an initialized \c SFBSilenceAnalyzer object detecting digital silence
+- (instancetype)init;
+
+/// Returns an initialized \c SFBSilenceAnalyzer object
+/// @param threshold The largest sample magnitude considered silent, as a fraction of full scale
+- (instancetype)initWithThreshold:(float)threshold NS_DESIGNATED_INITIALIZER;
+
+/// The largest sample magnitude considered silent, as a fraction of full scale
+@property (nonatomic, readonly) float threshold;
+
+@end
+
+/// The \c NSErrorDomain used by \c SFBSilenceAnalyzer
+extern NSErrorDomain const SFBSilenceAnalyzerErrorDomain NS_SWIFT_NAME(SilenceAnalyzer.ErrorDomain);
+
+/// Possible \c NSError error codes used by \c SFBSilenceAnalyzer
+typedef NS_ERROR_ENUM(SFBSilenceAnalyzerErrorDomain, SFBSilenceAnalyzerErrorCode) {
+	/// Audio format not supported
+	SFBSilenceAnalyzerErrorCodeFormatNotSupported		= 0,
+	/// Seeking not supported
+	SFBSilenceAnalyzerErrorCodeSeekingNotSupported		= 1,
+} NS_SWIFT_NAME(SilenceAnalyzer.ErrorCode);
+
+NS_ASSUME_NONNULL_END
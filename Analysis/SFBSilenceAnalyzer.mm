@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <algorithm>
+
+#import <os/log.h>
+
+#import "SFBSilenceAnalyzer.h"
+
+#import "AudioPCMConverter.h"
+#import "AudioSilenceDetector.h"
+#import "SFBAudioDecoder.h"
+
+// NSError domain for SFBSilenceAnalyzer
+NSErrorDomain const SFBSilenceAnalyzerErrorDomain = @"org.sbooth.AudioEngine.SilenceAnalyzer";
+
+// Key names for the silence dictionary
+SFBSilenceAnalyzerKey const SFBSilenceAnalyzerLeadingSilenceKey = @"Leading Silence";
+SFBSilenceAnalyzerKey const SFBSilenceAnalyzerTrailingSilenceKey = @"Trailing Silence";
+SFBSilenceAnalyzerKey const SFBSilenceAnalyzerFrameLengthKey = @"Frame Length";
+
+// The prefix of the key for results in an SFBAudioAnalysisCache; the version must be incremented when results change
+static NSString * const SFBSilenceAnalyzerCacheKeyPrefix = @"org.sbooth.AudioEngine.SilenceAnalyzer.1";
+
+#define BUFFER_SIZE_FRAMES 4096
+// The initial number of frames decoded at the end of the audio when searching for trailing silence
+#define TAIL_WINDOW_FRAMES 65536
+
+namespace {
+
+	/// Decodes at most \c frameLength frames from \c decoder into \c buffer, converting to \c float if \c decodeBuffer is not \c buffer
+	BOOL DecodeBlock(id<SFBPCMDecoding> decoder, AVAudioPCMBuffer *decodeBuffer, AVAudioPCMBuffer *buffer, SFB::Audio::PCMConverter& converter, AVAudioFrameCount frameLength, NSError **error)
+	{
+		if(![decoder decodeIntoBuffer:decodeBuffer frameLength:frameLength error:error])
+			return NO;
+
+		if(decodeBuffer != buffer) {
+			if(decodeBuffer.frameLength > 0 && !converter.Convert(decodeBuffer.audioBufferList, buffer.mutableAudioBufferList, decodeBuffer.frameLength)) {
+				os_log_error(OS_LOG_DEFAULT, "Error converting audio to %{public}@", buffer.format);
+				if(error)
+					*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EINVAL userInfo:nil];
+				return NO;
+			}
+			buffer.frameLength = decodeBuffer.frameLength;
+		}
+
+		return YES;
+	}
+
+	/// Returns the results for audio of \c frameLength frames with the audible frames found by \c detector
+	NSDictionary * SilenceDictionary(const SFB::Audio::SilenceDetector& detector, uint64_t audibleFrameEnd, uint64_t frameLength)
+	{
+		if(!detector.HasAudibleFrames())
+			return @{ SFBSilenceAnalyzerLeadingSilenceKey: @(frameLength), SFBSilenceAnalyzerTrailingSilenceKey: @0, SFBSilenceAnalyzerFrameLengthKey: @(frameLength) };
+
+		return @{
+			SFBSilenceAnalyzerLeadingSilenceKey: @(detector.FirstAudibleFrame()),
+			SFBSilenceAnalyzerTrailingSilenceKey: @(frameLength - std::min(audibleFrameEnd, frameLength)),
+			SFBSilenceAnalyzerFrameLengthKey: @(frameLength),
+		};
+	}
+
+}
+
+@interface SFBSilenceAnalyzer ()
+{
+@private
+	SFB::Audio::SilenceDetector _detector;
+}
+@end
+
+@implementation SFBSilenceAnalyzer
+
++ (void)load
+{
+	[NSError setUserInfoValueProviderForDomain:SFBSilenceAnalyzerErrorDomain provider:^id(NSError *err, NSErrorUserInfoKey userInfoKey) {
+		if(userInfoKey == NSLocalizedDescriptionKey) {
+			switch(err.code) {
+				case SFBSilenceAnalyzerErrorCodeFormatNotSupported:
+					return NSLocalizedString(@"The audio format is not supported.", @"");
+				case SFBSilenceAnalyzerErrorCodeSeekingNotSupported:
+					return NSLocalizedString(@"The audio does not support seeking.", @"");
+			}
+		}
+		return nil;
+	}];
+}
+
++ (NSDictionary *)analyzeURL:(NSURL *)url threshold:(float)threshold error:(NSError **)error
+{
+	NSParameterAssert(url != nil);
+
+	SFBAudioDecoder *decoder = [[SFBAudioDecoder alloc] initWithURL:url error:error];
+	if(!decoder)
+		return nil;
+
+	return [self analyzeDecoder:decoder threshold:threshold error:error];
+}
+
++ (NSDictionary *)analyzeDecoder:(id<SFBPCMDecoding>)decoder threshold:(float)threshold error:(NSError **)error
+{
+	NSParameterAssert(decoder != nil);
+	NSParameterAssert(threshold >= 0);
+
+	if(!decoder.isOpen && ![decoder openReturningError:error])
+		return nil;
+
+	AVAudioFormat *inputFormat = decoder.processingFormat;
+	AVAudioFormat *outputFormat = [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat32 sampleRate:inputFormat.sampleRate channels:inputFormat.channelCount interleaved:NO];
+
+	SFB::Audio::PCMConverter converter;
+	SFB::Audio::SilenceDetector detector;
+	const BOOL needsConversion = outputFormat && ![inputFormat isEqual:outputFormat];
+	if(!outputFormat || (needsConversion && !converter.Initialize(SFB::Audio::Format(inputFormat.streamDescription), SFB::Audio::Format(outputFormat.streamDescription))) || !detector.Initialize(inputFormat.channelCount, threshold)) {
+		os_log_error(OS_LOG_DEFAULT, "Unsupported format for silence analysis: %{public}@", inputFormat);
+		if(error)
+			*error = [NSError errorWithDomain:SFBSilenceAnalyzerErrorDomain code:SFBSilenceAnalyzerErrorCodeFormatNotSupported userInfo:nil];
+		return nil;
+	}
+
+	AVAudioPCMBuffer *buffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:outputFormat frameCapacity:BUFFER_SIZE_FRAMES];
+	AVAudioPCMBuffer *decodeBuffer = needsConversion ? [[AVAudioPCMBuffer alloc] initWithPCMFormat:inputFormat frameCapacity:BUFFER_SIZE_FRAMES] : buffer;
+
+	const AVAudioFramePosition startingFrame = decoder.framePosition;
+
+	// Decode until the first audible frame
+	BOOL endOfAudio = NO;
+	for(;;) {
+		if(!DecodeBlock(decoder, decodeBuffer, buffer, converter, BUFFER_SIZE_FRAMES, error))
+			return nil;
+
+		if(buffer.frameLength == 0) {
+			endOfAudio = YES;
+			break;
+		}
+
+		detector.Process(buffer.floatChannelData, buffer.frameLength);
+		if(detector.HasAudibleFrames())
+			break;
+	}
+
+	if(endOfAudio)
+		return SilenceDictionary(detector, detector.AudibleFrameEnd(), detector.FramePosition());
+
+	// Without seeking the remaining audio is scanned in order
+	if(!decoder.supportsSeeking || decoder.frameLength == SFBUnknownFrameLength) {
+		for(;;) {
+			if(!DecodeBlock(decoder, decodeBuffer, buffer, converter, BUFFER_SIZE_FRAMES, error))
+				return nil;
+			if(buffer.frameLength == 0)
+				break;
+			detector.Process(buffer.floatChannelData, buffer.frameLength);
+		}
+
+		return SilenceDictionary(detector, detector.AudibleFrameEnd(), detector.FramePosition());
+	}
+
+	// Otherwise windows of increasing size are scanned backward from the end until audio is found or the windows reach
+	// the audio already scanned. The first window is decoded to the end since the decoder's length may be an estimate.
+	SFB::Audio::SilenceDetector tailDetector;
+	tailDetector.Initialize(inputFormat.channelCount, threshold);
+
+	const uint64_t framesScanned = detector.FramePosition();
+	const uint64_t estimatedFrameLength = static_cast<uint64_t>(std::max(decoder.frameLength - startingFrame, static_cast<AVAudioFramePosition>(0)));
+
+	uint64_t frameLength = 0;
+	uint64_t windowEnd = estimatedFrameLength;
+	uint64_t windowLength = TAIL_WINDOW_FRAMES;
+	for(bool firstWindow = true; ; firstWindow = false) {
+		const uint64_t windowStart = windowEnd > framesScanned + windowLength ? windowEnd - windowLength : framesScanned;
+
+		if(![decoder seekToFrame:startingFrame + static_cast<AVAudioFramePosition>(windowStart) error:error])
+			return nil;
+
+		tailDetector.SetFramePosition(windowStart);
+		while(firstWindow || tailDetector.FramePosition() < windowEnd) {
+			const uint64_t framesRemaining = firstWindow ? BUFFER_SIZE_FRAMES : windowEnd - tailDetector.FramePosition();
+			if(!DecodeBlock(decoder, decodeBuffer, buffer, converter, static_cast<AVAudioFrameCount>(std::min(framesRemaining, static_cast<uint64_t>(BUFFER_SIZE_FRAMES))), error))
+				return nil;
+			if(buffer.frameLength == 0)
+				break;
+			tailDetector.Process(buffer.floatChannelData, buffer.frameLength);
+		}
+
+		if(firstWindow)
+			frameLength = std::max(tailDetector.FramePosition(), framesScanned);
+
+		if(tailDetector.HasAudibleFrames() || windowStart == framesScanned)
+			break;
+
+		windowEnd = windowStart;
+		windowLength *= 2;
+	}
+
+	return SilenceDictionary(detector, std::max(detector.AudibleFrameEnd(), tailDetector.AudibleFrameEnd()), frameLength);
+}
+
++ (SFBLoopableRegionDecoder *)audibleRegionDecoderForDecoder:(id<SFBPCMDecoding>)decoder threshold:(float)threshold error:(NSError **)error
+{
+	NSParameterAssert(decoder != nil);
+
+	if(!decoder.isOpen && ![decoder openReturningError:error])
+		return nil;
+
+	if(!decoder.supportsSeeking) {
+		if(error)
+			*error = [NSError errorWithDomain:SFBSilenceAnalyzerErrorDomain code:SFBSilenceAnalyzerErrorCodeSeekingNotSupported userInfo:nil];
+		return nil;
+	}
+
+	const AVAudioFramePosition startingFrame = decoder.framePosition;
+	NSDictionary *silence = [self analyzeDecoder:decoder threshold:threshold error:error];
+	if(!silence)
+		return nil;
+
+	const AVAudioFramePosition leadingSilence = [silence[SFBSilenceAnalyzerLeadingSilenceKey] longLongValue];
+	const AVAudioFramePosition trailingSilence = [silence[SFBSilenceAnalyzerTrailingSilenceKey] longLongValue];
+	const AVAudioFramePosition frameLength = [silence[SFBSilenceAnalyzerFrameLengthKey] longLongValue];
+
+	return [[SFBLoopableRegionDecoder alloc] initWithDecoder:decoder framePosition:startingFrame + leadingSilence frameLength:frameLength - leadingSilence - trailingSilence error:error];
+}
+
+- (instancetype)init
+{
+	return [self initWithThreshold:0];
+}
+
+- (instancetype)initWithThreshold:(float)threshold
+{
+	NSParameterAssert(threshold >= 0);
+
+	if((self = [super init]))
+		_threshold = threshold;
+	return self;
+}
+
+#pragma mark SFBAudioAnalysisPlugIn
+
+- (BOOL)prepareToAnalyzeFormat:(AVAudioFormat *)format error:(NSError **)error
+{
+	NSParameterAssert(format != nil);
+
+	if(!format.isStandard || !_detector.Initialize(format.channelCount, _threshold)) {
+		os_log_error(OS_LOG_DEFAULT, "Unsupported format for silence analysis: %{public}@", format);
+		if(error)
+			*error = [NSError errorWithDomain:SFBSilenceAnalyzerErrorDomain code:SFBSilenceAnalyzerErrorCodeFormatNotSupported userInfo:nil];
+		return NO;
+	}
+
+	return YES;
+}
+
+- (void)analyzeBuffer:(AVAudioPCMBuffer *)buffer
+{
+	NSParameterAssert(buffer != nil);
+	_detector.Process(buffer.floatChannelData, buffer.frameLength);
+}
+
+- (NSDictionary *)finishAnalysisReturningError:(NSError **)error
+{
+#pragma unused(error)
+	return SilenceDictionary(_detector, _detector.AudibleFrameEnd(), _detector.FramePosition());
+}
+
+- (BOOL)isCacheable
+{
+	return YES;
+}
+
+- (NSString *)cacheKey
+{
+	// Results depend on the threshold, which is formatted exactly
+	return [NSString stringWithFormat:@"%@?threshold=%a", SFBSilenceAnalyzerCacheKeyPrefix, _threshold];
+}
+
+@end
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <AVFoundation/AVFoundation.h>
+
+#import <SFBAudioEngine/SFBAudioAnalysisPlugIn.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class SFBAudioPlayerNode;
+
+/// A key in a spectrum analysis result
+typedef NSString * SFBSpectrumAnalyzerKey NS_TYPED_ENUM NS_SWIFT_NAME(SpectrumAnalyzer.Key);
+
+// Spectrum dictionary keys
+/// The average level of each band in dB relative to a full scale sine wave (\c NSArray of \c NSNumber)
+extern SFBSpectrumAnalyzerKey const SFBSpectrumAnalyzerBandLevelsKey;
+/// The edges of the bands in Hz, one more than the number of bands (\c NSArray of \c NSNumber)
+extern SFBSpectrumAnalyzerKey const SFBSpectrumAnalyzerBandEdgesKey;
+/// The highest frequency whose average level exceeds \c cutoffThreshold in Hz, or \c 0 if none does (\c NSNumber)
+extern SFBSpectrumAnalyzerKey const SFBSpectrumAnalyzerCutoffFrequencyKey;
+/// The number of spectra averaged (\c NSNumber)
+extern SFBSpectrumAnalyzerKey const SFBSpectrumAnalyzerSpectrumCountKey;
+
+/// A block receiving the spectrum of each window
+/// @param bandLevels The level of each band in dB relative to a full scale sine wave
+/// @param bandCount The number of bands
+/// @param framePosition The position of the first frame of the window
+typedef void (^SFBSpectrumAnalyzerSpectrumBlock)(const float *bandLevels, NSUInteger bandCount, AVAudioFramePosition framePosition) NS_SWIFT_NAME(SpectrumAnalyzer.SpectrumBlock);
+
+
+/// A streaming short-time Fourier transform spectrum analyzer
+///
+/// The channels are averaged and weighted by a Hann window of \c fftSize frames, transformed by a real FFT, and the
+/// window is advanced by \c hopSize frames. The energy of \c bandCount logarithmically-spaced bands from 20 Hz to the
+/// Nyquist frequency is passed to \c spectrumBlock for each window, and the power of each bin is averaged over all
+/// windows. The average spectrum exposes the low-pass cutoff typical of lossy encoders, so a cutoff frequency well below
+/// the Nyquist frequency suggests audio was transcoded from a lossy format.
+///
+/// Analysis performs no allocation once prepared, so the analyzer may also be fed from a tap on an
+/// \c SFBAudioPlayerNode using \c -installTapOnPlayerNode:error: to drive a real-time display.
+/// @note This class is not thread safe
+NS_SWIFT_NAME(SpectrumAnalyzer) @interface SFBSpectrumAnalyzer : NSObject <SFBAudioAnalysisPlugIn>
+
+/// Returns the average spectrum of the audio in \c url using the default settings
+/// @param url The URL to analyze
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return A dictionary of spectrum information, or \c nil on error
++ (nullable NSDictionary<SFBSpectrumAnalyzerKey, id> *)analyzeURL:(NSURL *)url error:(NSError **)error NS_SWIFT_NAME(analyze(_:));
+
+/// Returns an initialized \c SFBSpectrumAnalyzer object using 4096 frame windows, a 2048 frame hop, and 32 bands
+- (instancetype)init;
+
+/// Returns an initialized \c SFBSpectrumAnalyzer object that must be prepared with \c -prepareToAnalyzeFormat:error: before use
+/// @param fftSize The number of frames in each window, a power of two from \c 32 to \c 65536
+/// @param hopSize The number of frames between the starts of consecutive windows, from \c 1 to \c fftSize
+/// @param bandCount The number of bands
+- (instancetype)initWithFFTSize:(NSUInteger)fftSize hopSize:(NSUInteger)hopSize bandCount:(NSUInteger)bandCount NS_DESIGNATED_INITIALIZER;
+
+/// The number of frames in each window
+@property (nonatomic, readonly) NSUInteger fftSize;
+/// The number of frames between the starts of consecutive windows
+@property (nonatomic, readonly) NSUInteger hopSize;
+/// The number of bands
+@property (nonatomic, readonly) NSUInteger bandCount;
+
+/// The average level in dB above which a bin is audible when determining the cutoff frequency, by default \c -120
+@property (nonatomic) float cutoffThreshold;
+
+/// An optional block called with the spectrum of each window as it is computed
+@property (nonatomic, nullable, copy) SFBSpectrumAnalyzerSpectrumBlock spectrumBlock;
+
+/// Prepares to analyze the audio rendered by \c playerNode and installs a tap on it, replacing any existing tap
+///
+/// A spectrum is computed every \c hopSize frames, so \c spectrumBlock is called on the tap's private queue at most
+/// \c hopSize frames after the audio is rendered.
+/// @note The analyzer must not be used elsewhere while the tap is installed
+/// @param playerNode The player node
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return \c YES on success, \c NO otherwise
+- (BOOL)installTapOnPlayerNode:(SFBAudioPlayerNode *)playerNode error:(NSError **)error NS_SWIFT_NAME(installTap(on:));
+
+@end
+
+/// The \c NSErrorDomain used by \c SFBSpectrumAnalyzer
+extern NSErrorDomain const SFBSpectrumAnalyzerErrorDomain NS_SWIFT_NAME(SpectrumAnalyzer.ErrorDomain);
+
+/// Possible \c NSError error codes used by \c SFBSpectrumAnalyzer
+typedef NS_ERROR_ENUM(SFBSpectrumAnalyzerErrorDomain, SFBSpectrumAnalyzerErrorCode) {
+	/// Audio format or analysis settings not supported
+	SFBSpectrumAnalyzerErrorCodeFormatNotSupported		= 0,
+	/// Insufficient audio for analysis
+	SFBSpectrumAnalyzerErrorCodeInsufficientSamples		= 1,
+} NS_SWIFT_NAME(SpectrumAnalyzer.ErrorCode);
+
+NS_ASSUME_NONNULL_END
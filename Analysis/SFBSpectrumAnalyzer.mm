@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <algorithm>
+#import <cmath>
+#import <vector>
+
+#import <os/log.h>
+
+#import "SFBSpectrumAnalyzer.h"
+
+#import "AudioSpectrumAnalyzer.h"
+#import "SFBAudioAnalysisPipeline.h"
+#import "SFBAudioPlayerNode.h"
+
+// NSError domain for SFBSpectrumAnalyzer
+NSErrorDomain const SFBSpectrumAnalyzerErrorDomain = @"org.sbooth.AudioEngine.SpectrumAnalyzer";
+
+// Key names for the spectrum dictionary
+SFBSpectrumAnalyzerKey const SFBSpectrumAnalyzerBandLevelsKey = @"Band Levels";
+SFBSpectrumAnalyzerKey const SFBSpectrumAnalyzerBandEdgesKey = @"Band Edges";
+SFBSpectrumAnalyzerKey const SFBSpectrumAnalyzerCutoffFrequencyKey = @"Cutoff Frequency";
+SFBSpectrumAnalyzerKey const SFBSpectrumAnalyzerSpectrumCountKey = @"Spectrum Count";
+
+// The pipeline key used by +analyzeURL:error:
+static NSString * const SFBSpectrumAnalyzerPipelineKey = @"org.sbooth.AudioEngine.SpectrumAnalyzer";
+
+@interface SFBSpectrumAnalyzer ()
+{
+@private
+	SFB::Audio::SpectrumAnalyzer _analyzer;
+	/// The sum of the power of each bin over all windows
+	std::vector<double> _binPowerSums;
+	/// The number of windows summed
+	uint64_t _spectrumCount;
+}
+@end
+
+@implementation SFBSpectrumAnalyzer
+
++ (void)load
+{
+	[NSError setUserInfoValueProviderForDomain:SFBSpectrumAnalyzerErrorDomain provider:^id(NSError *err, NSErrorUserInfoKey userInfoKey) {
+		if(userInfoKey == NSLocalizedDescriptionKey) {
+			switch(err.code) {
+				case SFBSpectrumAnalyzerErrorCodeFormatNotSupported:
+					return NSLocalizedString(@"The audio format is not supported.", @"");
+				case SFBSpectrumAnalyzerErrorCodeInsufficientSamples:
+					return NSLocalizedString(@"The audio does not contain sufficient samples for analysis.", @"");
+			}
+		}
+		return nil;
+	}];
+}
+
++ (NSDictionary *)analyzeURL:(NSURL *)url error:(NSError **)error
+{
+	NSParameterAssert(url != nil);
+
+	SFBAudioAnalysisPipeline *pipeline = [[SFBAudioAnalysisPipeline alloc] init];
+	[pipeline addPlugIn:[[SFBSpectrumAnalyzer alloc] init] forKey:SFBSpectrumAnalyzerPipelineKey];
+
+	NSDictionary *results = [pipeline analyzeURL:url error:error];
+	if(!results)
+		return nil;
+
+	id result = results[SFBSpectrumAnalyzerPipelineKey];
+	if([result isKindOfClass:[NSError class]]) {
+		if(error)
+			*error = result;
+		return nil;
+	}
+
+	return result;
+}
+
+- (instancetype)init
+{
+	return [self initWithFFTSize:4096 hopSize:2048 bandCount:32];
+}
+
+- (instancetype)initWithFFTSize:(NSUInteger)fftSize hopSize:(NSUInteger)hopSize bandCount:(NSUInteger)bandCount
+{
+	NSParameterAssert(fftSize >= SFB::Audio::SpectrumAnalyzer::kMinimumFFTSize && fftSize <= SFB::Audio::SpectrumAnalyzer::kMaximumFFTSize);
+	NSParameterAssert(hopSize > 0 && hopSize <= fftSize);
+	NSParameterAssert(bandCount > 0);
+
+	if((self = [super init])) {
+		_fftSize = fftSize;
+		_hopSize = hopSize;
+		_bandCount = bandCount;
+		_cutoffThreshold = -120;
+	}
+	return self;
+}
+
+- (BOOL)installTapOnPlayerNode:(SFBAudioPlayerNode *)playerNode error:(NSError **)error
+{
+	NSParameterAssert(playerNode != nil);
+
+	if(![self prepareToAnalyzeFormat:playerNode.renderingFormat error:error])
+		return NO;
+
+	__weak SFBSpectrumAnalyzer *weakSelf = self;
+	if(![playerNode installTapWithBufferSize:static_cast<AVAudioFrameCount>(std::min(_hopSize, static_cast<NSUInteger>(8192))) block:^(AVAudioPCMBuffer *buffer) {
+		[weakSelf analyzeBuffer:buffer];
+	}]) {
+		if(error)
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EINVAL userInfo:nil];
+		return NO;
+	}
+
+	return YES;
+}
+
+#pragma mark SFBAudioAnalysisPlugIn
+
+- (BOOL)prepareToAnalyzeFormat:(AVAudioFormat *)format error:(NSError **)error
+{
+	NSParameterAssert(format != nil);
+
+	if(!format.isStandard || !_analyzer.Initialize(format.channelCount, format.sampleRate, _fftSize, _hopSize, _bandCount)) {
+		os_log_error(OS_LOG_DEFAULT, "Unsupported format for spectrum analysis: %{public}@", format);
+		if(error)
+			*error = [NSError errorWithDomain:SFBSpectrumAnalyzerErrorDomain code:SFBSpectrumAnalyzerErrorCodeFormatNotSupported userInfo:nil];
+		return NO;
+	}
+
+	_binPowerSums.assign(_analyzer.BinCount(), 0);
+	_spectrumCount = 0;
+
+	return YES;
+}
+
+- (void)analyzeBuffer:(AVAudioPCMBuffer *)buffer
+{
+	NSParameterAssert(buffer != nil);
+
+	SFBSpectrumAnalyzerSpectrumBlock spectrumBlock = _spectrumBlock;
+	_analyzer.Process(buffer.floatChannelData, buffer.frameLength, [&](const SFB::Audio::SpectrumAnalyzer& analyzer) {
+		const float *binPowers = analyzer.BinPowers();
+		for(size_t bin = 0; bin < _binPowerSums.size(); ++bin)
+			_binPowerSums[bin] += binPowers[bin];
+		++_spectrumCount;
+
+		if(spectrumBlock)
+			spectrumBlock(analyzer.BandLevels(), analyzer.BandCount(), static_cast<AVAudioFramePosition>(analyzer.FramePosition()));
+	});
+}
+
+- (NSDictionary *)finishAnalysisReturningError:(NSError **)error
+{
+	// At least one full window is required
+	if(_spectrumCount == 0) {
+		if(error)
+			*error = [NSError errorWithDomain:SFBSpectrumAnalyzerErrorDomain code:SFBSpectrumAnalyzerErrorCodeInsufficientSamples userInfo:nil];
+		return nil;
+	}
+
+	std::vector<float> binPowers(_binPowerSums.size());
+	size_t cutoffBin = 0;
+	for(size_t bin = 0; bin < binPowers.size(); ++bin) {
+		binPowers[bin] = static_cast<float>(_binPowerSums[bin] / _spectrumCount);
+		if(binPowers[bin] > 0 && 10 * std::log10(binPowers[bin]) > _cutoffThreshold)
+			cutoffBin = bin;
+	}
+
+	std::vector<float> bandLevels(_analyzer.BandCount());
+	_analyzer.GetBandLevels(binPowers.data(), bandLevels.data());
+
+	NSMutableArray *levels = [NSMutableArray arrayWithCapacity:bandLevels.size()];
+	for(auto level : bandLevels)
+		[levels addObject:@(level)];
+
+	NSMutableArray *edges = [NSMutableArray arrayWithCapacity:bandLevels.size() + 1];
+	for(size_t band = 0; band <= bandLevels.size(); ++band)
+		[edges addObject:@(_analyzer.BandEdges()[band])];
+
+	return @{
+		SFBSpectrumAnalyzerBandLevelsKey: levels,
+		SFBSpectrumAnalyzerBandEdgesKey: edges,
+		SFBSpectrumAnalyzerCutoffFrequencyKey: @(cutoffBin > 0 ? _analyzer.BinFrequency(cutoffBin) : 0),
+		SFBSpectrumAnalyzerSpectrumCountKey: @(_spectrumCount),
+	};
+}
+
+// Results depend on fftSize, hopSize, bandCount, and cutoffThreshold, and spectrumBlock must observe every window,
+// so results are never taken from a cache
+- (BOOL)isCacheable
+{
+	return NO;
+}
+
+@end
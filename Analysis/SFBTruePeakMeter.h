@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <AVFoundation/AVFoundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// A streaming true-peak meter as specified in ITU-R BS.1770 Annex 2
+///
+/// Audio is oversampled four times by a polyphase interpolator so peaks falling between samples, which may clip after
+/// lossy encoding or sample rate conversion, are measured. Peaks are held until \c -resetPeaks is called.
+///
+/// Audio in the standard deinterleaved \c float format is analyzed without allocation, making the meter suitable for
+/// use in a render or tap block. Other PCM formats are converted to \c float before analysis.
+/// @note This class is not thread safe
+NS_SWIFT_NAME(TruePeakMeter) @interface SFBTruePeakMeter : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Returns an initialized \c SFBTruePeakMeter object oversampling four times or \c nil if \c format is not supported
+/// @param format The format of the audio to analyze
+- (nullable instancetype)initWithFormat:(AVAudioFormat *)format;
+
+/// Returns an initialized \c SFBTruePeakMeter object or \c nil if \c format or \c oversampling is not supported
+/// @param format The format of the audio to analyze
+/// @param oversampling The oversampling factor, \c 2, \c 3, or \c 4
+/// @note Oversampling less than four times reduces processing at high sample rates but may underestimate true peaks
+- (nullable instancetype)initWithFormat:(AVAudioFormat *)format oversampling:(NSUInteger)oversampling NS_DESIGNATED_INITIALIZER;
+
+/// The format of the audio to analyze
+@property (nonatomic, readonly) AVAudioFormat *format;
+/// The oversampling factor
+@property (nonatomic, readonly) NSUInteger oversampling;
+
+/// Analyzes the audio in \c buffer
+/// @param buffer A buffer in \c format
+- (void)analyzeBuffer:(AVAudioPCMBuffer *)buffer;
+
+/// The largest true peak of all channels in dBTP, or \c -HUGE_VAL if only silence has been analyzed
+@property (nonatomic, readonly) double truePeak;
+
+/// Returns the true peak of \c channel in dBTP
+- (double)truePeakForChannel:(AVAudioChannelCount)channel;
+
+/// Clears the held peaks
+- (void)resetPeaks;
+
+/// Clears the held peaks and the interpolator state
+/// @note This should be called when analyzing audio that is not contiguous with the previous buffer
+- (void)reset;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <os/log.h>
+
+#import "SFBTruePeakMeter.h"
+
+#import "AudioPCMConverter.h"
+#import "AudioTruePeakMeter.h"
+
+@interface SFBTruePeakMeter ()
+{
+@private
+	SFB::Audio::TruePeakMeter _meter;
+	/// Converts audio in \c format to \c float, or uninitialized if \c format is the standard format
+	SFB::Audio::PCMConverter _converter;
+	/// Converted audio
+	AVAudioPCMBuffer *_buffer;
+}
+@end
+
+@implementation SFBTruePeakMeter
+
+- (instancetype)initWithFormat:(AVAudioFormat *)format
+{
+	return [self initWithFormat:format oversampling:SFB::Audio::TruePeakMeter::kDefaultOversampling];
+}
+
+- (instancetype)initWithFormat:(AVAudioFormat *)format oversampling:(NSUInteger)oversampling
+{
+	NSParameterAssert(format != nil);
+	NSParameterAssert(oversampling >= SFB::Audio::TruePeakMeter::kMinimumOversampling && oversampling <= SFB::Audio::TruePeakMeter::kMaximumOversampling);
+
+	if((self = [super init])) {
+		if(!format.isStandard) {
+			AVAudioFormat *standardFormat = nil;
+			if(format.channelLayout)
+				standardFormat = [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat32 sampleRate:format.sampleRate interleaved:NO channelLayout:format.channelLayout];
+			else
+				standardFormat = [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat32 sampleRate:format.sampleRate channels:format.channelCount interleaved:NO];
+
+			if(!standardFormat || !_converter.Initialize(SFB::Audio::Format(format.streamDescription), SFB::Audio::Format(standardFormat.streamDescription))) {
+				os_log_error(OS_LOG_DEFAULT, "Unsupported format for true peak measurement: %{public}@", format);
+				return nil;
+			}
+
+			_buffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:standardFormat frameCapacity:4096];
+		}
+
+		if(!_meter.Initialize(format.channelCount, format.sampleRate, static_cast<unsigned>(oversampling))) {
+			os_log_error(OS_LOG_DEFAULT, "Unable to initialize true peak meter for %{public}@", format);
+			return nil;
+		}
+
+		_format = format;
+		_oversampling = oversampling;
+	}
+	return self;
+}
+
+- (void)analyzeBuffer:(AVAudioPCMBuffer *)buffer
+{
+	NSParameterAssert(buffer != nil);
+	NSParameterAssert([buffer.format isEqual:_format]);
+
+	if(!_buffer) {
+		_meter.Process(buffer.floatChannelData, buffer.frameLength);
+		return;
+	}
+
+	if(_buffer.frameCapacity < buffer.frameLength)
+		_buffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:_buffer.format frameCapacity:buffer.frameLength];
+
+	if(!_converter.Convert(buffer.audioBufferList, _buffer.mutableAudioBufferList, buffer.frameLength)) {
+		os_log_error(OS_LOG_DEFAULT, "Error converting audio to %{public}@", _buffer.format);
+		return;
+	}
+
+	_meter.Process(_buffer.floatChannelData, buffer.frameLength);
+}
+
+- (double)truePeak
+{
+	return SFB::Audio::TruePeakMeter::Decibels(_meter.Peak());
+}
+
+- (double)truePeakForChannel:(AVAudioChannelCount)channel
+{
+	NSParameterAssert(channel < _format.channelCount);
+	return SFB::Audio::TruePeakMeter::Decibels(_meter.Peak(channel));
+}
+
+- (void)resetPeaks
+{
+	_meter.ResetPeaks();
+}
+
+- (void)reset
+{
+	_meter.Reset();
+}
+
+@end
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <AVFoundation/AVFoundation.h>
+
+#import <SFBAudioEngine/SFBAudioAnalysisPlugIn.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// A key in a waveform overview analysis result
+typedef NSString * SFBWaveformOverviewKey NS_TYPED_ENUM NS_SWIFT_NAME(WaveformOverview.Key);
+
+/// The serialized overview (\c NSData)
+extern SFBWaveformOverviewKey const SFBWaveformOverviewDataKey;
+
+
+/// A multi-resolution summary of audio for drawing waveforms
+///
+/// The minimum, maximum, and RMS of each channel are summarized in buckets of 256 frames and in coarser levels up to
+/// 65536 frames per bucket, all built in a single pass as audio is analyzed. Any range of audio may be summarized for
+/// display in time proportional to the number of pixels drawn, regardless of zoom level.
+///
+/// The serialized form is compact, about 2 KB per second per channel of 44.1 kHz audio, and is used in place when
+/// loaded so a memory-mapped file is not copied or parsed.
+///
+/// As an \c SFBAudioAnalysisPlugIn the overview returns its serialized form as \c SFBWaveformOverviewDataKey.
+/// @note This class is not thread safe
+NS_SWIFT_NAME(WaveformOverview) @interface SFBWaveformOverview : NSObject <SFBAudioAnalysisPlugIn>
+
+/// Returns the overview of the audio in \c url
+/// @param url The URL to analyze
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return An overview or \c nil on error
++ (nullable instancetype)overviewOfURL:(NSURL *)url error:(NSError **)error NS_SWIFT_NAME(init(url:));
+
+/// Returns an initialized \c SFBWaveformOverview object that must be prepared with \c -prepareToAnalyzeFormat:error: before use
+- (instancetype)init NS_DESIGNATED_INITIALIZER;
+
+/// Returns an \c SFBWaveformOverview object using a serialized overview in place
+/// @param data A serialized overview
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return An overview or \c nil if \c data is not a valid overview
+- (nullable instancetype)initWithData:(NSData *)data error:(NSError **)error;
+
+/// Returns an \c SFBWaveformOverview object using a memory-mapped serialized overview
+/// @param url The URL of a file containing a serialized overview
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return An overview or \c nil on error
+- (nullable instancetype)initWithContentsOfURL:(NSURL *)url error:(NSError **)error;
+
+/// The number of channels summarized
+@property (nonatomic, readonly) AVAudioChannelCount channelCount;
+/// The sample rate of the audio summarized
+@property (nonatomic, readonly) double sampleRate;
+/// The number of frames summarized
+@property (nonatomic, readonly) AVAudioFramePosition frameLength;
+
+/// Summarizes a range of audio for display
+///
+/// Each pixel summarizes \c frameLength / \c pixelCount frames. Pixels narrower than 256 frames repeat the values of
+/// the bucket containing them and pixels beyond the end of the audio are zero. Values are fractions of full scale.
+/// @param minimum An optional array of \c pixelCount values to receive the minimum sample value of each pixel
+/// @param maximum An optional array of \c pixelCount values to receive the maximum sample value of each pixel
+/// @param rms An optional array of \c pixelCount values to receive the RMS of each pixel
+/// @param pixelCount The number of values to produce
+/// @param channel The channel to summarize
+/// @param startingFrame The first frame to summarize
+/// @param frameLength The number of frames to summarize
+/// @return \c YES on success, \c NO if the channel or range is invalid
+- (BOOL)getMinimum:(nullable float *)minimum maximum:(nullable float *)maximum rms:(nullable float *)rms pixelCount:(NSUInteger)pixelCount forChannel:(AVAudioChannelCount)channel startingFrame:(AVAudioFramePosition)startingFrame frameLength:(AVAudioFramePosition)frameLength NS_REFINED_FOR_SWIFT;
+
+/// The serialized overview, or \c nil if analysis has not finished
+@property (nonatomic, nullable, readonly) NSData *dataRepresentation;
+
+/// Writes the serialized overview to \c url
+/// @param url The destination URL
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return \c YES on success, \c NO otherwise
+- (BOOL)writeToURL:(NSURL *)url error:(NSError **)error;
+
+@end
+
+/// The \c NSErrorDomain used by \c SFBWaveformOverview
+extern NSErrorDomain const SFBWaveformOverviewErrorDomain NS_SWIFT_NAME(WaveformOverview.ErrorDomain);
+
+/// Possible \c NSError error codes used by \c SFBWaveformOverview
+typedef NS_ERROR_ENUM(SFBWaveformOverviewErrorDomain, SFBWaveformOverviewErrorCode) {
+	/// Audio format not supported
+	SFBWaveformOverviewErrorCodeFormatNotSupported		= 0,
+	/// Invalid or corrupt serialized overview
+	SFBWaveformOverviewErrorCodeInvalidData				= 1,
+	/// Analysis has not finished
+	SFBWaveformOverviewErrorCodeIncomplete				= 2,
+} NS_SWIFT_NAME(WaveformOverview.ErrorCode);
+
+NS_ASSUME_NONNULL_END
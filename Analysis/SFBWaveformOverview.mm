@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <os/log.h>
+
+#import "SFBWaveformOverview.h"
+
+#import "AudioWaveformOverview.h"
+#import "SFBAudioAnalysisPipeline.h"
+
+// NSError domain for SFBWaveformOverview
+NSErrorDomain const SFBWaveformOverviewErrorDomain = @"org.sbooth.AudioEngine.WaveformOverview";
+
+// Key names for the analysis result
+SFBWaveformOverviewKey const SFBWaveformOverviewDataKey = @"Data";
+
+// The key for results in an SFBAudioAnalysisCache; the version must be incremented when results change
+static NSString * const SFBWaveformOverviewCacheKey = @"org.sbooth.AudioEngine.WaveformOverview.1";
+
+@interface SFBWaveformOverview ()
+{
+@private
+	SFB::Audio::WaveformOverview _overview;
+	/// The serialized overview backing \c _overview when loaded, or \c nil
+	NSData *_data;
+}
+@end
+
+@implementation SFBWaveformOverview
+
++ (void)load
+{
+	[NSError setUserInfoValueProviderForDomain:SFBWaveformOverviewErrorDomain provider:^id(NSError *err, NSErrorUserInfoKey userInfoKey) {
+		if(userInfoKey == NSLocalizedDescriptionKey) {
+			switch(err.code) {
+				case SFBWaveformOverviewErrorCodeFormatNotSupported:
+					return NSLocalizedString(@"The audio format is not supported.", @"");
+				case SFBWaveformOverviewErrorCodeInvalidData:
+					return NSLocalizedString(@"The waveform overview is invalid or corrupt.", @"");
+				case SFBWaveformOverviewErrorCodeIncomplete:
+					return NSLocalizedString(@"The waveform overview is incomplete.", @"");
+			}
+		}
+		return nil;
+	}];
+}
+
++ (instancetype)overviewOfURL:(NSURL *)url error:(NSError **)error
+{
+	NSParameterAssert(url != nil);
+
+	SFBWaveformOverview *overview = [[SFBWaveformOverview alloc] init];
+	SFBAudioAnalysisPipeline *pipeline = [[SFBAudioAnalysisPipeline alloc] init];
+	[pipeline addPlugIn:overview forKey:SFBWaveformOverviewDataKey];
+
+	NSDictionary *results = [pipeline analyzeURL:url error:error];
+	if(!results)
+		return nil;
+
+	id result = results[SFBWaveformOverviewDataKey];
+	if([result isKindOfClass:[NSError class]]) {
+		if(error)
+			*error = result;
+		return nil;
+	}
+
+	return overview;
+}
+
+- (instancetype)init
+{
+	return [super init];
+}
+
+- (instancetype)initWithData:(NSData *)data error:(NSError **)error
+{
+	NSParameterAssert(data != nil);
+
+	if((self = [self init])) {
+		// The overview refers to the bytes of data, which are copied in case data is mutable
+		data = [data copy];
+		if(!_overview.Initialize(data.bytes, data.length)) {
+			if(error)
+				*error = [NSError errorWithDomain:SFBWaveformOverviewErrorDomain code:SFBWaveformOverviewErrorCodeInvalidData userInfo:nil];
+			return nil;
+		}
+		_data = data;
+	}
+	return self;
+}
+
+- (instancetype)initWithContentsOfURL:(NSURL *)url error:(NSError **)error
+{
+	NSParameterAssert(url != nil);
+
+	NSData *data = [NSData dataWithContentsOfURL:url options:NSDataReadingMappedIfSafe error:error];
+	if(!data)
+		return nil;
+	return [self initWithData:data error:error];
+}
+
+- (AVAudioChannelCount)channelCount
+{
+	return _overview.ChannelCount();
+}
+
+- (double)sampleRate
+{
+	return _overview.SampleRate();
+}
+
+- (AVAudioFramePosition)frameLength
+{
+	return static_cast<AVAudioFramePosition>(_overview.FrameCount());
+}
+
+- (BOOL)getMinimum:(float *)minimum maximum:(float *)maximum rms:(float *)rms pixelCount:(NSUInteger)pixelCount forChannel:(AVAudioChannelCount)channel startingFrame:(AVAudioFramePosition)startingFrame frameLength:(AVAudioFramePosition)frameLength
+{
+	if(startingFrame < 0 || frameLength <= 0)
+		return NO;
+	return _overview.Summarize(channel, static_cast<uint64_t>(startingFrame), static_cast<uint64_t>(frameLength), pixelCount, minimum, maximum, rms);
+}
+
+- (NSData *)dataRepresentation
+{
+	if(_data)
+		return _data;
+
+	NSMutableData *data = [NSMutableData dataWithLength:_overview.SerializedLength()];
+	if(!data || !_overview.Serialize(data.mutableBytes, data.length))
+		return nil;
+	return data;
+}
+
+- (BOOL)writeToURL:(NSURL *)url error:(NSError **)error
+{
+	NSParameterAssert(url != nil);
+
+	NSData *data = self.dataRepresentation;
+	if(!data) {
+		if(error)
+			*error = [NSError errorWithDomain:SFBWaveformOverviewErrorDomain code:SFBWaveformOverviewErrorCodeIncomplete userInfo:nil];
+		return NO;
+	}
+
+	return [data writeToURL:url options:NSDataWritingAtomic error:error];
+}
+
+#pragma mark SFBAudioAnalysisPlugIn
+
+- (BOOL)prepareToAnalyzeFormat:(AVAudioFormat *)format error:(NSError **)error
+{
+	NSParameterAssert(format != nil);
+
+	if(!format.isStandard || !_overview.Initialize(format.channelCount, format.sampleRate)) {
+		os_log_error(OS_LOG_DEFAULT, "Unsupported format for waveform overview: %{public}@", format);
+		if(error)
+			*error = [NSError errorWithDomain:SFBWaveformOverviewErrorDomain code:SFBWaveformOverviewErrorCodeFormatNotSupported userInfo:nil];
+		return NO;
+	}
+
+	_data = nil;
+	return YES;
+}
+
+- (void)analyzeBuffer:(AVAudioPCMBuffer *)buffer
+{
+	NSParameterAssert(buffer != nil);
+
+	if(!_overview.Process(buffer.floatChannelData, buffer.frameLength))
+		os_log_error(OS_LOG_DEFAULT, "Error summarizing audio for waveform overview");
+}
+
+- (NSDictionary *)finishAnalysisReturningError:(NSError **)error
+{
+	NSData *data = _overview.Finish() ? self.dataRepresentation : nil;
+	if(!data) {
+		if(error)
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+		return nil;
+	}
+
+	return @{ SFBWaveformOverviewDataKey: data };
+}
+
+- (BOOL)isCacheable
+{
+	return YES;
+}
+
+- (NSString *)cacheKey
+{
+	return SFBWaveformOverviewCacheKey;
+}
+
+- (BOOL)restoreFromCachedResults:(NSDictionary *)results
+{
+	NSParameterAssert(results != nil);
+
+	NSData *data = results[SFBWaveformOverviewDataKey];
+	if([data isKindOfClass:[NSData class]])
+		data = [data copy];
+	else
+		data = nil;
+
+	if(!data || !_overview.Initialize(data.bytes, data.length)) {
+		os_log_error(OS_LOG_DEFAULT, "Invalid cached waveform overview");
+		return NO;
+	}
+
+	_data = data;
+	return YES;
+}
+
+@end
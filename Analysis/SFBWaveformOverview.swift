@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+import Foundation
+import AVFoundation
+
+extension WaveformOverview {
+	/// Summarizes a range of audio for display
+	/// - parameter channel: The channel to summarize
+	/// - parameter range: The frames to summarize
+	/// - parameter pixelCount: The number of values to produce
+	/// - returns: The minimum, maximum, and RMS of each pixel, or `nil` if the channel or range is invalid
+	public func summary(channel: AVAudioChannelCount, range: Range<AVAudioFramePosition>, pixelCount: Int) -> (minimum: [Float], maximum: [Float], rms: [Float])? {
+		var minimum = [Float](repeating: 0, count: pixelCount)
+		var maximum = [Float](repeating: 0, count: pixelCount)
+		var rms = [Float](repeating: 0, count: pixelCount)
+		guard __getMinimum(&minimum, maximum: &maximum, rms: &rms, pixelCount: pixelCount, forChannel: channel, startingFrame: range.lowerBound, frameLength: range.upperBound - range.lowerBound) else {
+			return nil
+		}
+		return (minimum, maximum, rms)
+	}
+}
@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+// Encodes deterministic test signals and optional music fixtures with each encoder at each of its settings and
+// writes the realtime factor, output size, and peak resident memory of every conversion to stdout as JSON.
+//
+// Usage: EncoderBenchmark [--duration seconds] [--output file.json] [--encoder name]... [fixture]...
+//
+// Each conversion is performed in a child process so peak resident memory is measured independently.
+
+#import <math.h>
+#import <stdio.h>
+#import <stdlib.h>
+#import <string.h>
+#import <unistd.h>
+
+#import <SFBAudioEngine/SFBAudioEngine.h>
+
+#define BENCHMARK_SAMPLE_RATE 44100
+#define BENCHMARK_CHANNEL_COUNT 2
+#define BENCHMARK_DEFAULT_DURATION 30
+
+// The option marking an invocation as a single conversion performed on behalf of the parent process
+static NSString * const kCaseOption = @"--case";
+
+#pragma mark Encoder Configurations
+
+/// Returns a configuration for each encoder and setting, identically ordered for each invocation
+static NSArray<NSDictionary *> * EncoderConfigurations(void)
+{
+	NSMutableArray *configurations = [NSMutableArray array];
+
+	void (^add)(SFBAudioEncoderName, NSString *, NSString *, NSDictionary *) = ^(SFBAudioEncoderName encoderName, NSString *pathExtension, NSString *setting, NSDictionary *settings) {
+		[configurations addObject:@{
+			@"encoder": encoderName,
+			@"pathExtension": pathExtension,
+			@"setting": setting,
+			@"settings": settings ?: @{},
+		}];
+	};
+
+	for(NSInteger level = 1; level <= 8; ++level)
+		add(SFBAudioEncoderNameFLAC, @"flac", [NSString stringWithFormat:@"compression level %ld", (long)level], @{ SFBAudioEncodingSettingsKeyFLACCompressionLevel: @(level) });
+
+	add(SFBAudioEncoderNameWavPack, @"wv", @"default", nil);
+	add(SFBAudioEncoderNameWavPack, @"wv", @"fast", @{ SFBAudioEncodingSettingsKeyWavPackCompressionLevel: SFBAudioEncodingSettingsValueWavPackCompressionLevelFast });
+	add(SFBAudioEncoderNameWavPack, @"wv", @"high", @{ SFBAudioEncodingSettingsKeyWavPackCompressionLevel: SFBAudioEncodingSettingsValueWavPackCompressionLevelHigh });
+	add(SFBAudioEncoderNameWavPack, @"wv", @"very high", @{ SFBAudioEncodingSettingsKeyWavPackCompressionLevel: SFBAudioEncodingSettingsValueWavPackCompressionLevelVeryHigh });
+
+	add(SFBAudioEncoderNameMonkeysAudio, @"ape", @"fast", @{ SFBAudioEncodingSettingsKeyAPECompressionLevel: SFBAudioEncodingSettingsValueAPECompressionLevelFast });
+	add(SFBAudioEncoderNameMonkeysAudio, @"ape", @"normal", @{ SFBAudioEncodingSettingsKeyAPECompressionLevel: SFBAudioEncodingSettingsValueAPECompressionNormal });
+	add(SFBAudioEncoderNameMonkeysAudio, @"ape", @"high", @{ SFBAudioEncodingSettingsKeyAPECompressionLevel: SFBAudioEncodingSettingsValueAPECompressionHigh });
+	add(SFBAudioEncoderNameMonkeysAudio, @"ape", @"extra high", @{ SFBAudioEncodingSettingsKeyAPECompressionLevel: SFBAudioEncodingSettingsValueAPECompressionLevelExtraHigh });
+	add(SFBAudioEncoderNameMonkeysAudio, @"ape", @"insane", @{ SFBAudioEncodingSettingsKeyAPECompressionLevel: SFBAudioEncodingSettingsValueAPECompressionLevelInsane });
+
+	add(SFBAudioEncoderNameTrueAudio, @"tta", @"default", nil);
+
+	for(NSInteger complexity = 0; complexity <= 10; ++complexity)
+		add(SFBAudioEncoderNameOggOpus, @"opus", [NSString stringWithFormat:@"complexity %ld", (long)complexity], @{ SFBAudioEncodingSettingsKeyOpusComplexity: @(complexity) });
+
+	for(NSInteger quality = 0; quality <= 10; ++quality)
+		add(SFBAudioEncoderNameOggVorbis, @"ogg", [NSString stringWithFormat:@"quality %.1f", quality / 10.0], @{ SFBAudioEncodingSettingsKeyVorbisQuality: @(quality / 10.0) });
+
+	for(NSInteger quality = 0; quality <= 9; ++quality)
+		add(SFBAudioEncoderNameMP3, @"mp3", [NSString stringWithFormat:@"quality %ld", (long)quality], @{ SFBAudioEncodingSettingsKeyMP3Quality: @(quality) });
+
+	for(NSInteger quality = 0; quality <= 10; ++quality)
+		add(SFBAudioEncoderNameMusepack, @"mpc", [NSString stringWithFormat:@"quality %ld", (long)quality], @{ SFBAudioEncodingSettingsKeyMusepackQuality: @(quality) });
+
+	for(NSInteger complexity = 0; complexity <= 10; ++complexity)
+		add(SFBAudioEncoderNameOggSpeex, @"spx", [NSString stringWithFormat:@"complexity %ld", (long)complexity], @{ SFBAudioEncodingSettingsKeySpeexComplexity: @(complexity) });
+
+	return configurations;
+}
+
+#pragma mark Test Signals
+
+/// A deterministic test signal generator writing \c frameLength interleaved frames starting at \c framePosition
+typedef void (^SignalGenerator)(int16_t *samples, AVAudioFrameCount frameLength, AVAudioFramePosition framePosition, AVAudioFramePosition totalFrames);
+
+/// Returns the test signal generators keyed by signal name
+static NSDictionary<NSString *, SignalGenerator> * SignalGenerators(void)
+{
+	// Uniform white noise at -6 dBFS from a fixed-seed xorshift generator
+	__block uint32_t state = 0x9E3779B9;
+	SignalGenerator noise = ^(int16_t *samples, AVAudioFrameCount frameLength, AVAudioFramePosition framePosition, AVAudioFramePosition totalFrames) {
+		(void)framePosition;
+		(void)totalFrames;
+		for(AVAudioFrameCount i = 0; i < frameLength * BENCHMARK_CHANNEL_COUNT; ++i) {
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			samples[i] = (int16_t)((int32_t)state >> 17);
+		}
+	};
+
+	// Exponential sine sweep from 20 Hz to 20 kHz at -6 dBFS
+	SignalGenerator sweep = ^(int16_t *samples, AVAudioFrameCount frameLength, AVAudioFramePosition framePosition, AVAudioFramePosition totalFrames) {
+		const double f0 = 20, f1 = 20000;
+		const double T = (double)totalFrames / BENCHMARK_SAMPLE_RATE;
+		const double k = log(f1 / f0);
+		for(AVAudioFrameCount i = 0; i < frameLength; ++i) {
+			const double t = (double)(framePosition + i) / BENCHMARK_SAMPLE_RATE;
+			const double phase = 2 * M_PI * f0 * T / k * (exp(t / T * k) - 1);
+			const int16_t sample = (int16_t)lrint(16383 * sin(phase));
+			for(AVAudioChannelCount channel = 0; channel < BENCHMARK_CHANNEL_COUNT; ++channel)
+				samples[i * BENCHMARK_CHANNEL_COUNT + channel] = sample;
+		}
+	};
+
+	// Digital silence
+	SignalGenerator silence = ^(int16_t *samples, AVAudioFrameCount frameLength, AVAudioFramePosition framePosition, AVAudioFramePosition totalFrames) {
+		(void)framePosition;
+		(void)totalFrames;
+		memset(samples, 0, frameLength * BENCHMARK_CHANNEL_COUNT * sizeof(int16_t));
+	};
+
+	return @{ @"noise": noise, @"sweep": sweep, @"silence": silence };
+}
+
+/// Writes \c duration seconds of a test signal to a 16-bit WAVE file at \c url
+static BOOL WriteSignal(SignalGenerator generator, NSTimeInterval duration, NSURL *url, NSError **error)
+{
+	SFBAudioEncoder *encoder = [[SFBAudioEncoder alloc] initWithURL:url encoderName:SFBAudioEncoderNameLibsndfile error:error];
+	if(!encoder)
+		return NO;
+
+	encoder.settings = @{
+		SFBAudioEncodingSettingsKeyLibsndfileMajorFormat: SFBAudioEncodingSettingsValueLibsndfileMajorFormatWAV,
+		SFBAudioEncodingSettingsKeyLibsndfileSubtype: SFBAudioEncodingSettingsValueLibsndfileSubtypePCM_16,
+	};
+
+	AVAudioFormat *format = [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatInt16 sampleRate:BENCHMARK_SAMPLE_RATE channels:BENCHMARK_CHANNEL_COUNT interleaved:YES];
+	if(![encoder setSourceFormat:format error:error] || ![encoder openReturningError:error])
+		return NO;
+
+	AVAudioPCMBuffer *buffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:encoder.processingFormat frameCapacity:4096];
+	const AVAudioFramePosition totalFrames = (AVAudioFramePosition)(duration * BENCHMARK_SAMPLE_RATE);
+	for(AVAudioFramePosition framePosition = 0; framePosition < totalFrames; framePosition += buffer.frameLength) {
+		buffer.frameLength = (AVAudioFrameCount)MIN(buffer.frameCapacity, totalFrames - framePosition);
+		generator(buffer.int16ChannelData[0], buffer.frameLength, framePosition, totalFrames);
+		if(![encoder encodeFromBuffer:buffer frameLength:buffer.frameLength error:error]) {
+			[encoder closeReturningError:nil];
+			return NO;
+		}
+	}
+
+	if(![encoder finishEncodingReturningError:error]) {
+		[encoder closeReturningError:nil];
+		return NO;
+	}
+
+	return [encoder closeReturningError:error];
+}
+
+#pragma mark Conversion
+
+/// Converts \c sourceURL using \c configuration and writes the results to stdout as JSON
+static int RunCase(NSDictionary *configuration, NSURL *sourceURL, NSURL *destinationURL)
+{
+	NSError *error = nil;
+	NSDictionary *results = nil;
+
+	SFBAudioDecoder *decoder = [[SFBAudioDecoder alloc] initWithURL:sourceURL error:&error];
+	SFBAudioEncoder *encoder = decoder ? [[SFBAudioEncoder alloc] initWithURL:destinationURL encoderName:configuration[@"encoder"] error:&error] : nil;
+	if(encoder) {
+		encoder.settings = configuration[@"settings"];
+		SFBAudioConverter *converter = [[SFBAudioConverter alloc] initWithDecoder:decoder encoder:encoder error:&error];
+		// Peak measurement would add to the encoding time of lossy encoders
+		converter.truePeakHandling = SFBAudioConverterTruePeakHandlingNone;
+		if([converter convertReturningError:&error]) {
+			SFBAudioConverterStatistics *statistics = converter.statistics;
+			NSMutableDictionary *dictionary = [statistics.dictionaryRepresentation mutableCopy];
+			// The encoder's throughput alone, excluding decoding and format conversion
+			dictionary[@"encoderRealtimeFactor"] = @(statistics.encodeFramesPerSecond / decoder.processingFormat.sampleRate);
+			results = dictionary;
+		}
+	}
+
+	const BOOL success = results != nil;
+	if(!success)
+		results = @{ @"error": error.localizedDescription ?: @"Unknown error" };
+
+	NSData *data = [NSJSONSerialization dataWithJSONObject:results options:0 error:nil];
+	fwrite(data.bytes, 1, data.length, stdout);
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/// Runs \c RunCase in a child process and returns its results
+static NSDictionary * RunCaseInChildProcess(NSUInteger configurationIndex, NSURL *sourceURL, NSURL *destinationURL)
+{
+	NSTask *task = [[NSTask alloc] init];
+	task.executableURL = NSBundle.mainBundle.executableURL;
+	task.arguments = @[kCaseOption, [NSString stringWithFormat:@"%lu", (unsigned long)configurationIndex], sourceURL.path, destinationURL.path];
+	NSPipe *pipe = [NSPipe pipe];
+	task.standardOutput = pipe;
+
+	NSError *error = nil;
+	if(![task launchAndReturnError:&error])
+		return @{ @"error": error.localizedDescription };
+
+	NSData *data = [pipe.fileHandleForReading readDataToEndOfFile];
+	[task waitUntilExit];
+
+	NSDictionary *results = data.length ? [NSJSONSerialization JSONObjectWithData:data options:0 error:nil] : nil;
+	if(![results isKindOfClass:[NSDictionary class]])
+		return @{ @"error": [NSString stringWithFormat:@"Conversion process exited with status %d", task.terminationStatus] };
+	return results;
+}
+
+#pragma mark -
+
+static void Usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [--duration seconds] [--output file.json] [--encoder name]... [fixture]...\n", name);
+}
+
+int main(int argc, const char * argv[])
+{
+	@autoreleasepool {
+		NSArray<NSString *> *arguments = NSProcessInfo.processInfo.arguments;
+		NSArray<NSDictionary *> *configurations = EncoderConfigurations();
+
+		if(arguments.count == 5 && [arguments[1] isEqualToString:kCaseOption]) {
+			const NSInteger configurationIndex = arguments[2].integerValue;
+			if(configurationIndex < 0 || configurationIndex >= (NSInteger)configurations.count)
+				return EXIT_FAILURE;
+			return RunCase(configurations[(NSUInteger)configurationIndex], [NSURL fileURLWithPath:arguments[3]], [NSURL fileURLWithPath:arguments[4]]);
+		}
+
+		NSTimeInterval duration = BENCHMARK_DEFAULT_DURATION;
+		NSString *outputPath = nil;
+		NSMutableSet *encoderNames = [NSMutableSet set];
+		NSMutableArray<NSURL *> *fixtures = [NSMutableArray array];
+
+		for(NSUInteger i = 1; i < arguments.count; ++i) {
+			NSString *argument = arguments[i];
+			if([argument isEqualToString:@"--duration"] && i + 1 < arguments.count)
+				duration = arguments[++i].doubleValue;
+			else if([argument isEqualToString:@"--output"] && i + 1 < arguments.count)
+				outputPath = arguments[++i];
+			else if([argument isEqualToString:@"--encoder"] && i + 1 < arguments.count)
+				[encoderNames addObject:arguments[++i]];
+			else if([argument hasPrefix:@"-"]) {
+				Usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			else
+				[fixtures addObject:[NSURL fileURLWithPath:argument]];
+		}
+
+		if(duration <= 0) {
+			Usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+
+		NSURL *directoryURL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"EncoderBenchmark-%d", getpid()]] isDirectory:YES];
+		NSError *error = nil;
+		if(![NSFileManager.defaultManager createDirectoryAtURL:directoryURL withIntermediateDirectories:YES attributes:nil error:&error]) {
+			fprintf(stderr, "Unable to create %s: %s\n", directoryURL.fileSystemRepresentation, error.localizedDescription.UTF8String);
+			return EXIT_FAILURE;
+		}
+
+		// The sources to encode, keyed by signal name
+		NSMutableArray<NSArray *> *sources = [NSMutableArray array];
+		NSDictionary<NSString *, SignalGenerator> *generators = SignalGenerators();
+		for(NSString *signal in [generators.allKeys sortedArrayUsingSelector:@selector(compare:)]) {
+			NSURL *url = [directoryURL URLByAppendingPathComponent:[signal stringByAppendingPathExtension:@"wav"]];
+			if(!WriteSignal(generators[signal], duration, url, &error)) {
+				fprintf(stderr, "Unable to write %s signal: %s\n", signal.UTF8String, error.localizedDescription.UTF8String);
+				[NSFileManager.defaultManager removeItemAtURL:directoryURL error:nil];
+				return EXIT_FAILURE;
+			}
+			[sources addObject:@[signal, url]];
+		}
+		for(NSURL *url in fixtures)
+			[sources addObject:@[url.lastPathComponent, url]];
+
+		NSMutableArray *results = [NSMutableArray array];
+		for(NSArray *source in sources) {
+			for(NSUInteger configurationIndex = 0; configurationIndex < configurations.count; ++configurationIndex) {
+				NSDictionary *configuration = configurations[configurationIndex];
+				if(encoderNames.count && ![encoderNames containsObject:configuration[@"encoder"]])
+					continue;
+
+				fprintf(stderr, "%s: %s %s\n", [source[0] UTF8String], [configuration[@"encoder"] UTF8String], [configuration[@"setting"] UTF8String]);
+
+				NSURL *destinationURL = [directoryURL URLByAppendingPathComponent:[@"output" stringByAppendingPathExtension:configuration[@"pathExtension"]]];
+				NSMutableDictionary *result = [RunCaseInChildProcess(configurationIndex, source[1], destinationURL) mutableCopy];
+				[NSFileManager.defaultManager removeItemAtURL:destinationURL error:nil];
+
+				result[@"source"] = source[0];
+				result[@"encoder"] = configuration[@"encoder"];
+				result[@"setting"] = configuration[@"setting"];
+				[results addObject:result];
+			}
+		}
+
+		[NSFileManager.defaultManager removeItemAtURL:directoryURL error:nil];
+
+		NSDictionary *report = @{
+			@"signalSampleRate": @(BENCHMARK_SAMPLE_RATE),
+			@"signalChannelCount": @(BENCHMARK_CHANNEL_COUNT),
+			@"signalDuration": @(duration),
+			@"results": results,
+		};
+
+		NSData *data = [NSJSONSerialization dataWithJSONObject:report options:NSJSONWritingPrettyPrinted | NSJSONWritingSortedKeys error:&error];
+		if(!data) {
+			fprintf(stderr, "Unable to serialize results: %s\n", error.localizedDescription.UTF8String);
+			return EXIT_FAILURE;
+		}
+
+		if(outputPath) {
+			if(![data writeToFile:outputPath options:NSDataWritingAtomic error:&error]) {
+				fprintf(stderr, "Unable to write %s: %s\n", outputPath.UTF8String, error.localizedDescription.UTF8String);
+				return EXIT_FAILURE;
+			}
+		}
+		else {
+			fwrite(data.bytes, 1, data.length, stdout);
+			fputc('\n', stdout);
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
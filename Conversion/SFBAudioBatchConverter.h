@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <Foundation/Foundation.h>
+#import <AVFoundation/AVFoundation.h>
+
+#import <SFBAudioEngine/SFBAudioEncoder.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Possible states of an \c SFBAudioConversionJob
+typedef NS_ENUM(NSInteger, SFBAudioConversionJobState) {
+	/// The job is waiting to run
+	SFBAudioConversionJobStatePending 		= 0,
+	/// The job is running
+	SFBAudioConversionJobStateRunning 		= 1,
+	/// The job completed successfully
+	SFBAudioConversionJobStateSucceeded 	= 2,
+	/// The job failed
+	SFBAudioConversionJobStateFailed 		= 3,
+	/// The job was cancelled
+	SFBAudioConversionJobStateCancelled 	= 4
+} NS_SWIFT_NAME(AudioConversionJob.State);
+
+/// A single conversion performed by \c SFBAudioBatchConverter
+NS_SWIFT_NAME(AudioConversionJob) @interface SFBAudioConversionJob : NSObject
+
++ (instancetype)new NS_UNAVAILABLE;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Returns an initialized \c SFBAudioConversionJob object converting \c sourceURL to \c destinationURL
+/// @note The file type to create is inferred from the file extension of \c destinationURL and metadata is copied
+/// @param sourceURL The URL to convert
+/// @param destinationURL The destination URL
+/// @return An initialized \c SFBAudioConversionJob object
+- (instancetype)initWithSourceURL:(NSURL *)sourceURL destinationURL:(NSURL *)destinationURL;
+/// Returns an initialized \c SFBAudioConversionJob object converting \c sourceURL to \c destinationURL
+/// @param sourceURL The URL to convert
+/// @param destinationURL The destination URL
+/// @param encoderName The name of the encoder to use or \c nil to infer the encoder from the file extension of \c destinationURL
+/// @param encoderSettings Settings for the encoder or \c nil for the defaults
+/// @param copyMetadata Whether metadata should be read from \c sourceURL and copied to \c destinationURL
+/// @return An initialized \c SFBAudioConversionJob object
+- (instancetype)initWithSourceURL:(NSURL *)sourceURL destinationURL:(NSURL *)destinationURL encoderName:(nullable SFBAudioEncoderName)encoderName encoderSettings:(nullable NSDictionary<SFBAudioEncodingSettingsKey, SFBAudioEncodingSettingsValue> *)encoderSettings copyMetadata:(BOOL)copyMetadata NS_DESIGNATED_INITIALIZER;
+
+/// The URL to convert
+@property (nonatomic, readonly) NSURL *sourceURL;
+/// The destination URL
+@property (nonatomic, readonly) NSURL *destinationURL;
+/// The name of the encoder to use or \c nil to infer the encoder from the file extension of \c destinationURL
+@property (nonatomic, nullable, readonly) SFBAudioEncoderName encoderName;
+/// Settings for the encoder or \c nil for the defaults
+@property (nonatomic, nullable, readonly) NSDictionary<SFBAudioEncodingSettingsKey, SFBAudioEncodingSettingsValue> *encoderSettings;
+/// Whether metadata should be read from \c sourceURL and copied to \c destinationURL
+@property (nonatomic, readonly) BOOL copiesMetadata;
+
+/// The job's current state
+@property (readonly) SFBAudioConversionJobState state;
+/// The number of frames converted so far
+@property (readonly) AVAudioFramePosition framesConverted;
+/// The fraction of the job completed, from \c 0 to \c 1, or \c 0 if unknown
+@property (readonly) double progress;
+/// The reason the job failed or \c nil
+@property (nullable, readonly) NSError *error;
+
+@end
+
+/// A block called when the progress of a job changes
+typedef void (^SFBAudioBatchConverterJobProgressBlock)(SFBAudioConversionJob *job) NS_SWIFT_NAME(AudioBatchConverter.JobProgressBlock);
+/// A block called when a job succeeds, fails, or is cancelled
+typedef void (^SFBAudioBatchConverterJobCompletionBlock)(SFBAudioConversionJob *job) NS_SWIFT_NAME(AudioBatchConverter.JobCompletionBlock);
+
+/// Converts many files concurrently
+///
+/// Jobs are started in the order they were added, up to \c maximumConcurrentJobs at a time. A job waits to begin
+/// converting while its buffers would push the total held by running jobs over \c maximumBufferMemory.
+/// A single job requiring more than \c maximumBufferMemory runs only when no other job holds buffers.
+NS_SWIFT_NAME(AudioBatchConverter) @interface SFBAudioBatchConverter : NSObject
+
+/// Returns an initialized \c SFBAudioBatchConverter running one job per active processor with a 64 MiB buffer memory limit
+- (instancetype)init;
+/// Returns an initialized \c SFBAudioBatchConverter object
+/// @param maximumConcurrentJobs The maximum number of jobs to run at once
+/// @param maximumBufferMemory The maximum number of bytes of audio buffers held by running jobs
+/// @return An initialized \c SFBAudioBatchConverter object
+- (instancetype)initWithMaximumConcurrentJobs:(NSUInteger)maximumConcurrentJobs maximumBufferMemory:(NSUInteger)maximumBufferMemory NS_DESIGNATED_INITIALIZER;
+
+/// The maximum number of jobs to run at once
+@property (nonatomic, readonly) NSUInteger maximumConcurrentJobs;
+/// The maximum number of bytes of audio buffers held by running jobs
+@property (nonatomic, readonly) NSUInteger maximumBufferMemory;
+
+/// Set to \c YES to use pipelined conversion for each job
+/// @note Pipelined jobs use additional threads and buffer memory
+@property (nonatomic, getter=isPipelined) BOOL pipelined;
+
+/// An optional block called on an arbitrary thread as jobs progress
+@property (nonatomic, copy, nullable) SFBAudioBatchConverterJobProgressBlock jobProgressBlock;
+/// An optional block called on an arbitrary thread as jobs complete
+@property (nonatomic, copy, nullable) SFBAudioBatchConverterJobCompletionBlock jobCompletionBlock;
+
+/// Adds a job to be run
+/// @note A job may be added only once; adding a job that was already added to any batch converter has no effect
+/// @param job The job to add
+- (void)addJob:(SFBAudioConversionJob *)job NS_SWIFT_NAME(add(_:));
+/// Adds jobs to be run
+/// @param jobs The jobs to add
+- (void)addJobs:(NSArray<SFBAudioConversionJob *> *)jobs NS_SWIFT_NAME(add(_:));
+
+/// Cancels a pending or running job
+/// @note A cancelled job that was running has its partially written destination removed
+/// @param job The job to cancel
+- (void)cancelJob:(SFBAudioConversionJob *)job NS_SWIFT_NAME(cancel(_:));
+/// Cancels all pending and running jobs
+- (void)cancelAllJobs;
+
+/// Blocks the calling thread until all jobs have completed
+- (void)waitUntilAllJobsAreFinished;
+
+/// The total number of frames converted by all jobs
+@property (readonly) AVAudioFramePosition framesConverted;
+/// The wall time during which at least one job was pending or running, in seconds
+@property (readonly) NSTimeInterval elapsedTime;
+/// The aggregate throughput of all jobs in frames per second of \c elapsedTime
+@property (readonly) double framesPerSecond;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,418 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+@import os.log;
+
+#import <os/lock.h>
+#import <stdatomic.h>
+#import <time.h>
+
+#import "SFBAudioBatchConverter.h"
+
+#import "SFBAudioConverter.h"
+#import "SFBAudioDecoder.h"
+#import "SFBAudioFile.h"
+
+#define DEFAULT_MAXIMUM_BUFFER_MEMORY (64 * 1024 * 1024)
+
+@interface SFBAudioConversionJob ()
+{
+@private
+	os_unfair_lock _lock;
+	SFBAudioConverter *_converter;
+	BOOL _cancelRequested;
+	BOOL _queued;
+	SFBAudioConversionJobState _state;
+	AVAudioFramePosition _framesConverted;
+	AVAudioFramePosition _frameLength;
+	NSError *_error;
+}
+/// Marks the job as queued, returning \c NO if it was already queued by a batch converter
+- (BOOL)beginQueueing;
+/// Marks the job as running unless it was cancelled, returning \c YES if the job should run
+- (BOOL)beginRunning;
+/// Sets the converter to be cancelled by \c -cancel, returning \c NO if the job was cancelled
+- (BOOL)attachConverter:(SFBAudioConverter *)converter;
+- (void)updateFramesConverted:(AVAudioFramePosition)framesConverted frameLength:(AVAudioFramePosition)frameLength;
+- (void)finishWithState:(SFBAudioConversionJobState)state error:(NSError *)error;
+- (void)cancel;
+@property (readonly, getter=isCancelled) BOOL cancelled;
+@end
+
+@implementation SFBAudioConversionJob
+
+- (instancetype)initWithSourceURL:(NSURL *)sourceURL destinationURL:(NSURL *)destinationURL
+{
+	return [self initWithSourceURL:sourceURL destinationURL:destinationURL encoderName:nil encoderSettings:nil copyMetadata:YES];
+}
+
+- (instancetype)initWithSourceURL:(NSURL *)sourceURL destinationURL:(NSURL *)destinationURL encoderName:(SFBAudioEncoderName)encoderName encoderSettings:(NSDictionary *)encoderSettings copyMetadata:(BOOL)copyMetadata
+{
+	NSParameterAssert(sourceURL != nil);
+	NSParameterAssert(destinationURL != nil);
+
+	if((self = [super init])) {
+		_sourceURL = sourceURL;
+		_destinationURL = destinationURL;
+		_encoderName = [encoderName copy];
+		_encoderSettings = [encoderSettings copy];
+		_copiesMetadata = copyMetadata;
+		_lock = OS_UNFAIR_LOCK_INIT;
+		_state = SFBAudioConversionJobStatePending;
+		_frameLength = SFBUnknownFrameLength;
+	}
+	return self;
+}
+
+- (SFBAudioConversionJobState)state
+{
+	os_unfair_lock_lock(&_lock);
+	SFBAudioConversionJobState state = _state;
+	os_unfair_lock_unlock(&_lock);
+	return state;
+}
+
+- (AVAudioFramePosition)framesConverted
+{
+	os_unfair_lock_lock(&_lock);
+	AVAudioFramePosition framesConverted = _framesConverted;
+	os_unfair_lock_unlock(&_lock);
+	return framesConverted;
+}
+
+- (double)progress
+{
+	os_unfair_lock_lock(&_lock);
+	double progress = 0;
+	if(_state == SFBAudioConversionJobStateSucceeded)
+		progress = 1;
+	else if(_frameLength > 0)
+		progress = MIN((double)_framesConverted / _frameLength, 1);
+	os_unfair_lock_unlock(&_lock);
+	return progress;
+}
+
+- (NSError *)error
+{
+	os_unfair_lock_lock(&_lock);
+	NSError *error = _error;
+	os_unfair_lock_unlock(&_lock);
+	return error;
+}
+
+- (BOOL)isCancelled
+{
+	os_unfair_lock_lock(&_lock);
+	BOOL cancelled = _cancelRequested;
+	os_unfair_lock_unlock(&_lock);
+	return cancelled;
+}
+
+- (BOOL)beginQueueing
+{
+	os_unfair_lock_lock(&_lock);
+	BOOL shouldQueue = !_queued;
+	_queued = YES;
+	os_unfair_lock_unlock(&_lock);
+	return shouldQueue;
+}
+
+- (BOOL)beginRunning
+{
+	os_unfair_lock_lock(&_lock);
+	BOOL shouldRun = !_cancelRequested && _state == SFBAudioConversionJobStatePending;
+	if(shouldRun)
+		_state = SFBAudioConversionJobStateRunning;
+	os_unfair_lock_unlock(&_lock);
+	return shouldRun;
+}
+
+- (BOOL)attachConverter:(SFBAudioConverter *)converter
+{
+	os_unfair_lock_lock(&_lock);
+	_converter = converter;
+	BOOL cancelled = _cancelRequested;
+	os_unfair_lock_unlock(&_lock);
+	return !cancelled;
+}
+
+- (void)updateFramesConverted:(AVAudioFramePosition)framesConverted frameLength:(AVAudioFramePosition)frameLength
+{
+	os_unfair_lock_lock(&_lock);
+	_framesConverted = framesConverted;
+	_frameLength = frameLength;
+	os_unfair_lock_unlock(&_lock);
+}
+
+- (void)finishWithState:(SFBAudioConversionJobState)state error:(NSError *)error
+{
+	os_unfair_lock_lock(&_lock);
+	_state = state;
+	_error = error;
+	_converter = nil;
+	os_unfair_lock_unlock(&_lock);
+}
+
+- (void)cancel
+{
+	os_unfair_lock_lock(&_lock);
+	_cancelRequested = YES;
+	SFBAudioConverter *converter = _converter;
+	os_unfair_lock_unlock(&_lock);
+	[converter cancel];
+}
+
+@end
+
+@interface SFBAudioBatchConverter ()
+{
+@private
+	dispatch_queue_t _schedulingQueue;
+	dispatch_queue_t _jobQueue;
+	dispatch_group_t _group;
+	dispatch_semaphore_t _jobSlots;
+
+	// Buffer memory accounting
+	NSCondition *_bufferMemoryCondition;
+	NSUInteger _bufferMemoryInUse;
+
+	// Job tracking and aggregate statistics
+	os_unfair_lock _lock;
+	NSMutableSet<SFBAudioConversionJob *> *_jobs;
+	uint64_t _busyStartTime;
+	uint64_t _busyTime;
+	_Atomic AVAudioFramePosition _framesConverted;
+}
+- (void)runJob:(SFBAudioConversionJob *)job;
+- (void)acquireBufferMemory:(NSUInteger)bytes;
+- (void)releaseBufferMemory:(NSUInteger)bytes;
+- (void)jobFinished:(SFBAudioConversionJob *)job;
+@end
+
+@implementation SFBAudioBatchConverter
+
+- (instancetype)init
+{
+	return [self initWithMaximumConcurrentJobs:NSProcessInfo.processInfo.activeProcessorCount maximumBufferMemory:DEFAULT_MAXIMUM_BUFFER_MEMORY];
+}
+
+- (instancetype)initWithMaximumConcurrentJobs:(NSUInteger)maximumConcurrentJobs maximumBufferMemory:(NSUInteger)maximumBufferMemory
+{
+	NSParameterAssert(maximumConcurrentJobs > 0);
+
+	if((self = [super init])) {
+		_maximumConcurrentJobs = maximumConcurrentJobs;
+		_maximumBufferMemory = maximumBufferMemory;
+
+		_schedulingQueue = dispatch_queue_create("org.sbooth.AudioEngine.AudioBatchConverter.Scheduling", DISPATCH_QUEUE_SERIAL);
+		_jobQueue = dispatch_queue_create("org.sbooth.AudioEngine.AudioBatchConverter.Jobs", DISPATCH_QUEUE_CONCURRENT);
+		_group = dispatch_group_create();
+
+		// The semaphore is created with a value of zero and then signaled so libdispatch doesn't
+		// consider it in use if the batch converter is deallocated with jobs outstanding
+		_jobSlots = dispatch_semaphore_create(0);
+		for(NSUInteger i = 0; i < maximumConcurrentJobs; ++i)
+			dispatch_semaphore_signal(_jobSlots);
+
+		_bufferMemoryCondition = [[NSCondition alloc] init];
+
+		_lock = OS_UNFAIR_LOCK_INIT;
+		_jobs = [NSMutableSet set];
+	}
+	return self;
+}
+
+- (void)addJob:(SFBAudioConversionJob *)job
+{
+	NSParameterAssert(job != nil);
+
+	// A job runs at most once, so a job that was already added is left alone
+	if(![job beginQueueing]) {
+		os_log_error(OS_LOG_DEFAULT, "Ignoring conversion job for %{public}@ that was already added", job.sourceURL);
+		return;
+	}
+
+	os_unfair_lock_lock(&_lock);
+	if(_jobs.count == 0)
+		_busyStartTime = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+	[_jobs addObject:job];
+	os_unfair_lock_unlock(&_lock);
+
+	// Jobs are started in order on the scheduling queue as slots become available
+	dispatch_group_async(_group, _schedulingQueue, ^{
+		dispatch_semaphore_wait(self->_jobSlots, DISPATCH_TIME_FOREVER);
+		dispatch_group_async(self->_group, self->_jobQueue, ^{
+			[self runJob:job];
+			dispatch_semaphore_signal(self->_jobSlots);
+		});
+	});
+}
+
+- (void)addJobs:(NSArray<SFBAudioConversionJob *> *)jobs
+{
+	NSParameterAssert(jobs != nil);
+
+	for(SFBAudioConversionJob *job in jobs)
+		[self addJob:job];
+}
+
+- (void)cancelJob:(SFBAudioConversionJob *)job
+{
+	NSParameterAssert(job != nil);
+	[job cancel];
+}
+
+- (void)cancelAllJobs
+{
+	os_unfair_lock_lock(&_lock);
+	NSArray *jobs = _jobs.allObjects;
+	os_unfair_lock_unlock(&_lock);
+
+	for(SFBAudioConversionJob *job in jobs)
+		[job cancel];
+}
+
+- (void)waitUntilAllJobsAreFinished
+{
+	dispatch_group_wait(_group, DISPATCH_TIME_FOREVER);
+}
+
+- (AVAudioFramePosition)framesConverted
+{
+	return atomic_load(&_framesConverted);
+}
+
+- (NSTimeInterval)elapsedTime
+{
+	os_unfair_lock_lock(&_lock);
+	uint64_t busyTime = _busyTime;
+	if(_jobs.count > 0)
+		busyTime += clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - _busyStartTime;
+	os_unfair_lock_unlock(&_lock);
+	return (double)busyTime / NSEC_PER_SEC;
+}
+
+- (double)framesPerSecond
+{
+	NSTimeInterval elapsedTime = self.elapsedTime;
+	return elapsedTime > 0 ? self.framesConverted / elapsedTime : 0;
+}
+
+#pragma mark - Internal
+
+- (void)runJob:(SFBAudioConversionJob *)job
+{
+	if(![job beginRunning]) {
+		[job finishWithState:SFBAudioConversionJobStateCancelled error:[NSError errorWithDomain:NSCocoaErrorDomain code:NSUserCancelledError userInfo:nil]];
+		[self jobFinished:job];
+		return;
+	}
+
+	NSError *error = nil;
+	SFBAudioConverter *converter = nil;
+
+	SFBAudioDecoder *decoder = [[SFBAudioDecoder alloc] initWithURL:job.sourceURL error:&error];
+	SFBAudioEncoder *encoder = nil;
+	if(decoder) {
+		if(job.encoderName)
+			encoder = [[SFBAudioEncoder alloc] initWithURL:job.destinationURL encoderName:job.encoderName error:&error];
+		else
+			encoder = [[SFBAudioEncoder alloc] initWithURL:job.destinationURL error:&error];
+	}
+
+	if(encoder) {
+		encoder.settings = job.encoderSettings;
+		SFBAudioMetadata *metadata = nil;
+		if(job.copiesMetadata)
+			metadata = [SFBAudioFile audioFileWithURL:job.sourceURL error:nil].metadata;
+		converter = [[SFBAudioConverter alloc] initWithDecoder:decoder encoder:encoder metadata:metadata error:&error];
+	}
+
+	if(!converter) {
+		os_log_error(OS_LOG_DEFAULT, "Error creating converter for %{public}@: %{public}@", job.sourceURL, error);
+		[decoder closeReturningError:nil];
+		if(encoder.isOpen)
+			[encoder closeReturningError:nil];
+		[job finishWithState:SFBAudioConversionJobStateFailed error:error];
+		[self jobFinished:job];
+		return;
+	}
+
+	converter.pipelined = _pipelined;
+
+	__block AVAudioFramePosition framesReported = 0;
+	SFBAudioBatchConverterJobProgressBlock jobProgressBlock = self.jobProgressBlock;
+	converter.progressBlock = ^(AVAudioFramePosition framesConverted, AVAudioFramePosition frameLength) {
+		atomic_fetch_add(&self->_framesConverted, framesConverted - framesReported);
+		framesReported = framesConverted;
+		[job updateFramesConverted:framesConverted frameLength:frameLength];
+		if(jobProgressBlock)
+			jobProgressBlock(job);
+	};
+
+	BOOL result = NO;
+	if([job attachConverter:converter]) {
+		NSUInteger bufferMemory = converter.bufferMemoryRequirement;
+		[self acquireBufferMemory:bufferMemory];
+		result = [converter convertReturningError:&error];
+		[self releaseBufferMemory:bufferMemory];
+	}
+	else
+		error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSUserCancelledError userInfo:nil];
+
+	if(result)
+		[job finishWithState:SFBAudioConversionJobStateSucceeded error:nil];
+	else {
+		// A failed conversion leaves the decoder and encoder open
+		if(decoder.isOpen)
+			[decoder closeReturningError:nil];
+		if(encoder.isOpen)
+			[encoder closeReturningError:nil];
+
+		// Remove the incomplete output
+		if(job.destinationURL.isFileURL)
+			[[NSFileManager defaultManager] removeItemAtURL:job.destinationURL error:nil];
+
+		BOOL cancelled = job.isCancelled && [error.domain isEqualToString:NSCocoaErrorDomain] && error.code == NSUserCancelledError;
+		if(!cancelled)
+			os_log_error(OS_LOG_DEFAULT, "Error converting %{public}@: %{public}@", job.sourceURL, error);
+		[job finishWithState:(cancelled ? SFBAudioConversionJobStateCancelled : SFBAudioConversionJobStateFailed) error:error];
+	}
+
+	[self jobFinished:job];
+}
+
+- (void)acquireBufferMemory:(NSUInteger)bytes
+{
+	[_bufferMemoryCondition lock];
+	// A job exceeding the limit by itself runs once no other job holds buffers
+	while(_bufferMemoryInUse > 0 && _bufferMemoryInUse + bytes > _maximumBufferMemory)
+		[_bufferMemoryCondition wait];
+	_bufferMemoryInUse += bytes;
+	[_bufferMemoryCondition unlock];
+}
+
+- (void)releaseBufferMemory:(NSUInteger)bytes
+{
+	[_bufferMemoryCondition lock];
+	_bufferMemoryInUse -= bytes;
+	[_bufferMemoryCondition broadcast];
+	[_bufferMemoryCondition unlock];
+}
+
+- (void)jobFinished:(SFBAudioConversionJob *)job
+{
+	os_unfair_lock_lock(&_lock);
+	[_jobs removeObject:job];
+	if(_jobs.count == 0)
+		_busyTime += clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - _busyStartTime;
+	os_unfair_lock_unlock(&_lock);
+
+	SFBAudioBatchConverterJobCompletionBlock jobCompletionBlock = self.jobCompletionBlock;
+	if(jobCompletionBlock)
+		jobCompletionBlock(job);
+}
+
+@end
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020 Stephen F. Booth <me@sbooth.org>
+ * Copyright (c) 2020 - 2021 Stephen F. Booth <me@sbooth.org>
  * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
  */
 
@@ -11,7 +11,31 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+@class SFBAudioConverterStatistics;
+
+/// A block called periodically during conversion
+/// @param framesConverted The number of frames encoded so far
+/// @param frameLength The total number of frames to be converted or \c SFBUnknownFrameLength
+typedef void (^SFBAudioConverterProgressBlock)(AVAudioFramePosition framesConverted, AVAudioFramePosition frameLength) NS_SWIFT_NAME(AudioConverter.ProgressBlock);
+
+/// How an \c SFBAudioConverter treats true peaks above \c truePeakCeiling when the encoder is lossy
+typedef NS_ENUM(NSInteger, SFBAudioConverterTruePeakHandling) {
+	/// True peaks are not measured
+	SFBAudioConverterTruePeakHandlingNone			= 0,
+	/// True peaks are measured during conversion and a message is logged if the ceiling is exceeded
+	SFBAudioConverterTruePeakHandlingWarn			= 1,
+	/// True peaks are measured before conversion and the audio is attenuated so its true peak does not exceed the ceiling
+	/// @note The decoder must support seeking. If it does not, true peaks are handled as for \c SFBAudioConverterTruePeakHandlingWarn.
+	SFBAudioConverterTruePeakHandlingNormalize		= 2,
+} NS_SWIFT_NAME(AudioConverter.TruePeakHandling);
+
 /// An audio converter
+///
+/// When the encoder's processing format is integer PCM with a lower bit depth than the decoder's audio, the audio is
+/// dithered as specified by the encoder's \c SFBAudioEncodingSettingsKeyDither setting.
+///
+/// Lossy encoding can raise inter-sample peaks enough to clip on playback, so when the encoder is lossy the true peak of
+/// the decoded audio is measured as specified in ITU-R BS.1770 Annex 2 and handled as specified by \c truePeakHandling.
 NS_SWIFT_NAME(AudioConverter) @interface SFBAudioConverter : NSObject
 
 /// Converts audio and writes to the specified URL
@@ -118,11 +142,83 @@ NS_SWIFT_NAME(AudioConverter) @interface SFBAudioConverter : NSObject
 /// Metadata to associate with the encoded audio
 @property (nonatomic, nullable) SFBAudioMetadata *metadata;
 
+/// Set to \c YES to decode, convert, and encode concurrently
+/// @note In pipelined mode decoding and format conversion are performed on separate threads and encoding on the calling thread,
+/// connected by bounded queues of reusable buffers. Conversion takes roughly as long as the slowest stage instead of the sum of all stages.
+@property (nonatomic, getter=isPipelined) BOOL pipelined;
+/// Throughput statistics for the most recent conversion or \c nil if unavailable
+@property (nonatomic, nullable, readonly) SFBAudioConverterStatistics *statistics;
+/// An optional block called on the encoding thread after each buffer is encoded
+@property (nonatomic, copy, nullable) SFBAudioConverterProgressBlock progressBlock;
+/// The approximate number of bytes of audio buffers allocated by \c -convertReturningError:
+@property (nonatomic, readonly) NSUInteger bufferMemoryRequirement;
+
+/// How true peaks above \c truePeakCeiling are treated when the encoder is lossy
+/// @note The default is \c SFBAudioConverterTruePeakHandlingWarn
+@property (nonatomic) SFBAudioConverterTruePeakHandling truePeakHandling;
+/// The largest acceptable true peak in dBTP
+/// @note The default is \c -1, as recommended by EBU R 128 for lossy distribution
+@property (nonatomic) double truePeakCeiling;
+/// The true peak of the decoded audio in dBTP for the most recent conversion, or \c -HUGE_VAL if it was not measured
+@property (nonatomic, readonly) double truePeak;
+/// The gain in dB applied to the audio for the most recent conversion to satisfy \c truePeakCeiling
+@property (nonatomic, readonly) double truePeakGain;
+
+/// Set to \c YES to remove leading and trailing silence before converting
+/// @note The decoder must support seeking. If it does not, or if the audio is entirely silent, the audio is converted without trimming.
+/// @note \c decoder is unchanged; the audible region is decoded through a private decoder. The estimated number of frames to encode
+/// reflects the trimmed audio unless the encoder was already open when the converter was initialized.
+@property (nonatomic) BOOL trimsSilence;
+/// The largest sample magnitude considered silent when \c trimsSilence is \c YES, as a fraction of full scale
+/// @note The default is \c 0, digital silence
+@property (nonatomic) float silenceThreshold;
+
 /// Converts audio
 /// @param error An optional pointer to an \c NSError object to receive error information
 /// @return \c YES on success, \c NO otherwise
 - (BOOL)convertReturningError:(NSError **)error NS_SWIFT_NAME(convert());
 
+/// Requests cancellation of an in-progress or future conversion
+/// @note This method may be called from any thread. A cancelled conversion fails with \c NSUserCancelledError in \c NSCocoaErrorDomain.
+- (void)cancel;
+
+@end
+
+/// Throughput statistics for a conversion
+///
+/// Encoder throughput may be compared across encoders and settings by converting the same source with each and
+/// serializing \c dictionaryRepresentation using \c NSJSONSerialization.
+NS_SWIFT_NAME(AudioConverter.Statistics) @interface SFBAudioConverterStatistics : NSObject
+
+/// The number of frames produced by the decoder
+@property (nonatomic, readonly) AVAudioFramePosition framesDecoded;
+/// The number of frames consumed by the encoder
+@property (nonatomic, readonly) AVAudioFramePosition framesEncoded;
+/// The wall time taken by the conversion, in seconds
+@property (nonatomic, readonly) NSTimeInterval elapsedTime;
+
+/// The decoder's throughput in frames per second of decoding time
+@property (nonatomic, readonly) double decodeFramesPerSecond;
+/// The format converter's throughput in frames per second of conversion time, or \c 0 if no conversion was required
+@property (nonatomic, readonly) double conversionFramesPerSecond;
+/// The encoder's throughput in frames per second of encoding time
+@property (nonatomic, readonly) double encodeFramesPerSecond;
+
+/// The average number of decoded buffers waiting when the next stage requested one, or \c 0 for serial conversions
+@property (nonatomic, readonly) double averageDecodeQueueOccupancy;
+/// The average number of buffers waiting when the encoder requested one, or \c 0 for serial conversions
+@property (nonatomic, readonly) double averageEncodeQueueOccupancy;
+
+/// The duration of the audio encoded divided by \c elapsedTime
+@property (nonatomic, readonly) double realtimeFactor;
+/// The number of bytes written by the encoder, or \c 0 if unknown
+@property (nonatomic, readonly) NSInteger bytesWritten;
+/// The peak resident memory of the process at the end of the conversion, in bytes
+@property (nonatomic, readonly) NSUInteger peakResidentMemory;
+
+/// The statistics as a dictionary of \c NSNumber objects keyed by property name
+@property (nonatomic, readonly) NSDictionary<NSString *, NSNumber *> *dictionaryRepresentation;
+
 @end
 
 /// The \c NSErrorDomain used by \c SFBAudioConverter
@@ -131,7 +227,13 @@ extern NSErrorDomain const SFBAudioConverterErrorDomain NS_SWIFT_NAME(AudioConve
 /// Possible \c NSError error codes used by \c SFBAudioExporter
 typedef NS_ERROR_ENUM(SFBAudioConverterErrorDomain, SFBAudioConverterErrorCode) {
 	/// Audio format not supported
-	SFBAudioConverterErrorCodeFormatNotSupported				= 0
+	SFBAudioConverterErrorCodeFormatNotSupported				= 0,
+	/// The decoder failed without providing an error
+	SFBAudioConverterErrorCodeDecodingFailed					= 1,
+	/// Conversion failed without providing an error
+	SFBAudioConverterErrorCodeConversionFailed					= 2,
+	/// The encoder failed without providing an error
+	SFBAudioConverterErrorCodeEncodingFailed					= 3,
 } NS_SWIFT_NAME(AudioConverter.ErrorCode);
 
 NS_ASSUME_NONNULL_END
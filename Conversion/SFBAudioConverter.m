@@ -1,27 +1,197 @@
 /*
- * Copyright (c) 2020 Stephen F. Booth <me@sbooth.org>
+ * Copyright (c) 2020 - 2021 Stephen F. Booth <me@sbooth.org>
  * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
  */
 
 @import os.log;
+@import Accelerate;
+
+#import <stdatomic.h>
+#import <time.h>
+
+#import <sys/resource.h>
 
 #import "SFBAudioConverter.h"
 
 #import "NSError+SFBURLPresentation.h"
 #import "SFBAudioDecoder.h"
+#import "SFBAudioDitherer.h"
 #import "SFBAudioEncoder.h"
 #import "SFBAudioFile.h"
+#import "SFBLoopableRegionDecoder.h"
+#import "SFBSilenceAnalyzer.h"
+#import "SFBTruePeakMeter.h"
 
 // NSError domain for SFBAudioConverter
 NSErrorDomain const SFBAudioConverterErrorDomain = @"org.sbooth.AudioEngine.AudioConverter";
 
 #define BUFFER_SIZE_FRAMES 2048
+#define PIPELINE_QUEUE_LENGTH 4
+
+/// A bounded single-producer, single-consumer queue of reusable audio buffers
+///
+/// The producer acquires an empty buffer, fills it, and commits it; the consumer acquires the oldest filled buffer,
+/// processes it, and commits it to return it to the pool. A buffer with \c frameLength of \c 0 marks the end of the stream.
+@interface SFBAudioConverterBufferQueue : NSObject
+{
+@private
+	NSArray<AVAudioPCMBuffer *> *_buffers;
+	dispatch_semaphore_t _emptySlots;
+	dispatch_semaphore_t _filledSlots;
+	_Atomic uint64_t _writeIndex;
+	_Atomic uint64_t _readIndex;
+	// Accessed only by the consumer
+	uint64_t _occupancySum;
+	uint64_t _occupancySamples;
+}
+- (nullable instancetype)initWithFormat:(AVAudioFormat *)format frameCapacity:(AVAudioFrameCount)frameCapacity length:(NSUInteger)length;
+- (AVAudioPCMBuffer *)acquireBufferForWriting;
+- (void)commitWrite;
+- (AVAudioPCMBuffer *)acquireBufferForReading;
+- (void)commitRead;
+@property (nonatomic, readonly) double averageOccupancy;
+@end
+
+@implementation SFBAudioConverterBufferQueue
+
+- (instancetype)initWithFormat:(AVAudioFormat *)format frameCapacity:(AVAudioFrameCount)frameCapacity length:(NSUInteger)length
+{
+	NSParameterAssert(format != nil);
+	NSParameterAssert(length > 0);
+
+	if((self = [super init])) {
+		NSMutableArray *buffers = [NSMutableArray arrayWithCapacity:length];
+		for(NSUInteger i = 0; i < length; ++i) {
+			AVAudioPCMBuffer *buffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:format frameCapacity:frameCapacity];
+			if(!buffer)
+				return nil;
+			[buffers addObject:buffer];
+		}
+		_buffers = buffers;
+
+		// Semaphores are created with a value of zero and then signaled so libdispatch doesn't
+		// consider them in use if a conversion is abandoned with buffers outstanding
+		_emptySlots = dispatch_semaphore_create(0);
+		for(NSUInteger i = 0; i < length; ++i)
+			dispatch_semaphore_signal(_emptySlots);
+		_filledSlots = dispatch_semaphore_create(0);
+	}
+	return self;
+}
+
+- (AVAudioPCMBuffer *)acquireBufferForWriting
+{
+	dispatch_semaphore_wait(_emptySlots, DISPATCH_TIME_FOREVER);
+	return _buffers[atomic_load_explicit(&_writeIndex, memory_order_relaxed) % _buffers.count];
+}
+
+- (void)commitWrite
+{
+	atomic_fetch_add_explicit(&_writeIndex, 1, memory_order_release);
+	dispatch_semaphore_signal(_filledSlots);
+}
+
+- (AVAudioPCMBuffer *)acquireBufferForReading
+{
+	dispatch_semaphore_wait(_filledSlots, DISPATCH_TIME_FOREVER);
+	uint64_t readIndex = atomic_load_explicit(&_readIndex, memory_order_relaxed);
+	_occupancySum += atomic_load_explicit(&_writeIndex, memory_order_acquire) - readIndex;
+	++_occupancySamples;
+	return _buffers[readIndex % _buffers.count];
+}
+
+- (void)commitRead
+{
+	atomic_fetch_add_explicit(&_readIndex, 1, memory_order_release);
+	dispatch_semaphore_signal(_emptySlots);
+}
+
+- (double)averageOccupancy
+{
+	return _occupancySamples > 0 ? (double)_occupancySum / _occupancySamples : 0;
+}
+
+@end
+
+@interface SFBAudioConverterStatistics ()
+@property (nonatomic) AVAudioFramePosition framesDecoded;
+@property (nonatomic) AVAudioFramePosition framesEncoded;
+@property (nonatomic) NSTimeInterval elapsedTime;
+@property (nonatomic) double decodeFramesPerSecond;
+@property (nonatomic) double conversionFramesPerSecond;
+@property (nonatomic) double encodeFramesPerSecond;
+@property (nonatomic) double averageDecodeQueueOccupancy;
+@property (nonatomic) double averageEncodeQueueOccupancy;
+@property (nonatomic) double realtimeFactor;
+@property (nonatomic) NSInteger bytesWritten;
+@property (nonatomic) NSUInteger peakResidentMemory;
+@end
+
+@implementation SFBAudioConverterStatistics
+
+- (NSDictionary<NSString *, NSNumber *> *)dictionaryRepresentation
+{
+	return @{
+		@"framesDecoded": @(_framesDecoded),
+		@"framesEncoded": @(_framesEncoded),
+		@"elapsedTime": @(_elapsedTime),
+		@"decodeFramesPerSecond": @(_decodeFramesPerSecond),
+		@"conversionFramesPerSecond": @(_conversionFramesPerSecond),
+		@"encodeFramesPerSecond": @(_encodeFramesPerSecond),
+		@"averageDecodeQueueOccupancy": @(_averageDecodeQueueOccupancy),
+		@"averageEncodeQueueOccupancy": @(_averageEncodeQueueOccupancy),
+		@"realtimeFactor": @(_realtimeFactor),
+		@"bytesWritten": @(_bytesWritten),
+		@"peakResidentMemory": @(_peakResidentMemory),
+	};
+}
+
+@end
+
+/// Returns the number of frames processed per second given a processing time in nanoseconds
+static double FramesPerSecond(AVAudioFramePosition frames, uint64_t nanoseconds)
+{
+	return nanoseconds > 0 ? (double)frames / ((double)nanoseconds / NSEC_PER_SEC) : 0;
+}
+
+/// Multiplies the samples in \c buffer, which must contain 32-bit floating point audio, by \c gain
+static void ApplyGain(AVAudioPCMBuffer *buffer, float gain)
+{
+	AudioBufferList *bufferList = buffer.mutableAudioBufferList;
+	for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i) {
+		float *samples = (float *)bufferList->mBuffers[i].mData;
+		vDSP_vsmul(samples, 1, &gain, samples, 1, buffer.frameLength * bufferList->mBuffers[i].mNumberChannels);
+	}
+}
+
+/// Returns the number of bytes required to store one frame of \c format in all channels
+static NSUInteger BytesPerFrameForAllChannels(AVAudioFormat *format)
+{
+	const AudioStreamBasicDescription *asbd = format.streamDescription;
+	return format.isInterleaved ? asbd->mBytesPerFrame : asbd->mBytesPerFrame * asbd->mChannelsPerFrame;
+}
 
 @interface SFBAudioConverter ()
 {
 @private
+	/// The decoder read during conversion, either \c _decoder or a region of it excluding trimmed silence
+	id <SFBPCMDecoding> _conversionDecoder;
+	/// \c YES if the encoder is opened when conversion begins, once the number of frames to encode is known
+	BOOL _opensEncoder;
 	AVAudioConverter *_converter;
+	/// Dithers converted audio to the encoder's processing format, or \c nil if \c _converter produces that format
+	SFBAudioDitherer *_ditherer;
+	/// Measures the decoded audio during conversion, or \c nil if true peaks are not measured during conversion
+	SFBTruePeakMeter *_truePeakMeter;
+	atomic_bool _cancelled;
+	atomic_bool _cancelPipeline;
+	/// Set when any pipeline stage fails, whether or not the stage provided an error
+	atomic_bool _pipelineFailed;
 }
+- (BOOL)trimSilenceReturningError:(NSError **)error;
+- (BOOL)normalizeTruePeakReturningError:(NSError **)error;
+- (BOOL)convertSeriallyReturningError:(NSError **)error;
+- (BOOL)convertPipelinedReturningError:(NSError **)error;
 @end
 
 @implementation SFBAudioConverter
@@ -33,6 +203,12 @@ NSErrorDomain const SFBAudioConverterErrorDomain = @"org.sbooth.AudioEngine.Audi
 			switch(err.code) {
 				case SFBAudioConverterErrorCodeFormatNotSupported:
 					return NSLocalizedString(@"The requested audio format is not supported.", @"");
+				case SFBAudioConverterErrorCodeDecodingFailed:
+					return NSLocalizedString(@"The audio could not be decoded.", @"");
+				case SFBAudioConverterErrorCodeConversionFailed:
+					return NSLocalizedString(@"The audio could not be converted.", @"");
+				case SFBAudioConverterErrorCodeEncodingFailed:
+					return NSLocalizedString(@"The audio could not be encoded.", @"");
 			}
 		}
 		return nil;
@@ -147,14 +323,20 @@ NSErrorDomain const SFBAudioConverterErrorDomain = @"org.sbooth.AudioEngine.Audi
 			if(![encoder setSourceFormat:desiredEncodingFormat error:error])
 				return nil;
 
-			encoder.estimatedFramesToEncode = decoder.frameLength;
-
-			if(![encoder openReturningError:error])
-				return nil;
+			// The encoder is opened by -convertReturningError: after any silence is trimmed
+			_opensEncoder = YES;
 		}
 		_encoder = encoder;
 
-		_converter = [[AVAudioConverter alloc] initFromFormat:decoder.processingFormat toFormat:encoder.processingFormat];
+		// Bit depth reduction is dithered unless disabled in the encoder settings
+		SFBAudioEncodingSettingsValueDither dither = encoder.settings[SFBAudioEncodingSettingsKeyDither];
+		if(![dither isEqual:SFBAudioEncodingSettingsValueDitherNone] && [SFBAudioDitherer shouldDitherFromFormat:decoder.processingFormat toFormat:encoder.processingFormat]) {
+			_ditherer = [[SFBAudioDitherer alloc] initWithOutputFormat:encoder.processingFormat dither:dither];
+			if(!_ditherer)
+				os_log_error(OS_LOG_DEFAULT, "Unable to dither to %{public}@", encoder.processingFormat);
+		}
+
+		_converter = [[AVAudioConverter alloc] initFromFormat:decoder.processingFormat toFormat:(_ditherer ? _ditherer.inputFormat : encoder.processingFormat)];
 		if(!_converter) {
 			if(error)
 				*error = [NSError SFB_errorWithDomain:SFBAudioConverterErrorDomain
@@ -167,21 +349,225 @@ NSErrorDomain const SFBAudioConverterErrorDomain = @"org.sbooth.AudioEngine.Audi
 		}
 
 		_metadata = [metadata copy];
+
+		_truePeakHandling = SFBAudioConverterTruePeakHandlingWarn;
+		_truePeakCeiling = -1;
+		_truePeak = -HUGE_VAL;
 	}
 	return self;
 }
 
+- (NSUInteger)bufferMemoryRequirement
+{
+	NSUInteger inputBytesPerFrame = BytesPerFrameForAllChannels(_converter.inputFormat);
+	NSUInteger outputBytesPerFrame = BytesPerFrameForAllChannels(_ditherer ? _ditherer.outputFormat : _converter.outputFormat);
+	// Audio is converted into a single intermediate buffer before dithering
+	NSUInteger ditherBytesPerFrame = _ditherer ? BytesPerFrameForAllChannels(_ditherer.inputFormat) : 0;
+
+	if(!_pipelined)
+		return BUFFER_SIZE_FRAMES * (inputBytesPerFrame + ditherBytesPerFrame + outputBytesPerFrame);
+
+	NSUInteger bytes = PIPELINE_QUEUE_LENGTH * BUFFER_SIZE_FRAMES * inputBytesPerFrame;
+	if(_ditherer || ![_converter.inputFormat isEqual:_converter.outputFormat])
+		bytes += BUFFER_SIZE_FRAMES * ditherBytesPerFrame + PIPELINE_QUEUE_LENGTH * BUFFER_SIZE_FRAMES * outputBytesPerFrame;
+	return bytes;
+}
+
+- (void)cancel
+{
+	atomic_store(&_cancelled, true);
+	atomic_store(&_cancelPipeline, true);
+}
+
 - (BOOL)convertReturningError:(NSError **)error
 {
-	AVAudioPCMBuffer *encodeBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:_converter.outputFormat frameCapacity:BUFFER_SIZE_FRAMES];
+	_statistics = nil;
+
+	_conversionDecoder = _decoder;
+	if(_trimsSilence && ![self trimSilenceReturningError:error])
+		return NO;
+
+	// Some encoders write the number of frames to encode in a header and require it to be accurate
+	if(_opensEncoder && !_encoder.isOpen) {
+		_encoder.estimatedFramesToEncode = _conversionDecoder.frameLength;
+		if(![_encoder openReturningError:error])
+			return NO;
+	}
+
+	_truePeak = -HUGE_VAL;
+	_truePeakGain = 0;
+	_truePeakMeter = nil;
+	if(_truePeakHandling != SFBAudioConverterTruePeakHandlingNone && !_encoder.encodingIsLossless) {
+		if(_truePeakHandling == SFBAudioConverterTruePeakHandlingNormalize && ![self normalizeTruePeakReturningError:error])
+			return NO;
+		// Audio is measured during conversion unless it was measured by normalization
+		if(_truePeak == -HUGE_VAL)
+			_truePeakMeter = [[SFBTruePeakMeter alloc] initWithFormat:_conversionDecoder.processingFormat];
+	}
+
+	if(_pipelined) {
+		if(![self convertPipelinedReturningError:error])
+			return NO;
+	}
+	else if(![self convertSeriallyReturningError:error])
+		return NO;
+
+	if(![_encoder finishEncodingReturningError:error])
+		return NO;
+
+	if(_truePeakMeter) {
+		_truePeak = _truePeakMeter.truePeak;
+		_truePeakMeter = nil;
+	}
+
+	if(_truePeak + _truePeakGain > _truePeakCeiling)
+		os_log(OS_LOG_DEFAULT, "True peak of %.2f dBTP exceeds the ceiling of %.2f dBTP for lossy encoding", _truePeak + _truePeakGain, _truePeakCeiling);
+
+	if(_statistics) {
+		const double sampleRate = _encoder.processingFormat.sampleRate;
+		if(sampleRate > 0 && _statistics.elapsedTime > 0)
+			_statistics.realtimeFactor = (_statistics.framesEncoded / sampleRate) / _statistics.elapsedTime;
+
+		// Encoders may have seeked to update headers so the length is preferred to the offset
+		NSInteger bytesWritten;
+		SFBOutputSource *outputSource = _encoder.outputSource;
+		if(outputSource.isOpen && ([outputSource getLength:&bytesWritten error:nil] || [outputSource getOffset:&bytesWritten error:nil]))
+			_statistics.bytesWritten = bytesWritten;
+
+		struct rusage usage;
+		if(getrusage(RUSAGE_SELF, &usage) == 0)
+			_statistics.peakResidentMemory = (NSUInteger)usage.ru_maxrss;
+	}
+
+	if(![_encoder closeReturningError:error])
+		return NO;
+
+	if(![_conversionDecoder closeReturningError:error])
+		return NO;
+
+	if(_metadata && _encoder.outputSource.url.isFileURL) {
+		SFBAudioFile *audioFile = [[SFBAudioFile alloc] initWithURL:_encoder.outputSource.url];
+		if(audioFile) {
+			audioFile.metadata = _metadata;
+			if(![audioFile writeMetadataReturningError:error])
+				os_log_error(OS_LOG_DEFAULT, "Error writing metadata: %{public}@", error ? *error : nil);
+		}
+	}
+
+	return YES;
+}
+
+- (BOOL)trimSilenceReturningError:(NSError **)error
+{
+	if(!_conversionDecoder.supportsSeeking) {
+		os_log_info(OS_LOG_DEFAULT, "Unable to trim silence: decoder does not support seeking");
+		return YES;
+	}
+
+	const AVAudioFramePosition startingFrame = _conversionDecoder.framePosition;
+	NSDictionary *silence = [SFBSilenceAnalyzer analyzeDecoder:_conversionDecoder threshold:_silenceThreshold error:error];
+	if(!silence)
+		return NO;
+
+	const AVAudioFramePosition leadingSilence = [silence[SFBSilenceAnalyzerLeadingSilenceKey] longLongValue];
+	const AVAudioFramePosition trailingSilence = [silence[SFBSilenceAnalyzerTrailingSilenceKey] longLongValue];
+	const AVAudioFramePosition frameLength = [silence[SFBSilenceAnalyzerFrameLengthKey] longLongValue];
+
+	// Audio without silence and audio that is entirely silent are converted unchanged
+	if((leadingSilence == 0 && trailingSilence == 0) || leadingSilence == frameLength)
+		return [_conversionDecoder seekToFrame:startingFrame error:error];
+
+	// The region decoder positions the original decoder at the first audible frame when opened
+	SFBLoopableRegionDecoder *decoder = [[SFBLoopableRegionDecoder alloc] initWithDecoder:_conversionDecoder framePosition:startingFrame + leadingSilence frameLength:frameLength - leadingSilence - trailingSilence error:error];
+	if(!decoder || ![decoder openReturningError:error])
+		return NO;
+
+	os_log_debug(OS_LOG_DEFAULT, "Trimming %lld frames of leading and %lld frames of trailing silence", leadingSilence, trailingSilence);
+
+	_conversionDecoder = decoder;
+	return YES;
+}
+
+- (BOOL)normalizeTruePeakReturningError:(NSError **)error
+{
+	if(!_conversionDecoder.supportsSeeking) {
+		os_log_info(OS_LOG_DEFAULT, "Unable to normalize true peak: decoder does not support seeking");
+		return YES;
+	}
+
+	// Gain is applied to floating point audio before dithering or encoding
+	if(!_ditherer && _encoder.processingFormat.commonFormat != AVAudioPCMFormatFloat32) {
+		os_log_info(OS_LOG_DEFAULT, "Unable to normalize true peak for encoding format %{public}@", _encoder.processingFormat);
+		return YES;
+	}
+
+	SFBTruePeakMeter *truePeakMeter = [[SFBTruePeakMeter alloc] initWithFormat:_conversionDecoder.processingFormat];
+	AVAudioPCMBuffer *buffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:_conversionDecoder.processingFormat frameCapacity:BUFFER_SIZE_FRAMES];
+	if(!truePeakMeter || !buffer)
+		return YES;
+
+	const AVAudioFramePosition startingFrame = _conversionDecoder.framePosition;
+	for(;;) {
+		if(atomic_load(&_cancelled)) {
+			if(error)
+				*error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSUserCancelledError userInfo:nil];
+			return NO;
+		}
+
+		if(![_conversionDecoder decodeIntoBuffer:buffer frameLength:buffer.frameCapacity error:error])
+			return NO;
+		if(buffer.frameLength == 0)
+			break;
+		[truePeakMeter analyzeBuffer:buffer];
+	}
+
+	if(![_conversionDecoder seekToFrame:startingFrame error:error])
+		return NO;
+
+	_truePeak = truePeakMeter.truePeak;
+	if(_truePeak > _truePeakCeiling)
+		_truePeakGain = _truePeakCeiling - _truePeak;
+
+	return YES;
+}
+
+- (BOOL)convertSeriallyReturningError:(NSError **)error
+{
+	AVAudioPCMBuffer *encodeBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:_encoder.processingFormat frameCapacity:BUFFER_SIZE_FRAMES];
 	AVAudioPCMBuffer *decodeBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:_converter.inputFormat frameCapacity:BUFFER_SIZE_FRAMES];
+	AVAudioPCMBuffer *convertBuffer = _ditherer ? [[AVAudioPCMBuffer alloc] initWithPCMFormat:_converter.outputFormat frameCapacity:BUFFER_SIZE_FRAMES] : encodeBuffer;
+	const float gain = (float)pow(10, _truePeakGain / 20);
+
+	const uint64_t startTime = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+
+	const AVAudioFramePosition frameLength = _conversionDecoder.frameLength;
+	__block AVAudioFramePosition framesDecoded = 0;
+	__block uint64_t decodeTime = 0;
+	AVAudioFramePosition framesConverted = 0;
+	uint64_t conversionTime = 0;
+	AVAudioFramePosition framesEncoded = 0;
+	uint64_t encodeTime = 0;
 
 	for(;;) {
-		AVAudioConverterOutputStatus status = [_converter convertToBuffer:encodeBuffer error:error withInputFromBlock:^AVAudioBuffer *(AVAudioPacketCount inNumberOfPackets, AVAudioConverterInputStatus *outStatus) {
+		if(atomic_load(&_cancelled)) {
+			if(error)
+				*error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSUserCancelledError userInfo:nil];
+			return NO;
+		}
+
+		// Decoding happens within the conversion and its time is subtracted from the conversion time
+		const uint64_t conversionStart = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+		const uint64_t decodeTimeBefore = decodeTime;
+		AVAudioConverterOutputStatus status = [_converter convertToBuffer:convertBuffer error:error withInputFromBlock:^AVAudioBuffer *(AVAudioPacketCount inNumberOfPackets, AVAudioConverterInputStatus *outStatus) {
+			const uint64_t decodeStart = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
 			NSError *err = nil;
-			BOOL result = [self->_decoder decodeIntoBuffer:decodeBuffer frameLength:inNumberOfPackets error:&err];
+			BOOL result = [self->_conversionDecoder decodeIntoBuffer:decodeBuffer frameLength:inNumberOfPackets error:&err];
+			decodeTime += clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - decodeStart;
+			framesDecoded += decodeBuffer.frameLength;
 			if(!result)
 				os_log_error(OS_LOG_DEFAULT, "Error decoding audio: %{public}@", err);
+			else if(decodeBuffer.frameLength > 0)
+				[self->_truePeakMeter analyzeBuffer:decodeBuffer];
 
 			if(decodeBuffer.frameLength == 0) {
 				if(result)
@@ -201,28 +587,261 @@ NSErrorDomain const SFBAudioConverterErrorDomain = @"org.sbooth.AudioEngine.Audi
 		else if(status == AVAudioConverterOutputStatus_EndOfStream)
 			break;
 
+		if(_truePeakGain != 0)
+			ApplyGain(convertBuffer, gain);
+
+		if(_ditherer && ![_ditherer ditherBuffer:convertBuffer intoBuffer:encodeBuffer error:error]) {
+			os_log_error(OS_LOG_DEFAULT, "Error dithering audio: %{public}@", error ? *error : nil);
+			return NO;
+		}
+
+		conversionTime += clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - conversionStart - (decodeTime - decodeTimeBefore);
+		framesConverted += encodeBuffer.frameLength;
+
+		const uint64_t encodeStart = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
 		if(![_encoder encodeFromBuffer:encodeBuffer frameLength:encodeBuffer.frameLength error:error]) {
 			os_log_error(OS_LOG_DEFAULT, "Error encoding audio: %{public}@", error ? *error : nil);
 			return NO;
 		}
+		encodeTime += clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - encodeStart;
+
+		framesEncoded += encodeBuffer.frameLength;
+		if(_progressBlock)
+			_progressBlock(framesEncoded, frameLength);
 	}
 
-	if(![_encoder finishEncodingReturningError:error])
-		return NO;
+	SFBAudioConverterStatistics *statistics = [[SFBAudioConverterStatistics alloc] init];
+	statistics.framesDecoded = framesDecoded;
+	statistics.framesEncoded = framesEncoded;
+	statistics.elapsedTime = (double)(clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - startTime) / NSEC_PER_SEC;
+	statistics.decodeFramesPerSecond = FramesPerSecond(framesDecoded, decodeTime);
+	statistics.conversionFramesPerSecond = FramesPerSecond(framesConverted, conversionTime);
+	statistics.encodeFramesPerSecond = FramesPerSecond(framesEncoded, encodeTime);
+	_statistics = statistics;
 
-	if(![_encoder closeReturningError:error])
-		return NO;
+	return YES;
+}
+
+- (BOOL)convertPipelinedReturningError:(NSError **)error
+{
+	const uint64_t startTime = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+
+	// Conversion is skipped when the decoder produces audio in the encoder's processing format and no gain is applied
+	const BOOL needsConversion = _ditherer || _truePeakGain != 0 || ![_converter.inputFormat isEqual:_converter.outputFormat];
+	const float gain = (float)pow(10, _truePeakGain / 20);
+
+	SFBAudioConverterBufferQueue *decodeQueue = [[SFBAudioConverterBufferQueue alloc] initWithFormat:_converter.inputFormat frameCapacity:BUFFER_SIZE_FRAMES length:PIPELINE_QUEUE_LENGTH];
+	SFBAudioConverterBufferQueue *encodeQueue = decodeQueue;
+	if(needsConversion)
+		encodeQueue = [[SFBAudioConverterBufferQueue alloc] initWithFormat:_encoder.processingFormat frameCapacity:BUFFER_SIZE_FRAMES length:PIPELINE_QUEUE_LENGTH];
 
-	if(![_decoder closeReturningError:error])
+	// When dithering, audio is converted into an intermediate buffer and then dithered into the encode queue
+	AVAudioPCMBuffer *ditherBuffer = nil;
+	if(_ditherer)
+		ditherBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:_converter.outputFormat frameCapacity:BUFFER_SIZE_FRAMES];
+
+	if(!decodeQueue || !encodeQueue || (_ditherer && !ditherBuffer)) {
+		if(error)
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
 		return NO;
+	}
 
-	if(_metadata && _encoder.outputSource.url.isFileURL) {
-		SFBAudioFile *audioFile = [[SFBAudioFile alloc] initWithURL:_encoder.outputSource.url];
-		if(audioFile) {
-			audioFile.metadata = _metadata;
-			if(![audioFile writeMetadataReturningError:error])
-				os_log_error(OS_LOG_DEFAULT, "Error writing metadata: %{public}@", error ? *error : nil);
+	// A cancellation requested before conversion began is honored
+	atomic_store(&_cancelPipeline, atomic_load(&_cancelled));
+	atomic_store(&_pipelineFailed, false);
+
+	__block NSError *decodeError = nil;
+	__block AVAudioFramePosition framesDecoded = 0;
+	__block uint64_t decodeTime = 0;
+
+	__block NSError *conversionError = nil;
+	__block AVAudioFramePosition framesConverted = 0;
+	__block uint64_t conversionTime = 0;
+
+	dispatch_group_t group = dispatch_group_create();
+	dispatch_queue_t queue = dispatch_get_global_queue(qos_class_self(), 0);
+
+	// Decode
+	dispatch_group_async(group, queue, ^{
+		for(;;) {
+			AVAudioPCMBuffer *buffer = [decodeQueue acquireBufferForWriting];
+			if(atomic_load(&self->_cancelPipeline))
+				buffer.frameLength = 0;
+			else {
+				const uint64_t start = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+				NSError *err = nil;
+				BOOL result = [self->_conversionDecoder decodeIntoBuffer:buffer frameLength:buffer.frameCapacity error:&err];
+				decodeTime += clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - start;
+				if(!result) {
+					os_log_error(OS_LOG_DEFAULT, "Error decoding audio: %{public}@", err);
+					// Decoders are not required to provide an error on failure
+					decodeError = err ?: [NSError errorWithDomain:SFBAudioConverterErrorDomain code:SFBAudioConverterErrorCodeDecodingFailed userInfo:nil];
+					buffer.frameLength = 0;
+					atomic_store(&self->_pipelineFailed, true);
+					atomic_store(&self->_cancelPipeline, true);
+				}
+				else if(buffer.frameLength > 0)
+					[self->_truePeakMeter analyzeBuffer:buffer];
+			}
+
+			const AVAudioFrameCount frameLength = buffer.frameLength;
+			framesDecoded += frameLength;
+			[decodeQueue commitWrite];
+
+			if(frameLength == 0)
+				break;
 		}
+	});
+
+	// Convert
+	if(needsConversion) {
+		dispatch_group_async(group, queue, ^{
+			// The decoded buffer most recently lent to the converter
+			__block BOOL bufferLent = NO;
+			__block BOOL endOfInput = NO;
+
+			AVAudioConverterInputBlock inputBlock = ^AVAudioBuffer *(AVAudioPacketCount inNumberOfPackets, AVAudioConverterInputStatus *outStatus) {
+#pragma unused(inNumberOfPackets)
+				// The converter requests more input only after consuming the previous buffer
+				if(bufferLent) {
+					[decodeQueue commitRead];
+					bufferLent = NO;
+				}
+
+				if(endOfInput) {
+					*outStatus = AVAudioConverterInputStatus_EndOfStream;
+					return nil;
+				}
+
+				AVAudioPCMBuffer *buffer = [decodeQueue acquireBufferForReading];
+				if(buffer.frameLength == 0) {
+					[decodeQueue commitRead];
+					endOfInput = YES;
+					*outStatus = AVAudioConverterInputStatus_EndOfStream;
+					return nil;
+				}
+
+				bufferLent = YES;
+				*outStatus = AVAudioConverterInputStatus_HaveData;
+				return buffer;
+			};
+
+			for(;;) {
+				AVAudioPCMBuffer *buffer = [encodeQueue acquireBufferForWriting];
+				AVAudioConverterOutputStatus status = AVAudioConverterOutputStatus_EndOfStream;
+				buffer.frameLength = 0;
+
+				if(!atomic_load(&self->_cancelPipeline)) {
+					const uint64_t start = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+					NSError *err = nil;
+					status = [self->_converter convertToBuffer:(ditherBuffer ?: buffer) error:&err withInputFromBlock:inputBlock];
+					if(status == AVAudioConverterOutputStatus_Error) {
+						os_log_error(OS_LOG_DEFAULT, "Error converting audio: %{public}@", err);
+						conversionError = err ?: [NSError errorWithDomain:SFBAudioConverterErrorDomain code:SFBAudioConverterErrorCodeConversionFailed userInfo:nil];
+						buffer.frameLength = 0;
+						atomic_store(&self->_pipelineFailed, true);
+						atomic_store(&self->_cancelPipeline, true);
+					}
+					else {
+						if(self->_truePeakGain != 0)
+							ApplyGain(ditherBuffer ?: buffer, gain);
+
+						if(ditherBuffer && ![self->_ditherer ditherBuffer:ditherBuffer intoBuffer:buffer error:&err]) {
+							os_log_error(OS_LOG_DEFAULT, "Error dithering audio: %{public}@", err);
+							conversionError = err ?: [NSError errorWithDomain:SFBAudioConverterErrorDomain code:SFBAudioConverterErrorCodeConversionFailed userInfo:nil];
+							buffer.frameLength = 0;
+							status = AVAudioConverterOutputStatus_Error;
+							atomic_store(&self->_pipelineFailed, true);
+							atomic_store(&self->_cancelPipeline, true);
+						}
+					}
+					conversionTime += clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - start;
+				}
+
+				const AVAudioFrameCount frameLength = buffer.frameLength;
+				framesConverted += frameLength;
+				[encodeQueue commitWrite];
+
+				if(frameLength == 0)
+					break;
+
+				// Audio returned with the end of stream still requires an end of stream marker
+				if(status == AVAudioConverterOutputStatus_EndOfStream) {
+					buffer = [encodeQueue acquireBufferForWriting];
+					buffer.frameLength = 0;
+					[encodeQueue commitWrite];
+					break;
+				}
+			}
+
+			// Return any buffer still lent to the converter and discard unconverted input
+			if(bufferLent)
+				[decodeQueue commitRead];
+			while(!endOfInput) {
+				AVAudioPCMBuffer *buffer = [decodeQueue acquireBufferForReading];
+				endOfInput = buffer.frameLength == 0;
+				[decodeQueue commitRead];
+			}
+		});
+	}
+
+	// Encode on the calling thread
+	NSError *encodeError = nil;
+	AVAudioFramePosition framesEncoded = 0;
+	uint64_t encodeTime = 0;
+	const AVAudioFramePosition frameLength = _conversionDecoder.frameLength;
+
+	for(;;) {
+		AVAudioPCMBuffer *buffer = [encodeQueue acquireBufferForReading];
+		const AVAudioFrameCount bufferFrameLength = buffer.frameLength;
+
+		if(bufferFrameLength > 0 && !atomic_load(&_pipelineFailed)) {
+			const uint64_t start = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+			NSError *err = nil;
+			BOOL result = [_encoder encodeFromBuffer:buffer frameLength:bufferFrameLength error:&err];
+			encodeTime += clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - start;
+			if(result) {
+				framesEncoded += bufferFrameLength;
+				if(_progressBlock)
+					_progressBlock(framesEncoded, frameLength);
+			}
+			else {
+				os_log_error(OS_LOG_DEFAULT, "Error encoding audio: %{public}@", err);
+				encodeError = err ?: [NSError errorWithDomain:SFBAudioConverterErrorDomain code:SFBAudioConverterErrorCodeEncodingFailed userInfo:nil];
+				atomic_store(&_pipelineFailed, true);
+				atomic_store(&_cancelPipeline, true);
+			}
+		}
+
+		[encodeQueue commitRead];
+
+		if(bufferFrameLength == 0)
+			break;
+	}
+
+	dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+
+	SFBAudioConverterStatistics *statistics = [[SFBAudioConverterStatistics alloc] init];
+	statistics.framesDecoded = framesDecoded;
+	statistics.framesEncoded = framesEncoded;
+	statistics.elapsedTime = (double)(clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - startTime) / NSEC_PER_SEC;
+	statistics.decodeFramesPerSecond = FramesPerSecond(framesDecoded, decodeTime);
+	statistics.conversionFramesPerSecond = FramesPerSecond(framesConverted, conversionTime);
+	statistics.encodeFramesPerSecond = FramesPerSecond(framesEncoded, encodeTime);
+	statistics.averageDecodeQueueOccupancy = decodeQueue.averageOccupancy;
+	statistics.averageEncodeQueueOccupancy = encodeQueue.averageOccupancy;
+	_statistics = statistics;
+
+	// An error from an earlier stage is preferred since later stages fail as a consequence
+	if(atomic_load(&_pipelineFailed)) {
+		if(error)
+			*error = decodeError ?: conversionError ?: encodeError;
+		return NO;
+	}
+	else if(atomic_load(&_cancelled)) {
+		if(error)
+			*error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSUserCancelledError userInfo:nil];
+		return NO;
 	}
 
 	return YES;
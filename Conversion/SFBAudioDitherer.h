@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <AVFoundation/AVFoundation.h>
+
+#import "SFBAudioEncoder.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Reduces the bit depth of audio using TPDF dither and optional noise shaping
+///
+/// Audio in \c inputFormat is dithered in place and then converted exactly to \c outputFormat.
+/// @note This class is not thread safe
+@interface SFBAudioDitherer : NSObject
+
+/// Returns \c YES if audio in \c sourceFormat should be dithered when converted to \c destinationFormat
+///
+/// Dither is appropriate when \c destinationFormat is integer PCM with a bit depth from 8 to 24 and \c sourceFormat
+/// is floating point or has a greater bit depth.
++ (BOOL)shouldDitherFromFormat:(AVAudioFormat *)sourceFormat toFormat:(AVAudioFormat *)destinationFormat;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Returns an initialized \c SFBAudioDitherer object or \c nil if \c outputFormat is not supported
+/// @param outputFormat The format of the dithered audio
+/// @param dither The dither to apply, or \c nil for \c SFBAudioEncodingSettingsValueDitherTPDF
+- (nullable instancetype)initWithOutputFormat:(AVAudioFormat *)outputFormat dither:(nullable SFBAudioEncodingSettingsValueDither)dither NS_DESIGNATED_INITIALIZER;
+
+/// The format of audio accepted by \c -ditherBuffer:intoBuffer:error:
+///
+/// This is non-interleaved 32-bit floating point with the sample rate and channel layout of \c outputFormat
+@property (nonatomic, readonly) AVAudioFormat *inputFormat;
+/// The format of the dithered audio
+@property (nonatomic, readonly) AVAudioFormat *outputFormat;
+
+/// Dithers \c sourceBuffer in place and converts it to \c outputFormat in \c destinationBuffer
+/// @param sourceBuffer A buffer in \c inputFormat
+/// @param destinationBuffer A buffer in \c outputFormat with sufficient capacity to hold the contents of \c sourceBuffer
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return \c YES on success, \c NO otherwise
+- (BOOL)ditherBuffer:(AVAudioPCMBuffer *)sourceBuffer intoBuffer:(AVAudioPCMBuffer *)destinationBuffer error:(NSError **)error;
+
+/// Clears the noise shaping filter state
+- (void)reset;
+
+@end
+
+NS_ASSUME_NONNULL_END
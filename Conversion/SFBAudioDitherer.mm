@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <os/log.h>
+
+#import "SFBAudioDitherer.h"
+
+#import "AudioDither.h"
+#import "AudioPCMConverter.h"
+
+namespace {
+
+	/// Returns the noise shaping corresponding to \c dither, or \c false if no dither should be applied
+	bool NoiseShapingForDither(SFBAudioEncodingSettingsValueDither dither, SFB::Audio::Dither::NoiseShaping& noiseShaping)
+	{
+		if(!dither || [dither isEqualToString:SFBAudioEncodingSettingsValueDitherTPDF])
+			noiseShaping = SFB::Audio::Dither::NoiseShaping::None;
+		else if([dither isEqualToString:SFBAudioEncodingSettingsValueDitherTPDFHighpass])
+			noiseShaping = SFB::Audio::Dither::NoiseShaping::Highpass;
+		else if([dither isEqualToString:SFBAudioEncodingSettingsValueDitherLipshitz])
+			noiseShaping = SFB::Audio::Dither::NoiseShaping::Lipshitz;
+		else if([dither isEqualToString:SFBAudioEncodingSettingsValueDitherWannamaker])
+			noiseShaping = SFB::Audio::Dither::NoiseShaping::Wannamaker;
+		else
+			return false;
+		return true;
+	}
+
+	/// Returns non-interleaved 32-bit floating point audio with the sample rate and channel layout of \c format
+	AVAudioFormat * FloatFormatMatchingFormat(AVAudioFormat *format)
+	{
+		if(format.channelLayout)
+			return [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat32 sampleRate:format.sampleRate interleaved:NO channelLayout:format.channelLayout];
+		return [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat32 sampleRate:format.sampleRate channels:format.channelCount interleaved:NO];
+	}
+
+}
+
+@interface SFBAudioDitherer ()
+{
+@private
+	SFB::Audio::Dither _dither;
+	SFB::Audio::PCMConverter _converter;
+}
+@end
+
+@implementation SFBAudioDitherer
+
++ (BOOL)shouldDitherFromFormat:(AVAudioFormat *)sourceFormat toFormat:(AVAudioFormat *)destinationFormat
+{
+	NSParameterAssert(sourceFormat != nil);
+	NSParameterAssert(destinationFormat != nil);
+
+	const AudioStreamBasicDescription *sourceDescription = sourceFormat.streamDescription;
+	const AudioStreamBasicDescription *destinationDescription = destinationFormat.streamDescription;
+
+	if(sourceDescription->mFormatID != kAudioFormatLinearPCM || destinationDescription->mFormatID != kAudioFormatLinearPCM)
+		return NO;
+
+	if(destinationDescription->mFormatFlags & kAudioFormatFlagIsFloat || destinationDescription->mBitsPerChannel < 8 || destinationDescription->mBitsPerChannel > 24)
+		return NO;
+
+	if(!(sourceDescription->mFormatFlags & kAudioFormatFlagIsFloat) && sourceDescription->mBitsPerChannel <= destinationDescription->mBitsPerChannel)
+		return NO;
+
+	AVAudioFormat *inputFormat = FloatFormatMatchingFormat(destinationFormat);
+	return inputFormat && SFB::Audio::PCMConverter::CanConvert(SFB::Audio::Format(inputFormat.streamDescription), SFB::Audio::Format(destinationDescription));
+}
+
+- (instancetype)initWithOutputFormat:(AVAudioFormat *)outputFormat dither:(SFBAudioEncodingSettingsValueDither)dither
+{
+	NSParameterAssert(outputFormat != nil);
+
+	if((self = [super init])) {
+		SFB::Audio::Dither::NoiseShaping noiseShaping;
+		if(!NoiseShapingForDither(dither, noiseShaping)) {
+			os_log_error(OS_LOG_DEFAULT, "Unknown dither: %{public}@", dither);
+			return nil;
+		}
+
+		_outputFormat = outputFormat;
+		_inputFormat = FloatFormatMatchingFormat(outputFormat);
+		if(!_inputFormat)
+			return nil;
+
+		if(!_converter.Initialize(SFB::Audio::Format(_inputFormat.streamDescription), SFB::Audio::Format(_outputFormat.streamDescription))) {
+			os_log_error(OS_LOG_DEFAULT, "Unsupported dither output format: %{public}@", _outputFormat);
+			return nil;
+		}
+
+		if(!_dither.Initialize(_outputFormat.channelCount, _outputFormat.streamDescription->mBitsPerChannel, noiseShaping, _outputFormat.sampleRate))
+			return nil;
+	}
+	return self;
+}
+
+- (BOOL)ditherBuffer:(AVAudioPCMBuffer *)sourceBuffer intoBuffer:(AVAudioPCMBuffer *)destinationBuffer error:(NSError **)error
+{
+	NSParameterAssert(sourceBuffer != nil);
+	NSParameterAssert(destinationBuffer != nil);
+
+	if(![sourceBuffer.format isEqual:_inputFormat] || ![destinationBuffer.format isEqual:_outputFormat] || destinationBuffer.frameCapacity < sourceBuffer.frameLength) {
+		if(error)
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EINVAL userInfo:nil];
+		return NO;
+	}
+
+	const AVAudioFrameCount frameLength = sourceBuffer.frameLength;
+	_dither.Process(sourceBuffer.floatChannelData, frameLength);
+
+	if(!_converter.Convert(sourceBuffer.audioBufferList, destinationBuffer.mutableAudioBufferList, frameLength)) {
+		if(error)
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EINVAL userInfo:nil];
+		return NO;
+	}
+
+	destinationBuffer.frameLength = frameLength;
+	return YES;
+}
+
+- (void)reset
+{
+	_dither.Reset();
+}
+
+@end
@@ -1,15 +1,27 @@
 /*
- * Copyright (c) 2020 Stephen F. Booth <me@sbooth.org>
+ * Copyright (c) 2020 - 2021 Stephen F. Booth <me@sbooth.org>
  * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
  */
 
 #import <Foundation/Foundation.h>
 
 @protocol SFBPCMDecoding;
+@class SFBOutputSource;
 
 NS_ASSUME_NONNULL_BEGIN
 
+/// Stream types supported by \c SFBAudioExporter without conversion
+typedef NS_ENUM(NSInteger, SFBAudioExporterFileType) {
+	/// RIFF WAVE
+	SFBAudioExporterFileTypeWAVE	= 0,
+	/// AIFF, or AIFF-C for floating point audio
+	SFBAudioExporterFileTypeAIFF	= 1
+} NS_SWIFT_NAME(AudioExporter.FileType);
+
 /// A class that exports audio using \c AVAudioFile
+///
+/// When exporting to WAVE or AIFF and the decoder's processing format is integer or floating point PCM with a
+/// whole number of bytes per sample, the decoded audio is written directly to the file without \c AVAudioFile.
 NS_SWIFT_NAME(AudioExporter) @interface SFBAudioExporter : NSObject
 
 /// Exports audio to the specified URL
@@ -28,6 +40,19 @@ NS_SWIFT_NAME(AudioExporter) @interface SFBAudioExporter : NSObject
 /// @return \c YES on success, \c NO otherwise
 + (BOOL)exportDecoder:(id <SFBPCMDecoding>)decoder toURL:(NSURL *)targetURL error:(NSError **)error;
 
+/// Exports audio to the specified output source without conversion
+///
+/// The output source may be a pipe or standard output. If \c outputSource supports seeking the header is updated after
+/// the audio is written. Otherwise the header declares the decoder's frame length, or the largest length possible if the
+/// frame length is unknown.
+/// @note \c outputSource is opened if necessary and closed if it was opened by this method
+/// @param decoder The decoder to export
+/// @param outputSource The destination output source
+/// @param fileType The type of stream to write
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return \c YES on success, \c NO otherwise
++ (BOOL)exportDecoder:(id <SFBPCMDecoding>)decoder toOutputSource:(SFBOutputSource *)outputSource fileType:(SFBAudioExporterFileType)fileType error:(NSError **)error;
+
 @end
 
 /// The \c NSErrorDomain used by \c SFBAudioExporter
@@ -36,7 +61,11 @@ extern NSErrorDomain const SFBAudioExporterErrorDomain NS_SWIFT_NAME(AudioExport
 /// Possible \c NSError error codes used by \c SFBAudioExporter
 typedef NS_ERROR_ENUM(SFBAudioExporterErrorDomain, SFBAudioExporterErrorCode) {
 	/// File format not supported
-	SFBAudioExporterErrorCodeFileFormatNotSupported				= 0
+	SFBAudioExporterErrorCodeFileFormatNotSupported				= 0,
+	/// The decoder failed without providing an error
+	SFBAudioExporterErrorCodeDecodingFailed						= 1,
+	/// Writing the audio failed without providing an error
+	SFBAudioExporterErrorCodeWritingFailed						= 2,
 } NS_SWIFT_NAME(AudioExporter.ErrorCode);
 
 NS_ASSUME_NONNULL_END
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020 Stephen F. Booth <me@sbooth.org>
+ * Copyright (c) 2020 - 2021 Stephen F. Booth <me@sbooth.org>
  * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
  */
 
@@ -9,12 +9,31 @@
 
 #import "NSError+SFBURLPresentation.h"
 #import "SFBAudioDecoder.h"
+#import "SFBOutputSource.h"
+#import "SFBPCMStreamWriter.h"
 #import "AVAudioFormat+SFBFormatTransformation.h"
 
 // NSError domain for SFBAudioExporter
 NSErrorDomain const SFBAudioExporterErrorDomain = @"org.sbooth.AudioEngine.AudioExporter";
 
 #define BUFFER_SIZE_FRAMES 2048
+// Unconverted audio is written in larger blocks since the export is limited by I/O
+#define STREAM_BUFFER_SIZE_FRAMES 16384
+
+/// Sets \c fileType to the stream type written without conversion for \c pathExtension and returns \c YES, or returns \c NO if none
+static BOOL FileTypeForPathExtension(NSString *pathExtension, SFBAudioExporterFileType *fileType)
+{
+	NSString *extension = pathExtension.lowercaseString;
+	if([extension isEqualToString:@"wav"] || [extension isEqualToString:@"wave"]) {
+		*fileType = SFBAudioExporterFileTypeWAVE;
+		return YES;
+	}
+	else if([extension isEqualToString:@"aif"] || [extension isEqualToString:@"aiff"] || [extension isEqualToString:@"aifc"]) {
+		*fileType = SFBAudioExporterFileTypeAIFF;
+		return YES;
+	}
+	return NO;
+}
 
 @implementation SFBAudioExporter
 
@@ -25,6 +44,10 @@ NSErrorDomain const SFBAudioExporterErrorDomain = @"org.sbooth.AudioEngine.Audio
 			switch(err.code) {
 				case SFBAudioExporterErrorCodeFileFormatNotSupported:
 					return NSLocalizedString(@"The file's format is not supported.", @"");
+				case SFBAudioExporterErrorCodeDecodingFailed:
+					return NSLocalizedString(@"The audio could not be decoded.", @"");
+				case SFBAudioExporterErrorCodeWritingFailed:
+					return NSLocalizedString(@"The audio could not be written.", @"");
 			}
 		}
 		return nil;
@@ -50,6 +73,19 @@ NSErrorDomain const SFBAudioExporterErrorDomain = @"org.sbooth.AudioEngine.Audio
 	if(!decoder.isOpen && ![decoder openReturningError:error])
 		return NO;
 
+	// Write WAVE and AIFF directly when the decoded audio can be stored without conversion
+	SFBAudioExporterFileType fileType;
+	if(targetURL.isFileURL && FileTypeForPathExtension(targetURL.pathExtension, &fileType) && [SFBPCMStreamWriter canWriteFormat:decoder.processingFormat fileType:fileType]) {
+		SFBOutputSource *outputSource = [SFBOutputSource outputSourceForURL:targetURL error:error];
+		if(!outputSource)
+			return NO;
+		if(![self exportDecoder:decoder toOutputSource:outputSource fileType:fileType error:error]) {
+			[[NSFileManager defaultManager] trashItemAtURL:targetURL resultingItemURL:nil error:nil];
+			return NO;
+		}
+		return YES;
+	}
+
 	AVAudioFormat *processingFormat = decoder.processingFormat.standardEquivalent;
 
 	AVAudioConverter *converter = [[AVAudioConverter alloc] initFromFormat:decoder.processingFormat toFormat:processingFormat];
@@ -107,4 +143,64 @@ NSErrorDomain const SFBAudioExporterErrorDomain = @"org.sbooth.AudioEngine.Audio
 	return YES;
 }
 
++ (BOOL)exportDecoder:(id<SFBPCMDecoding>)decoder toOutputSource:(SFBOutputSource *)outputSource fileType:(SFBAudioExporterFileType)fileType error:(NSError **)error
+{
+	NSParameterAssert(decoder != nil);
+	NSParameterAssert(outputSource != nil);
+
+	if(!decoder.isOpen && ![decoder openReturningError:error])
+		return NO;
+
+	if(![SFBPCMStreamWriter canWriteFormat:decoder.processingFormat fileType:fileType]) {
+		if(error)
+			*error = [NSError SFB_errorWithDomain:SFBAudioExporterErrorDomain
+											 code:SFBAudioExporterErrorCodeFileFormatNotSupported
+					descriptionFormatStringForURL:NSLocalizedString(@"The format of the file “%@” is not supported.", @"")
+											  url:decoder.inputSource.url
+									failureReason:NSLocalizedString(@"Unsupported file format", @"")
+							   recoverySuggestion:NSLocalizedString(@"The file's format is not supported for export.", @"")];
+		return NO;
+	}
+
+	const BOOL openedOutputSource = !outputSource.isOpen;
+	if(openedOutputSource && ![outputSource openReturningError:error])
+		return NO;
+
+	BOOL result = NO;
+	SFBPCMStreamWriter *writer = [[SFBPCMStreamWriter alloc] initWithOutputSource:outputSource fileType:fileType format:decoder.processingFormat estimatedFrameLength:decoder.frameLength error:error];
+	AVAudioPCMBuffer *buffer = writer ? [[AVAudioPCMBuffer alloc] initWithPCMFormat:decoder.processingFormat frameCapacity:STREAM_BUFFER_SIZE_FRAMES] : nil;
+	if(writer && !buffer && error)
+		*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+
+	if(writer && buffer) {
+		for(;;) {
+			NSError *err = nil;
+			if(![decoder decodeIntoBuffer:buffer frameLength:buffer.frameCapacity error:&err]) {
+				os_log_error(OS_LOG_DEFAULT, "Error decoding audio: %{public}@", err);
+				// Decoders are not required to provide an error on failure
+				if(error)
+					*error = err ?: [NSError errorWithDomain:SFBAudioExporterErrorDomain code:SFBAudioExporterErrorCodeDecodingFailed userInfo:nil];
+				break;
+			}
+
+			if(buffer.frameLength == 0) {
+				result = [writer finishReturningError:error];
+				break;
+			}
+
+			if(![writer writeFromBuffer:buffer error:&err]) {
+				os_log_error(OS_LOG_DEFAULT, "Error writing audio: %{public}@", err);
+				if(error)
+					*error = err ?: [NSError errorWithDomain:SFBAudioExporterErrorDomain code:SFBAudioExporterErrorCodeWritingFailed userInfo:nil];
+				break;
+			}
+		}
+	}
+
+	if(openedOutputSource && ![outputSource closeReturningError:(result ? error : nil)])
+		result = NO;
+
+	return result;
+}
+
 @end
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <AVFoundation/AVFoundation.h>
+
+#import "SFBAudioExporter.h"
+#import "SFBOutputSource.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Writes PCM audio to a WAVE or AIFF stream without intermediate conversion
+///
+/// The header is written when the writer is created. If the output source supports seeking the header's sizes are
+/// updated by \c -finishReturningError:, otherwise they are derived from the estimated frame length, or the largest
+/// representable size if the frame length is unknown.
+@interface SFBPCMStreamWriter : NSObject
+
+/// Returns \c YES if audio in \c format can be written to \c fileType without loss
++ (BOOL)canWriteFormat:(AVAudioFormat *)format fileType:(SFBAudioExporterFileType)fileType;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Returns an initialized \c SFBPCMStreamWriter object after writing the file header, or \c nil on failure
+/// @param outputSource An open output source
+/// @param fileType The type of stream to write
+/// @param format The format of the audio to be written
+/// @param frameLength The number of frames to be written or \c SFBUnknownFrameLength
+/// @param error An optional pointer to an \c NSError object to receive error information
+- (nullable instancetype)initWithOutputSource:(SFBOutputSource *)outputSource fileType:(SFBAudioExporterFileType)fileType format:(AVAudioFormat *)format estimatedFrameLength:(AVAudioFramePosition)frameLength error:(NSError **)error NS_DESIGNATED_INITIALIZER;
+
+/// The number of frames written
+@property (nonatomic, readonly) AVAudioFramePosition framesWritten;
+
+/// Writes the contents of \c buffer
+/// @param buffer A buffer in the format passed to the initializer
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return \c YES on success, \c NO otherwise
+- (BOOL)writeFromBuffer:(AVAudioPCMBuffer *)buffer error:(NSError **)error;
+
+/// Completes the stream, updating the header if possible
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return \c YES on success, \c NO otherwise
+- (BOOL)finishReturningError:(NSError **)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
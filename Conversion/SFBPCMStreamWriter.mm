@@ -0,0 +1,427 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <cmath>
+#import <vector>
+
+#import <os/log.h>
+
+#import <AudioToolbox/AudioToolbox.h>
+
+#import "SFBPCMStreamWriter.h"
+
+#import "AudioPCMConverter.h"
+
+namespace {
+
+	// WAVE format tags
+	constexpr uint16_t kWAVEFormatPCM			= 0x0001;
+	constexpr uint16_t kWAVEFormatIEEEFloat		= 0x0003;
+	constexpr uint16_t kWAVEFormatExtensible	= 0xFFFE;
+
+	// The AIFF-C version 1 timestamp
+	constexpr uint32_t kAIFCVersion1 			= 0xA2805140;
+
+	/// A header under construction
+	class HeaderBuilder
+	{
+	public:
+		inline size_t Size() const noexcept							{ return mBytes.size(); }
+		inline const uint8_t * Bytes() const noexcept				{ return mBytes.data(); }
+
+		inline void AppendFourCC(const char *fourCC)
+		{
+			mBytes.insert(mBytes.end(), fourCC, fourCC + 4);
+		}
+
+		inline void AppendUInt16LE(uint16_t value)
+		{
+			mBytes.push_back(static_cast<uint8_t>(value));
+			mBytes.push_back(static_cast<uint8_t>(value >> 8));
+		}
+
+		inline void AppendUInt32LE(uint32_t value)
+		{
+			AppendUInt16LE(static_cast<uint16_t>(value));
+			AppendUInt16LE(static_cast<uint16_t>(value >> 16));
+		}
+
+		inline void AppendUInt16BE(uint16_t value)
+		{
+			mBytes.push_back(static_cast<uint8_t>(value >> 8));
+			mBytes.push_back(static_cast<uint8_t>(value));
+		}
+
+		inline void AppendUInt32BE(uint32_t value)
+		{
+			AppendUInt16BE(static_cast<uint16_t>(value >> 16));
+			AppendUInt16BE(static_cast<uint16_t>(value));
+		}
+
+		/// Appends \c value as an 80-bit IEEE 754 extended precision number
+		void AppendExtended(double value)
+		{
+			uint16_t exponent = 0;
+			uint64_t mantissa = 0;
+			if(value > 0) {
+				int e;
+				const double fraction = std::frexp(value, &e);
+				exponent = static_cast<uint16_t>(e - 1 + 16383);
+				mantissa = static_cast<uint64_t>(std::ldexp(fraction, 64));
+			}
+			AppendUInt16BE(exponent);
+			AppendUInt32BE(static_cast<uint32_t>(mantissa >> 32));
+			AppendUInt32BE(static_cast<uint32_t>(mantissa));
+		}
+
+		/// Appends a Pascal string padded to an even length
+		void AppendPString(const char *string)
+		{
+			const auto length = strlen(string);
+			mBytes.push_back(static_cast<uint8_t>(length));
+			mBytes.insert(mBytes.end(), string, string + length);
+			if(!(length & 1))
+				mBytes.push_back(0);
+		}
+
+	private:
+		std::vector<uint8_t> mBytes;
+	};
+
+	/// Returns the format in which audio in \c format is stored in \c fileType
+	bool StreamFormatForFormat(const SFB::Audio::Format& format, SFBAudioExporterFileType fileType, SFB::Audio::Format& streamFormat) noexcept
+	{
+		const auto encoding = SFB::Audio::PCMConverter::SampleEncodingForFormat(format);
+		if(encoding == SFB::Audio::SampleEncoding::Unknown || format.mChannelsPerFrame > UINT16_MAX)
+			return false;
+
+		const bool bigEndian = fileType == SFBAudioExporterFileTypeAIFF;
+
+		streamFormat = SFB::Audio::Format();
+		streamFormat.mFormatID = kAudioFormatLinearPCM;
+		streamFormat.mSampleRate = format.mSampleRate;
+		streamFormat.mChannelsPerFrame = format.mChannelsPerFrame;
+		streamFormat.mFramesPerPacket = 1;
+		streamFormat.mFormatFlags = kAudioFormatFlagIsPacked | (bigEndian ? kAudioFormatFlagIsBigEndian : 0);
+
+		if(format.IsFloat())
+			streamFormat.mFormatFlags |= kAudioFormatFlagIsFloat;
+		// WAVE stores 8-bit samples as unsigned integers
+		else if(!(encoding == SFB::Audio::SampleEncoding::UInt8 || encoding == SFB::Audio::SampleEncoding::Int8) || bigEndian)
+			streamFormat.mFormatFlags |= kAudioFormatFlagIsSignedInteger;
+
+		// Samples are stored in the smallest whole number of bytes
+		streamFormat.mBitsPerChannel = (format.mBitsPerChannel + 7) & ~7u;
+		streamFormat.mBytesPerFrame = streamFormat.mBitsPerChannel / 8 * streamFormat.mChannelsPerFrame;
+		streamFormat.mBytesPerPacket = streamFormat.mBytesPerFrame;
+
+		return SFB::Audio::PCMConverter::CanConvert(format, streamFormat);
+	}
+
+	/// Returns the WAVE channel mask for \c channelLayout or \c 0 if none
+	uint32_t ChannelMaskForChannelLayout(AVAudioChannelLayout *channelLayout, AVAudioChannelCount channelCount) noexcept
+	{
+		if(!channelLayout)
+			return 0;
+
+		AudioChannelBitmap bitmap = 0;
+		const AudioChannelLayout *layout = channelLayout.layout;
+		if(layout->mChannelLayoutTag == kAudioChannelLayoutTag_UseChannelBitmap)
+			bitmap = layout->mChannelBitmap;
+		else if(layout->mChannelLayoutTag != kAudioChannelLayoutTag_UseChannelDescriptions) {
+			AudioChannelLayoutTag tag = layout->mChannelLayoutTag;
+			UInt32 size = sizeof bitmap;
+			if(AudioFormatGetProperty(kAudioFormatProperty_BitmapForLayoutTag, sizeof tag, &tag, &size, &bitmap) != noErr)
+				return 0;
+		}
+
+		// The WAVE speaker positions match the first eighteen Core Audio channel bits
+		if(bitmap & ~0x3FFFFu || static_cast<AVAudioChannelCount>(__builtin_popcount(bitmap)) != channelCount)
+			return 0;
+
+		return bitmap;
+	}
+
+}
+
+@interface SFBPCMStreamWriter ()
+{
+@private
+	SFBOutputSource *_outputSource;
+	SFBAudioExporterFileType _fileType;
+	SFB::Audio::Format _format;
+	SFB::Audio::Format _streamFormat;
+	AVAudioChannelLayout *_channelLayout;
+	/// Converts audio not already in \c _streamFormat
+	SFB::Audio::PCMConverter _converter;
+	std::vector<uint8_t> _conversionBuffer;
+	/// Offsets of the header fields updated by \c -finishReturningError:
+	NSInteger _containerSizeOffset;
+	NSInteger _frameCountOffset;
+	NSInteger _dataSizeOffset;
+	NSInteger _dataOffset;
+	/// The number of bytes the header declares, excluding padding
+	uint64_t _declaredDataSize;
+}
+@end
+
+@implementation SFBPCMStreamWriter
+
++ (BOOL)canWriteFormat:(AVAudioFormat *)format fileType:(SFBAudioExporterFileType)fileType
+{
+	NSParameterAssert(format != nil);
+
+	SFB::Audio::Format streamFormat;
+	if(!StreamFormatForFormat(SFB::Audio::Format(format.streamDescription), fileType, streamFormat))
+		return NO;
+
+	// WAVE sample rates are integers
+	if(fileType == SFBAudioExporterFileTypeWAVE && (format.sampleRate != std::floor(format.sampleRate) || format.sampleRate > UINT32_MAX))
+		return NO;
+
+	return YES;
+}
+
+- (instancetype)initWithOutputSource:(SFBOutputSource *)outputSource fileType:(SFBAudioExporterFileType)fileType format:(AVAudioFormat *)format estimatedFrameLength:(AVAudioFramePosition)frameLength error:(NSError **)error
+{
+	NSParameterAssert(outputSource != nil);
+	NSParameterAssert(outputSource.isOpen);
+	NSParameterAssert(format != nil);
+
+	if((self = [super init])) {
+		_outputSource = outputSource;
+		_fileType = fileType;
+		_format = SFB::Audio::Format(format.streamDescription);
+		_channelLayout = format.channelLayout;
+
+		if(![SFBPCMStreamWriter canWriteFormat:format fileType:fileType] || !StreamFormatForFormat(_format, fileType, _streamFormat)) {
+			if(error)
+				*error = [NSError errorWithDomain:SFBAudioExporterErrorDomain code:SFBAudioExporterErrorCodeFileFormatNotSupported userInfo:nil];
+			return nil;
+		}
+
+		// Audio already stored as in the stream is written directly
+		const bool sameLayout = _format.IsInterleaved() || _format.mChannelsPerFrame == 1;
+		if(!sameLayout || _format.IsBigEndian() != _streamFormat.IsBigEndian() || SFB::Audio::PCMConverter::SampleEncodingForFormat(_format) != SFB::Audio::PCMConverter::SampleEncodingForFormat(_streamFormat)) {
+			if(!_converter.Initialize(_format, _streamFormat)) {
+				if(error)
+					*error = [NSError errorWithDomain:SFBAudioExporterErrorDomain code:SFBAudioExporterErrorCodeFileFormatNotSupported userInfo:nil];
+				return nil;
+			}
+		}
+
+		// Without seeking the header must be correct when written, so an unknown length is declared as large as possible
+		const uint64_t maximumDataSize = (UINT32_MAX - 128) / _streamFormat.mBytesPerFrame * _streamFormat.mBytesPerFrame;
+		if(frameLength != SFBUnknownFrameLength && frameLength >= 0 && (uint64_t)frameLength * _streamFormat.mBytesPerFrame <= maximumDataSize)
+			_declaredDataSize = (uint64_t)frameLength * _streamFormat.mBytesPerFrame;
+		else
+			_declaredDataSize = outputSource.supportsSeeking ? 0 : maximumDataSize;
+
+		if(![self writeHeaderReturningError:error])
+			return nil;
+	}
+	return self;
+}
+
+- (BOOL)writeHeaderReturningError:(NSError **)error
+{
+	HeaderBuilder header;
+
+	const uint32_t bytesPerFrame = _streamFormat.mBytesPerFrame;
+	const uint32_t frameCount = static_cast<uint32_t>(_declaredDataSize / bytesPerFrame);
+	const uint32_t dataSize = static_cast<uint32_t>(_declaredDataSize);
+	const uint32_t padding = dataSize & 1;
+
+	if(_fileType == SFBAudioExporterFileTypeWAVE) {
+		const uint16_t containerBits = static_cast<uint16_t>(_streamFormat.mBitsPerChannel);
+		const uint16_t validBits = static_cast<uint16_t>(_format.mBitsPerChannel);
+		const uint16_t formatTag = _streamFormat.IsFloat() ? kWAVEFormatIEEEFloat : kWAVEFormatPCM;
+		const bool extensible = _streamFormat.mChannelsPerFrame > 2 || validBits != containerBits || (!_streamFormat.IsFloat() && containerBits > 16);
+		const uint32_t formatSize = extensible ? 40 : (_streamFormat.IsFloat() ? 18 : 16);
+		const uint32_t factSize = _streamFormat.IsFloat() ? 12 : 0;
+
+		header.AppendFourCC("RIFF");
+		_containerSizeOffset = static_cast<NSInteger>(header.Size());
+		header.AppendUInt32LE(4 + (8 + formatSize) + factSize + 8 + dataSize + padding);
+		header.AppendFourCC("WAVE");
+
+		header.AppendFourCC("fmt ");
+		header.AppendUInt32LE(formatSize);
+		header.AppendUInt16LE(extensible ? kWAVEFormatExtensible : formatTag);
+		header.AppendUInt16LE(static_cast<uint16_t>(_streamFormat.mChannelsPerFrame));
+		header.AppendUInt32LE(static_cast<uint32_t>(_streamFormat.mSampleRate));
+		header.AppendUInt32LE(static_cast<uint32_t>(_streamFormat.mSampleRate) * bytesPerFrame);
+		header.AppendUInt16LE(static_cast<uint16_t>(bytesPerFrame));
+		header.AppendUInt16LE(containerBits);
+		if(extensible) {
+			header.AppendUInt16LE(22);
+			header.AppendUInt16LE(validBits);
+			header.AppendUInt32LE(ChannelMaskForChannelLayout(_channelLayout, _format.mChannelsPerFrame));
+			// KSDATAFORMAT_SUBTYPE_PCM or KSDATAFORMAT_SUBTYPE_IEEE_FLOAT
+			header.AppendUInt16LE(formatTag);
+			header.AppendUInt16LE(0x0000);
+			header.AppendUInt16LE(0x0010);
+			header.AppendUInt16LE(0x0080);
+			header.AppendUInt32BE(0x00AA0038);
+			header.AppendUInt16BE(0x9B71);
+		}
+		else if(_streamFormat.IsFloat())
+			header.AppendUInt16LE(0);
+
+		_frameCountOffset = -1;
+		if(factSize) {
+			header.AppendFourCC("fact");
+			header.AppendUInt32LE(4);
+			_frameCountOffset = static_cast<NSInteger>(header.Size());
+			header.AppendUInt32LE(frameCount);
+		}
+
+		header.AppendFourCC("data");
+		_dataSizeOffset = static_cast<NSInteger>(header.Size());
+		header.AppendUInt32LE(dataSize);
+	}
+	else {
+		// Floating point audio requires AIFF-C
+		const bool aifc = _streamFormat.IsFloat();
+		const char *compressionType = _streamFormat.mBitsPerChannel == 64 ? "fl64" : "fl32";
+		const char *compressionName = _streamFormat.mBitsPerChannel == 64 ? "64-bit floating point" : "32-bit floating point";
+		const uint32_t commonSize = aifc ? 18 + 4 + ((1 + static_cast<uint32_t>(strlen(compressionName)) + 1) & ~1u) : 18;
+		const uint32_t versionSize = aifc ? 12 : 0;
+
+		header.AppendFourCC("FORM");
+		_containerSizeOffset = static_cast<NSInteger>(header.Size());
+		header.AppendUInt32BE(4 + versionSize + (8 + commonSize) + 16 + dataSize + padding);
+		header.AppendFourCC(aifc ? "AIFC" : "AIFF");
+
+		if(aifc) {
+			header.AppendFourCC("FVER");
+			header.AppendUInt32BE(4);
+			header.AppendUInt32BE(kAIFCVersion1);
+		}
+
+		header.AppendFourCC("COMM");
+		header.AppendUInt32BE(commonSize);
+		header.AppendUInt16BE(static_cast<uint16_t>(_streamFormat.mChannelsPerFrame));
+		_frameCountOffset = static_cast<NSInteger>(header.Size());
+		header.AppendUInt32BE(frameCount);
+		header.AppendUInt16BE(static_cast<uint16_t>(_format.mBitsPerChannel));
+		header.AppendExtended(_streamFormat.mSampleRate);
+		if(aifc) {
+			header.AppendFourCC(compressionType);
+			header.AppendPString(compressionName);
+		}
+
+		header.AppendFourCC("SSND");
+		_dataSizeOffset = static_cast<NSInteger>(header.Size());
+		header.AppendUInt32BE(8 + dataSize);
+		header.AppendUInt32BE(0);
+		header.AppendUInt32BE(0);
+	}
+
+	_dataOffset = static_cast<NSInteger>(header.Size());
+
+	NSInteger bytesWritten;
+	if(![_outputSource writeBytes:header.Bytes() length:static_cast<NSInteger>(header.Size()) bytesWritten:&bytesWritten error:error] || bytesWritten != static_cast<NSInteger>(header.Size())) {
+		os_log_error(OS_LOG_DEFAULT, "Error writing header");
+		return NO;
+	}
+
+	return YES;
+}
+
+- (BOOL)writeFromBuffer:(AVAudioPCMBuffer *)buffer error:(NSError **)error
+{
+	NSParameterAssert(buffer != nil);
+
+	const AVAudioFrameCount frameLength = buffer.frameLength;
+	if(frameLength == 0)
+		return YES;
+
+	const size_t byteCount = frameLength * _streamFormat.mBytesPerFrame;
+	if(_framesWritten * _streamFormat.mBytesPerFrame + byteCount > UINT32_MAX - 128) {
+		os_log_error(OS_LOG_DEFAULT, "Audio data exceeds the maximum stream size");
+		if(error)
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EFBIG userInfo:nil];
+		return NO;
+	}
+
+	const void *bytes = buffer.audioBufferList->mBuffers[0].mData;
+	if(_converter.IsInitialized()) {
+		if(_conversionBuffer.size() < byteCount)
+			_conversionBuffer.resize(byteCount);
+
+		AudioBufferList bufferList;
+		bufferList.mNumberBuffers = 1;
+		bufferList.mBuffers[0].mNumberChannels = _streamFormat.mChannelsPerFrame;
+		bufferList.mBuffers[0].mDataByteSize = static_cast<UInt32>(byteCount);
+		bufferList.mBuffers[0].mData = _conversionBuffer.data();
+
+		if(!_converter.Convert(buffer.audioBufferList, &bufferList, frameLength)) {
+			if(error)
+				*error = [NSError errorWithDomain:SFBAudioExporterErrorDomain code:SFBAudioExporterErrorCodeFileFormatNotSupported userInfo:nil];
+			return NO;
+		}
+
+		bytes = _conversionBuffer.data();
+	}
+
+	NSInteger bytesWritten;
+	if(![_outputSource writeBytes:bytes length:static_cast<NSInteger>(byteCount) bytesWritten:&bytesWritten error:error] || bytesWritten != static_cast<NSInteger>(byteCount))
+		return NO;
+
+	_framesWritten += frameLength;
+	return YES;
+}
+
+- (BOOL)finishReturningError:(NSError **)error
+{
+	const uint64_t dataSize = static_cast<uint64_t>(_framesWritten) * _streamFormat.mBytesPerFrame;
+
+	// Chunks are padded to an even length
+	if(dataSize & 1) {
+		const uint8_t pad = 0;
+		NSInteger bytesWritten;
+		if(![_outputSource writeBytes:&pad length:1 bytesWritten:&bytesWritten error:error])
+			return NO;
+	}
+
+	if(dataSize == _declaredDataSize)
+		return YES;
+
+	if(!_outputSource.supportsSeeking) {
+		os_log_error(OS_LOG_DEFAULT, "Stream header declares %llu bytes of audio but %llu were written", _declaredDataSize, dataSize);
+		return YES;
+	}
+
+	NSInteger endOffset;
+	if(![_outputSource getOffset:&endOffset error:error])
+		return NO;
+
+	const uint32_t containerSize = static_cast<uint32_t>(_dataOffset - 8 + dataSize + (dataSize & 1));
+	const uint32_t frameCount = static_cast<uint32_t>(_framesWritten);
+
+	if(_fileType == SFBAudioExporterFileTypeWAVE) {
+		if(![_outputSource seekToOffset:_containerSizeOffset error:error] || ![_outputSource writeUInt32LittleEndian:containerSize error:error])
+			return NO;
+		if(_frameCountOffset != -1 && (![_outputSource seekToOffset:_frameCountOffset error:error] || ![_outputSource writeUInt32LittleEndian:frameCount error:error]))
+			return NO;
+		if(![_outputSource seekToOffset:_dataSizeOffset error:error] || ![_outputSource writeUInt32LittleEndian:static_cast<uint32_t>(dataSize) error:error])
+			return NO;
+	}
+	else {
+		if(![_outputSource seekToOffset:_containerSizeOffset error:error] || ![_outputSource writeUInt32BigEndian:containerSize error:error])
+			return NO;
+		if(![_outputSource seekToOffset:_frameCountOffset error:error] || ![_outputSource writeUInt32BigEndian:frameCount error:error])
+			return NO;
+		if(![_outputSource seekToOffset:_dataSizeOffset error:error] || ![_outputSource writeUInt32BigEndian:static_cast<uint32_t>(8 + dataSize) error:error])
+			return NO;
+	}
+
+	_declaredDataSize = dataSize;
+
+	return [_outputSource seekToOffset:endOffset error:error];
+}
+
+@end
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/stat.h>
+
+#include "AudioDecoder.h"
+
+#pragma mark File Input Source
+
+SFB::Audio::Decoder::FileInputSource::FileInputSource(const char *path) noexcept
+	: mFile(nullptr)
+{
+	assert(path != nullptr);
+	mFile = fopen(path, "r");
+	if(!mFile)
+		os_log_error(Decoder::Log(), "fopen failed: %{public}s", strerror(errno));
+}
+
+SFB::Audio::Decoder::FileInputSource::~FileInputSource()
+{
+	if(mFile)
+		fclose(mFile);
+}
+
+bool SFB::Audio::Decoder::FileInputSource::Read(void *buffer, int64_t count, int64_t& bytesRead) noexcept
+{
+	assert(buffer != nullptr);
+	assert(count >= 0);
+
+	size_t read = fread(buffer, 1, static_cast<size_t>(count), mFile);
+	if(read != static_cast<size_t>(count) && ferror(mFile))
+		return false;
+	bytesRead = static_cast<int64_t>(read);
+	return true;
+}
+
+bool SFB::Audio::Decoder::FileInputSource::AtEOF() const noexcept
+{
+	return feof(mFile) != 0;
+}
+
+bool SFB::Audio::Decoder::FileInputSource::GetOffset(int64_t& offset) const noexcept
+{
+	off_t result = ftello(mFile);
+	if(result == -1)
+		return false;
+	offset = static_cast<int64_t>(result);
+	return true;
+}
+
+bool SFB::Audio::Decoder::FileInputSource::GetLength(int64_t& length) const noexcept
+{
+	struct stat s;
+	if(fstat(fileno(mFile), &s))
+		return false;
+	length = static_cast<int64_t>(s.st_size);
+	return true;
+}
+
+bool SFB::Audio::Decoder::FileInputSource::SupportsSeeking() const noexcept
+{
+	return true;
+}
+
+bool SFB::Audio::Decoder::FileInputSource::SeekToOffset(int64_t offset) noexcept
+{
+	return fseeko(mFile, static_cast<off_t>(offset), SEEK_SET) == 0;
+}
+
+#pragma mark Creation and Destruction
+
+SFB::Audio::Decoder::Decoder(InputSource::unique_ptr inputSource) noexcept
+	: mInputSource(std::move(inputSource)), mChannelLayoutTag(0), mLastError(Error::None)
+{
+	assert(mInputSource != nullptr);
+}
+
+#pragma mark Utilities
+
+void SFB::Audio::Decoder::SetBufferListFrameLength(AudioBufferList * const bufferList, uint32_t frameCount) const noexcept
+{
+	assert(bufferList != nullptr);
+
+	UInt32 byteSize = frameCount * mProcessingFormat.mBytesPerPacket;
+	for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i)
+		bufferList->mBuffers[i].mDataByteSize = byteSize;
+}
+
+os_log_t SFB::Audio::Decoder::Log() noexcept
+{
+	static os_log_t log = os_log_create("org.sbooth.AudioEngine", "AudioDecoder");
+	return log;
+}
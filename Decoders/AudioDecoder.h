@@ -0,0 +1,313 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <type_traits>
+
+#include "AudioFormat.h"
+#include "Portability.h"
+
+/*! @file AudioDecoder.h @brief An audio decoder free of Objective-C */
+
+/*! @brief \c SFBAudioEngine's encompassing namespace */
+namespace SFB {
+
+	/*! @brief %Audio functionality */
+	namespace Audio {
+
+		/*!
+		 * @brief An audio decoder producing audio into an \c AudioBufferList.
+		 *
+		 * Decoding performs no Objective-C message sends and no allocations, making the class usable
+		 * from real-time threads and from code without Foundation. Without Apple's SDKs the Core %Audio types, logging,
+		 * and byte swapping are supplied by Portability.h, so the class may also be built on other platforms.
+		 * For DSD processing formats a frame is a DSD packet (a clustered frame of one channel byte per channel).
+		 */
+		class Decoder
+		{
+		public:
+
+			// ========================================
+			/*! @name Input */
+			//@{
+
+			/*! @brief A byte source for a \c Decoder */
+			class InputSource
+			{
+			public:
+				/*! @brief A \c std::unique_ptr for \c InputSource objects */
+				using unique_ptr = std::unique_ptr<InputSource>;
+
+				/*! @brief Destroy the \c InputSource */
+				virtual ~InputSource() = default;
+
+				/*!
+				 * @brief Read bytes, advancing the read position
+				 * @param buffer The destination buffer
+				 * @param count The maximum number of bytes to read
+				 * @param bytesRead The number of bytes actually read
+				 * @return \c true on success, \c false on error
+				 */
+				virtual bool Read(void *buffer, int64_t count, int64_t& bytesRead) noexcept = 0;
+
+				/*! @brief Returns \c true if the end of input has been reached */
+				virtual bool AtEOF() const noexcept = 0;
+
+				/*! @brief Returns the current read position in \c offset */
+				virtual bool GetOffset(int64_t& offset) const noexcept = 0;
+
+				/*! @brief Returns the length of the input in \c length */
+				virtual bool GetLength(int64_t& length) const noexcept = 0;
+
+				/*! @brief Returns \c true if the input is seekable */
+				virtual bool SupportsSeeking() const noexcept = 0;
+
+				/*! @brief Sets the read position to \c offset */
+				virtual bool SeekToOffset(int64_t offset) noexcept = 0;
+
+				/*! @brief Reads exactly \c count bytes */
+				inline bool ReadExactly(void *buffer, int64_t count) noexcept
+				{
+					int64_t bytesRead;
+					return Read(buffer, count, bytesRead) && bytesRead == count;
+				}
+
+				/*! @brief Reads a little-endian unsigned integer */
+				template <typename T>
+				bool ReadLE(T& value) noexcept
+				{
+					static_assert(std::is_unsigned<T>::value, "Unsigned integral type required");
+					uint8_t bytes [sizeof(T)];
+					if(!ReadExactly(bytes, sizeof(T)))
+						return false;
+					value = 0;
+					for(size_t i = 0; i < sizeof(T); ++i)
+						value |= static_cast<T>(static_cast<T>(bytes[i]) << (8 * i));
+					return true;
+				}
+
+				/*! @brief Reads a big-endian unsigned integer */
+				template <typename T>
+				bool ReadBE(T& value) noexcept
+				{
+					static_assert(std::is_unsigned<T>::value, "Unsigned integral type required");
+					uint8_t bytes [sizeof(T)];
+					if(!ReadExactly(bytes, sizeof(T)))
+						return false;
+					value = 0;
+					for(size_t i = 0; i < sizeof(T); ++i)
+						value = static_cast<T>((value << 8) | bytes[i]);
+					return true;
+				}
+			};
+
+			/*! @brief An \c InputSource reading from a file using stdio */
+			class FileInputSource : public InputSource
+			{
+			public:
+				/*!
+				 * @brief Open the file at \c path for reading
+				 * @note Use \c IsOpen() to determine whether the file was opened successfully
+				 */
+				explicit FileInputSource(const char *path) noexcept;
+
+				/*! @brief Close the file */
+				~FileInputSource();
+
+				/*! @cond */
+
+				/*! @internal This class is non-copyable */
+				FileInputSource(const FileInputSource& rhs) = delete;
+
+				/*! @internal This class is non-assignable */
+				FileInputSource& operator=(const FileInputSource& rhs) = delete;
+
+				/*! @endcond */
+
+				/*! @brief Returns \c true if the file is open */
+				inline bool IsOpen() const noexcept						{ return mFile != nullptr; }
+
+				bool Read(void *buffer, int64_t count, int64_t& bytesRead) noexcept override;
+				bool AtEOF() const noexcept override;
+				bool GetOffset(int64_t& offset) const noexcept override;
+				bool GetLength(int64_t& length) const noexcept override;
+				bool SupportsSeeking() const noexcept override;
+				bool SeekToOffset(int64_t offset) noexcept override;
+
+			private:
+				FILE				*mFile;					// The underlying file
+			};
+
+			//@}
+
+
+			// ========================================
+			/*! @name Errors */
+			//@{
+
+			/*! @brief Possible decoder errors */
+			enum class Error {
+				None,					/*!< No error */
+				InternalError,			/*!< An internal decoder or input error */
+				InvalidFormat,			/*!< The input is not in the decoder's format */
+				UnsupportedFormat,		/*!< The input is in the decoder's format but uses unsupported features */
+				OutOfMemory				/*!< Memory allocation failed */
+			};
+
+			//@}
+
+
+			// ========================================
+			/*! @name Creation and Destruction */
+			//@{
+
+			/*! @brief A \c std::unique_ptr for \c Decoder objects */
+			using unique_ptr = std::unique_ptr<Decoder>;
+
+			/*! @brief Create a new \c Decoder reading from \c inputSource */
+			explicit Decoder(InputSource::unique_ptr inputSource) noexcept;
+
+			/*! @brief Destroy the \c Decoder */
+			virtual ~Decoder() = default;
+
+			/*! @cond */
+
+			/*! @internal This class is non-copyable */
+			Decoder(const Decoder& rhs) = delete;
+
+			/*! @internal This class is non-assignable */
+			Decoder& operator=(const Decoder& rhs) = delete;
+
+			/*! @endcond */
+
+			//@}
+
+
+			// ========================================
+			/*! @name Opening and closing */
+			//@{
+
+			/*!
+			 * @brief Open the decoder
+			 * @note The input source must already be positioned at the start of the stream
+			 * @return \c true on success, \c false on error
+			 */
+			virtual bool Open() noexcept = 0;
+
+			/*!
+			 * @brief Close the decoder
+			 * @return \c true on success, \c false on error
+			 */
+			virtual bool Close() noexcept = 0;
+
+			/*! @brief Returns \c true if the decoder is open */
+			virtual bool IsOpen() const noexcept = 0;
+
+			//@}
+
+
+			// ========================================
+			/*! @name Format information */
+			//@{
+
+			/*! @brief Returns the format of the encoded audio */
+			inline const Format& SourceFormat() const noexcept				{ return mSourceFormat; }
+
+			/*! @brief Returns the format of the audio produced by \c Decode() */
+			inline const Format& ProcessingFormat() const noexcept			{ return mProcessingFormat; }
+
+			/*! @brief Returns the layout tag for the processing format's channels or \c 0 if unknown */
+			inline AudioChannelLayoutTag ChannelLayoutTag() const noexcept	{ return mChannelLayoutTag; }
+
+			/*! @brief Returns \c true if decoding allows the original signal to be perfectly reconstructed */
+			virtual bool DecodingIsLossless() const noexcept = 0;
+
+			//@}
+
+
+			// ========================================
+			/*! @name Position and length */
+			//@{
+
+			/*! @brief Returns the current frame position or \c -1 if unknown */
+			virtual int64_t FramePosition() const noexcept = 0;
+
+			/*! @brief Returns the length in frames or \c -1 if unknown */
+			virtual int64_t FrameLength() const noexcept = 0;
+
+			//@}
+
+
+			// ========================================
+			/*! @name Decoding */
+			//@{
+
+			/*!
+			 * @brief Decode audio
+			 *
+			 * The buffers in \c bufferList must match the processing format and have capacity for \c frameCount frames.
+			 * On return each buffer's \c mDataByteSize reflects \c framesDecoded.
+			 * @param bufferList An \c AudioBufferList to receive the decoded audio
+			 * @param frameCount The desired number of frames
+			 * @param framesDecoded The number of frames actually decoded; \c 0 indicates the end of the stream
+			 * @return \c true on success, \c false on error
+			 */
+			virtual bool Decode(AudioBufferList * const bufferList, uint32_t frameCount, uint32_t& framesDecoded) noexcept = 0;
+
+			//@}
+
+
+			// ========================================
+			/*! @name Seeking */
+			//@{
+
+			/*! @brief Returns \c true if the decoder is seekable */
+			virtual bool SupportsSeeking() const noexcept					{ return mInputSource->SupportsSeeking(); }
+
+			/*!
+			 * @brief Seek to the specified frame
+			 * @return \c true on success, \c false on error
+			 */
+			virtual bool SeekToFrame(int64_t frame) noexcept = 0;
+
+			//@}
+
+
+			// ========================================
+			/*! @name Error information */
+			//@{
+
+			/*! @brief Returns the error that caused the most recent failure */
+			inline Error LastError() const noexcept							{ return mLastError; }
+
+			//@}
+
+		protected:
+
+			/*! @brief Sets the buffer sizes in \c bufferList to reflect \c frameCount frames in the processing format */
+			void SetBufferListFrameLength(AudioBufferList * const bufferList, uint32_t frameCount) const noexcept;
+
+			/*! @brief Records \c error as the most recent error and returns \c false */
+			inline bool Fail(Error error) noexcept							{ mLastError = error; return false; }
+
+			/*! @brief The log used by decoders */
+			static os_log_t Log() noexcept;
+
+			InputSource::unique_ptr		mInputSource;			// The source of encoded audio
+			class Format				mSourceFormat;			// The format of the encoded audio
+			class Format				mProcessingFormat;		// The format of the decoded audio
+			AudioChannelLayoutTag		mChannelLayoutTag;		// The channel layout of the decoded audio
+
+		private:
+
+			Error						mLastError;				// The error that caused the most recent failure
+		};
+
+	}
+}
@@ -0,0 +1,316 @@
+/*
+ * Copyright (c) 2014 - 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include "DSFDecoder.h"
+
+#define DSF_BLOCK_SIZE_BYTES_PER_CHANNEL 4096
+
+namespace {
+
+	// Read a four byte chunk ID as a uint32_t
+	bool ReadChunkID(SFB::Audio::Decoder::InputSource& inputSource, uint32_t& chunkID) noexcept
+	{
+		return inputSource.ReadBE(chunkID);
+	}
+
+	// For the size of matrices this class deals with the naive approach is adequate
+	void MatrixTransposeNaive(const uint8_t * __restrict A, uint8_t * __restrict B, size_t rows, size_t columns) noexcept
+	{
+		for(size_t i = 0; i < rows; ++i) {
+			for(size_t j = 0; j < columns; ++j)
+				B[j * rows + i] = A[i * columns + j];
+		}
+	}
+
+}
+
+#pragma mark Creation and Destruction
+
+SFB::Audio::DSFDecoder::DSFDecoder(InputSource::unique_ptr inputSource) noexcept
+	: Decoder(std::move(inputSource)), mPacketPosition(0), mPacketCount(0), mAudioOffset(0), mPacketsBuffered(0), mBlockOffset(0)
+{}
+
+SFB::Audio::DSFDecoder::~DSFDecoder()
+{
+	if(IsOpen())
+		Close();
+}
+
+#pragma mark Opening and Closing
+
+bool SFB::Audio::DSFDecoder::Open() noexcept
+{
+	auto& inputSource = *mInputSource;
+
+	// Read the 'DSD ' chunk
+	uint32_t chunkID;
+	if(!ReadChunkID(inputSource, chunkID) || chunkID != 'DSD ') {
+		os_log_error(Log(), "Unable to read 'DSD ' chunk");
+		return Fail(Error::InvalidFormat);
+	}
+
+	uint64_t chunkSize = 0, fileSize, metadataOffset;
+	// Unlike normal IFF, the chunkSize includes the size of the chunk ID and size
+	if(!inputSource.ReadLE(chunkSize) || chunkSize != 28) {
+		os_log_error(Log(), "Unexpected 'DSD ' chunk size: %llu", chunkSize);
+		return Fail(Error::InvalidFormat);
+	}
+
+	if(!inputSource.ReadLE(fileSize)) {
+		os_log_error(Log(), "Unable to read file size in 'DSD ' chunk");
+		return Fail(Error::InvalidFormat);
+	}
+
+	if(!inputSource.ReadLE(metadataOffset)) {
+		os_log_error(Log(), "Unable to read metadata offset in 'DSD ' chunk");
+		return Fail(Error::InvalidFormat);
+	}
+
+
+	// Read the 'fmt ' chunk
+	if(!ReadChunkID(inputSource, chunkID) || chunkID != 'fmt ') {
+		os_log_error(Log(), "Unable to read 'fmt ' chunk");
+		return Fail(Error::InvalidFormat);
+	}
+
+	if(!inputSource.ReadLE(chunkSize)) {
+		os_log_error(Log(), "Unexpected 'fmt ' chunk size: %llu", chunkSize);
+		return Fail(Error::InvalidFormat);
+	}
+
+	uint32_t formatVersion, formatID, channelType, channelNum, samplingFrequency, bitsPerSample;
+	uint64_t sampleCount;
+	uint32_t blockSizePerChannel, reserved;
+
+	if(!inputSource.ReadLE(formatVersion) || formatVersion != 1) {
+		os_log_error(Log(), "Unexpected format version in 'fmt ': %u", formatVersion);
+		return Fail(Error::InvalidFormat);
+	}
+
+	if(!inputSource.ReadLE(formatID) || formatID != 0) {
+		os_log_error(Log(), "Unexpected format ID in 'fmt ': %u", formatID);
+		return Fail(Error::InvalidFormat);
+	}
+
+	if(!inputSource.ReadLE(channelType) || (channelType < 1 || channelType > 7)) {
+		os_log_error(Log(), "Unexpected channel type in 'fmt ': %u", channelType);
+		return Fail(Error::InvalidFormat);
+	}
+
+	if(!inputSource.ReadLE(channelNum) || (channelNum < 1 || channelNum > 6)) {
+		os_log_error(Log(), "Unexpected channel count in 'fmt ': %u", channelNum);
+		return Fail(Error::InvalidFormat);
+	}
+
+	if(!inputSource.ReadLE(samplingFrequency) || (samplingFrequency != kSFBSampleRateDSD64 && samplingFrequency != kSFBSampleRateDSD128)) {
+		os_log_error(Log(), "Unexpected sample rate in 'fmt ': %u", samplingFrequency);
+		return Fail(Error::InvalidFormat);
+	}
+
+	if(!inputSource.ReadLE(bitsPerSample) || (bitsPerSample != 1 && bitsPerSample != 8)) {
+		os_log_error(Log(), "Unexpected bits per sample in 'fmt ': %u", bitsPerSample);
+		return Fail(Error::InvalidFormat);
+	}
+
+	if(!inputSource.ReadLE(sampleCount)) {
+		os_log_error(Log(), "Unable to read sample count in 'fmt ' chunk");
+		return Fail(Error::InvalidFormat);
+	}
+
+	if(!inputSource.ReadLE(blockSizePerChannel) || blockSizePerChannel != DSF_BLOCK_SIZE_BYTES_PER_CHANNEL) {
+		os_log_error(Log(), "Unexpected block size per channel in 'fmt ': %u", blockSizePerChannel);
+		return Fail(Error::InvalidFormat);
+	}
+
+	if(!inputSource.ReadLE(reserved) || reserved != 0) {
+		os_log_error(Log(), "Unexpected non-zero value for reserved in 'fmt ': %u", reserved);
+		return Fail(Error::InvalidFormat);
+	}
+
+
+	// Read the 'data' chunk
+	if(!ReadChunkID(inputSource, chunkID) || chunkID != 'data') {
+		os_log_error(Log(), "Unable to read 'data' chunk");
+		return Fail(Error::InvalidFormat);
+	}
+
+	if(!inputSource.ReadLE(chunkSize)) {
+		os_log_error(Log(), "Unexpected 'data' chunk size: %llu", chunkSize);
+		return Fail(Error::InvalidFormat);
+	}
+
+	int64_t offset;
+	if(!inputSource.GetOffset(offset)) {
+		os_log_error(Log(), "Error getting audio offset");
+		return Fail(Error::InternalError);
+	}
+
+	// Channel layouts are defined in the DSF file format specification
+	switch(channelType) {
+		case 1:		mChannelLayoutTag = kAudioChannelLayoutTag_Mono;			break;
+		case 2:		mChannelLayoutTag = kAudioChannelLayoutTag_Stereo;			break;
+		case 3:		mChannelLayoutTag = kAudioChannelLayoutTag_MPEG_3_0_A;		break;
+		case 4:		mChannelLayoutTag = kAudioChannelLayoutTag_Quadraphonic;	break;
+		case 5:		mChannelLayoutTag = kAudioChannelLayoutTag_ITU_2_2;			break;
+		case 6:		mChannelLayoutTag = kAudioChannelLayoutTag_MPEG_5_0_A;		break;
+		case 7:		mChannelLayoutTag = kAudioChannelLayoutTag_MPEG_5_1_A;		break;
+	}
+
+	AudioStreamBasicDescription processingStreamDescription{};
+
+	// The output format is raw DSD
+	processingStreamDescription.mFormatID			= kSFBAudioFormatDSD;
+	processingStreamDescription.mFormatFlags		= bitsPerSample == 8 ? kAudioFormatFlagIsBigEndian : 0;
+
+	processingStreamDescription.mSampleRate			= static_cast<Float64>(samplingFrequency);
+	processingStreamDescription.mChannelsPerFrame	= channelNum;
+	processingStreamDescription.mBitsPerChannel		= 1;
+
+	processingStreamDescription.mBytesPerPacket		= kSFBBytesPerDSDPacketPerChannel * channelNum;
+	processingStreamDescription.mFramesPerPacket	= kSFBPCMFramesPerDSDPacket;
+
+	mProcessingFormat = processingStreamDescription;
+
+	// Set up the source format
+	AudioStreamBasicDescription sourceStreamDescription{};
+
+	sourceStreamDescription.mFormatID			= kSFBAudioFormatDSD;
+
+	sourceStreamDescription.mSampleRate			= static_cast<Float64>(samplingFrequency);
+	sourceStreamDescription.mChannelsPerFrame	= channelNum;
+	sourceStreamDescription.mBitsPerChannel		= 1;
+
+	mSourceFormat = sourceStreamDescription;
+
+	// Metadata chunk is ignored
+
+	size_t blockSize = DSF_BLOCK_SIZE_BYTES_PER_CHANNEL * channelNum;
+	mBlock.reset(new (std::nothrow) uint8_t [blockSize]);
+	mScratch.reset(new (std::nothrow) uint8_t [blockSize]);
+	if(!mBlock || !mScratch) {
+		mBlock.reset();
+		mScratch.reset();
+		return Fail(Error::OutOfMemory);
+	}
+
+	mPacketCount = static_cast<int64_t>(sampleCount / kSFBPCMFramesPerDSDPacket);
+	mAudioOffset = offset;
+	mPacketPosition = 0;
+	mPacketsBuffered = 0;
+	mBlockOffset = 0;
+
+	return true;
+}
+
+bool SFB::Audio::DSFDecoder::Close() noexcept
+{
+	mBlock.reset();
+	mScratch.reset();
+	mPacketsBuffered = 0;
+	mBlockOffset = 0;
+
+	return true;
+}
+
+#pragma mark Decoding
+
+bool SFB::Audio::DSFDecoder::Decode(AudioBufferList * const bufferList, uint32_t frameCount, uint32_t& framesDecoded) noexcept
+{
+	assert(bufferList != nullptr);
+	assert(bufferList->mNumberBuffers == 1);
+
+	framesDecoded = 0;
+
+	const uint32_t packetSize = mProcessingFormat.mBytesPerPacket;
+	auto dst = static_cast<uint8_t *>(bufferList->mBuffers[0].mData);
+
+	for(;;) {
+		// Copy data from the internal buffer to output
+		uint32_t packetsToCopy = std::min(mPacketsBuffered - mBlockOffset, frameCount - framesDecoded);
+		if(packetsToCopy > 0) {
+			memcpy(dst + (framesDecoded * packetSize), mBlock.get() + (mBlockOffset * packetSize), packetsToCopy * packetSize);
+			mBlockOffset += packetsToCopy;
+			framesDecoded += packetsToCopy;
+		}
+
+		// All requested packets were read
+		if(framesDecoded == frameCount)
+			break;
+
+		// Read the next block
+		if(!ReadAndInterleaveBlock())
+			break;
+	}
+
+	SetBufferListFrameLength(bufferList, framesDecoded);
+	mPacketPosition += framesDecoded;
+
+	return true;
+}
+
+#pragma mark Seeking
+
+bool SFB::Audio::DSFDecoder::SeekToFrame(int64_t frame) noexcept
+{
+	assert(frame >= 0);
+
+	const int64_t channelCount = mProcessingFormat.mChannelsPerFrame;
+
+	// A DSF version 1 block is 4096 bytes per channel
+	// This equates to 4096 packets or 32768 frames per block
+
+	// Seek to the start of the block containing packet
+	int64_t blockNumber = frame / DSF_BLOCK_SIZE_BYTES_PER_CHANNEL;
+	int64_t blockOffset = blockNumber * DSF_BLOCK_SIZE_BYTES_PER_CHANNEL * channelCount;
+
+	if(!mInputSource->SeekToOffset(mAudioOffset + blockOffset)) {
+		os_log_debug(Log(), "SeekToFrame() failed seeking to input offset: %lld", mAudioOffset + blockOffset);
+		return Fail(Error::InternalError);
+	}
+
+	if(!ReadAndInterleaveBlock())
+		return Fail(Error::InternalError);
+
+	// Skip ahead in the interleaved audio to the specified packet
+	mBlockOffset = static_cast<uint32_t>(frame % mPacketsBuffered);
+	mPacketPosition = frame;
+
+	return true;
+}
+
+#pragma mark Block Reading
+
+// Read input, grouped in DSF as 8 one-bit samples per frame (a single channel byte) in a block
+// of the specified block size (4096 bytes per channel for DSF version 1) for each channel,
+// then interleave the channel bytes into clustered frames.
+// The DSF blocks form a matrix with one row per channel and one column per channel byte.
+// For stereo, the data is arranged as 4096 L channel bytes followed by 4096 R channel bytes,
+// a 2 x 4096 matrix.
+// Interleaving is accomplished by matrix transposition.
+bool SFB::Audio::DSFDecoder::ReadAndInterleaveBlock() noexcept
+{
+	const uint32_t channelCount = mProcessingFormat.mChannelsPerFrame;
+	assert(channelCount != 0);
+
+	const int64_t blockSize = DSF_BLOCK_SIZE_BYTES_PER_CHANNEL * channelCount;
+
+	int64_t bytesRead = 0;
+	if(!mInputSource->Read(mScratch.get(), blockSize, bytesRead) || bytesRead != blockSize) {
+		os_log_debug(Log(), "Error reading audio block: requested %lld bytes, got %lld", blockSize, bytesRead);
+		return false;
+	}
+
+	// Deinterleave the blocks and interleave the samples into clustered frames
+	MatrixTransposeNaive(mScratch.get(), mBlock.get(), channelCount, DSF_BLOCK_SIZE_BYTES_PER_CHANNEL);
+
+	mPacketsBuffered = static_cast<uint32_t>(bytesRead / (kSFBBytesPerDSDPacketPerChannel * channelCount));
+	mBlockOffset = 0;
+
+	return true;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "AudioDecoder.h"
+
+/*! @file DSFDecoder.h @brief A DSF \c Decoder */
+
+/*! @brief \c SFBAudioEngine's encompassing namespace */
+namespace SFB {
+
+	/*! @brief %Audio functionality */
+	namespace Audio {
+
+		/*!
+		 * @brief A \c Decoder for DSF (DSD stream files)
+		 *
+		 * The processing format is raw interleaved DSD so frames are DSD packets.
+		 * @see http://dsd-guide.com/sites/default/files/white-papers/DSFFileFormatSpec_E.pdf
+		 */
+		class DSFDecoder : public Decoder
+		{
+		public:
+			/*!
+			 * @brief Create a new \c DSFDecoder
+			 * @param inputSource The source of encoded audio
+			 */
+			explicit DSFDecoder(InputSource::unique_ptr inputSource) noexcept;
+
+			/*! @brief Destroy the \c DSFDecoder */
+			~DSFDecoder();
+
+			bool Open() noexcept override;
+			bool Close() noexcept override;
+			inline bool IsOpen() const noexcept override				{ return mBlock != nullptr; }
+
+			inline bool DecodingIsLossless() const noexcept override	{ return true; }
+
+			inline int64_t FramePosition() const noexcept override		{ return mPacketPosition; }
+			inline int64_t FrameLength() const noexcept override		{ return mPacketCount; }
+
+			bool Decode(AudioBufferList * const bufferList, uint32_t frameCount, uint32_t& framesDecoded) noexcept override;
+
+			bool SeekToFrame(int64_t frame) noexcept override;
+
+		private:
+
+			/*! @internal Reads the next DSF block and interleaves it into \c mBlock */
+			bool ReadAndInterleaveBlock() noexcept;
+
+			int64_t							mPacketPosition;
+			int64_t							mPacketCount;
+			int64_t							mAudioOffset;			// Offset of the first block in the input
+
+			std::unique_ptr<uint8_t []>		mBlock;					// One block of interleaved DSD packets
+			std::unique_ptr<uint8_t []>		mScratch;				// One block as read from the input
+			uint32_t						mPacketsBuffered;		// Number of packets in mBlock
+			uint32_t						mBlockOffset;			// Index of the first unconsumed packet in mBlock
+		};
+
+	}
+}
@@ -0,0 +1,398 @@
+/*
+ * Copyright (c) 2006 - 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include "FLACDecoder.h"
+
+#pragma mark FLAC Callbacks
+
+FLAC__StreamDecoderReadStatus SFB::Audio::FLACDecoder::ReadCallback(const FLAC__StreamDecoder *decoder, FLAC__byte buffer[], size_t *bytes, void *client_data)
+{
+#pragma unused(decoder)
+	assert(client_data != nullptr);
+
+	auto flacDecoder = static_cast<FLACDecoder *>(client_data);
+	auto& inputSource = *flacDecoder->mInputSource;
+
+	int64_t bytesRead;
+	if(!inputSource.Read(buffer, static_cast<int64_t>(*bytes), bytesRead))
+		return FLAC__STREAM_DECODER_READ_STATUS_ABORT;
+
+	*bytes = static_cast<size_t>(bytesRead);
+
+	if(bytesRead == 0 && inputSource.AtEOF())
+		return FLAC__STREAM_DECODER_READ_STATUS_END_OF_STREAM;
+
+	return FLAC__STREAM_DECODER_READ_STATUS_CONTINUE;
+}
+
+FLAC__StreamDecoderSeekStatus SFB::Audio::FLACDecoder::SeekCallback(const FLAC__StreamDecoder *decoder, FLAC__uint64 absolute_byte_offset, void *client_data)
+{
+#pragma unused(decoder)
+	assert(client_data != nullptr);
+
+	auto flacDecoder = static_cast<FLACDecoder *>(client_data);
+	auto& inputSource = *flacDecoder->mInputSource;
+
+	if(!inputSource.SupportsSeeking())
+		return FLAC__STREAM_DECODER_SEEK_STATUS_UNSUPPORTED;
+
+	if(!inputSource.SeekToOffset(static_cast<int64_t>(absolute_byte_offset)))
+		return FLAC__STREAM_DECODER_SEEK_STATUS_ERROR;
+
+	return FLAC__STREAM_DECODER_SEEK_STATUS_OK;
+}
+
+FLAC__StreamDecoderTellStatus SFB::Audio::FLACDecoder::TellCallback(const FLAC__StreamDecoder *decoder, FLAC__uint64 *absolute_byte_offset, void *client_data)
+{
+#pragma unused(decoder)
+	assert(client_data != nullptr);
+
+	auto flacDecoder = static_cast<FLACDecoder *>(client_data);
+
+	int64_t offset;
+	if(!flacDecoder->mInputSource->GetOffset(offset))
+		return FLAC__STREAM_DECODER_TELL_STATUS_ERROR;
+
+	*absolute_byte_offset = static_cast<FLAC__uint64>(offset);
+	return FLAC__STREAM_DECODER_TELL_STATUS_OK;
+}
+
+FLAC__StreamDecoderLengthStatus SFB::Audio::FLACDecoder::LengthCallback(const FLAC__StreamDecoder *decoder, FLAC__uint64 *stream_length, void *client_data)
+{
+#pragma unused(decoder)
+	assert(client_data != nullptr);
+
+	auto flacDecoder = static_cast<FLACDecoder *>(client_data);
+
+	int64_t length;
+	if(!flacDecoder->mInputSource->GetLength(length))
+		return FLAC__STREAM_DECODER_LENGTH_STATUS_ERROR;
+
+	*stream_length = static_cast<FLAC__uint64>(length);
+	return FLAC__STREAM_DECODER_LENGTH_STATUS_OK;
+}
+
+FLAC__bool SFB::Audio::FLACDecoder::EOFCallback(const FLAC__StreamDecoder *decoder, void *client_data)
+{
+#pragma unused(decoder)
+	assert(client_data != nullptr);
+
+	auto flacDecoder = static_cast<FLACDecoder *>(client_data);
+	return flacDecoder->mInputSource->AtEOF();
+}
+
+FLAC__StreamDecoderWriteStatus SFB::Audio::FLACDecoder::WriteCallback(const FLAC__StreamDecoder *decoder, const FLAC__Frame *frame, const FLAC__int32 * const buffer[], void *client_data)
+{
+#pragma unused(decoder)
+	assert(client_data != nullptr);
+
+	auto flacDecoder = static_cast<FLACDecoder *>(client_data);
+	return flacDecoder->HandleWrite(frame, buffer);
+}
+
+void SFB::Audio::FLACDecoder::MetadataCallback(const FLAC__StreamDecoder *decoder, const FLAC__StreamMetadata *metadata, void *client_data)
+{
+#pragma unused(decoder)
+	assert(client_data != nullptr);
+	assert(metadata != nullptr);
+
+	auto flacDecoder = static_cast<FLACDecoder *>(client_data);
+	if(metadata->type == FLAC__METADATA_TYPE_STREAMINFO)
+		memcpy(&flacDecoder->mStreamInfo, &metadata->data.stream_info, sizeof(metadata->data.stream_info));
+}
+
+void SFB::Audio::FLACDecoder::ErrorCallback(const FLAC__StreamDecoder *decoder, FLAC__StreamDecoderErrorStatus status, void *client_data)
+{
+#pragma unused(decoder)
+#pragma unused(client_data)
+	os_log_error(Log(), "FLAC error: %{public}s", FLAC__StreamDecoderErrorStatusString[status]);
+}
+
+#pragma mark Creation and Destruction
+
+SFB::Audio::FLACDecoder::FLACDecoder(InputSource::unique_ptr inputSource, bool isOggHint) noexcept
+	: Decoder(std::move(inputSource)), mStreamInfo{}, mFramePosition(0), mIsOggHint(isOggHint), mFramesBuffered(0), mFrameBufferOffset(0)
+{}
+
+SFB::Audio::FLACDecoder::~FLACDecoder()
+{
+	if(IsOpen())
+		Close();
+}
+
+#pragma mark Opening and Closing
+
+bool SFB::Audio::FLACDecoder::Open() noexcept
+{
+	// Create FLAC decoder
+	std::unique_ptr<FLAC__StreamDecoder, StreamDecoderDeleter> flac(FLAC__stream_decoder_new());
+	if(!flac)
+		return Fail(Error::OutOfMemory);
+
+	// Prefer the stream's signature to the hint since the latter may be wrong
+	bool isOggStream = mIsOggHint;
+	int64_t offset;
+	if(mInputSource->SupportsSeeking() && mInputSource->GetOffset(offset)) {
+		uint8_t header [4];
+		int64_t bytesRead;
+		if(mInputSource->Read(header, sizeof header, bytesRead) && bytesRead == static_cast<int64_t>(sizeof header))
+			isOggStream = !memcmp(header, "OggS", 4);
+		if(!mInputSource->SeekToOffset(offset))
+			return Fail(Error::InternalError);
+	}
+
+	// Attempt to create a stream decoder based on the stream's type
+	FLAC__StreamDecoderInitStatus status;
+	if(!isOggStream)
+		status = FLAC__stream_decoder_init_stream(flac.get(), ReadCallback, SeekCallback, TellCallback, LengthCallback, EOFCallback, WriteCallback, MetadataCallback, ErrorCallback, this);
+	else
+		status = FLAC__stream_decoder_init_ogg_stream(flac.get(), ReadCallback, SeekCallback, TellCallback, LengthCallback, EOFCallback, WriteCallback, MetadataCallback, ErrorCallback, this);
+
+	if(status != FLAC__STREAM_DECODER_INIT_STATUS_OK) {
+		os_log_error(Log(), "FLAC__stream_decoder_init_xxx failed: %{public}s", FLAC__stream_decoder_get_resolved_state_string(flac.get()));
+		return Fail(Error::InvalidFormat);
+	}
+
+	// Process metadata
+	if(!FLAC__stream_decoder_process_until_end_of_metadata(flac.get())) {
+		os_log_error(Log(), "FLAC__stream_decoder_process_until_end_of_metadata failed: %{public}s", FLAC__stream_decoder_get_resolved_state_string(flac.get()));
+		return Fail(Error::InvalidFormat);
+	}
+
+	// Set up the processing format
+	AudioStreamBasicDescription processingStreamDescription{};
+
+	processingStreamDescription.mFormatID			= kAudioFormatLinearPCM;
+	processingStreamDescription.mFormatFlags		= kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsSignedInteger | kAudioFormatFlagIsNonInterleaved;
+
+	processingStreamDescription.mSampleRate			= mStreamInfo.sample_rate;
+	processingStreamDescription.mChannelsPerFrame	= mStreamInfo.channels;
+	processingStreamDescription.mBitsPerChannel		= mStreamInfo.bits_per_sample;
+
+	processingStreamDescription.mBytesPerPacket		= (mStreamInfo.bits_per_sample + 7) / 8;
+	processingStreamDescription.mFramesPerPacket	= 1;
+	processingStreamDescription.mBytesPerFrame		= processingStreamDescription.mBytesPerPacket / processingStreamDescription.mFramesPerPacket;
+
+	// FLAC supports from 4 to 32 bits per sample
+	switch(processingStreamDescription.mBitsPerChannel) {
+		case 8:
+		case 16:
+		case 24:
+		case 32:
+			processingStreamDescription.mFormatFlags |= kAudioFormatFlagIsPacked;
+			break;
+
+		case 4 ... 7:
+		case 9 ... 15:
+		case 17 ... 23:
+		case 25 ... 31:
+			// Align high because Apple's AudioConverter doesn't handle low alignment
+			processingStreamDescription.mFormatFlags |= kAudioFormatFlagIsAlignedHigh;
+			break;
+
+		default:
+			os_log_error(Log(), "Unsupported bit depth: %u", mStreamInfo.bits_per_sample);
+			return Fail(Error::UnsupportedFormat);
+	}
+
+	mProcessingFormat = processingStreamDescription;
+
+	switch(mStreamInfo.channels) {
+		case 1:		mChannelLayoutTag = kAudioChannelLayoutTag_Mono;			break;
+		case 2:		mChannelLayoutTag = kAudioChannelLayoutTag_Stereo;			break;
+		case 3:		mChannelLayoutTag = kAudioChannelLayoutTag_MPEG_3_0_A;		break;
+		case 4:		mChannelLayoutTag = kAudioChannelLayoutTag_Quadraphonic;	break;
+		case 5:		mChannelLayoutTag = kAudioChannelLayoutTag_MPEG_5_0_A;		break;
+		case 6:		mChannelLayoutTag = kAudioChannelLayoutTag_MPEG_5_1_A;		break;
+		case 7:		mChannelLayoutTag = kAudioChannelLayoutTag_MPEG_6_1_A;		break;
+		case 8:		mChannelLayoutTag = kAudioChannelLayoutTag_MPEG_7_1_A;		break;
+		default:	mChannelLayoutTag = 0;										break;
+	}
+
+	// Set up the source format
+	AudioStreamBasicDescription sourceStreamDescription{};
+
+	sourceStreamDescription.mFormatID			= kAudioFormatFLAC;
+
+	sourceStreamDescription.mSampleRate			= mStreamInfo.sample_rate;
+	sourceStreamDescription.mChannelsPerFrame	= mStreamInfo.channels;
+	// Apple uses kAppleLosslessFormatFlag_XXBitSourceData to indicate FLAC bit depth in the Core Audio FLAC decoder
+	// Since the number of flags is limited the source bit depth is also stored in mBitsPerChannel
+	sourceStreamDescription.mBitsPerChannel		= mStreamInfo.bits_per_sample;
+	switch(mStreamInfo.bits_per_sample) {
+		case 16:
+			sourceStreamDescription.mFormatFlags = kAppleLosslessFormatFlag_16BitSourceData;
+			break;
+		case 20:
+			sourceStreamDescription.mFormatFlags = kAppleLosslessFormatFlag_20BitSourceData;
+			break;
+		case 24:
+			sourceStreamDescription.mFormatFlags = kAppleLosslessFormatFlag_24BitSourceData;
+			break;
+		case 32:
+			sourceStreamDescription.mFormatFlags = kAppleLosslessFormatFlag_32BitSourceData;
+			break;
+	}
+
+	sourceStreamDescription.mFramesPerPacket	= mStreamInfo.max_blocksize;
+
+	mSourceFormat = sourceStreamDescription;
+
+	// Allocate the frame buffer (which will convert from FLAC's push model to a pull model)
+	size_t channelBufferSize = static_cast<size_t>(mStreamInfo.max_blocksize) * processingStreamDescription.mBytesPerFrame;
+	mFrameBuffer.reset(new (std::nothrow) uint8_t [channelBufferSize * mStreamInfo.channels]);
+	mChannelBuffers.reset(new (std::nothrow) uint8_t * [mStreamInfo.channels]);
+	if(!mFrameBuffer || !mChannelBuffers) {
+		mFrameBuffer.reset();
+		mChannelBuffers.reset();
+		return Fail(Error::OutOfMemory);
+	}
+
+	for(uint32_t channel = 0; channel < mStreamInfo.channels; ++channel)
+		mChannelBuffers[channel] = mFrameBuffer.get() + (channel * channelBufferSize);
+
+	mFramesBuffered = 0;
+	mFrameBufferOffset = 0;
+	mFramePosition = 0;
+
+	mFLAC = std::move(flac);
+
+	return true;
+}
+
+bool SFB::Audio::FLACDecoder::Close() noexcept
+{
+	if(mFLAC && !FLAC__stream_decoder_finish(mFLAC.get()))
+		os_log_info(Log(), "FLAC__stream_decoder_finish failed: %{public}s", FLAC__stream_decoder_get_resolved_state_string(mFLAC.get()));
+
+	mFLAC.reset();
+
+	mFrameBuffer.reset();
+	mChannelBuffers.reset();
+	mFramesBuffered = 0;
+	mFrameBufferOffset = 0;
+	memset(&mStreamInfo, 0, sizeof(mStreamInfo));
+
+	return true;
+}
+
+#pragma mark Decoding
+
+bool SFB::Audio::FLACDecoder::Decode(AudioBufferList * const bufferList, uint32_t frameCount, uint32_t& framesDecoded) noexcept
+{
+	assert(bufferList != nullptr);
+	assert(bufferList->mNumberBuffers == mStreamInfo.channels);
+
+	framesDecoded = 0;
+
+	const uint32_t bytesPerFrame = mProcessingFormat.mBytesPerFrame;
+
+	for(;;) {
+		// Copy buffered audio to the output
+		uint32_t framesToCopy = std::min(mFramesBuffered - mFrameBufferOffset, frameCount - framesDecoded);
+		if(framesToCopy > 0) {
+			for(UInt32 channel = 0; channel < bufferList->mNumberBuffers; ++channel)
+				memcpy(static_cast<uint8_t *>(bufferList->mBuffers[channel].mData) + (framesDecoded * bytesPerFrame), mChannelBuffers[channel] + (mFrameBufferOffset * bytesPerFrame), framesToCopy * bytesPerFrame);
+			mFrameBufferOffset += framesToCopy;
+			framesDecoded += framesToCopy;
+		}
+
+		// All requested frames were read or EOS reached
+		if(framesDecoded == frameCount || FLAC__stream_decoder_get_state(mFLAC.get()) == FLAC__STREAM_DECODER_END_OF_STREAM)
+			break;
+
+		// Grab the next frame
+		if(!FLAC__stream_decoder_process_single(mFLAC.get())) {
+			os_log_error(Log(), "FLAC__stream_decoder_process_single failed: %{public}s", FLAC__stream_decoder_get_resolved_state_string(mFLAC.get()));
+			SetBufferListFrameLength(bufferList, framesDecoded);
+			mFramePosition += framesDecoded;
+			return Fail(Error::InternalError);
+		}
+	}
+
+	SetBufferListFrameLength(bufferList, framesDecoded);
+	mFramePosition += framesDecoded;
+
+	return true;
+}
+
+FLAC__StreamDecoderWriteStatus SFB::Audio::FLACDecoder::HandleWrite(const FLAC__Frame *frame, const FLAC__int32 * const buffer[]) noexcept
+{
+	assert(frame != nullptr);
+
+	if(frame->header.channels != mStreamInfo.channels || frame->header.blocksize > mStreamInfo.max_blocksize)
+		return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+
+	// FLAC hands us 32-bit signed integers with the samples low-aligned
+	uint32_t bytesPerFrame = (frame->header.bits_per_sample + 7) / 8;
+	if(bytesPerFrame != mProcessingFormat.mBytesPerFrame)
+		return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+
+	switch(bytesPerFrame) {
+		case 1:
+			for(uint32_t channel = 0; channel < frame->header.channels; ++channel) {
+				auto dst = reinterpret_cast<int8_t *>(mChannelBuffers[channel]);
+				for(uint32_t sample = 0; sample < frame->header.blocksize; ++sample)
+					*dst++ = static_cast<int8_t>(buffer[channel][sample]);
+			}
+			break;
+
+		case 2:
+			for(uint32_t channel = 0; channel < frame->header.channels; ++channel) {
+				auto dst = reinterpret_cast<int16_t *>(mChannelBuffers[channel]);
+				for(uint32_t sample = 0; sample < frame->header.blocksize; ++sample)
+					*dst++ = static_cast<int16_t>(buffer[channel][sample]);
+			}
+			break;
+
+		case 3:
+			for(uint32_t channel = 0; channel < frame->header.channels; ++channel) {
+				uint8_t *dst = mChannelBuffers[channel];
+				for(uint32_t sample = 0; sample < frame->header.blocksize; ++sample) {
+					uint32_t value = OSSwapHostToLittleInt32(static_cast<uint32_t>(buffer[channel][sample]));
+					*dst++ = static_cast<uint8_t>(value & 0xff);
+					*dst++ = static_cast<uint8_t>((value >> 8) & 0xff);
+					*dst++ = static_cast<uint8_t>((value >> 16) & 0xff);
+				}
+			}
+			break;
+
+		case 4:
+			for(uint32_t channel = 0; channel < frame->header.channels; ++channel)
+				memcpy(mChannelBuffers[channel], buffer[channel], frame->header.blocksize * sizeof(int32_t));
+			break;
+	}
+
+	mFramesBuffered = frame->header.blocksize;
+	mFrameBufferOffset = 0;
+
+	return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+}
+
+#pragma mark Seeking
+
+bool SFB::Audio::FLACDecoder::SeekToFrame(int64_t frame) noexcept
+{
+	assert(frame >= 0);
+
+	FLAC__bool result = FLAC__stream_decoder_seek_absolute(mFLAC.get(), static_cast<FLAC__uint64>(frame));
+
+	// Attempt to re-sync the stream if necessary
+	if(FLAC__stream_decoder_get_state(mFLAC.get()) == FLAC__STREAM_DECODER_SEEK_ERROR)
+		result = FLAC__stream_decoder_flush(mFLAC.get());
+
+	if(!result)
+		return Fail(Error::InternalError);
+
+	mFramePosition = frame;
+	mFramesBuffered = 0;
+	mFrameBufferOffset = 0;
+
+	return true;
+}
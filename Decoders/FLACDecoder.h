@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#pragma once
+
+#include <memory>
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wquoted-include-in-framework-header"
+
+#include <FLAC/stream_decoder.h>
+
+#pragma clang diagnostic pop
+
+#include "AudioDecoder.h"
+
+/*! @file FLACDecoder.h @brief A FLAC and Ogg FLAC \c Decoder */
+
+/*! @brief \c SFBAudioEngine's encompassing namespace */
+namespace SFB {
+
+	/*! @brief %Audio functionality */
+	namespace Audio {
+
+		/*! @brief A \c Decoder for FLAC and Ogg FLAC */
+		class FLACDecoder : public Decoder
+		{
+		public:
+			/*!
+			 * @brief Create a new \c FLACDecoder
+			 * @param inputSource The source of encoded audio
+			 * @param isOggHint Whether to treat non-seekable input as Ogg FLAC, since the stream type can't be probed
+			 */
+			explicit FLACDecoder(InputSource::unique_ptr inputSource, bool isOggHint = false) noexcept;
+
+			/*! @brief Destroy the \c FLACDecoder */
+			~FLACDecoder();
+
+			bool Open() noexcept override;
+			bool Close() noexcept override;
+			inline bool IsOpen() const noexcept override				{ return mFLAC != nullptr; }
+
+			inline bool DecodingIsLossless() const noexcept override	{ return true; }
+
+			inline int64_t FramePosition() const noexcept override		{ return mFramePosition; }
+			inline int64_t FrameLength() const noexcept override		{ return static_cast<int64_t>(mStreamInfo.total_samples); }
+
+			bool Decode(AudioBufferList * const bufferList, uint32_t frameCount, uint32_t& framesDecoded) noexcept override;
+
+			bool SeekToFrame(int64_t frame) noexcept override;
+
+		private:
+
+			/*! @internal Deleter for \c FLAC__StreamDecoder */
+			struct StreamDecoderDeleter {
+				inline void operator()(FLAC__StreamDecoder *decoder) const noexcept { FLAC__stream_decoder_delete(decoder); }
+			};
+
+			static FLAC__StreamDecoderReadStatus ReadCallback(const FLAC__StreamDecoder *decoder, FLAC__byte buffer[], size_t *bytes, void *client_data);
+			static FLAC__StreamDecoderSeekStatus SeekCallback(const FLAC__StreamDecoder *decoder, FLAC__uint64 absolute_byte_offset, void *client_data);
+			static FLAC__StreamDecoderTellStatus TellCallback(const FLAC__StreamDecoder *decoder, FLAC__uint64 *absolute_byte_offset, void *client_data);
+			static FLAC__StreamDecoderLengthStatus LengthCallback(const FLAC__StreamDecoder *decoder, FLAC__uint64 *stream_length, void *client_data);
+			static FLAC__bool EOFCallback(const FLAC__StreamDecoder *decoder, void *client_data);
+			static FLAC__StreamDecoderWriteStatus WriteCallback(const FLAC__StreamDecoder *decoder, const FLAC__Frame *frame, const FLAC__int32 * const buffer[], void *client_data);
+			static void MetadataCallback(const FLAC__StreamDecoder *decoder, const FLAC__StreamMetadata *metadata, void *client_data);
+			static void ErrorCallback(const FLAC__StreamDecoder *decoder, FLAC__StreamDecoderErrorStatus status, void *client_data);
+
+			/*! @internal Converts a decoded FLAC frame to the processing format */
+			FLAC__StreamDecoderWriteStatus HandleWrite(const FLAC__Frame *frame, const FLAC__int32 * const buffer[]) noexcept;
+
+			std::unique_ptr<FLAC__StreamDecoder, StreamDecoderDeleter>	mFLAC;
+			FLAC__StreamMetadata_StreamInfo			mStreamInfo;
+			int64_t									mFramePosition;
+			bool									mIsOggHint;
+
+			// Converts FLAC's push model to a pull model
+			std::unique_ptr<uint8_t []>				mFrameBuffer;			// Storage for one decoded FLAC frame
+			std::unique_ptr<uint8_t * []>			mChannelBuffers;		// Per-channel pointers into mFrameBuffer
+			uint32_t								mFramesBuffered;		// Number of frames in mFrameBuffer
+			uint32_t								mFrameBufferOffset;		// Index of the first unconsumed frame in mFrameBuffer
+		};
+
+	}
+}
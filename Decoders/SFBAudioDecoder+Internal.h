@@ -11,6 +11,25 @@ NS_ASSUME_NONNULL_BEGIN
 
 extern os_log_t gSFBAudioDecoderLog;
 
+/// The maximum length of an \c SFBAudioDecoderSignature, in bytes
+#define SFB_AUDIO_DECODER_SIGNATURE_MAX_LENGTH 32
+
+/// A sequence of bytes at a fixed offset from the start of a file identifying its format
+@interface SFBAudioDecoderSignature : NSObject
++ (instancetype)new NS_UNAVAILABLE;
+- (instancetype)init NS_UNAVAILABLE;
+/// Returns a signature matching \c bytes at the start of the data
++ (instancetype)signatureWithBytes:(const void *)bytes length:(NSUInteger)length;
+/// Returns a signature matching \c bytes at \c offset from the start of the data
++ (instancetype)signatureWithBytes:(const void *)bytes length:(NSUInteger)length offset:(NSUInteger)offset;
+/// Returns an initialized signature matching \c bytes at \c offset from the start of the data
+- (instancetype)initWithBytes:(const void *)bytes length:(NSUInteger)length offset:(NSUInteger)offset NS_DESIGNATED_INITIALIZER;
+/// The bytes to match
+@property (nonatomic, readonly) NSData *bytes;
+/// The offset of \c bytes from the start of the data
+@property (nonatomic, readonly) NSUInteger offset;
+@end
+
 @interface SFBAudioDecoder ()
 {
 @package
@@ -18,9 +37,13 @@ extern os_log_t gSFBAudioDecoderLog;
 @protected
 	AVAudioFormat *_sourceFormat;
 	AVAudioFormat *_processingFormat;
+	NSDictionary<SFBAudioDecodingSettingsKey, SFBAudioDecodingSettingsValue> *_settings;
 }
 /// Returns the decoder name
 @property (class, nonatomic, readonly) SFBAudioDecoderName decoderName;
+/// Returns the byte signatures identifying data handled by the decoder
+/// @note The default implementation returns an empty array
+@property (class, nonatomic, readonly) NSArray<SFBAudioDecoderSignature *> *supportedSignatures;
 @end
 
 #pragma mark - Subclass Registration and Lookup
@@ -41,6 +64,11 @@ extern os_log_t gSFBAudioDecoderLog;
 + (nullable Class)subclassForMIMEType:(NSString *)mimeType;
 /// Returns the appropriate \c SFBAudioDecoder subclass corresponding to \c decoderName
 + (nullable Class)subclassForDecoderName:(SFBAudioDecoderName)decoderName;
+/// Returns the \c SFBAudioDecoder subclass whose signatures best match the first bytes of \c inputSource
+/// @note \c inputSource is opened if necessary and its read position is restored
++ (nullable Class)subclassForHeaderOfInputSource:(SFBInputSource *)inputSource;
+/// Returns the \c SFBAudioDecoder subclass whose signatures best match \c header
++ (nullable Class)subclassForHeader:(const void *)header length:(NSUInteger)length;
 @end
 
 NS_ASSUME_NONNULL_END
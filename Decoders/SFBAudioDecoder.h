@@ -10,6 +10,11 @@ NS_ASSUME_NONNULL_BEGIN
 /// Constant type for decoder names
 typedef NSString * SFBAudioDecoderName NS_TYPED_ENUM NS_SWIFT_NAME(AudioDecoder.Name);
 
+/// A key in an audio decoder's settings dictionary
+typedef NSString * SFBAudioDecodingSettingsKey NS_TYPED_ENUM NS_SWIFT_NAME(AudioDecodingSettingsKey);
+/// A value in an audio decoder's settings dictionary
+typedef id SFBAudioDecodingSettingsValue NS_SWIFT_NAME(AudioDecodingSettingsValue);
+
 /// FLAC and Ogg FLAC
 extern SFBAudioDecoderName const SFBAudioDecoderNameFLAC;
 /// Monkey's Audio
@@ -124,6 +129,12 @@ NS_SWIFT_NAME(AudioDecoder) @interface SFBAudioDecoder : NSObject <SFBPCMDecodin
 /// @return \c YES on success, \c NO otherwise
 - (BOOL)closeReturningError:(NSError **)error NS_REQUIRES_SUPER;
 
+#pragma mark - Decoding Settings
+
+/// Decoder settings
+/// @note Settings must be set before the decoder is opened
+@property (nonatomic, copy, nullable) NSDictionary<SFBAudioDecodingSettingsKey, SFBAudioDecodingSettingsValue> *settings;
+
 @end
 
 #pragma mark - Error Information
@@ -141,4 +152,10 @@ typedef NS_ERROR_ENUM(SFBAudioDecoderErrorDomain, SFBAudioDecoderErrorCode) {
 	SFBAudioDecoderErrorCodeInvalidFormat	= 2
 } NS_SWIFT_NAME(AudioDecoder.ErrorCode);
 
+#pragma mark - Ogg Opus Decoder Settings
+
+/// Set to nonzero to produce non-interleaved audio (\c NSNumber)
+/// @note By default Ogg Opus audio is produced interleaved, which is libopusfile's native layout
+extern SFBAudioDecodingSettingsKey const SFBAudioDecodingSettingsKeyOggOpusNonInterleaved;
+
 NS_ASSUME_NONNULL_END
@@ -5,6 +5,9 @@
 
 @import os.log;
 
+#import <os/lock.h>
+#import <stdlib.h>
+
 #import "SFBAudioDecoder.h"
 #import "SFBAudioDecoder+Internal.h"
 
@@ -29,17 +32,69 @@ static void SFBCreateAudioDecoderLog()
 @property (nonatomic) int priority;
 @end
 
+/// An entry in the probe table
+typedef struct SFBAudioDecoderProbeEntry {
+	/// The subclass identified by this entry
+	__unsafe_unretained Class klass;
+	/// The priority of \c klass
+	int priority;
+	/// The entry's rank by priority and signature length, lower is better
+	NSUInteger rank;
+	/// The index of the entry's offset in the probe table
+	NSUInteger offsetIndex;
+	/// The number of bytes in \c bytes
+	NSUInteger length;
+	/// The signature bytes
+	uint8_t bytes [SFB_AUDIO_DECODER_SIGNATURE_MAX_LENGTH];
+} SFBAudioDecoderProbeEntry;
+
+/// Immutable lookup tables derived from the registered subclasses
+@interface SFBAudioDecoderLookupTables : NSObject
+{
+@package
+	NSDictionary<NSString *, Class> *_pathExtensions;
+	NSDictionary<NSString *, Class> *_mimeTypes;
+	NSDictionary<SFBAudioDecoderName, Class> *_decoderNames;
+
+	/// The distinct signature offsets, in ascending order
+	NSUInteger *_probeOffsets;
+	NSUInteger _probeOffsetCount;
+	/// Probe entries sorted by offset, first byte, and rank
+	SFBAudioDecoderProbeEntry *_probeEntries;
+	/// Bucket boundaries in \c _probeEntries: 257 indexes per offset keyed by first byte
+	NSUInteger *_probeBuckets;
+	/// The number of bytes required to test every signature
+	NSUInteger _probeLength;
+}
+- (instancetype)initWithRegisteredSubclasses:(NSArray<SFBAudioDecoderSubclassInfo *> *)registeredSubclasses;
+- (nullable Class)subclassForHeader:(const uint8_t *)header length:(NSUInteger)length;
+@end
+
 @implementation SFBAudioDecoder
 
 @synthesize inputSource = _inputSource;
 @synthesize sourceFormat = _sourceFormat;
 @synthesize processingFormat = _processingFormat;
+@synthesize settings = _settings;
 
 @dynamic decodingIsLossless;
 @dynamic framePosition;
 @dynamic frameLength;
 
 static NSMutableArray *_registeredSubclasses = nil;
+static SFBAudioDecoderLookupTables *_lookupTables = nil;
+static os_unfair_lock _registrationLock = OS_UNFAIR_LOCK_INIT;
+
+/// Returns the lookup tables for the registered subclasses, building them if necessary
+static SFBAudioDecoderLookupTables * SFBAudioDecoderCurrentLookupTables(void)
+{
+	os_unfair_lock_lock(&_registrationLock);
+	if(!_lookupTables)
+		_lookupTables = [[SFBAudioDecoderLookupTables alloc] initWithRegisteredSubclasses:_registeredSubclasses];
+	SFBAudioDecoderLookupTables *lookupTables = _lookupTables;
+	os_unfair_lock_unlock(&_registrationLock);
+	return lookupTables;
+}
 
 + (void)load
 {
@@ -60,22 +115,12 @@ static NSMutableArray *_registeredSubclasses = nil;
 
 + (NSSet *)supportedPathExtensions
 {
-	NSMutableSet *result = [NSMutableSet set];
-	for(SFBAudioDecoderSubclassInfo *subclassInfo in _registeredSubclasses) {
-		NSSet *supportedPathExtensions = [subclassInfo.klass supportedPathExtensions];
-		[result unionSet:supportedPathExtensions];
-	}
-	return result;
+	return [NSSet setWithArray:SFBAudioDecoderCurrentLookupTables()->_pathExtensions.allKeys];
 }
 
 + (NSSet *)supportedMIMETypes
 {
-	NSMutableSet *result = [NSMutableSet set];
-	for(SFBAudioDecoderSubclassInfo *subclassInfo in _registeredSubclasses) {
-		NSSet *supportedMIMETypes = [subclassInfo.klass supportedMIMETypes];
-		[result unionSet:supportedMIMETypes];
-	}
-	return result;
+	return [NSSet setWithArray:SFBAudioDecoderCurrentLookupTables()->_mimeTypes.allKeys];
 }
 
 + (SFBAudioDecoderName)decoderName
@@ -84,26 +129,19 @@ static NSMutableArray *_registeredSubclasses = nil;
 	__builtin_unreachable();
 }
 
++ (NSArray *)supportedSignatures
+{
+	return @[];
+}
+
 + (BOOL)handlesPathsWithExtension:(NSString *)extension
 {
-	NSString *lowercaseExtension = extension.lowercaseString;
-	for(SFBAudioDecoderSubclassInfo *subclassInfo in _registeredSubclasses) {
-		NSSet *supportedPathExtensions = [subclassInfo.klass supportedPathExtensions];
-		if([supportedPathExtensions containsObject:lowercaseExtension])
-			return YES;
-	}
-	return NO;
+	return SFBAudioDecoderCurrentLookupTables()->_pathExtensions[extension.lowercaseString] != nil;
 }
 
 + (BOOL)handlesMIMEType:(NSString *)mimeType
 {
-	NSString *lowercaseMIMEType = mimeType.lowercaseString;
-	for(SFBAudioDecoderSubclassInfo *subclassInfo in _registeredSubclasses) {
-		NSSet *supportedMIMETypes = [subclassInfo.klass supportedMIMETypes];
-		if([supportedMIMETypes containsObject:lowercaseMIMEType])
-			return YES;
-	}
-	return NO;
+	return SFBAudioDecoderCurrentLookupTables()->_mimeTypes[mimeType.lowercaseString] != nil;
 }
 
 - (instancetype)initWithURL:(NSURL *)url
@@ -150,12 +188,15 @@ static NSMutableArray *_registeredSubclasses = nil;
 		os_log_debug(gSFBAudioDecoderLog, "SFBAudioDecoder unsupported MIME type: %{public}@", mimeType);
 	}
 
-	// If no MIME type was specified, use the extension-based resolvers
-
-	// TODO: Some extensions (.oga for example) support multiple audio codecs (Vorbis, FLAC, Speex)
-	// and if openDecoder is false the wrong decoder type may be returned, since the file isn't analyzed
-	// until Open() is called
+	// Otherwise examine the data for a known signature, which takes precedence over the file extension
+	Class subclass = [SFBAudioDecoder subclassForHeaderOfInputSource:inputSource];
+	if(subclass) {
+		if((self = [[subclass alloc] init]))
+			_inputSource = inputSource;
+		return self;
+	}
 
+	// Fall back to the extension-based resolvers for formats without signatures
 	NSString *pathExtension = inputSource.url.pathExtension;
 	if(!pathExtension) {
 		if(error)
@@ -168,7 +209,7 @@ static NSMutableArray *_registeredSubclasses = nil;
 		return nil;
 	}
 
-	Class subclass = [SFBAudioDecoder subclassForPathExtension:pathExtension.lowercaseString];
+	subclass = [SFBAudioDecoder subclassForPathExtension:pathExtension.lowercaseString];
 	if(!subclass) {
 		os_log_debug(gSFBAudioDecoderLog, "SFBAudioDecoder unsupported path extension: %{public}@", pathExtension);
 
@@ -281,6 +322,195 @@ static NSMutableArray *_registeredSubclasses = nil;
 @implementation SFBAudioDecoderSubclassInfo
 @end
 
+@implementation SFBAudioDecoderSignature
+
++ (instancetype)signatureWithBytes:(const void *)bytes length:(NSUInteger)length
+{
+	return [[SFBAudioDecoderSignature alloc] initWithBytes:bytes length:length offset:0];
+}
+
++ (instancetype)signatureWithBytes:(const void *)bytes length:(NSUInteger)length offset:(NSUInteger)offset
+{
+	return [[SFBAudioDecoderSignature alloc] initWithBytes:bytes length:length offset:offset];
+}
+
+- (instancetype)initWithBytes:(const void *)bytes length:(NSUInteger)length offset:(NSUInteger)offset
+{
+	NSParameterAssert(bytes != NULL);
+	NSParameterAssert(length > 0 && length <= SFB_AUDIO_DECODER_SIGNATURE_MAX_LENGTH);
+
+	if((self = [super init])) {
+		_bytes = [NSData dataWithBytes:bytes length:length];
+		_offset = offset;
+	}
+	return self;
+}
+
+@end
+
+static int SFBAudioDecoderProbeEntryCompareRank(const void *lhs, const void *rhs)
+{
+	const SFBAudioDecoderProbeEntry *a = lhs;
+	const SFBAudioDecoderProbeEntry *b = rhs;
+	if(a->rank != b->rank)
+		return a->rank < b->rank ? -1 : 1;
+	return 0;
+}
+
+static int SFBAudioDecoderProbeEntryComparePriority(const void *lhs, const void *rhs)
+{
+	const SFBAudioDecoderProbeEntry *a = lhs;
+	const SFBAudioDecoderProbeEntry *b = rhs;
+	if(a->priority != b->priority)
+		return a->priority > b->priority ? -1 : 1;
+	if(a->length != b->length)
+		return a->length > b->length ? -1 : 1;
+	// Before ranking, rank holds the registration order
+	return SFBAudioDecoderProbeEntryCompareRank(lhs, rhs);
+}
+
+static int SFBAudioDecoderProbeEntryCompareBucket(const void *lhs, const void *rhs)
+{
+	const SFBAudioDecoderProbeEntry *a = lhs;
+	const SFBAudioDecoderProbeEntry *b = rhs;
+	if(a->offsetIndex != b->offsetIndex)
+		return a->offsetIndex < b->offsetIndex ? -1 : 1;
+	if(a->bytes[0] != b->bytes[0])
+		return a->bytes[0] < b->bytes[0] ? -1 : 1;
+	return SFBAudioDecoderProbeEntryCompareRank(lhs, rhs);
+}
+
+@implementation SFBAudioDecoderLookupTables
+
+- (instancetype)initWithRegisteredSubclasses:(NSArray<SFBAudioDecoderSubclassInfo *> *)registeredSubclasses
+{
+	if((self = [super init])) {
+		NSMutableDictionary *pathExtensions = [NSMutableDictionary dictionary];
+		NSMutableDictionary *mimeTypes = [NSMutableDictionary dictionary];
+		NSMutableDictionary *decoderNames = [NSMutableDictionary dictionary];
+		NSMutableArray *signatures = [NSMutableArray array];
+		NSMutableArray *signatureInfo = [NSMutableArray array];
+
+		// registeredSubclasses is ordered by descending priority so the first subclass claiming a key wins
+		for(SFBAudioDecoderSubclassInfo *subclassInfo in registeredSubclasses) {
+			for(NSString *pathExtension in [subclassInfo.klass supportedPathExtensions]) {
+				NSString *key = pathExtension.lowercaseString;
+				if(!pathExtensions[key])
+					pathExtensions[key] = subclassInfo.klass;
+			}
+			for(NSString *mimeType in [subclassInfo.klass supportedMIMETypes]) {
+				NSString *key = mimeType.lowercaseString;
+				if(!mimeTypes[key])
+					mimeTypes[key] = subclassInfo.klass;
+			}
+			SFBAudioDecoderName decoderName = [subclassInfo.klass decoderName];
+			if(!decoderNames[decoderName])
+				decoderNames[decoderName] = subclassInfo.klass;
+			for(SFBAudioDecoderSignature *signature in [subclassInfo.klass supportedSignatures]) {
+				[signatures addObject:signature];
+				[signatureInfo addObject:subclassInfo];
+			}
+		}
+
+		_pathExtensions = [pathExtensions copy];
+		_mimeTypes = [mimeTypes copy];
+		_decoderNames = [decoderNames copy];
+
+		NSUInteger entryCount = signatures.count;
+		if(entryCount == 0)
+			return self;
+
+		_probeEntries = calloc(entryCount, sizeof(SFBAudioDecoderProbeEntry));
+		_probeOffsets = calloc(entryCount, sizeof(NSUInteger));
+		if(!_probeEntries || !_probeOffsets) {
+			os_log_error(gSFBAudioDecoderLog, "Unable to allocate memory for probe table");
+			return self;
+		}
+
+		// Collect the distinct offsets
+		NSMutableIndexSet *offsets = [NSMutableIndexSet indexSet];
+		for(SFBAudioDecoderSignature *signature in signatures)
+			[offsets addIndex:signature.offset];
+		[offsets enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+			self->_probeOffsets[self->_probeOffsetCount++] = idx;
+		}];
+
+		for(NSUInteger i = 0; i < entryCount; ++i) {
+			SFBAudioDecoderSignature *signature = signatures[i];
+			SFBAudioDecoderSubclassInfo *subclassInfo = signatureInfo[i];
+			SFBAudioDecoderProbeEntry *entry = _probeEntries + i;
+			entry->klass = subclassInfo.klass;
+			entry->priority = subclassInfo.priority;
+			entry->rank = i;
+			entry->offsetIndex = [offsets countOfIndexesInRange:NSMakeRange(0, signature.offset)];
+			entry->length = signature.bytes.length;
+			memcpy(entry->bytes, signature.bytes.bytes, entry->length);
+			_probeLength = MAX(_probeLength, signature.offset + entry->length);
+		}
+
+		// Rank the entries by priority, then by signature length since a longer match is more specific
+		qsort(_probeEntries, entryCount, sizeof(SFBAudioDecoderProbeEntry), SFBAudioDecoderProbeEntryComparePriority);
+		for(NSUInteger i = 0; i < entryCount; ++i)
+			_probeEntries[i].rank = i;
+
+		qsort(_probeEntries, entryCount, sizeof(SFBAudioDecoderProbeEntry), SFBAudioDecoderProbeEntryCompareBucket);
+
+		// Bucket b for offset o spans [_probeBuckets[o * 257 + b], _probeBuckets[o * 257 + b + 1])
+		_probeBuckets = calloc(_probeOffsetCount * 257, sizeof(NSUInteger));
+		if(!_probeBuckets) {
+			os_log_error(gSFBAudioDecoderLog, "Unable to allocate memory for probe table");
+			_probeLength = 0;
+			return self;
+		}
+
+		NSUInteger entryIndex = 0;
+		for(NSUInteger offsetIndex = 0; offsetIndex < _probeOffsetCount; ++offsetIndex) {
+			NSUInteger *buckets = _probeBuckets + offsetIndex * 257;
+			for(NSUInteger byte = 0; byte < 256; ++byte) {
+				buckets[byte] = entryIndex;
+				while(entryIndex < entryCount && _probeEntries[entryIndex].offsetIndex == offsetIndex && _probeEntries[entryIndex].bytes[0] == byte)
+					++entryIndex;
+			}
+			buckets[256] = entryIndex;
+		}
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	free(_probeEntries);
+	free(_probeOffsets);
+	free(_probeBuckets);
+}
+
+- (Class)subclassForHeader:(const uint8_t *)header length:(NSUInteger)length
+{
+	const SFBAudioDecoderProbeEntry *best = NULL;
+	for(NSUInteger offsetIndex = 0; offsetIndex < _probeOffsetCount; ++offsetIndex) {
+		NSUInteger offset = _probeOffsets[offsetIndex];
+		if(offset >= length)
+			break;
+
+		const NSUInteger *buckets = _probeBuckets + offsetIndex * 257;
+		uint8_t byte = header[offset];
+		// Entries in a bucket are ordered by rank so the first match is the best for this offset
+		for(NSUInteger i = buckets[byte]; i < buckets[byte + 1]; ++i) {
+			const SFBAudioDecoderProbeEntry *entry = _probeEntries + i;
+			if(best && best->rank < entry->rank)
+				break;
+			if(offset + entry->length <= length && !memcmp(header + offset, entry->bytes, entry->length)) {
+				best = entry;
+				break;
+			}
+		}
+	}
+
+	return best ? best->klass : nil;
+}
+
+@end
+
 @implementation SFBAudioDecoder (SFBAudioDecoderSubclassRegistration)
 
 + (void)registerSubclass:(Class)subclass
@@ -301,10 +531,22 @@ static NSMutableArray *_registeredSubclasses = nil;
 	subclassInfo.klass = subclass;
 	subclassInfo.priority = priority;
 
-	[_registeredSubclasses addObject:subclassInfo];
-	[_registeredSubclasses sortUsingComparator:^NSComparisonResult(id _Nonnull obj1, id _Nonnull obj2) {
-		return ((SFBAudioDecoderSubclassInfo *)obj1).priority < ((SFBAudioDecoderSubclassInfo *)obj2).priority;
+	os_unfair_lock_lock(&_registrationLock);
+
+	// Keep _registeredSubclasses ordered by descending priority, with equal priorities in registration order
+	NSUInteger index = [_registeredSubclasses indexOfObject:subclassInfo inSortedRange:NSMakeRange(0, _registeredSubclasses.count) options:NSBinarySearchingInsertionIndex | NSBinarySearchingLastEqual usingComparator:^NSComparisonResult(id _Nonnull obj1, id _Nonnull obj2) {
+		int priority1 = ((SFBAudioDecoderSubclassInfo *)obj1).priority;
+		int priority2 = ((SFBAudioDecoderSubclassInfo *)obj2).priority;
+		if(priority1 == priority2)
+			return NSOrderedSame;
+		return priority1 > priority2 ? NSOrderedAscending : NSOrderedDescending;
 	}];
+	[_registeredSubclasses insertObject:subclassInfo atIndex:index];
+
+	// The lookup tables are rebuilt lazily on next use
+	_lookupTables = nil;
+
+	os_unfair_lock_unlock(&_registrationLock);
 }
 
 @end
@@ -322,35 +564,73 @@ static NSMutableArray *_registeredSubclasses = nil;
 
 + (Class)subclassForPathExtension:(NSString *)extension
 {
-	for(SFBAudioDecoderSubclassInfo *subclassInfo in _registeredSubclasses) {
-		NSSet *supportedPathExtensions = [subclassInfo.klass supportedPathExtensions];
-		if([supportedPathExtensions containsObject:extension])
-			return subclassInfo.klass;
-	}
-
-	return nil;
+	return SFBAudioDecoderCurrentLookupTables()->_pathExtensions[extension];
 }
 
 + (Class)subclassForMIMEType:(NSString *)mimeType
 {
-	for(SFBAudioDecoderSubclassInfo *subclassInfo in _registeredSubclasses) {
-		NSSet *supportedMIMETypes = [subclassInfo.klass supportedMIMETypes];
-		if([supportedMIMETypes containsObject:mimeType])
-			return subclassInfo.klass;
-	}
-
-	return nil;
+	return SFBAudioDecoderCurrentLookupTables()->_mimeTypes[mimeType];
 }
 
 + (Class)subclassForDecoderName:(SFBAudioDecoderName)decoderName
 {
-	for(SFBAudioDecoderSubclassInfo *subclassInfo in _registeredSubclasses) {
-		SFBAudioDecoderName subclassDecoderName = [subclassInfo.klass decoderName];
-		if(subclassDecoderName == decoderName)
-			return subclassInfo.klass;
+	return SFBAudioDecoderCurrentLookupTables()->_decoderNames[decoderName];
+}
+
++ (Class)subclassForHeader:(const void *)header length:(NSUInteger)length
+{
+	NSParameterAssert(header != NULL);
+	return [SFBAudioDecoderCurrentLookupTables() subclassForHeader:header length:length];
+}
+
++ (Class)subclassForHeaderOfInputSource:(SFBInputSource *)inputSource
+{
+	NSParameterAssert(inputSource != nil);
+
+	SFBAudioDecoderLookupTables *lookupTables = SFBAudioDecoderCurrentLookupTables();
+	NSUInteger probeLength = lookupTables->_probeLength;
+	if(probeLength == 0)
+		return nil;
+
+	BOOL openedInputSource = NO;
+	if(!inputSource.isOpen) {
+		if(![inputSource openReturningError:nil])
+			return nil;
+		openedInputSource = YES;
 	}
 
-	return nil;
+	Class subclass = nil;
+	NSInteger originalOffset = 0;
+	if(inputSource.supportsSeeking && [inputSource getOffset:&originalOffset error:nil]) {
+		// A single read of the header suffices unless an ID3v2 tag precedes the audio data
+		uint8_t header [probeLength < 10 ? 10 : probeLength];
+		NSInteger headerOffset = 0;
+		NSInteger bytesRead = 0;
+		if([inputSource seekToOffset:0 error:nil] && [inputSource readBytes:header length:(NSInteger)sizeof header bytesRead:&bytesRead error:nil]) {
+			if(bytesRead >= 10 && !memcmp(header, "ID3", 3) && header[3] != 0xff && header[4] != 0xff && !((header[6] | header[7] | header[8] | header[9]) & 0x80)) {
+				// ID3v2 tag sizes are syncsafe integers excluding the header and footer
+				headerOffset = 10 + ((header[6] << 21) | (header[7] << 14) | (header[8] << 7) | header[9]);
+				if(header[5] & 0x10)
+					headerOffset += 10;
+				if(![inputSource seekToOffset:headerOffset error:nil] || ![inputSource readBytes:header length:(NSInteger)sizeof header bytesRead:&bytesRead error:nil])
+					bytesRead = 0;
+			}
+
+			if(bytesRead > 0)
+				subclass = [lookupTables subclassForHeader:header length:(NSUInteger)bytesRead];
+		}
+
+		if(![inputSource seekToOffset:originalOffset error:nil])
+			os_log_error(gSFBAudioDecoderLog, "Unable to restore input source offset after probing");
+	}
+
+	if(openedInputSource)
+		[inputSource closeReturningError:nil];
+
+	if(subclass)
+		os_log_debug(gSFBAudioDecoderLog, "SFBAudioDecoder probe matched %{public}@", NSStringFromClass(subclass));
+
+	return subclass;
 }
 
 @end
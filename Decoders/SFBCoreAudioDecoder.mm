@@ -182,6 +182,18 @@ namespace {
 	return SFBAudioDecoderNameCoreAudio;
 }
 
++ (NSArray *)supportedSignatures
+{
+	// CAF, MPEG-4, RIFF, AIFF, and AIFF-C
+	return @[
+		[SFBAudioDecoderSignature signatureWithBytes:"caff" length:4],
+		[SFBAudioDecoderSignature signatureWithBytes:"ftyp" length:4 offset:4],
+		[SFBAudioDecoderSignature signatureWithBytes:"WAVE" length:4 offset:8],
+		[SFBAudioDecoderSignature signatureWithBytes:"AIFF" length:4 offset:8],
+		[SFBAudioDecoderSignature signatureWithBytes:"AIFC" length:4 offset:8]
+	];
+}
+
 - (BOOL)decodingIsLossless
 {
 	switch(_sourceFormat.streamDescription->mFormatID) {
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <Foundation/Foundation.h>
+#import <AVFoundation/AVFoundation.h>
+
+#import "SFBInputSource.h"
+
+#import "AudioDecoder.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+namespace SFB {
+
+	namespace Audio {
+
+		/// A \c Decoder::InputSource reading from an \c SFBInputSource
+		class InputSourceAdapter : public Decoder::InputSource
+		{
+		public:
+			/// Creates an \c InputSourceAdapter reading from \c inputSource
+			explicit InputSourceAdapter(SFBInputSource *inputSource) noexcept;
+
+			bool Read(void *buffer, int64_t count, int64_t& bytesRead) noexcept override;
+			bool AtEOF() const noexcept override;
+			bool GetOffset(int64_t& offset) const noexcept override;
+			bool GetLength(int64_t& length) const noexcept override;
+			bool SupportsSeeking() const noexcept override;
+			bool SeekToOffset(int64_t offset) noexcept override;
+
+		private:
+			/// The wrapped input source
+			SFBInputSource *mInputSource;
+		};
+
+	}
+}
+
+/// Protocol for decoders whose work is performed by an \c SFB::Audio::Decoder
+///
+/// Clients able to use C++ may decode directly into an \c AudioBufferList using \c coreDecoder,
+/// bypassing Objective-C message sends and buffer format validation.
+@protocol SFBCoreDecoding
+/// Returns the underlying decoder or \c nullptr if the decoder is not open
+@property (nonatomic, readonly, nullable) SFB::Audio::Decoder *coreDecoder;
+@end
+
+/// Returns an \c AVAudioFormat describing the processing format of \c decoder
+extern AVAudioFormat * _Nullable SFBCoreDecoderProcessingFormat(const SFB::Audio::Decoder& decoder);
+
+/// Returns an \c AVAudioFormat describing the source format of \c decoder
+extern AVAudioFormat * _Nullable SFBCoreDecoderSourceFormat(const SFB::Audio::Decoder& decoder);
+
+/// Returns an \c NSError describing the most recent failure of \c decoder
+/// @param decoder The decoder
+/// @param domain The error domain, either \c SFBAudioDecoderErrorDomain or \c SFBDSDDecoderErrorDomain
+/// @param url The URL being decoded or \c nil
+/// @param formatName The localized name of the audio format, such as \c FLAC
+extern NSError * SFBCoreDecoderError(const SFB::Audio::Decoder& decoder, NSErrorDomain domain, NSURL * _Nullable url, NSString *formatName);
+
+/// Decodes audio from \c decoder into \c buffer
+/// @param decoder The decoder or \c nullptr if the decoder is not open
+/// @param buffer A buffer in the processing format of \c decoder to receive the decoded audio
+/// @param frameLength The desired number of frames
+/// @param url The URL being decoded or \c nil
+/// @param formatName The localized name of the audio format, such as \c FLAC
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return \c YES on success, \c NO otherwise
+extern BOOL SFBCoreDecoderDecodeIntoBuffer(SFB::Audio::Decoder * _Nullable decoder, AVAudioPCMBuffer *buffer, AVAudioFrameCount frameLength, NSURL * _Nullable url, NSString *formatName, NSError **error);
+
+/// Decodes DSD packets from \c decoder into \c buffer
+/// @param decoder The decoder or \c nullptr if the decoder is not open
+/// @param buffer A buffer in the processing format of \c decoder to receive the decoded packets
+/// @param packetCount The desired number of packets
+/// @param url The URL being decoded or \c nil
+/// @param formatName The localized name of the audio format, such as \c DSF
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return \c YES on success, \c NO otherwise
+extern BOOL SFBCoreDecoderDecodeIntoCompressedBuffer(SFB::Audio::Decoder * _Nullable decoder, AVAudioCompressedBuffer *buffer, AVAudioPacketCount packetCount, NSURL * _Nullable url, NSString *formatName, NSError **error);
+
+/// Seeks \c decoder to \c frame
+/// @param decoder The decoder or \c nullptr if the decoder is not open
+/// @param frame The desired frame
+/// @param domain The error domain, either \c SFBAudioDecoderErrorDomain or \c SFBDSDDecoderErrorDomain
+/// @param url The URL being decoded or \c nil
+/// @param formatName The localized name of the audio format, such as \c FLAC
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return \c YES on success, \c NO otherwise
+extern BOOL SFBCoreDecoderSeekToFrame(SFB::Audio::Decoder * _Nullable decoder, AVAudioFramePosition frame, NSErrorDomain domain, NSURL * _Nullable url, NSString *formatName, NSError **error);
+
+NS_ASSUME_NONNULL_END
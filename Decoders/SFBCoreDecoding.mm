@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import "SFBCoreDecoding.h"
+
+#import "SFBAudioDecoder.h"
+#import "SFBDSDDecoder.h"
+
+#import "NSError+SFBURLPresentation.h"
+
+namespace {
+
+	/// Returns the code in \c domain for an internal error
+	NSInteger InternalErrorCode(NSErrorDomain domain)
+	{
+		if([domain isEqualToString:SFBDSDDecoderErrorDomain])
+			return SFBDSDDecoderErrorCodeInternalError;
+		return SFBAudioDecoderErrorCodeInternalError;
+	}
+
+	/// Returns the code in \c domain for an invalid or unsupported format
+	NSInteger InvalidFormatErrorCode(NSErrorDomain domain)
+	{
+		if([domain isEqualToString:SFBDSDDecoderErrorDomain])
+			return SFBDSDDecoderErrorCodeInvalidFormat;
+		return SFBAudioDecoderErrorCodeInvalidFormat;
+	}
+
+}
+
+#pragma mark Input Source Adapter
+
+SFB::Audio::InputSourceAdapter::InputSourceAdapter(SFBInputSource *inputSource) noexcept
+	: mInputSource(inputSource)
+{
+	assert(mInputSource != nil);
+}
+
+bool SFB::Audio::InputSourceAdapter::Read(void *buffer, int64_t count, int64_t& bytesRead) noexcept
+{
+	NSInteger read;
+	if(![mInputSource readBytes:buffer length:(NSInteger)count bytesRead:&read error:nil])
+		return false;
+	bytesRead = read;
+	return true;
+}
+
+bool SFB::Audio::InputSourceAdapter::AtEOF() const noexcept
+{
+	return mInputSource.atEOF;
+}
+
+bool SFB::Audio::InputSourceAdapter::GetOffset(int64_t& offset) const noexcept
+{
+	NSInteger value;
+	if(![mInputSource getOffset:&value error:nil])
+		return false;
+	offset = value;
+	return true;
+}
+
+bool SFB::Audio::InputSourceAdapter::GetLength(int64_t& length) const noexcept
+{
+	NSInteger value;
+	if(![mInputSource getLength:&value error:nil])
+		return false;
+	length = value;
+	return true;
+}
+
+bool SFB::Audio::InputSourceAdapter::SupportsSeeking() const noexcept
+{
+	return mInputSource.supportsSeeking;
+}
+
+bool SFB::Audio::InputSourceAdapter::SeekToOffset(int64_t offset) noexcept
+{
+	return [mInputSource seekToOffset:(NSInteger)offset error:nil];
+}
+
+#pragma mark Utilities
+
+AVAudioFormat * SFBCoreDecoderProcessingFormat(const SFB::Audio::Decoder& decoder)
+{
+	const AudioStreamBasicDescription& asbd = decoder.ProcessingFormat();
+	AudioChannelLayoutTag layoutTag = decoder.ChannelLayoutTag();
+	if(layoutTag)
+		return [[AVAudioFormat alloc] initWithStreamDescription:&asbd channelLayout:[AVAudioChannelLayout layoutWithLayoutTag:layoutTag]];
+	return [[AVAudioFormat alloc] initWithStreamDescription:&asbd];
+}
+
+AVAudioFormat * SFBCoreDecoderSourceFormat(const SFB::Audio::Decoder& decoder)
+{
+	const AudioStreamBasicDescription& asbd = decoder.SourceFormat();
+	return [[AVAudioFormat alloc] initWithStreamDescription:&asbd];
+}
+
+NSError * SFBCoreDecoderError(const SFB::Audio::Decoder& decoder, NSErrorDomain domain, NSURL *url, NSString *formatName)
+{
+	NSCParameterAssert(domain != nil);
+	NSCParameterAssert(formatName != nil);
+
+	switch(decoder.LastError()) {
+		case SFB::Audio::Decoder::Error::InvalidFormat:
+			return [NSError SFB_errorWithDomain:domain
+										   code:InvalidFormatErrorCode(domain)
+				  descriptionFormatStringForURL:[NSString stringWithFormat:NSLocalizedString(@"The file “%%@” is not a valid %@ file.", @""), formatName]
+											url:url
+								  failureReason:[NSString stringWithFormat:NSLocalizedString(@"Not a %@ file", @""), formatName]
+							 recoverySuggestion:NSLocalizedString(@"The file's extension may not match the file's type.", @"")];
+
+		case SFB::Audio::Decoder::Error::UnsupportedFormat:
+			return [NSError SFB_errorWithDomain:domain
+										   code:InvalidFormatErrorCode(domain)
+				  descriptionFormatStringForURL:[NSString stringWithFormat:NSLocalizedString(@"The file “%%@” is not a supported %@ file.", @""), formatName]
+											url:url
+								  failureReason:NSLocalizedString(@"Format not supported", @"")
+							 recoverySuggestion:NSLocalizedString(@"The file's format is not supported.", @"")];
+
+		case SFB::Audio::Decoder::Error::OutOfMemory:
+			return [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+
+		default:
+			return [NSError errorWithDomain:domain code:InternalErrorCode(domain) userInfo:nil];
+	}
+}
+
+BOOL SFBCoreDecoderDecodeIntoBuffer(SFB::Audio::Decoder *decoder, AVAudioPCMBuffer *buffer, AVAudioFrameCount frameLength, NSURL *url, NSString *formatName, NSError **error)
+{
+	NSCParameterAssert(buffer != nil);
+
+	// Reset output buffer data size
+	buffer.frameLength = 0;
+
+	if(!decoder) {
+		if(error)
+			*error = [NSError errorWithDomain:SFBAudioDecoderErrorDomain code:SFBAudioDecoderErrorCodeInternalError userInfo:nil];
+		return NO;
+	}
+
+	if(frameLength > buffer.frameCapacity)
+		frameLength = buffer.frameCapacity;
+
+	if(frameLength == 0)
+		return YES;
+
+	uint32_t framesDecoded = 0;
+	if(!decoder->Decode(buffer.mutableAudioBufferList, frameLength, framesDecoded)) {
+		if(error)
+			*error = SFBCoreDecoderError(*decoder, SFBAudioDecoderErrorDomain, url, formatName);
+		return NO;
+	}
+
+	buffer.frameLength = framesDecoded;
+
+	return YES;
+}
+
+BOOL SFBCoreDecoderDecodeIntoCompressedBuffer(SFB::Audio::Decoder *decoder, AVAudioCompressedBuffer *buffer, AVAudioPacketCount packetCount, NSURL *url, NSString *formatName, NSError **error)
+{
+	NSCParameterAssert(buffer != nil);
+
+	// Reset output buffer data size
+	buffer.packetCount = 0;
+	buffer.byteLength = 0;
+
+	if(!decoder) {
+		if(error)
+			*error = [NSError errorWithDomain:SFBDSDDecoderErrorDomain code:SFBDSDDecoderErrorCodeInternalError userInfo:nil];
+		return NO;
+	}
+
+	if(packetCount > buffer.packetCapacity)
+		packetCount = buffer.packetCapacity;
+
+	if(packetCount == 0)
+		return YES;
+
+	AudioBufferList bufferList;
+	bufferList.mNumberBuffers = 1;
+	bufferList.mBuffers[0].mNumberChannels = buffer.format.channelCount;
+	bufferList.mBuffers[0].mDataByteSize = buffer.byteCapacity;
+	bufferList.mBuffers[0].mData = buffer.data;
+
+	uint32_t packetsDecoded = 0;
+	if(!decoder->Decode(&bufferList, packetCount, packetsDecoded)) {
+		if(error)
+			*error = SFBCoreDecoderError(*decoder, SFBDSDDecoderErrorDomain, url, formatName);
+		return NO;
+	}
+
+	buffer.packetCount = packetsDecoded;
+	buffer.byteLength = bufferList.mBuffers[0].mDataByteSize;
+
+	return YES;
+}
+
+BOOL SFBCoreDecoderSeekToFrame(SFB::Audio::Decoder *decoder, AVAudioFramePosition frame, NSErrorDomain domain, NSURL *url, NSString *formatName, NSError **error)
+{
+	NSCParameterAssert(domain != nil);
+
+	if(!decoder) {
+		if(error)
+			*error = [NSError errorWithDomain:domain code:InternalErrorCode(domain) userInfo:nil];
+		return NO;
+	}
+
+	if(!decoder->SeekToFrame(frame)) {
+		if(error)
+			*error = SFBCoreDecoderError(*decoder, domain, url, formatName);
+		return NO;
+	}
+
+	return YES;
+}
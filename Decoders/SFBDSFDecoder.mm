@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2014 - 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <memory>
+
+#import "SFBDSFDecoder.h"
+
+#import "DSFDecoder.h"
+#import "SFBCoreDecoding.h"
+
+SFBDSDDecoderName const SFBDSDDecoderNameDSF = @"org.sbooth.AudioEngine.DSDDecoder.DSF";
+
+@interface SFBDSFDecoder () <SFBCoreDecoding>
+{
+@private
+	std::unique_ptr<SFB::Audio::DSFDecoder> _decoder;
+}
+@end
+
+@implementation SFBDSFDecoder
+
++ (void)load
+{
+	[SFBDSDDecoder registerSubclass:[self class]];
+}
+
++ (NSSet *)supportedPathExtensions
+{
+	return [NSSet setWithObject:@"dsf"];
+}
+
++ (NSSet *)supportedMIMETypes
+{
+	return [NSSet setWithObject:@"audio/dsf"];
+}
+
++ (SFBDSDDecoderName)decoderName
+{
+	return SFBDSDDecoderNameDSF;
+}
+
+- (BOOL)decodingIsLossless
+{
+	return YES;
+}
+
+- (BOOL)openReturningError:(NSError **)error
+{
+	if(![super openReturningError:error])
+		return NO;
+
+	auto decoder = std::make_unique<SFB::Audio::DSFDecoder>(std::make_unique<SFB::Audio::InputSourceAdapter>(_inputSource));
+	if(!decoder->Open()) {
+		if(error)
+			*error = SFBCoreDecoderError(*decoder, SFBDSDDecoderErrorDomain, _inputSource.url, @"DSF");
+		return NO;
+	}
+
+	_processingFormat = SFBCoreDecoderProcessingFormat(*decoder);
+	_sourceFormat = SFBCoreDecoderSourceFormat(*decoder);
+
+	_decoder = std::move(decoder);
+
+	return YES;
+}
+
+- (BOOL)closeReturningError:(NSError **)error
+{
+	if(_decoder) {
+		_decoder->Close();
+		_decoder.reset();
+	}
+
+	return [super closeReturningError:error];
+}
+
+- (BOOL)isOpen
+{
+	return _decoder != nullptr;
+}
+
+- (SFB::Audio::Decoder *)coreDecoder
+{
+	return _decoder.get();
+}
+
+- (AVAudioFramePosition)packetPosition
+{
+	return _decoder ? _decoder->FramePosition() : SFBUnknownPacketPosition;
+}
+
+- (AVAudioFramePosition)packetCount
+{
+	return _decoder ? _decoder->FrameLength() : SFBUnknownPacketCount;
+}
+
+- (BOOL)decodeIntoBuffer:(AVAudioCompressedBuffer *)buffer packetCount:(AVAudioPacketCount)packetCount error:(NSError **)error
+{
+	NSParameterAssert(buffer != nil);
+	NSParameterAssert([buffer.format isEqual:_processingFormat]);
+
+	return SFBCoreDecoderDecodeIntoCompressedBuffer(_decoder.get(), buffer, packetCount, _inputSource.url, @"DSF", error);
+}
+
+- (BOOL)seekToPacket:(AVAudioFramePosition)packet error:(NSError **)error
+{
+	NSParameterAssert(packet >= 0);
+	return SFBCoreDecoderSeekToFrame(_decoder.get(), packet, SFBDSDDecoderErrorDomain, _inputSource.url, @"DSF", error);
+}
+
+@end
@@ -166,6 +166,17 @@ static sf_count_t my_sf_vio_tell(void *user_data)
 	return SFBAudioDecoderNameLibsndfile;
 }
 
++ (NSArray *)supportedSignatures
+{
+	// RIFF, AIFF, AIFF-C, and Sun/NeXT
+	return @[
+		[SFBAudioDecoderSignature signatureWithBytes:"WAVE" length:4 offset:8],
+		[SFBAudioDecoderSignature signatureWithBytes:"AIFF" length:4 offset:8],
+		[SFBAudioDecoderSignature signatureWithBytes:"AIFC" length:4 offset:8],
+		[SFBAudioDecoderSignature signatureWithBytes:".snd" length:4]
+	];
+}
+
 - (BOOL)decodingIsLossless
 {
 	switch(_sfinfo.format & SF_FORMAT_SUBMASK) {
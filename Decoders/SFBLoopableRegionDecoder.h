@@ -61,6 +61,17 @@ NS_SWIFT_NAME(LoopableRegionDecoder) @interface SFBLoopableRegionDecoder : NSObj
 /// @return An initialized \c SFBLoopableRegionDecoder object for the specified decoder, or \c nil on failure
 - (nullable instancetype)initWithDecoder:(id <SFBPCMDecoding>)decoder framePosition:(AVAudioFramePosition)framePosition frameLength:(AVAudioFramePosition)frameLength repeatCount:(NSInteger)repeatCount error:(NSError **)error NS_DESIGNATED_INITIALIZER;
 
+/// The maximum size in bytes of the in-memory region cache, or \c 0 to disable caching
+///
+/// When the decoded region fits within this limit it is decoded once, during the first pass,
+/// and subsequent passes are served from memory without seeking the underlying decoder.
+/// The default is \c 0.
+/// @note This property must be set before the decoder is opened
+@property (nonatomic) NSUInteger maximumRegionCacheSize;
+
+/// Returns \c YES if the entire region is cached in memory
+@property (nonatomic, readonly) BOOL regionIsCached;
+
 @end
 
 NS_ASSUME_NONNULL_END
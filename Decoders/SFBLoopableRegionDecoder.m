@@ -15,6 +15,7 @@
 @private
 	id <SFBPCMDecoding> _decoder;
 	AVAudioPCMBuffer *_buffer;
+	AVAudioPCMBuffer *_regionCache; // Decoded region audio starting at _framePosition
 	AVAudioFramePosition _framePosition;
 	AVAudioFramePosition _frameLength;
 	NSInteger _repeatCount;
@@ -109,12 +110,23 @@
 
 	_buffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:_decoder.processingFormat frameCapacity:512];
 
+	// The cache is filled as the region is decoded
+	if(_maximumRegionCacheSize > 0 && _frameLength > 0 && _frameLength <= UINT32_MAX) {
+		AVAudioFormat *format = _decoder.processingFormat;
+		NSUInteger bytesPerFrame = format.streamDescription->mBytesPerFrame * (format.isInterleaved ? 1 : format.channelCount);
+		if((NSUInteger)_frameLength <= _maximumRegionCacheSize / bytesPerFrame)
+			_regionCache = [[AVAudioPCMBuffer alloc] initWithPCMFormat:format frameCapacity:(AVAudioFrameCount)_frameLength];
+		else
+			os_log_debug(gSFBAudioDecoderLog, "Region of %lld frames exceeds cache size limit of %lu bytes", _frameLength, (unsigned long)_maximumRegionCacheSize);
+	}
+
 	return YES;
 }
 
 - (BOOL)closeReturningError:(NSError **)error
 {
 	_buffer = nil;
+	_regionCache = nil;
 	return [_decoder closeReturningError:error];
 }
 
@@ -147,45 +159,51 @@
 	// Reset output buffer data size
 	buffer.frameLength = 0;
 
-	if((_repeatCount && (_framesDecoded / _frameLength) == (_repeatCount + 1)) || frameLength == 0)
-		return YES;
-
 	if(frameLength > buffer.frameCapacity)
 		frameLength = buffer.frameCapacity;
 
-	AVAudioFrameCount framesRemaining = frameLength;
+	AVAudioFramePosition totalFrames = self.frameLength;
+	if(_frameLength <= 0 || frameLength == 0 || _framesDecoded >= totalFrames)
+		return YES;
 
-	_buffer.frameLength = 0;
+	AVAudioFrameCount framesRemaining = (AVAudioFrameCount)MIN(frameLength, totalFrames - _framesDecoded);
 
 	while(framesRemaining > 0) {
-		AVAudioFrameCount framesRemainingInCurrentPass = (AVAudioFrameCount)(_framePosition + _frameLength - _decoder.framePosition);
-		AVAudioFrameCount framesToDecode = MIN(MIN(framesRemaining, framesRemainingInCurrentPass), _buffer.frameCapacity);
+		AVAudioFrameCount passOffset = (AVAudioFrameCount)(_framesDecoded % _frameLength);
+		AVAudioFrameCount framesRemainingInCurrentPass = (AVAudioFrameCount)_frameLength - passOffset;
+
+		// Serve cached audio from memory
+		if(_regionCache && passOffset < _regionCache.frameLength) {
+			AVAudioFrameCount framesCopied = [buffer appendFromBuffer:_regionCache readingFromOffset:passOffset frameLength:MIN(framesRemaining, framesRemainingInCurrentPass)];
+			_framesDecoded += framesCopied;
+			framesRemaining -= framesCopied;
+			continue;
+		}
 
-		// Nothing left to read
-		if(framesToDecode == 0)
-			break;
+		// Position the decoder at the correct frame, which is required at the start of each pass after the first
+		// and when resuming decoding after cached audio
+		if(_decoder.framePosition != _framePosition + passOffset && ![_decoder seekToFrame:(_framePosition + passOffset) error:error])
+			return NO;
 
-		// Zero the internal buffer in preparation for decoding
-		_buffer.frameLength = 0;
+		AVAudioFrameCount framesToDecode = MIN(MIN(framesRemaining, framesRemainingInCurrentPass), _buffer.frameCapacity);
 
 		// Decode audio into our internal buffer and append it to output
 		if(![_decoder decodeIntoBuffer:_buffer frameLength:framesToDecode error:error])
 			return NO;
 
+		// Nothing left to read
+		if(_buffer.frameLength == 0)
+			break;
+
 		[buffer appendContentsOfBuffer:_buffer];
 
+		// Extend the cache if this audio immediately follows the cached audio
+		if(_regionCache && passOffset == _regionCache.frameLength)
+			[_regionCache appendContentsOfBuffer:_buffer];
+
 		// Housekeeping
 		_framesDecoded += _buffer.frameLength;
 		framesRemaining -= _buffer.frameLength;
-
-		// If this pass is finished, seek to the beginning of the region in preparation for the next read
-		if(_repeatCount && _frameLength == (_framesDecoded / _frameLength)) {
-			// Only seek to the beginning of the region if more passes remain
-			if((_framesDecoded / _frameLength) < (_repeatCount + 1)) {
-				if(![_decoder seekToFrame:_framePosition error:error])
-					return NO;
-			}
-		}
 	}
 
 	return YES;
@@ -204,7 +222,18 @@
 		return NO;
 
 	_framesDecoded = frame;
-	return [_decoder seekToFrame:(_framePosition + (frame % _frameLength)) error:error];
+
+	// Cached audio doesn't require the decoder to be repositioned
+	AVAudioFramePosition passOffset = frame % _frameLength;
+	if(_regionCache && passOffset < _regionCache.frameLength)
+		return YES;
+
+	return [_decoder seekToFrame:(_framePosition + passOffset) error:error];
+}
+
+- (BOOL)regionIsCached
+{
+	return _regionCache && _regionCache.frameLength == _frameLength;
 }
 
 - (BOOL)resetReturningError:(NSError **)error
@@ -110,6 +110,23 @@ static off_t lseek_callback(void *iohandle, off_t offset, int whence)
 	return SFBAudioDecoderNameMPEG;
 }
 
++ (NSArray *)supportedSignatures
+{
+	// Frame sync for unprotected and CRC-protected Layer III and Layer II frames
+	return @[
+		[SFBAudioDecoderSignature signatureWithBytes:"\xff\xfb" length:2],
+		[SFBAudioDecoderSignature signatureWithBytes:"\xff\xfa" length:2],
+		[SFBAudioDecoderSignature signatureWithBytes:"\xff\xf3" length:2],
+		[SFBAudioDecoderSignature signatureWithBytes:"\xff\xf2" length:2],
+		[SFBAudioDecoderSignature signatureWithBytes:"\xff\xe3" length:2],
+		[SFBAudioDecoderSignature signatureWithBytes:"\xff\xe2" length:2],
+		[SFBAudioDecoderSignature signatureWithBytes:"\xff\xfd" length:2],
+		[SFBAudioDecoderSignature signatureWithBytes:"\xff\xfc" length:2],
+		[SFBAudioDecoderSignature signatureWithBytes:"\xff\xf5" length:2],
+		[SFBAudioDecoderSignature signatureWithBytes:"\xff\xf4" length:2]
+	];
+}
+
 - (BOOL)decodingIsLossless
 {
 	return NO;
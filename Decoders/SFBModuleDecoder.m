@@ -122,6 +122,17 @@ static dumb_off_t get_size_callback(void *f)
 	return SFBAudioDecoderNameModule;
 }
 
++ (NSArray *)supportedSignatures
+{
+	// XM, IT, S3M, and ProTracker
+	return @[
+		[SFBAudioDecoderSignature signatureWithBytes:"Extended Module: " length:17],
+		[SFBAudioDecoderSignature signatureWithBytes:"IMPM" length:4],
+		[SFBAudioDecoderSignature signatureWithBytes:"SCRM" length:4 offset:44],
+		[SFBAudioDecoderSignature signatureWithBytes:"M.K." length:4 offset:1080]
+	];
+}
+
 - (BOOL)decodingIsLossless
 {
 	return NO;
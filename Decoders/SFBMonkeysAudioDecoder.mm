@@ -166,6 +166,11 @@ namespace {
 	return SFBAudioDecoderNameMonkeysAudio;
 }
 
++ (NSArray *)supportedSignatures
+{
+	return @[[SFBAudioDecoderSignature signatureWithBytes:"MAC " length:4]];
+}
+
 - (BOOL)decodingIsLossless
 {
 	return YES;
@@ -104,6 +104,15 @@ static mpc_bool_t canseek_callback(mpc_reader *p_reader)
 	return SFBAudioDecoderNameMusepack;
 }
 
++ (NSArray *)supportedSignatures
+{
+	// SV8 and SV7
+	return @[
+		[SFBAudioDecoderSignature signatureWithBytes:"MPCK" length:4],
+		[SFBAudioDecoderSignature signatureWithBytes:"MP+" length:3]
+	];
+}
+
 - (BOOL)decodingIsLossless
 {
 	return NO;
@@ -4,6 +4,7 @@
  */
 
 @import os.log;
+@import Accelerate;
 
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wquoted-include-in-framework-header"
@@ -19,7 +20,11 @@
 
 SFBAudioDecoderName const SFBAudioDecoderNameOggOpus = @"org.sbooth.AudioEngine.Decoder.OggOpus";
 
+SFBAudioDecodingSettingsKey const SFBAudioDecodingSettingsKeyOggOpusNonInterleaved = @"Non-Interleaved";
+
 #define OPUS_SAMPLE_RATE 48000
+// The largest Opus packet is 120 ms
+#define OPUS_MAX_PACKET_FRAMES 5760
 
 static int read_callback(void *stream, unsigned char *ptr, int nbytes)
 {
@@ -72,10 +77,28 @@ static 	opus_int64 tell_callback(void *stream)
 	return offset;
 }
 
+/// Deinterleaves \c frameCount frames of \c channelCount channel audio from \c src into \c dst starting at \c offset
+static void DeinterleaveFloat(const float *src, float * const *dst, AVAudioFrameCount offset, AVAudioChannelCount channelCount, vDSP_Length frameCount)
+{
+	if(channelCount == 2) {
+		// Treating stereo frames as complex numbers allows a single vectorized split
+		DSPSplitComplex split = { .realp = dst[0] + offset, .imagp = dst[1] + offset };
+		vDSP_ctoz((const DSPComplex *)src, 2, &split, 1, frameCount);
+	}
+	else {
+		for(AVAudioChannelCount channel = 0; channel < channelCount; ++channel)
+			cblas_scopy((int)frameCount, src + channel, (int)channelCount, dst[channel] + offset, 1);
+	}
+}
+
 @interface SFBOggOpusDecoder ()
 {
 @private
 	OggOpusFile *_opusFile;
+	/// Interleaved samples awaiting deinterleaving when producing non-interleaved audio
+	float *_scratch;
+	/// The capacity of \c _scratch in frames
+	int _scratchFrameCapacity;
 }
 @end
 
@@ -101,6 +124,12 @@ static 	opus_int64 tell_callback(void *stream)
 	return SFBAudioDecoderNameOggOpus;
 }
 
++ (NSArray *)supportedSignatures
+{
+	// Identification header in the first Ogg page
+	return @[[SFBAudioDecoderSignature signatureWithBytes:"OpusHead" length:8 offset:28]];
+}
+
 - (BOOL)decodingIsLossless
 {
 	return NO;
@@ -172,7 +201,23 @@ static 	opus_int64 tell_callback(void *stream)
 			break;
 	}
 
-	_processingFormat = [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat32 sampleRate:OPUS_SAMPLE_RATE interleaved:NO channelLayout:channelLayout];
+	// libopusfile produces interleaved audio; deinterleaving is performed only if requested
+	BOOL nonInterleaved = [[_settings objectForKey:SFBAudioDecodingSettingsKeyOggOpusNonInterleaved] boolValue];
+	if(nonInterleaved && header->channel_count > 1) {
+		_scratchFrameCapacity = OPUS_MAX_PACKET_FRAMES;
+		_scratch = malloc(sizeof(float) * (size_t)_scratchFrameCapacity * (size_t)header->channel_count);
+		if(!_scratch) {
+			op_free(_opusFile);
+			_opusFile = NULL;
+
+			if(error)
+				*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+
+			return NO;
+		}
+	}
+
+	_processingFormat = [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat32 sampleRate:OPUS_SAMPLE_RATE interleaved:!nonInterleaved channelLayout:channelLayout];
 
 	// Set up the source format
 	AudioStreamBasicDescription sourceStreamDescription = {0};
@@ -194,6 +239,10 @@ static 	opus_int64 tell_callback(void *stream)
 		_opusFile = NULL;
 	}
 
+	free(_scratch);
+	_scratch = NULL;
+	_scratchFrameCapacity = 0;
+
 	return [super closeReturningError:error];
 }
 
@@ -234,8 +283,16 @@ static 	opus_int64 tell_callback(void *stream)
 
 	AVAudioFrameCount framesRemaining = frameLength;
 	while(framesRemaining > 0) {
+		int framesRead;
 		// Decode a chunk of samples from the file
-		int framesRead = op_read_float(_opusFile, buffer.floatChannelData[0] + buffer.frameLength, (int)(framesRemaining * buffer.stride), NULL);
+		if(_scratch) {
+			int framesToRead = MIN((int)framesRemaining, _scratchFrameCapacity);
+			framesRead = op_read_float(_opusFile, _scratch, framesToRead * (int)buffer.format.channelCount, NULL);
+			if(framesRead > 0)
+				DeinterleaveFloat(_scratch, buffer.floatChannelData, buffer.frameLength, buffer.format.channelCount, (vDSP_Length)framesRead);
+		}
+		else
+			framesRead = op_read_float(_opusFile, buffer.floatChannelData[0] + (buffer.frameLength * buffer.stride), (int)(framesRemaining * buffer.stride), NULL);
 
 		if(framesRead < 0) {
 			os_log_error(gSFBAudioDecoderLog, "Ogg Opus decoding error");
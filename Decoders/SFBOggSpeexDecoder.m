@@ -76,6 +76,12 @@ SFBAudioDecoderName const SFBAudioDecoderNameOggSpeex = @"org.sbooth.AudioEngine
 	return SFBAudioDecoderNameOggSpeex;
 }
 
++ (NSArray *)supportedSignatures
+{
+	// Identification header in the first Ogg page
+	return @[[SFBAudioDecoderSignature signatureWithBytes:"Speex   " length:8 offset:28]];
+}
+
 - (BOOL)decodingIsLossless
 {
 	return NO;
@@ -98,6 +98,12 @@ static long tell_func_callback(void *datasource)
 	return SFBAudioDecoderNameOggVorbis;
 }
 
++ (NSArray *)supportedSignatures
+{
+	// Identification header in the first Ogg page
+	return @[[SFBAudioDecoderSignature signatureWithBytes:"\x01" "vorbis" length:7 offset:28]];
+}
+
 - (BOOL)decodingIsLossless
 {
 	return NO;
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <SFBAudioEngine/SFBPCMDecoding.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// A decoder that decodes ahead of its consumer on a dedicated thread
+///
+/// The wrapped decoder fills a bounded pool of PCM buffers in the background so that
+/// \c -decodeIntoBuffer:frameLength:error: usually only copies already-decoded audio.
+/// Seeking discards any prefetched audio.
+/// @note The wrapped decoder must not be used directly while the \c SFBPrefetchingDecoder is open
+NS_SWIFT_NAME(PrefetchingDecoder) @interface SFBPrefetchingDecoder : NSObject <SFBPCMDecoding>
+
++ (instancetype)new NS_UNAVAILABLE;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Returns an initialized \c SFBPrefetchingDecoder object for the given URL or \c nil on failure
+/// @param url The URL
+/// @param error An optional pointer to a \c NSError to receive error information
+/// @return An initialized \c SFBPrefetchingDecoder object for the specified URL, or \c nil on failure
+- (nullable instancetype)initWithURL:(NSURL *)url error:(NSError **)error;
+
+/// Returns an initialized \c SFBPrefetchingDecoder object for the given input source or \c nil on failure
+/// @param inputSource The input source
+/// @param error An optional pointer to a \c NSError to receive error information
+/// @return An initialized \c SFBPrefetchingDecoder object for the specified input source, or \c nil on failure
+- (nullable instancetype)initWithInputSource:(SFBInputSource *)inputSource error:(NSError **)error;
+
+/// Returns an initialized \c SFBPrefetchingDecoder object for the given decoder or \c nil on failure
+/// @param decoder The decoder
+/// @param error An optional pointer to a \c NSError to receive error information
+/// @return An initialized \c SFBPrefetchingDecoder object for the specified decoder, or \c nil on failure
+- (nullable instancetype)initWithDecoder:(id <SFBPCMDecoding>)decoder error:(NSError **)error;
+/// Returns an initialized \c SFBPrefetchingDecoder object for the given decoder or \c nil on failure
+/// @param decoder The decoder
+/// @param bufferCount The number of buffers to decode ahead
+/// @param bufferFrameCapacity The capacity of each buffer in frames
+/// @param error An optional pointer to a \c NSError to receive error information
+/// @return An initialized \c SFBPrefetchingDecoder object for the specified decoder, or \c nil on failure
+- (nullable instancetype)initWithDecoder:(id <SFBPCMDecoding>)decoder bufferCount:(NSInteger)bufferCount bufferFrameCapacity:(AVAudioFrameCount)bufferFrameCapacity error:(NSError **)error NS_DESIGNATED_INITIALIZER;
+
+/// The number of buffers decoded ahead
+@property (nonatomic, readonly) NSInteger bufferCount;
+/// The capacity of each buffer in frames
+@property (nonatomic, readonly) AVAudioFrameCount bufferFrameCapacity;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,414 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <atomic>
+#import <mutex>
+#import <thread>
+
+#import <os/log.h>
+
+#import "SFBPrefetchingDecoder.h"
+
+#import "AVAudioPCMBuffer+SFBBufferUtilities.h"
+#import "RingBuffer.h"
+#import "SFBAudioDecoder+Internal.h"
+#import "UnfairLock.h"
+
+@interface SFBPrefetchingDecoder ()
+- (void *)decodingThreadEntry;
+@end
+
+namespace {
+
+#pragma mark - Flags
+
+	enum ePrefetchingDecoderFlags : unsigned int {
+		ePrefetchingDecoderFlagStopDecodingThread		= 1u << 0,
+		ePrefetchingDecoderFlagDecodingComplete			= 1u << 1,
+		ePrefetchingDecoderFlagDecodingError			= 1u << 2
+	};
+
+#pragma mark - Constants
+
+	const NSInteger 			kDefaultBufferCount 			= 8;
+	const AVAudioFrameCount 	kDefaultBufferFrameCapacity 	= 4096;
+	const uint32_t 				kNoBuffer 						= UINT32_MAX;
+
+#pragma mark - Thread entry point
+
+	void * DecodingThreadEntry(void *arg)
+	{
+		pthread_setname_np("org.sbooth.AudioEngine.PrefetchingDecoder.DecodingThread");
+		pthread_set_qos_class_self_np(QOS_CLASS_USER_INITIATED, 0);
+
+		SFBPrefetchingDecoder *decoder = (__bridge SFBPrefetchingDecoder *)arg;
+		return [decoder decodingThreadEntry];
+	}
+
+}
+
+@interface SFBPrefetchingDecoder ()
+{
+@private
+	id <SFBPCMDecoding> 	_decoder;
+	/// Buffers owned by the decoding thread, the consumer, or one of the queues
+	NSArray<AVAudioPCMBuffer *> *_buffers;
+	/// Indexes of buffers available for decoding; written by the consumer and read by the decoding thread
+	SFB::RingBuffer 		_freeBuffers;
+	/// Indexes of decoded buffers; written by the decoding thread and read by the consumer
+	SFB::RingBuffer 		_decodedBuffers;
+	/// The lock used to serialize access to \c _decoder between decoding and seeking
+	SFB::UnfairLock 		_decoderLock;
+
+	std::thread 			_decodingThread;
+	dispatch_semaphore_t 	_decodingSemaphore;
+	dispatch_semaphore_t 	_consumerSemaphore;
+	std::atomic_uint 		_flags;
+	/// The error causing decoding to stop, valid when \c ePrefetchingDecoderFlagDecodingError is set
+	NSError 				*_decodingError;
+
+	/// The buffer being consumed and the offset of the next frame to read from it
+	uint32_t 				_currentBuffer;
+	AVAudioFrameCount 		_currentBufferOffset;
+
+	AVAudioFramePosition 	_framePosition;
+	AVAudioFramePosition 	_frameLength;
+}
+- (BOOL)dequeueBuffer;
+- (void)recycleBuffer:(uint32_t)index;
+@end
+
+@implementation SFBPrefetchingDecoder
+
+- (instancetype)initWithURL:(NSURL *)url error:(NSError **)error
+{
+	NSParameterAssert(url != nil);
+
+	SFBInputSource *inputSource = [SFBInputSource inputSourceForURL:url flags:0 error:error];
+	if(!inputSource)
+		return nil;
+	return [self initWithInputSource:inputSource error:error];
+}
+
+- (instancetype)initWithInputSource:(SFBInputSource *)inputSource error:(NSError **)error
+{
+	NSParameterAssert(inputSource != nil);
+
+	SFBAudioDecoder *decoder = [[SFBAudioDecoder alloc] initWithInputSource:inputSource error:error];
+	if(!decoder)
+		return nil;
+	return [self initWithDecoder:decoder error:error];
+}
+
+- (instancetype)initWithDecoder:(id <SFBPCMDecoding>)decoder error:(NSError **)error
+{
+	return [self initWithDecoder:decoder bufferCount:kDefaultBufferCount bufferFrameCapacity:kDefaultBufferFrameCapacity error:error];
+}
+
+- (instancetype)initWithDecoder:(id <SFBPCMDecoding>)decoder bufferCount:(NSInteger)bufferCount bufferFrameCapacity:(AVAudioFrameCount)bufferFrameCapacity error:(NSError **)error
+{
+	NSParameterAssert(decoder != nil);
+	NSParameterAssert(bufferCount > 1);
+	NSParameterAssert(bufferFrameCapacity > 0);
+
+	if((self = [super init])) {
+		_decoder = decoder;
+		_bufferCount = bufferCount;
+		_bufferFrameCapacity = bufferFrameCapacity;
+		_currentBuffer = kNoBuffer;
+
+		_decodingSemaphore = dispatch_semaphore_create(0);
+		_consumerSemaphore = dispatch_semaphore_create(0);
+		if(!_decodingSemaphore || !_consumerSemaphore) {
+			os_log_error(gSFBAudioDecoderLog, "dispatch_semaphore_create failed");
+			if(error)
+				*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+			return nil;
+		}
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[self closeReturningError:nil];
+}
+
+- (SFBInputSource *)inputSource
+{
+	return _decoder.inputSource;
+}
+
+- (AVAudioFormat *)processingFormat
+{
+	return _decoder.processingFormat;
+}
+
+- (AVAudioFormat *)sourceFormat
+{
+	return _decoder.sourceFormat;
+}
+
+- (BOOL)decodingIsLossless
+{
+	return _decoder.decodingIsLossless;
+}
+
+- (BOOL)openReturningError:(NSError **)error
+{
+	if(self.isOpen)
+		return YES;
+
+	// The wrapped decoder is closed on failure only if it was opened here
+	const BOOL openedDecoder = !_decoder.isOpen;
+	if(openedDecoder && ![_decoder openReturningError:error])
+		return NO;
+
+	NSMutableArray *buffers = [NSMutableArray arrayWithCapacity:(NSUInteger)_bufferCount];
+	for(NSInteger i = 0; i < _bufferCount; ++i) {
+		AVAudioPCMBuffer *buffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:_decoder.processingFormat frameCapacity:_bufferFrameCapacity];
+		if(!buffer) {
+			if(openedDecoder)
+				[_decoder closeReturningError:nil];
+			if(error)
+				*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+			return NO;
+		}
+		[buffers addObject:buffer];
+	}
+
+	size_t queueCapacity = sizeof(uint32_t) * (size_t)(_bufferCount + 1);
+	if(!_freeBuffers.Allocate(queueCapacity) || !_decodedBuffers.Allocate(queueCapacity)) {
+		os_log_error(gSFBAudioDecoderLog, "SFB::RingBuffer::Allocate() failed");
+		_freeBuffers.Deallocate();
+		_decodedBuffers.Deallocate();
+		if(openedDecoder)
+			[_decoder closeReturningError:nil];
+		if(error)
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+		return NO;
+	}
+
+	for(uint32_t i = 0; i < (uint32_t)_bufferCount; ++i)
+		_freeBuffers.Write(&i, sizeof i);
+
+	_buffers = buffers;
+	_currentBuffer = kNoBuffer;
+	_currentBufferOffset = 0;
+	_framePosition = _decoder.framePosition;
+	_frameLength = _decoder.frameLength;
+	_decodingError = nil;
+	_flags.store(0);
+
+	try {
+		_decodingThread = std::thread(DecodingThreadEntry, (__bridge void *)self);
+	}
+
+	catch(const std::exception& e) {
+		os_log_error(gSFBAudioDecoderLog, "Unable to create thread: %{public}s", e.what());
+		_buffers = nil;
+		_freeBuffers.Deallocate();
+		_decodedBuffers.Deallocate();
+		if(openedDecoder)
+			[_decoder closeReturningError:nil];
+		if(error)
+			*error = [NSError errorWithDomain:SFBAudioDecoderErrorDomain code:SFBAudioDecoderErrorCodeInternalError userInfo:nil];
+		return NO;
+	}
+
+	return YES;
+}
+
+- (BOOL)closeReturningError:(NSError **)error
+{
+	if(_decodingThread.joinable()) {
+		_flags.fetch_or(ePrefetchingDecoderFlagStopDecodingThread);
+		dispatch_semaphore_signal(_decodingSemaphore);
+		_decodingThread.join();
+	}
+
+	_buffers = nil;
+	_freeBuffers.Deallocate();
+	_decodedBuffers.Deallocate();
+
+	return [_decoder closeReturningError:error];
+}
+
+- (BOOL)isOpen
+{
+	return _buffers != nil;
+}
+
+- (AVAudioFramePosition)framePosition
+{
+	return _framePosition;
+}
+
+- (AVAudioFramePosition)frameLength
+{
+	return _frameLength;
+}
+
+- (BOOL)decodeIntoBuffer:(AVAudioBuffer *)buffer error:(NSError **)error
+{
+	NSParameterAssert(buffer != nil);
+	NSParameterAssert([buffer isKindOfClass:[AVAudioPCMBuffer class]]);
+	return [self decodeIntoBuffer:(AVAudioPCMBuffer *)buffer frameLength:((AVAudioPCMBuffer *)buffer).frameCapacity error:error];
+}
+
+- (BOOL)decodeIntoBuffer:(AVAudioPCMBuffer *)buffer frameLength:(AVAudioFrameCount)frameLength error:(NSError **)error
+{
+	NSParameterAssert(buffer != nil);
+	NSParameterAssert([buffer.format isEqual:_decoder.processingFormat]);
+
+	// Reset output buffer data size
+	buffer.frameLength = 0;
+
+	if(frameLength > buffer.frameCapacity)
+		frameLength = buffer.frameCapacity;
+
+	while(buffer.frameLength < frameLength) {
+		if(_currentBuffer == kNoBuffer && ![self dequeueBuffer])
+			break;
+
+		AVAudioPCMBuffer *decodedBuffer = _buffers[_currentBuffer];
+
+		// An empty buffer marks the end of decoding, either due to end of stream or an error
+		if(decodedBuffer.frameLength == 0) {
+			if(buffer.frameLength == 0 && (_flags.load() & ePrefetchingDecoderFlagDecodingError)) {
+				if(error)
+					*error = _decodingError;
+				return NO;
+			}
+			break;
+		}
+
+		AVAudioFrameCount framesCopied = [buffer appendFromBuffer:decodedBuffer readingFromOffset:_currentBufferOffset frameLength:(frameLength - buffer.frameLength)];
+		_currentBufferOffset += framesCopied;
+
+		if(_currentBufferOffset == decodedBuffer.frameLength) {
+			[self recycleBuffer:_currentBuffer];
+			_currentBuffer = kNoBuffer;
+		}
+	}
+
+	_framePosition += buffer.frameLength;
+
+	return YES;
+}
+
+- (BOOL)supportsSeeking
+{
+	return _decoder.supportsSeeking;
+}
+
+- (BOOL)seekToFrame:(AVAudioFramePosition)frame error:(NSError **)error
+{
+	NSParameterAssert(frame >= 0);
+
+	// Holding the lock guarantees the decoding thread isn't using _decoder and every buffer index is in a queue or held by the consumer
+	std::lock_guard<SFB::UnfairLock> lock(_decoderLock);
+
+	// Discard any prefetched audio
+	if(_currentBuffer != kNoBuffer) {
+		[self recycleBuffer:_currentBuffer];
+		_currentBuffer = kNoBuffer;
+	}
+
+	uint32_t index;
+	while(_decodedBuffers.Read(&index, sizeof index) == sizeof index)
+		[self recycleBuffer:index];
+
+	// Drain any stale signals from the decoding thread
+	while(!dispatch_semaphore_wait(_consumerSemaphore, DISPATCH_TIME_NOW))
+		;
+
+	_flags.fetch_and(~(ePrefetchingDecoderFlagDecodingComplete | ePrefetchingDecoderFlagDecodingError));
+	_decodingError = nil;
+
+	BOOL result = [_decoder seekToFrame:frame error:error];
+	_framePosition = _decoder.framePosition;
+
+	dispatch_semaphore_signal(_decodingSemaphore);
+
+	return result;
+}
+
+#pragma mark - Buffer Management
+
+- (BOOL)dequeueBuffer
+{
+	for(;;) {
+		uint32_t index;
+		if(_decodedBuffers.Read(&index, sizeof index) == sizeof index) {
+			_currentBuffer = index;
+			_currentBufferOffset = 0;
+			return YES;
+		}
+
+		// The decoding thread always enqueues an empty buffer before setting these flags
+		// so if one is set the queue must be checked once more before giving up
+		if(_flags.load() & (ePrefetchingDecoderFlagDecodingComplete | ePrefetchingDecoderFlagDecodingError)) {
+			if(_decodedBuffers.BytesAvailableToRead() >= sizeof index)
+				continue;
+			return NO;
+		}
+
+		dispatch_semaphore_wait(_consumerSemaphore, dispatch_time(DISPATCH_TIME_NOW, NSEC_PER_SEC / 10));
+	}
+}
+
+- (void)recycleBuffer:(uint32_t)index
+{
+	_buffers[index].frameLength = 0;
+	_freeBuffers.Write(&index, sizeof index);
+	dispatch_semaphore_signal(_decodingSemaphore);
+}
+
+#pragma mark - Decoding Thread
+
+- (void *)decodingThreadEntry
+{
+	os_log_debug(gSFBAudioDecoderLog, "Prefetching decoding thread starting");
+
+	while(!(_flags.load() & ePrefetchingDecoderFlagStopDecodingThread)) {
+		bool enqueuedBuffer = false;
+
+		{
+			std::lock_guard<SFB::UnfairLock> lock(_decoderLock);
+
+			uint32_t index;
+			if(!(_flags.load() & (ePrefetchingDecoderFlagDecodingComplete | ePrefetchingDecoderFlagDecodingError)) && _freeBuffers.Read(&index, sizeof index) == sizeof index) {
+				AVAudioPCMBuffer *buffer = _buffers[index];
+
+				NSError *error = nil;
+				if(![_decoder decodeIntoBuffer:buffer frameLength:buffer.frameCapacity error:&error]) {
+					os_log_error(gSFBAudioDecoderLog, "Error decoding audio: %{public}@", error);
+					buffer.frameLength = 0;
+					_decodingError = error ?: [NSError errorWithDomain:SFBAudioDecoderErrorDomain code:SFBAudioDecoderErrorCodeInternalError userInfo:nil];
+				}
+
+				_decodedBuffers.Write(&index, sizeof index);
+				enqueuedBuffer = true;
+
+				if(_decodingError)
+					_flags.fetch_or(ePrefetchingDecoderFlagDecodingError);
+				else if(buffer.frameLength == 0)
+					_flags.fetch_or(ePrefetchingDecoderFlagDecodingComplete);
+			}
+		}
+
+		if(enqueuedBuffer)
+			dispatch_semaphore_signal(_consumerSemaphore);
+		else
+			dispatch_semaphore_wait(_decodingSemaphore, DISPATCH_TIME_FOREVER);
+	}
+
+	os_log_debug(gSFBAudioDecoderLog, "Prefetching decoding thread stopping");
+
+	return nullptr;
+}
+
+@end
@@ -76,6 +76,11 @@ namespace {
 	return SFBAudioDecoderNameTrueAudio;
 }
 
++ (NSArray *)supportedSignatures
+{
+	return @[[SFBAudioDecoderSignature signatureWithBytes:"TTA1" length:4]];
+}
+
 - (BOOL)decodingIsLossless
 {
 	return YES;
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2011 - 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <memory>
+
+#import "SFBWavPackDecoder.h"
+
+#import "SFBCoreDecoding.h"
+#import "WavPackDecoder.h"
+
+SFBAudioDecoderName const SFBAudioDecoderNameWavPack = @"org.sbooth.AudioEngine.Decoder.WavPack";
+
+@interface SFBWavPackDecoder () <SFBCoreDecoding>
+{
+@private
+	std::unique_ptr<SFB::Audio::WavPackDecoder> _decoder;
+}
+@end
+
+@implementation SFBWavPackDecoder
+
++ (void)load
+{
+	[SFBAudioDecoder registerSubclass:[self class]];
+}
+
++ (NSSet *)supportedPathExtensions
+{
+	return [NSSet setWithObject:@"wv"];
+}
+
++ (NSSet *)supportedMIMETypes
+{
+	return [NSSet setWithArray:@[@"audio/wavpack", @"audio/x-wavpack"]];
+}
+
++ (SFBAudioDecoderName)decoderName
+{
+	return SFBAudioDecoderNameWavPack;
+}
+
++ (NSArray *)supportedSignatures
+{
+	return @[[SFBAudioDecoderSignature signatureWithBytes:"wvpk" length:4]];
+}
+
+- (BOOL)decodingIsLossless
+{
+	return _decoder && _decoder->DecodingIsLossless();
+}
+
+- (BOOL)openReturningError:(NSError **)error
+{
+	if(![super openReturningError:error])
+		return NO;
+
+	auto decoder = std::make_unique<SFB::Audio::WavPackDecoder>(std::make_unique<SFB::Audio::InputSourceAdapter>(_inputSource));
+	if(!decoder->Open()) {
+		if(error)
+			*error = SFBCoreDecoderError(*decoder, SFBAudioDecoderErrorDomain, _inputSource.url, @"WavPack");
+		return NO;
+	}
+
+	_processingFormat = SFBCoreDecoderProcessingFormat(*decoder);
+	_sourceFormat = SFBCoreDecoderSourceFormat(*decoder);
+
+	_decoder = std::move(decoder);
+
+	return YES;
+}
+
+- (BOOL)closeReturningError:(NSError **)error
+{
+	if(_decoder) {
+		_decoder->Close();
+		_decoder.reset();
+	}
+
+	return [super closeReturningError:error];
+}
+
+- (BOOL)isOpen
+{
+	return _decoder != nullptr;
+}
+
+- (SFB::Audio::Decoder *)coreDecoder
+{
+	return _decoder.get();
+}
+
+- (AVAudioFramePosition)framePosition
+{
+	return _decoder ? _decoder->FramePosition() : SFBUnknownFramePosition;
+}
+
+- (AVAudioFramePosition)frameLength
+{
+	return _decoder ? _decoder->FrameLength() : SFBUnknownFrameLength;
+}
+
+- (BOOL)decodeIntoBuffer:(AVAudioPCMBuffer *)buffer frameLength:(AVAudioFrameCount)frameLength error:(NSError **)error
+{
+	NSParameterAssert(buffer != nil);
+	NSParameterAssert([buffer.format isEqual:_processingFormat]);
+
+	return SFBCoreDecoderDecodeIntoBuffer(_decoder.get(), buffer, frameLength, _inputSource.url, @"WavPack", error);
+}
+
+- (BOOL)seekToFrame:(AVAudioFramePosition)frame error:(NSError **)error
+{
+	NSParameterAssert(frame >= 0);
+	return SFBCoreDecoderSeekToFrame(_decoder.get(), frame, SFBAudioDecoderErrorDomain, _inputSource.url, @"WavPack", error);
+}
+
+@end
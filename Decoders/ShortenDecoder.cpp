@@ -0,0 +1,1309 @@
+/*
+ * Copyright (c) 2020 - 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "ShortenDecoder.h"
+
+#include "ByteStream.h"
+
+#define MIN_SUPPORTED_VERSION 1
+#define MAX_SUPPORTED_VERSION 3
+
+#define DEFAULT_BLOCK_SIZE  256
+#define DEFAULT_V0NMEAN     0
+#define DEFAULT_V2NMEAN     4
+#define DEFAULT_MAXNLPC     0
+
+#define CHANSIZE      0
+#define ENERGYSIZE    3
+#define BITSHIFTSIZE  2
+#define NWRAP         3
+
+#define FNSIZE       2
+#define FN_DIFF0     0
+#define FN_DIFF1     1
+#define FN_DIFF2     2
+#define FN_DIFF3     3
+#define FN_QUIT      4
+#define FN_BLOCKSIZE 5
+#define FN_BITSHIFT  6
+#define FN_QLPC      7
+#define FN_ZERO      8
+#define FN_VERBATIM  9
+
+#define VERBATIM_CKSIZE_SIZE 5   /* a var_put code size */
+#define VERBATIM_BYTE_SIZE   8   /* code size 8 on single bytes means no compression at all */
+#define VERBATIM_CHUNK_MAX   256 /* max. size of a FN_VERBATIM chunk */
+
+#define ULONGSIZE 2
+#define NSKIPSIZE 1
+#define LPCQSIZE  2
+#define LPCQUANT  5
+#define XBYTESIZE 7
+
+#define TYPESIZE            4
+#define TYPE_S8             1  /* signed 8 bit characters                   */
+#define TYPE_U8             2  /* unsigned 8 bit characters                 */
+#define TYPE_S16HL          3  /* signed 16 bit shorts: high-low            */
+#define TYPE_U16HL          4  /* unsigned 16 bit shorts: high-low          */
+#define TYPE_S16LH          5  /* signed 16 bit shorts: low-high            */
+#define TYPE_U16LH          6  /* unsigned 16 bit shorts: low-high          */
+
+#define SEEK_TABLE_REVISION 1
+
+#define SEEK_HEADER_SIZE  12
+#define SEEK_TRAILER_SIZE 12
+#define SEEK_ENTRY_SIZE   80
+
+#define V2LPCQOFFSET (1 << LPCQUANT)
+
+#define MAX_CHANNELS 8
+#define MAX_BLOCKSIZE 65535
+
+#define CANONICAL_HEADER_SIZE 44
+
+#define WAVE_FORMAT_PCM 0x0001
+
+#define ROUNDEDSHIFTDOWN(x, n) (((n) == 0) ? (x) : ((x) >> ((n) - 1)) >> 1)
+
+namespace {
+	/// Returns a two-dimensional \c rows x \c cols array using one allocation from \c malloc
+	template <typename T>
+	T ** AllocateContiguous2DArray(size_t rows, size_t cols)
+	{
+		T **result = (T **)malloc((rows * sizeof(T *)) + (rows * cols * sizeof(T)));
+		if(!result)
+			return nullptr;
+		T *tmp = (T *)(result + rows);
+		for(size_t i = 0; i < rows; ++i) {
+			result[i] = tmp + i * cols;
+		}
+		return result;
+	}
+
+	/// Clips values to the interval [lower, upper]
+	template <typename T>
+	T clip(const T& n, const T& lower, const T& upper) {
+		return std::max(lower, std::min(n, upper));
+	}
+
+	/// Shorten seek table header
+	struct SeekTableHeader
+	{
+		int8_t mSignature [4];
+		uint32_t mVersion;
+		uint32_t mFileSize;
+	};
+
+	SeekTableHeader ParseSeekTableHeader(const void *buf)
+	{
+		SFB::ByteStream byteStream(buf, SEEK_HEADER_SIZE);
+
+		SeekTableHeader header;
+		byteStream.Read(header.mSignature, 4);
+		header.mVersion = byteStream.ReadLE<uint32_t>();
+		header.mFileSize = byteStream.ReadLE<uint32_t>();
+
+		return header;
+	}
+
+	/// Shorten seek table trailer
+	struct SeekTableTrailer
+	{
+		uint32_t mSeekTableSize;
+		int8_t mSignature [8];
+	};
+
+	SeekTableTrailer ParseSeekTableTrailer(const void *buf)
+	{
+		SFB::ByteStream byteStream(buf, SEEK_TRAILER_SIZE);
+
+		SeekTableTrailer trailer;
+		trailer.mSeekTableSize = byteStream.ReadLE<uint32_t>();
+		byteStream.Read(trailer.mSignature, 8);
+
+		return trailer;
+	}
+}
+
+#pragma mark Variable-Length Input
+
+/// Variable-length input using Golomb-Rice coding
+class SFB::Audio::ShortenDecoder::VariableLengthInput {
+public:
+	static constexpr uint32_t sMaskTable [] = {
+		0x0,
+		0x1,		0x3,		0x7,		0xf,
+		0x1f,		0x3f,		0x7f,		0xff,
+		0x1ff,		0x3ff,		0x7ff,		0xfff,
+		0x1fff,		0x3fff,		0x7fff,		0xffff,
+		0x1ffff,	0x3ffff,	0x7ffff,	0xfffff,
+		0x1fffff,	0x3fffff,	0x7fffff,	0xffffff,
+		0x1ffffff,	0x3ffffff,	0x7ffffff,	0xfffffff,
+		0x1fffffff,	0x3fffffff,	0x7fffffff,	0xffffffff
+	};
+
+	/// Size of the internal buffer in bytes
+	/// @warning Sizes other than \c 512 will break seeking
+	static constexpr size_t sBufferSize = 512;
+
+	/// Creates a new \c VariableLengthInput object reading from \c inputSource
+	explicit VariableLengthInput(Decoder::InputSource& inputSource) noexcept
+		: mInputSource(inputSource), mByteBufferPosition(mByteBuffer), mBytesAvailable(0), mBitBuffer(0), mBitsAvailable(0)
+	{}
+
+	/// Reads a single unsigned value from the specified bin
+	bool uvar_get(int32_t& i32, size_t bin)
+	{
+		if(mBitsAvailable == 0) {
+			if(!word_get(mBitBuffer))
+				return false;
+			mBitsAvailable = 32;
+		}
+
+		int32_t result;
+		for(result = 0; !(mBitBuffer & (1L << --mBitsAvailable)); ++result) {
+			if(mBitsAvailable == 0) {
+				if(!word_get(mBitBuffer))
+					return false;
+				mBitsAvailable = 32;
+			}
+		}
+
+		while(bin != 0) {
+			if(mBitsAvailable >= bin) {
+				result = (result << bin) | (int32_t)((mBitBuffer >> (mBitsAvailable - bin)) & sMaskTable[bin]);
+				mBitsAvailable -= bin;
+				bin = 0;
+			}
+			else {
+				result = (result << mBitsAvailable) | (int32_t)(mBitBuffer & sMaskTable[mBitsAvailable]);
+				bin -= mBitsAvailable;
+				if(!word_get(mBitBuffer))
+					return false;
+				mBitsAvailable = 32;
+			}
+		}
+
+		i32 = result;
+		return true;
+	}
+
+	/// Reads a single signed value from the specified bin
+	bool var_get(int32_t& i32, size_t bin)
+	{
+		int32_t var;
+		if(!uvar_get(var, bin + 1))
+			return false;
+
+		uint32_t uvar = (uint32_t)var;
+		if(uvar & 1)
+			i32 = ~(uvar >> 1);
+		else
+			i32 = (uvar >> 1);
+		return true;
+	}
+
+	/// Reads the unsigned Golomb-Rice code
+	bool ulong_get(uint32_t& ui32)
+	{
+		int32_t bitcount;
+		if(!uvar_get(bitcount, ULONGSIZE))
+			return false;
+
+		int32_t i32;
+		if(!uvar_get(i32, (uint32_t)bitcount))
+			return false;
+
+		ui32 = (uint32_t)i32;
+		return true;
+	}
+
+	bool uint_get(uint32_t& ui32, int version, size_t bin)
+	{
+		if(version == 0) {
+			int32_t i32;
+			if(!uvar_get(i32, bin))
+				return false;
+			ui32 = (uint32_t)i32;
+			return true;
+		}
+		else
+			return ulong_get(ui32);
+	}
+
+	static size_t sizeof_uvar(uint32_t val, size_t nbin)
+	{
+		return (val >> nbin) + nbin;
+	}
+
+	static size_t sizeof_var(int32_t val, size_t nbin)
+	{
+		return (size_t)(labs(val) >> nbin) + nbin + 1;
+	}
+
+	void Reset()
+	{
+		mByteBufferPosition = mByteBuffer;
+		mBytesAvailable = 0;
+		mBitsAvailable = 0;
+	}
+
+	bool Refill()
+	{
+		int64_t bytesRead = 0;
+		if(!mInputSource.Read(mByteBuffer, sBufferSize, bytesRead) || bytesRead < 4)
+			return false;
+		mBytesAvailable += (size_t)bytesRead;
+		mByteBufferPosition = mByteBuffer;
+		return true;
+	}
+
+	bool SetState(uint16_t byteBufferPosition, uint16_t bytesAvailable, uint32_t bitBuffer, uint16_t bitsAvailable)
+	{
+		if(byteBufferPosition > mBytesAvailable || bytesAvailable > mBytesAvailable - byteBufferPosition || bitsAvailable > 32)
+			return false;
+		mByteBufferPosition = mByteBuffer + byteBufferPosition;
+		mBytesAvailable = bytesAvailable;
+		mBitBuffer = bitBuffer;
+		mBitsAvailable = bitsAvailable;
+		return true;
+	}
+
+private:
+	/// Input source
+	Decoder::InputSource& mInputSource;
+	/// Byte buffer
+	uint8_t mByteBuffer [sBufferSize];
+	/// Current position in \c mByteBuffer
+	uint8_t *mByteBufferPosition;
+	/// Bytes available in \c mByteBuffer
+	size_t mBytesAvailable;
+	/// Bit buffer
+	uint32_t mBitBuffer;
+	/// Bits available in \c mBuffer
+	size_t mBitsAvailable;
+
+	/// Reads a single \c uint32_t from the byte buffer, refilling if necessary
+	bool word_get(uint32_t& ui32)
+	{
+		if(mBytesAvailable < 4 && !Refill())
+			return false;
+
+		ui32 = (uint32_t)((((int32_t)mByteBufferPosition[0]) << 24) | (((int32_t)mByteBufferPosition[1]) << 16) | (((int32_t)mByteBufferPosition[2]) << 8) | ((int32_t)mByteBufferPosition[3]));
+
+		mByteBufferPosition += 4;
+		mBytesAvailable -= 4;
+
+		return true;
+	}
+
+};
+
+#pragma mark Seek Table
+
+/// A Shorten seek table entry
+struct SFB::Audio::ShortenDecoder::SeekTableEntry
+{
+	uint32_t mFrameNumber;
+	uint32_t mByteOffsetInFile;
+	uint32_t mLastBufferReadPosition;
+	uint16_t mBytesAvailable;
+	uint16_t mByteBufferPosition;
+	uint16_t mBitBufferPosition;
+	uint32_t mBitBuffer;
+	uint16_t mBitshift;
+	int32_t mCBuf0 [3];
+	int32_t mCBuf1 [3];
+	int32_t mOffset0 [4];
+	int32_t mOffset1 [4];
+};
+
+SFB::Audio::ShortenDecoder::SeekTableEntry SFB::Audio::ShortenDecoder::ParseSeekTableEntry(const void *buf) noexcept
+{
+	SFB::ByteStream byteStream(buf, SEEK_ENTRY_SIZE);
+
+	SeekTableEntry entry;
+	entry.mFrameNumber = byteStream.ReadLE<uint32_t>();
+	entry.mByteOffsetInFile = byteStream.ReadLE<uint32_t>();
+	entry.mLastBufferReadPosition = byteStream.ReadLE<uint32_t>();
+	entry.mBytesAvailable = byteStream.ReadLE<uint16_t>();
+	entry.mByteBufferPosition = byteStream.ReadLE<uint16_t>();
+	entry.mBitBufferPosition = byteStream.ReadLE<uint16_t>();
+	entry.mBitBuffer = byteStream.ReadLE<uint32_t>();
+	entry.mBitshift = byteStream.ReadLE<uint16_t>();
+	for(auto i = 0; i < 3; ++i) {
+		entry.mCBuf0[i] = (int32_t)byteStream.ReadLE<uint32_t>();
+	}
+	for(auto i = 0; i < 3; ++i) {
+		entry.mCBuf1[i] = (int32_t)byteStream.ReadLE<uint32_t>();
+	}
+	for(auto i = 0; i < 4; ++i) {
+		entry.mOffset0[i] = (int32_t)byteStream.ReadLE<uint32_t>();
+	}
+	for(auto i = 0; i < 4; ++i) {
+		entry.mOffset1[i] = (int32_t)byteStream.ReadLE<uint32_t>();
+	}
+
+	return entry;
+}
+
+#pragma mark Creation and Destruction
+
+SFB::Audio::ShortenDecoder::ShortenDecoder(InputSource::unique_ptr inputSource, InputSource::unique_ptr externalSeekTable) noexcept
+	: Decoder(std::move(inputSource)), mExternalSeekTable(std::move(externalSeekTable)), mVersion(0), mLPCQOffset(0), mInternalFileType(0), mNChan(0), mNMean(0), mBlockSize(0), mMaxNLPC(0), mNWrap(0), mSampleRate(0), mBitsPerSample(0), mBigEndian(false), mBuffer(nullptr), mOffset(nullptr), mBitshift(0), mEOS(false), mFramesBuffered(0), mFrameBufferOffset(0), mFramePosition(0), mFrameLength(0), mBlocksDecoded(0)
+{}
+
+SFB::Audio::ShortenDecoder::~ShortenDecoder()
+{
+	if(IsOpen())
+		Close();
+}
+
+#pragma mark Opening and Closing
+
+bool SFB::Audio::ShortenDecoder::Open() noexcept
+{
+	mInput.reset(new (std::nothrow) VariableLengthInput(*mInputSource));
+	if(!mInput)
+		return Fail(Error::OutOfMemory);
+
+	if(!ParseShortenHeader())
+		return false;
+
+	// Sanity checks
+	if(mBitsPerSample != 8 && mBitsPerSample != 16) {
+		os_log_error(Log(), "Unsupported bit depth: %u", mBitsPerSample);
+		return Fail(Error::UnsupportedFormat);
+	}
+
+	if((mBitsPerSample == 8 && (mInternalFileType != TYPE_U8 && mInternalFileType != TYPE_S8)) || (mBitsPerSample == 16 && (mInternalFileType != TYPE_U16HL && mInternalFileType != TYPE_U16LH && mInternalFileType != TYPE_S16HL && mInternalFileType != TYPE_S16LH))) {
+		os_log_error(Log(), "Unsupported bit depth/audio type combination: %u, %u", mBitsPerSample, mInternalFileType);
+		return Fail(Error::UnsupportedFormat);
+	}
+
+	if(!ScanForSeekTable())
+		return Fail(Error::InternalError);
+
+	// Set up the processing format
+	AudioStreamBasicDescription processingStreamDescription{};
+
+	processingStreamDescription.mFormatID			= kAudioFormatLinearPCM;
+	processingStreamDescription.mFormatFlags		= kAudioFormatFlagIsNonInterleaved | kAudioFormatFlagIsPacked;
+	// Apparently *16HL isn't true for 'AIFF'
+//	if(mInternalFileType == TYPE_U16HL || mInternalFileType == TYPE_S16HL)
+	if(mBigEndian)
+		processingStreamDescription.mFormatFlags	|= kAudioFormatFlagIsBigEndian;
+	if(mInternalFileType == TYPE_S8 || mInternalFileType == TYPE_S16HL || mInternalFileType == TYPE_S16LH)
+		processingStreamDescription.mFormatFlags	|= kAudioFormatFlagIsSignedInteger;
+
+	processingStreamDescription.mSampleRate			= mSampleRate;
+	processingStreamDescription.mChannelsPerFrame	= static_cast<UInt32>(mNChan);
+	processingStreamDescription.mBitsPerChannel		= mBitsPerSample;
+
+	processingStreamDescription.mBytesPerPacket		= (mBitsPerSample + 7) / 8;
+	processingStreamDescription.mFramesPerPacket	= 1;
+	processingStreamDescription.mBytesPerFrame		= processingStreamDescription.mBytesPerPacket / processingStreamDescription.mFramesPerPacket;
+
+	mProcessingFormat = processingStreamDescription;
+
+	switch(mNChan) {
+		case 1:		mChannelLayoutTag = kAudioChannelLayoutTag_Mono;			break;
+		case 2:		mChannelLayoutTag = kAudioChannelLayoutTag_Stereo;			break;
+		case 3:		mChannelLayoutTag = kAudioChannelLayoutTag_MPEG_3_0_A;		break;
+		case 4:		mChannelLayoutTag = kAudioChannelLayoutTag_Quadraphonic;	break;
+		case 5:		mChannelLayoutTag = kAudioChannelLayoutTag_MPEG_5_0_A;		break;
+		case 6:		mChannelLayoutTag = kAudioChannelLayoutTag_MPEG_5_1_A;		break;
+		case 7:		mChannelLayoutTag = kAudioChannelLayoutTag_MPEG_6_1_A;		break;
+		case 8:		mChannelLayoutTag = kAudioChannelLayoutTag_MPEG_7_1_A;		break;
+		default:	mChannelLayoutTag = 0;										break;
+	}
+
+	// Set up the source format
+	AudioStreamBasicDescription sourceStreamDescription{};
+
+	sourceStreamDescription.mFormatID			= kSFBAudioFormatShorten;
+
+	sourceStreamDescription.mSampleRate			= mSampleRate;
+	sourceStreamDescription.mChannelsPerFrame	= static_cast<UInt32>(mNChan);
+	sourceStreamDescription.mBitsPerChannel		= mBitsPerSample;
+
+	sourceStreamDescription.mFramesPerPacket	= static_cast<UInt32>(mBlockSize);
+
+	mSourceFormat = sourceStreamDescription;
+
+	// Allocate the frame buffer, which holds one block
+	// The block size may decrease while decoding but never increases
+	size_t channelBufferSize = static_cast<size_t>(mBlockSize) * processingStreamDescription.mBytesPerFrame;
+	mFrameBuffer.reset(new (std::nothrow) uint8_t [channelBufferSize * static_cast<size_t>(mNChan)]);
+	mChannelBuffers.reset(new (std::nothrow) uint8_t * [static_cast<size_t>(mNChan)]);
+	if(!mFrameBuffer || !mChannelBuffers) {
+		mFrameBuffer.reset();
+		mChannelBuffers.reset();
+		return Fail(Error::OutOfMemory);
+	}
+
+	for(auto channel = 0; channel < mNChan; ++channel)
+		mChannelBuffers[channel] = mFrameBuffer.get() + (static_cast<size_t>(channel) * channelBufferSize);
+
+	mFramesBuffered = 0;
+	mFrameBufferOffset = 0;
+
+	// Initialize offset
+	int32_t mean = 0;
+	switch(mInternalFileType) {
+//		case TYPE_AU1:
+		case TYPE_S8:
+		case TYPE_S16HL:
+		case TYPE_S16LH:
+//		case TYPE_ULAW:
+//		case TYPE_AU2:
+//		case TYPE_AU3:
+//		case TYPE_ALAW:
+			mean = 0;
+			break;
+		case TYPE_U8:
+			mean = 0x80;
+			break;
+		case TYPE_U16HL:
+		case TYPE_U16LH:
+			mean = 0x8000;
+			break;
+		default:
+			os_log_error(Log(), "Unsupported audio type: %u", mInternalFileType);
+			return Fail(Error::UnsupportedFormat);
+	}
+
+	// Allocate decoding buffers
+	if(mMaxNLPC > 0) {
+		mQLPC.reset(new (std::nothrow) int [static_cast<size_t>(mMaxNLPC)]);
+		if(!mQLPC)
+			return Fail(Error::OutOfMemory);
+	}
+
+	auto buffer = AllocateContiguous2DArray<int32_t>(static_cast<size_t>(mNChan), static_cast<size_t>(mBlockSize + mNWrap));
+	auto offset = AllocateContiguous2DArray<int32_t>(static_cast<size_t>(mNChan), static_cast<size_t>(std::max(1, mNMean)));
+	if(!buffer || !offset) {
+		free(buffer);
+		free(offset);
+		return Fail(Error::OutOfMemory);
+	}
+
+	for(auto i = 0; i < mNChan; ++i) {
+		for(auto j = 0; j < mNWrap; ++j) {
+			buffer[i][j] = 0;
+		}
+		buffer[i] += mNWrap;
+	}
+
+	for(auto chan = 0; chan < mNChan; ++chan) {
+		for(auto i = 0; i < std::max(1, mNMean); ++i) {
+			offset[chan][i] = mean;
+		}
+	}
+
+	mBuffer = buffer;
+	mOffset = offset;
+
+	mEOS = false;
+	mFramePosition = 0;
+	mBlocksDecoded = 0;
+
+	return true;
+}
+
+bool SFB::Audio::ShortenDecoder::Close() noexcept
+{
+	if(mBuffer) {
+		free(mBuffer);
+		mBuffer = nullptr;
+	}
+	if(mOffset) {
+		free(mOffset);
+		mOffset = nullptr;
+	}
+
+	mQLPC.reset();
+	mInput.reset();
+
+	mFrameBuffer.reset();
+	mChannelBuffers.reset();
+	mFramesBuffered = 0;
+	mFrameBufferOffset = 0;
+
+	mSeekTableEntries.clear();
+
+	return true;
+}
+
+#pragma mark Decoding
+
+bool SFB::Audio::ShortenDecoder::Decode(AudioBufferList * const bufferList, uint32_t frameCount, uint32_t& framesDecoded) noexcept
+{
+	assert(bufferList != nullptr);
+	assert(bufferList->mNumberBuffers == static_cast<UInt32>(mNChan));
+
+	framesDecoded = 0;
+
+	const uint32_t bytesPerFrame = mProcessingFormat.mBytesPerFrame;
+
+	for(;;) {
+		// Copy buffered audio to the output
+		uint32_t framesToCopy = std::min(mFramesBuffered - mFrameBufferOffset, frameCount - framesDecoded);
+		if(framesToCopy > 0) {
+			for(UInt32 channel = 0; channel < bufferList->mNumberBuffers; ++channel)
+				memcpy(static_cast<uint8_t *>(bufferList->mBuffers[channel].mData) + (framesDecoded * bytesPerFrame), mChannelBuffers[channel] + (mFrameBufferOffset * bytesPerFrame), framesToCopy * bytesPerFrame);
+			mFrameBufferOffset += framesToCopy;
+			framesDecoded += framesToCopy;
+		}
+
+		// All requested frames were read or EOS reached
+		if(framesDecoded == frameCount || mEOS)
+			break;
+
+		// Decode the next mBlockSize frames
+		if(!DecodeBlock()) {
+			os_log_error(Log(), "Error decoding Shorten block");
+			SetBufferListFrameLength(bufferList, framesDecoded);
+			mFramePosition += framesDecoded;
+			return false;
+		}
+	}
+
+	SetBufferListFrameLength(bufferList, framesDecoded);
+	mFramePosition += framesDecoded;
+
+	return true;
+}
+
+#pragma mark Seeking
+
+bool SFB::Audio::ShortenDecoder::SupportsSeeking() const noexcept
+{
+	return !mSeekTableEntries.empty();
+}
+
+bool SFB::Audio::ShortenDecoder::SeekToFrame(int64_t frame) noexcept
+{
+	assert(frame >= 0);
+
+	if(frame >= mFrameLength)
+		return Fail(Error::InternalError);
+
+	// Locate the most suitable seek table entry for frame
+	auto entry = std::upper_bound(mSeekTableEntries.cbegin(), mSeekTableEntries.cend(), frame, [](int64_t value, const SeekTableEntry& seekTableEntry) {
+		return value < seekTableEntry.mFrameNumber;
+	});
+	if(entry == mSeekTableEntries.cbegin()) {
+		os_log_error(Log(), "No seek table entry for frame %lld", frame);
+		return Fail(Error::InternalError);
+	}
+	--entry;
+
+#if DEBUG
+	os_log_debug(Log(), "Using seek table entry %ld for frame %d to seek to frame %lld", std::distance(mSeekTableEntries.cbegin(), entry), entry->mFrameNumber, frame);
+#endif
+
+	if(!mInputSource->SeekToOffset(entry->mLastBufferReadPosition))
+		return Fail(Error::InternalError);
+
+	mInput->Reset();
+	if(!mInput->Refill() || !mInput->SetState(entry->mByteBufferPosition, entry->mBytesAvailable, entry->mBitBuffer, entry->mBitBufferPosition))
+		return Fail(Error::InternalError);
+
+	mBuffer[0][-1] = entry->mCBuf0[0];
+	mBuffer[0][-2] = entry->mCBuf0[1];
+	mBuffer[0][-3] = entry->mCBuf0[2];
+	if(mNChan == 2) {
+		mBuffer[1][-1] = entry->mCBuf1[0];
+		mBuffer[1][-2] = entry->mCBuf1[1];
+		mBuffer[1][-3] = entry->mCBuf1[2];
+	}
+
+	for(auto i = 0; i < std::max(1, mNMean); ++i) {
+		mOffset[0][i] = entry->mOffset0[i];
+		if(mNChan == 2)
+			mOffset[1][i] = entry->mOffset1[i];
+	}
+
+	mBitshift = entry->mBitshift;
+
+	mFramePosition = entry->mFrameNumber;
+	mFramesBuffered = 0;
+	mFrameBufferOffset = 0;
+	mEOS = false;
+
+	uint32_t framesToSkip = static_cast<uint32_t>(frame - entry->mFrameNumber);
+	uint32_t framesSkipped = 0;
+
+	for(;;) {
+		// Decode the next mBlockSize frames
+		if(!DecodeBlock()) {
+			os_log_error(Log(), "Error decoding Shorten block");
+			return false;
+		}
+
+		uint32_t framesToTrim = std::min(framesToSkip - framesSkipped, mFramesBuffered - mFrameBufferOffset);
+		mFrameBufferOffset += framesToTrim;
+
+		framesSkipped += framesToTrim;
+
+		// All requested frames were skipped or EOS reached
+		if(framesSkipped == framesToSkip || mEOS)
+			break;
+	}
+
+	mFramePosition += framesSkipped;
+
+	return true;
+}
+
+#pragma mark Parsing
+
+bool SFB::Audio::ShortenDecoder::ParseShortenHeader() noexcept
+{
+	// Read magic number
+	uint32_t magic;
+	if(!mInputSource->ReadBE(magic) || magic != 'ajkg') {
+		return Fail(Error::InvalidFormat);
+	}
+
+	// Read file version
+	uint8_t version = 0;
+	if(!mInputSource->ReadBE(version) || version < MIN_SUPPORTED_VERSION || version > MAX_SUPPORTED_VERSION) {
+		os_log_error(Log(), "Unsupported version: %u", version);
+		return Fail(Error::UnsupportedFormat);
+	}
+	mVersion = version;
+
+	// Default nmean
+	mNMean = mVersion < 2 ? DEFAULT_V0NMEAN : DEFAULT_V2NMEAN;
+
+	// Read internal file type
+	uint32_t ftype;
+	if(!mInput->uint_get(ftype, mVersion, TYPESIZE)) {
+		return Fail(Error::InvalidFormat);
+	}
+	if(ftype != TYPE_U8 && ftype != TYPE_S8 && ftype != TYPE_U16HL && ftype != TYPE_U16LH && ftype != TYPE_S16HL && ftype != TYPE_S16LH) {
+		os_log_error(Log(), "Unsupported audio type: %u", ftype);
+		return Fail(Error::InvalidFormat);
+	}
+	mInternalFileType = (int)ftype;
+
+	// Read number of channels
+	uint32_t nchan = 0;
+	if(!mInput->uint_get(nchan, mVersion, CHANSIZE) || nchan == 0 || nchan > MAX_CHANNELS) {
+		os_log_error(Log(), "Invalid or unsupported channel count: %u", nchan);
+		return Fail(Error::InvalidFormat);
+	}
+	mNChan = (int)nchan;
+
+	// Read blocksize if version > 0
+	if(mVersion > 0) {
+		uint32_t blocksize = 0;
+		if(!mInput->uint_get(blocksize, mVersion, (size_t)log2(DEFAULT_BLOCK_SIZE)) || blocksize == 0 || blocksize > MAX_BLOCKSIZE) {
+			os_log_error(Log(), "Invalid or unsupported block size: %u", blocksize);
+			return Fail(Error::InvalidFormat);
+		}
+		mBlockSize = (int)blocksize;
+
+		uint32_t maxnlpc = 0;
+		if(!mInput->uint_get(maxnlpc, mVersion, LPCQSIZE) || maxnlpc > 1024) {
+			os_log_error(Log(), "Invalid maxnlpc: %u", maxnlpc);
+			return Fail(Error::InvalidFormat);
+		}
+		mMaxNLPC = (int)maxnlpc;
+
+		uint32_t nmean = 0;
+		if(!mInput->uint_get(nmean, mVersion, 0) || nmean > 32768) {
+			os_log_error(Log(), "Invalid nmean: %u", nmean);
+			return Fail(Error::InvalidFormat);
+		}
+		mNMean = (int)nmean;
+
+		uint32_t nskip;
+		if(!mInput->uint_get(nskip, mVersion, NSKIPSIZE) /* || nskip > bits_remaining_in_input */) {
+			return Fail(Error::InvalidFormat);
+		}
+
+		for(uint32_t i = 0; i < nskip; ++i) {
+			uint32_t dummy;
+			if(!mInput->uint_get(dummy, mVersion, XBYTESIZE)) {
+				return Fail(Error::InvalidFormat);
+			}
+		}
+	}
+	else {
+		mBlockSize = DEFAULT_BLOCK_SIZE;
+		mMaxNLPC = DEFAULT_MAXNLPC;
+	}
+
+	mNWrap = std::max(NWRAP, (int)mMaxNLPC);
+
+	if(mVersion > 1)
+		mLPCQOffset = V2LPCQOFFSET;
+
+	// Parse the WAVE or AIFF header in the verbatim section
+
+	int32_t fn;
+	if(!mInput->uvar_get(fn, FNSIZE) || fn != FN_VERBATIM) {
+		os_log_error(Log(), "Missing initial verbatim section");
+		return Fail(Error::UnsupportedFormat);
+	}
+
+	int32_t header_size;
+	if(!mInput->uvar_get(header_size, VERBATIM_CKSIZE_SIZE) || header_size < CANONICAL_HEADER_SIZE || header_size > VERBATIM_CHUNK_MAX) {
+		os_log_error(Log(), "Incorrect header size: %u", header_size);
+		return Fail(Error::InvalidFormat);
+	}
+
+	int8_t header_bytes [header_size];
+	for(int32_t i = 0; i < header_size; ++i) {
+		int32_t byte;
+		if(!mInput->uvar_get(byte, VERBATIM_BYTE_SIZE)) {
+			return Fail(Error::InvalidFormat);
+		}
+
+		header_bytes[i] = (int8_t)byte;
+	}
+
+	SFB::ByteStream chunkData{header_bytes, (size_t)header_size};
+	auto chunkID = chunkData.ReadBE<uint32_t>();
+
+	// Skip chunk size
+	chunkData.Skip(4);
+
+	// WAVE
+	if(chunkID == 'RIFF') {
+		if(!ParseRIFFChunk(chunkData))
+			return false;
+	}
+	// AIFF
+	else if(chunkID == 'FORM') {
+		if(!ParseFORMChunk(chunkData))
+			return false;
+	}
+	else {
+		os_log_error(Log(), "Unsupported data format: %u", chunkID);
+		return Fail(Error::UnsupportedFormat);
+	}
+
+	return true;
+}
+
+bool SFB::Audio::ShortenDecoder::ParseRIFFChunk(SFB::ByteStream& chunkData) noexcept
+{
+	auto chunkID = chunkData.ReadBE<uint32_t>();
+	if(chunkID != 'WAVE') {
+		os_log_error(Log(), "Missing 'WAVE' in 'RIFF' chunk");
+		return Fail(Error::InvalidFormat);
+	}
+
+	bool sawFormatChunk = false;
+	uint32_t dataChunkSize = 0;
+	uint16_t blockAlign = 0;
+
+	while((chunkID = chunkData.ReadBE<uint32_t>())) {
+		auto len = chunkData.ReadLE<uint32_t>();
+		switch(chunkID) {
+			case 'fmt ':
+			{
+				if(len < 16) {
+					os_log_error(Log(), "'fmt ' chunk is too small (%u bytes)", len);
+					return Fail(Error::InvalidFormat);
+				}
+
+				auto format_tag = chunkData.ReadLE<uint16_t>();
+				if(format_tag != WAVE_FORMAT_PCM) {
+					os_log_error(Log(), "Unsupported WAVE format tag: %x", format_tag);
+					return Fail(Error::UnsupportedFormat);
+				}
+
+				auto channels = chunkData.ReadLE<uint16_t>();
+				if(mNChan != channels)
+					os_log_info(Log(), "Channel count mismatch between Shorten (%d) and 'fmt ' chunk (%u)", mNChan, channels);
+				mSampleRate = chunkData.ReadLE<uint32_t>();
+				chunkData.Skip(4); // average bytes per second
+				blockAlign = chunkData.ReadLE<uint16_t>();
+				mBitsPerSample = chunkData.ReadLE<uint16_t>();
+
+				if(len > 16)
+					os_log_info(Log(), "%u bytes in 'fmt ' chunk not parsed", len - 16);
+
+				sawFormatChunk = true;
+
+				break;
+			}
+
+			case 'data':
+				dataChunkSize = len;
+				break;
+		}
+	}
+
+	if(!sawFormatChunk) {
+		os_log_error(Log(), "Missing 'fmt ' chunk");
+		return Fail(Error::InvalidFormat);
+	}
+
+	if(dataChunkSize && blockAlign)
+		mFrameLength = dataChunkSize / blockAlign;
+
+	return true;
+}
+
+bool SFB::Audio::ShortenDecoder::ParseFORMChunk(SFB::ByteStream& chunkData) noexcept
+{
+	auto chunkID = chunkData.ReadBE<uint32_t>();
+	if(chunkID != 'AIFF' && chunkID != 'AIFC') {
+		os_log_error(Log(), "Missing 'AIFF' or 'AIFC' in 'FORM' chunk");
+		return Fail(Error::InvalidFormat);
+	}
+
+	if(chunkID == 'AIFC')
+		mBigEndian = true;
+
+	// Skip unknown chunks, looking for 'COMM'
+	while(chunkData.ReadBE<uint32_t>() != 'COMM') {
+		auto len = chunkData.ReadBE<uint32_t>();
+		// pad byte not included in ckLen
+		if((int32_t)len < 0 || chunkData.Remaining() < 18 + len + (len & 1)) {
+			os_log_error(Log(), "Missing 'COMM' chunk");
+			return Fail(Error::InvalidFormat);
+		}
+		chunkData.Skip(len + (len & 1));
+	}
+
+	auto len = chunkData.ReadBE<uint32_t>();
+	if((int32_t)len < 18) {
+		os_log_error(Log(), "'COMM' chunk is too small (%u bytes)", len);
+		return Fail(Error::InvalidFormat);
+	}
+
+	auto channels = chunkData.ReadBE<uint16_t>();
+	if(mNChan != channels)
+		os_log_info(Log(), "Channel count mismatch between Shorten (%d) and 'COMM' chunk (%u)", mNChan, channels);
+
+	mFrameLength = chunkData.ReadBE<uint32_t>();
+
+	mBitsPerSample = chunkData.ReadBE<uint16_t>();
+
+	// sample rate is IEEE 754 80-bit extended float (16-bit exponent, 1-bit integer part, 63-bit fraction)
+	auto exp = (int16_t)chunkData.ReadBE<uint16_t>() - 16383 - 63;
+	if(exp < -63 || exp > 63) {
+		os_log_error(Log(), "exp out of range: %d", exp);
+		return Fail(Error::InvalidFormat);
+	}
+
+	auto frac = chunkData.ReadBE<uint64_t>();
+	if(exp >= 0)
+		mSampleRate = (uint32_t)(frac << exp);
+	else
+		mSampleRate = (uint32_t)((frac + ((uint64_t)1 << (-exp - 1))) >> -exp);
+
+	if(len > 18)
+		os_log_info(Log(), "%u bytes in 'COMM' chunk not parsed", len - 16);
+
+	return true;
+}
+
+bool SFB::Audio::ShortenDecoder::DecodeBlock() noexcept
+{
+	int chan = 0;
+	for(;;) {
+		int32_t cmd;
+		if(!mInput->uvar_get(cmd, FNSIZE)) {
+			return Fail(Error::InvalidFormat);
+		}
+
+		if(cmd == FN_QUIT) {
+			mEOS = true;
+			return true;
+		}
+
+		switch(cmd) {
+			case FN_ZERO:
+			case FN_DIFF0:
+			case FN_DIFF1:
+			case FN_DIFF2:
+			case FN_DIFF3:
+			case FN_QLPC:
+			{
+				int32_t coffset, *cbuffer = mBuffer[chan];
+				int resn = 0, nlpc;
+
+				if(cmd != FN_ZERO) {
+					if(!mInput->uvar_get(resn, ENERGYSIZE)) {
+						return Fail(Error::InvalidFormat);
+					}
+					/* this is a hack as version 0 differed in definition of var_get */
+					if(mVersion == 0)
+						resn--;
+				}
+
+				/* find mean offset : N.B. this code duplicated */
+				if(mNMean == 0)
+					coffset = mOffset[chan][0];
+				else
+				{
+					int32_t sum = (mVersion < 2) ? 0 : mNMean / 2;
+					for(auto i = 0; i < mNMean; i++) {
+						sum += mOffset[chan][i];
+					}
+					if(mVersion < 2)
+						coffset = sum / mNMean;
+					else
+						coffset = ROUNDEDSHIFTDOWN(sum / mNMean, mBitshift);
+				}
+
+				switch(cmd)
+				{
+					case FN_ZERO:
+						for(auto i = 0; i < mBlockSize; ++i) {
+							cbuffer[i] = 0;
+						}
+						break;
+					case FN_DIFF0:
+						for(auto i = 0; i < mBlockSize; ++i) {
+							int32_t var;
+							if(!mInput->var_get(var, (size_t)resn)) {
+								return Fail(Error::InvalidFormat);
+							}
+							cbuffer[i] = var + coffset;
+						}
+						break;
+					case FN_DIFF1:
+						for(auto i = 0; i < mBlockSize; ++i) {
+							int32_t var;
+							if(!mInput->var_get(var, (size_t)resn)) {
+								return Fail(Error::InvalidFormat);
+							}
+							cbuffer[i] = var + cbuffer[i - 1];
+						}
+						break;
+					case FN_DIFF2:
+						for(auto i = 0; i < mBlockSize; ++i) {
+							int32_t var;
+							if(!mInput->var_get(var, (size_t)resn)) {
+								return Fail(Error::InvalidFormat);
+							}
+							cbuffer[i] = var + (2 * cbuffer[i - 1] - cbuffer[i - 2]);
+						}
+						break;
+					case FN_DIFF3:
+						for(auto i = 0; i < mBlockSize; ++i) {
+							int32_t var;
+							if(!mInput->var_get(var, (size_t)resn)) {
+								return Fail(Error::InvalidFormat);
+							}
+							cbuffer[i] = var + 3 * (cbuffer[i - 1] -  cbuffer[i - 2]) + cbuffer[i - 3];
+						}
+						break;
+					case FN_QLPC:
+						if(!mInput->uvar_get(nlpc, LPCQSIZE)) {
+							return Fail(Error::InvalidFormat);
+						}
+
+						for(auto i = 0; i < nlpc; ++i) {
+							if(!mInput->var_get(mQLPC[i], LPCQUANT)) {
+								return Fail(Error::InvalidFormat);
+							}
+						}
+						for(auto i = 0; i < nlpc; ++i) {
+							cbuffer[i - nlpc] -= coffset;
+						}
+						for(auto i = 0; i < mBlockSize; ++i) {
+							int32_t sum = mLPCQOffset;
+
+							for(auto j = 0; j < nlpc; ++j) {
+								sum += mQLPC[j] * cbuffer[i - j - 1];
+							}
+							int32_t var;
+							if(!mInput->var_get(var, (size_t)resn)) {
+								return Fail(Error::InvalidFormat);
+							}
+							cbuffer[i] = var + (sum >> LPCQUANT);
+						}
+						if(coffset != 0) {
+							for(auto i = 0; i < mBlockSize; ++i) {
+								cbuffer[i] += coffset;
+							}
+						}
+						break;
+				}
+
+				/* store mean value if appropriate : N.B. Duplicated code */
+				if(mNMean > 0) {
+					int32_t sum = (mVersion < 2) ? 0 : mBlockSize / 2;
+
+					for(auto i = 0; i < mBlockSize; ++i) {
+						sum += cbuffer[i];
+					}
+
+					for(auto i = 1; i < mNMean; ++i) {
+						mOffset[chan][i - 1] = mOffset[chan][i];
+					}
+					if(mVersion < 2)
+						mOffset[chan][mNMean - 1] = sum / mBlockSize;
+					else
+						mOffset[chan][mNMean - 1] = (sum / mBlockSize) << mBitshift;
+				}
+
+				/* do the wrap */
+				for(auto i = -mNWrap; i < 0; i++) {
+					cbuffer[i] = cbuffer[i + mBlockSize];
+				}
+
+				if(mBitshift != 0) {
+					for(auto i = 0; i < mBlockSize; ++i) {
+						cbuffer[i] <<= mBitshift;
+					}
+				}
+
+				if(chan == mNChan - 1) {
+					switch(mInternalFileType) {
+						case TYPE_U8:
+						{
+							for(auto channel = 0; channel < mNChan; ++channel) {
+								auto channel_buf = (uint8_t *)mChannelBuffers[channel];
+								for(auto sample = 0; sample < mBlockSize; ++sample) {
+									channel_buf[sample] = (uint8_t)clip(mBuffer[channel][sample], 0, UINT8_MAX);
+								}
+							}
+							break;
+						}
+						case TYPE_S8:
+						{
+							for(auto channel = 0; channel < mNChan; ++channel) {
+								auto channel_buf = (int8_t *)mChannelBuffers[channel];
+								for(auto sample = 0; sample < mBlockSize; ++sample) {
+									channel_buf[sample] = (int8_t)clip(mBuffer[channel][sample], INT8_MIN, INT8_MAX);
+								}
+							}
+							break;
+						}
+						case TYPE_U16HL:
+						case TYPE_U16LH:
+						{
+							for(auto channel = 0; channel < mNChan; ++channel) {
+								auto channel_buf = (uint16_t *)mChannelBuffers[channel];
+								for(auto sample = 0; sample < mBlockSize; ++sample) {
+									channel_buf[sample] = (uint16_t)clip(mBuffer[channel][sample], 0, UINT16_MAX);
+								}
+							}
+							break;
+						}
+						case TYPE_S16HL:
+						case TYPE_S16LH:
+						{
+							for(auto channel = 0; channel < mNChan; ++channel) {
+								auto channel_buf = (int16_t *)mChannelBuffers[channel];
+								for(auto sample = 0; sample < mBlockSize; ++sample) {
+									channel_buf[sample] = (int16_t)clip(mBuffer[channel][sample], INT16_MIN, INT16_MAX);
+								}
+							}
+							break;
+						}
+					}
+
+					mFramesBuffered = static_cast<uint32_t>(mBlockSize);
+					mFrameBufferOffset = 0;
+
+					++mBlocksDecoded;
+					return true;
+				}
+				chan = (chan + 1) % mNChan;
+				break;
+			}
+
+			case FN_BLOCKSIZE:
+			{
+				uint32_t uint = 0;
+				if(!mInput->uint_get(uint, mVersion, (size_t)log2(mBlockSize)) || uint == 0 || uint > MAX_BLOCKSIZE || (int)uint > mBlockSize) {
+					os_log_error(Log(), "Invalid or unsupported block size: %u", uint);
+					return Fail(Error::InvalidFormat);
+				}
+				mBlockSize = (int)uint;
+				break;
+			}
+			case FN_BITSHIFT:
+				if(!mInput->uvar_get(mBitshift, BITSHIFTSIZE) || mBitshift > 32) {
+					os_log_error(Log(), "Invald or unsupported bitshift: %u", mBitshift);
+					return Fail(Error::InvalidFormat);
+				}
+				break;
+			case FN_VERBATIM:
+			{
+				int32_t chunk_len;
+				if(!mInput->uvar_get(chunk_len, VERBATIM_CKSIZE_SIZE) || chunk_len < 0 || chunk_len > VERBATIM_CHUNK_MAX) {
+					os_log_error(Log(), "Invald verbatim length: %u", chunk_len);
+					return Fail(Error::InvalidFormat);
+				}
+				while(chunk_len--) {
+					int32_t dummy;
+					if(!mInput->uvar_get(dummy, VERBATIM_BYTE_SIZE)) {
+						return Fail(Error::InvalidFormat);
+					}
+				}
+				break;
+			}
+
+			default:
+				os_log_error(Log(), "sanity check failed for function: %d", cmd);
+				return Fail(Error::InvalidFormat);
+		}
+	}
+
+	return true;
+}
+
+#pragma mark Seek Table Parsing
+
+// A return value of true indicates that decoding may continue, not that no errors exist with the seek table itself
+bool SFB::Audio::ShortenDecoder::ScanForSeekTable() noexcept
+{
+	// Non-seekable input source; not an error
+	if(!mInputSource->SupportsSeeking())
+		return true;
+
+	int64_t startOffset;
+	if(!mInputSource->GetOffset(startOffset))
+		return false;
+
+	int64_t fileLength;
+	if(!mInputSource->GetLength(fileLength) || !mInputSource->SeekToOffset(fileLength - SEEK_TRAILER_SIZE))
+		return false;
+
+	SeekTableTrailer trailer;
+	{
+		uint8_t buf [SEEK_TRAILER_SIZE];
+		if(!mInputSource->ReadExactly(buf, SEEK_TRAILER_SIZE))
+			return false;
+		trailer = ParseSeekTableTrailer(buf);
+	}
+
+	// No appended seek table found; not an error
+	if(memcmp("SHNAMPSK", trailer.mSignature, 8)) {
+		// Check for separate seek table
+		if(mExternalSeekTable) {
+			auto entries = ParseExternalSeekTable();
+			if(!entries.empty() && SeekTableIsValid(entries, startOffset))
+				mSeekTableEntries = std::move(entries);
+		}
+		if(!mInputSource->SeekToOffset(startOffset))
+			return false;
+		return true;
+	}
+
+	if(!mInputSource->SeekToOffset(fileLength - trailer.mSeekTableSize))
+		return false;
+
+	SeekTableHeader header;
+	{
+		uint8_t buf [SEEK_HEADER_SIZE];
+		if(!mInputSource->ReadExactly(buf, SEEK_HEADER_SIZE))
+			return false;
+		header = ParseSeekTableHeader(buf);
+	}
+
+	// A corrupt seek table is an error, however true is returned to try and permit decoding to continue
+	if(memcmp("SEEK", header.mSignature, 4)) {
+		os_log_error(Log(), "Unexpected seek table header signature: %{public}.4s", header.mSignature);
+		if(!mInputSource->SeekToOffset(startOffset))
+			return false;
+		return true;
+	}
+
+	std::vector<SeekTableEntry> entries;
+
+	auto count = (trailer.mSeekTableSize - SEEK_TRAILER_SIZE - SEEK_HEADER_SIZE) / SEEK_ENTRY_SIZE;
+	for(uint32_t i = 0; i < count; ++i) {
+		uint8_t buf [SEEK_ENTRY_SIZE];
+		if(!mInputSource->ReadExactly(buf, SEEK_ENTRY_SIZE))
+			return false;
+
+		auto entry = ParseSeekTableEntry(buf);
+		entries.push_back(entry);
+	}
+
+	// Reset file marker
+	if(!mInputSource->SeekToOffset(startOffset))
+		return false;
+
+	if(!entries.empty() && SeekTableIsValid(entries, startOffset))
+		mSeekTableEntries = std::move(entries);
+
+	return true;
+}
+
+std::vector<SFB::Audio::ShortenDecoder::SeekTableEntry> SFB::Audio::ShortenDecoder::ParseExternalSeekTable() noexcept
+{
+	assert(mExternalSeekTable != nullptr);
+
+	{
+		uint8_t buf [SEEK_HEADER_SIZE];
+		if(!mExternalSeekTable->ReadExactly(buf, SEEK_HEADER_SIZE)) {
+			os_log_error(Log(), "Error reading external seek table header");
+			return {};
+		}
+
+		auto header = ParseSeekTableHeader(buf);
+		if(memcmp("SEEK", header.mSignature, 4)) {
+			os_log_error(Log(), "Unexpected seek table header signature: %{public}.4s", header.mSignature);
+			return {};
+		}
+	}
+
+	std::vector<SeekTableEntry> entries;
+
+	for(;;) {
+		uint8_t buf [SEEK_ENTRY_SIZE];
+		if(!mExternalSeekTable->ReadExactly(buf, SEEK_ENTRY_SIZE)) {
+			os_log_error(Log(), "Error reading external seek table entry");
+			return {};
+		}
+
+		auto entry = ParseSeekTableEntry(buf);
+		entries.push_back(entry);
+
+		if(mExternalSeekTable->AtEOF())
+			break;
+	}
+
+	return entries;
+}
+
+bool SFB::Audio::ShortenDecoder::SeekTableIsValid(const std::vector<SeekTableEntry>& entries, int64_t startOffset) const noexcept
+{
+	if(entries.empty())
+		return false;
+	else if(startOffset != entries[0].mByteOffsetInFile) {
+		os_log_error(Log(), "Seek table error: Mismatch between actual data start (%ld) and start in first seek table entry (%d)", (long)startOffset, entries[0].mByteOffsetInFile);
+		return false;
+	}
+	else if(mBitshift != entries[0].mBitshift) {
+		os_log_error(Log(), "Seek table error: Invalid bitshift (%d) in first seek table entry", entries[0].mBitshift);
+		return false;
+	}
+	else if(mNChan != 1 && mNChan != 2) {
+		os_log_error(Log(), "Seek table error: Invalid channel count (%d); mono or stereo required", mNChan);
+		return false;
+	}
+	else if(mMaxNLPC > 3) {
+		os_log_error(Log(), "Seek table error: Invalid maxnlpc (%d); [0, 3] required", mMaxNLPC);
+		return false;
+	}
+	else if(mNMean > 4) {
+		os_log_error(Log(), "Seek table error: Invalid nmean (%d); [0, 4] required", mNMean);
+		return false;
+	}
+
+	return true;
+}
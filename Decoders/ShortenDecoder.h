@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "AudioDecoder.h"
+
+namespace SFB {
+	class ByteStream;
+}
+
+/*! @file ShortenDecoder.h @brief A Shorten \c Decoder */
+
+/*! @brief \c SFBAudioEngine's encompassing namespace */
+namespace SFB {
+
+	/*! @brief %Audio functionality */
+	namespace Audio {
+
+		/*! @brief A \c Decoder for Shorten */
+		class ShortenDecoder : public Decoder
+		{
+		public:
+			/*!
+			 * @brief Create a new \c ShortenDecoder
+			 * @param inputSource The source of encoded audio
+			 * @param externalSeekTable An optional source for a seek table in a separate \c .skt file, used if \c inputSource contains no seek table
+			 */
+			explicit ShortenDecoder(InputSource::unique_ptr inputSource, InputSource::unique_ptr externalSeekTable = nullptr) noexcept;
+
+			/*! @brief Destroy the \c ShortenDecoder */
+			~ShortenDecoder();
+
+			bool Open() noexcept override;
+			bool Close() noexcept override;
+			inline bool IsOpen() const noexcept override				{ return mBuffer != nullptr; }
+
+			inline bool DecodingIsLossless() const noexcept override	{ return true; }
+
+			inline int64_t FramePosition() const noexcept override		{ return mFramePosition; }
+			inline int64_t FrameLength() const noexcept override		{ return mFrameLength; }
+
+			bool Decode(AudioBufferList * const bufferList, uint32_t frameCount, uint32_t& framesDecoded) noexcept override;
+
+			bool SupportsSeeking() const noexcept override;
+			bool SeekToFrame(int64_t frame) noexcept override;
+
+		private:
+
+			/*! @internal Variable-length input using Golomb-Rice coding */
+			class VariableLengthInput;
+
+			/*! @internal A Shorten seek table entry */
+			struct SeekTableEntry;
+
+			bool ParseShortenHeader() noexcept;
+			bool ParseRIFFChunk(SFB::ByteStream& chunkData) noexcept;
+			bool ParseFORMChunk(SFB::ByteStream& chunkData) noexcept;
+			bool DecodeBlock() noexcept;
+			bool ScanForSeekTable() noexcept;
+			std::vector<SeekTableEntry> ParseExternalSeekTable() noexcept;
+			bool SeekTableIsValid(const std::vector<SeekTableEntry>& entries, int64_t startOffset) const noexcept;
+
+			static SeekTableEntry ParseSeekTableEntry(const void *buf) noexcept;
+
+			std::unique_ptr<VariableLengthInput>	mInput;
+			InputSource::unique_ptr					mExternalSeekTable;
+
+			int										mVersion;
+			int32_t									mLPCQOffset;
+			int										mInternalFileType;
+			int										mNChan;
+			int										mNMean;
+			int										mBlockSize;
+			int										mMaxNLPC;
+			int										mNWrap;
+
+			uint32_t								mSampleRate;
+			uint32_t								mBitsPerSample;
+			bool									mBigEndian;
+
+			int32_t									**mBuffer;
+			int32_t									**mOffset;
+			std::unique_ptr<int []>					mQLPC;
+			int										mBitshift;
+
+			bool									mEOS;
+			std::vector<SeekTableEntry>				mSeekTableEntries;
+
+			// Holds one decoded block
+			std::unique_ptr<uint8_t []>				mFrameBuffer;			// Storage for one decoded block
+			std::unique_ptr<uint8_t * []>			mChannelBuffers;		// Per-channel pointers into mFrameBuffer
+			uint32_t								mFramesBuffered;		// Number of frames in mFrameBuffer
+			uint32_t								mFrameBufferOffset;		// Index of the first unconsumed frame in mFrameBuffer
+
+			int64_t									mFramePosition;
+			int64_t									mFrameLength;
+			uint64_t								mBlocksDecoded;
+		};
+
+	}
+}
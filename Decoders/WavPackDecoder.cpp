@@ -0,0 +1,311 @@
+/*
+ * Copyright (c) 2011 - 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#include <algorithm>
+#include <new>
+
+#include "WavPackDecoder.h"
+
+#define BUFFER_SIZE_FRAMES 2048
+
+#pragma mark WavPack Callbacks
+
+int32_t SFB::Audio::WavPackDecoder::ReadBytesCallback(void *id, void *data, int32_t bcount)
+{
+	assert(id != nullptr);
+
+	auto decoder = static_cast<WavPackDecoder *>(id);
+
+	int64_t bytesRead;
+	if(!decoder->mInputSource->Read(data, bcount, bytesRead))
+		return -1;
+	return static_cast<int32_t>(bytesRead);
+}
+
+int64_t SFB::Audio::WavPackDecoder::GetPosCallback(void *id)
+{
+	assert(id != nullptr);
+
+	auto decoder = static_cast<WavPackDecoder *>(id);
+
+	int64_t offset;
+	if(!decoder->mInputSource->GetOffset(offset))
+		return 0;
+	return offset;
+}
+
+int SFB::Audio::WavPackDecoder::SetPosAbsCallback(void *id, int64_t pos)
+{
+	assert(id != nullptr);
+
+	auto decoder = static_cast<WavPackDecoder *>(id);
+	return !decoder->mInputSource->SeekToOffset(pos);
+}
+
+int SFB::Audio::WavPackDecoder::SetPosRelCallback(void *id, int64_t delta, int mode)
+{
+	assert(id != nullptr);
+
+	auto decoder = static_cast<WavPackDecoder *>(id);
+	auto& inputSource = *decoder->mInputSource;
+
+	if(!inputSource.SupportsSeeking())
+		return -1;
+
+	// Adjust offset as required
+	int64_t offset = delta;
+	switch(mode) {
+		case SEEK_SET:
+			// offset remains unchanged
+			break;
+		case SEEK_CUR: {
+			int64_t inputSourceOffset;
+			if(inputSource.GetOffset(inputSourceOffset))
+				offset += inputSourceOffset;
+			break;
+		}
+		case SEEK_END: {
+			int64_t inputSourceLength;
+			if(inputSource.GetLength(inputSourceLength))
+				offset += inputSourceLength;
+			break;
+		}
+	}
+
+	return !inputSource.SeekToOffset(offset);
+}
+
+// FIXME: How does one emulate ungetc when the data is non-seekable?
+// A small read buffer in WavPackDecoder would work but this function
+// only seems to be called once per file (when opening) so it may not be worthwhile
+int SFB::Audio::WavPackDecoder::PushBackByteCallback(void *id, int c)
+{
+	assert(id != nullptr);
+
+	auto decoder = static_cast<WavPackDecoder *>(id);
+	auto& inputSource = *decoder->mInputSource;
+
+	if(!inputSource.SupportsSeeking())
+		return EOF;
+
+	int64_t offset;
+	if(!inputSource.GetOffset(offset) || offset < 1)
+		return EOF;
+
+	if(!inputSource.SeekToOffset(offset - 1))
+		return EOF;
+
+	return c;
+}
+
+int64_t SFB::Audio::WavPackDecoder::GetLengthCallback(void *id)
+{
+	assert(id != nullptr);
+
+	auto decoder = static_cast<WavPackDecoder *>(id);
+
+	int64_t length;
+	if(!decoder->mInputSource->GetLength(length))
+		return -1;
+	return length;
+}
+
+int SFB::Audio::WavPackDecoder::CanSeekCallback(void *id)
+{
+	assert(id != nullptr);
+
+	auto decoder = static_cast<WavPackDecoder *>(id);
+	return static_cast<int>(decoder->mInputSource->SupportsSeeking());
+}
+
+#pragma mark Creation and Destruction
+
+SFB::Audio::WavPackDecoder::WavPackDecoder(InputSource::unique_ptr inputSource) noexcept
+	: Decoder(std::move(inputSource)), mStreamReader{}, mFramePosition(0), mFrameLength(0)
+{
+	mStreamReader.read_bytes = ReadBytesCallback;
+	mStreamReader.get_pos = GetPosCallback;
+	mStreamReader.set_pos_abs = SetPosAbsCallback;
+	mStreamReader.set_pos_rel = SetPosRelCallback;
+	mStreamReader.push_back_byte = PushBackByteCallback;
+	mStreamReader.get_length = GetLengthCallback;
+	mStreamReader.can_seek = CanSeekCallback;
+}
+
+SFB::Audio::WavPackDecoder::~WavPackDecoder()
+{
+	if(IsOpen())
+		Close();
+}
+
+#pragma mark Opening and Closing
+
+bool SFB::Audio::WavPackDecoder::Open() noexcept
+{
+	char errorBuf [80];
+
+	// Setup converter
+	std::unique_ptr<WavpackContext, ContextDeleter> wpc(WavpackOpenFileInputEx64(&mStreamReader, this, nullptr, errorBuf, OPEN_WVC | OPEN_NORMALIZE/* | OPEN_DSD_NATIVE*/, 0));
+	if(!wpc) {
+		os_log_error(Log(), "WavpackOpenFileInputEx64 failed: %{public}s", errorBuf);
+		return Fail(Error::InvalidFormat);
+	}
+
+	auto channels = static_cast<UInt32>(WavpackGetNumChannels(wpc.get()));
+	switch(channels) {
+		case 1:		mChannelLayoutTag = kAudioChannelLayoutTag_Mono;			break;
+		case 2:		mChannelLayoutTag = kAudioChannelLayoutTag_Stereo;			break;
+		case 4:		mChannelLayoutTag = kAudioChannelLayoutTag_Quadraphonic;	break;
+		default:	mChannelLayoutTag = kAudioChannelLayoutTag_Unknown | channels;	break;
+	}
+
+	// Floating-point and lossy files will be handed off in the canonical Core Audio format
+	int mode = WavpackGetMode(wpc.get());
+	if(MODE_FLOAT & mode || !(MODE_LOSSLESS & mode))
+		mProcessingFormat = Format(kCommonPCMFormatFloat32, WavpackGetSampleRate(wpc.get()), channels, false);
+	else {
+		AudioStreamBasicDescription processingStreamDescription{};
+
+		processingStreamDescription.mFormatID			= kAudioFormatLinearPCM;
+		processingStreamDescription.mFormatFlags		= kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsSignedInteger | kAudioFormatFlagIsNonInterleaved;
+
+		// Align high because Apple's AudioConverter doesn't handle low alignment
+		if(WavpackGetBitsPerSample(wpc.get()) != 32)
+			processingStreamDescription.mFormatFlags 	|= kAudioFormatFlagIsAlignedHigh;
+
+		processingStreamDescription.mSampleRate			= WavpackGetSampleRate(wpc.get());
+		processingStreamDescription.mChannelsPerFrame	= channels;
+		processingStreamDescription.mBitsPerChannel		= static_cast<UInt32>(WavpackGetBitsPerSample(wpc.get()));
+
+		processingStreamDescription.mBytesPerPacket		= 4;
+		processingStreamDescription.mFramesPerPacket	= 1;
+		processingStreamDescription.mBytesPerFrame		= processingStreamDescription.mBytesPerPacket / processingStreamDescription.mFramesPerPacket;
+
+		mProcessingFormat = processingStreamDescription;
+	}
+
+	// Set up the source format
+	AudioStreamBasicDescription sourceStreamDescription{};
+
+	sourceStreamDescription.mFormatID			= kSFBAudioFormatWavPack;
+
+	sourceStreamDescription.mSampleRate			= WavpackGetSampleRate(wpc.get());
+	sourceStreamDescription.mChannelsPerFrame	= channels;
+	sourceStreamDescription.mBitsPerChannel		= static_cast<UInt32>(WavpackGetBitsPerSample(wpc.get()));
+	sourceStreamDescription.mBytesPerPacket		= static_cast<UInt32>(WavpackGetBytesPerSample(wpc.get()));
+
+	mSourceFormat = sourceStreamDescription;
+
+	mBuffer.reset(new (std::nothrow) int32_t [static_cast<size_t>(BUFFER_SIZE_FRAMES) * channels]);
+	if(!mBuffer)
+		return Fail(Error::OutOfMemory);
+
+	mFrameLength = WavpackGetNumSamples64(wpc.get());
+	mFramePosition = 0;
+
+	mWPC = std::move(wpc);
+
+	return true;
+}
+
+bool SFB::Audio::WavPackDecoder::Close() noexcept
+{
+	mWPC.reset();
+	mBuffer.reset();
+
+	return true;
+}
+
+bool SFB::Audio::WavPackDecoder::DecodingIsLossless() const noexcept
+{
+	return (WavpackGetMode(mWPC.get()) & MODE_LOSSLESS) == MODE_LOSSLESS;
+}
+
+#pragma mark Decoding
+
+bool SFB::Audio::WavPackDecoder::Decode(AudioBufferList * const bufferList, uint32_t frameCount, uint32_t& framesDecoded) noexcept
+{
+	assert(bufferList != nullptr);
+	assert(bufferList->mNumberBuffers == mProcessingFormat.mChannelsPerFrame);
+
+	framesDecoded = 0;
+
+	const UInt32 channelCount = bufferList->mNumberBuffers;
+
+	// The samples returned are handled differently based on the file's mode
+	const int mode = WavpackGetMode(mWPC.get());
+	const int bytesPerSample = WavpackGetBytesPerSample(mWPC.get());
+
+	while(framesDecoded < frameCount) {
+		uint32_t framesToRead = std::min(frameCount - framesDecoded, static_cast<uint32_t>(BUFFER_SIZE_FRAMES));
+
+		// Wavpack uses "complete" samples (one sample across all channels), i.e. a Core Audio frame
+		uint32_t samplesRead = WavpackUnpackSamples(mWPC.get(), mBuffer.get(), framesToRead);
+
+		if(samplesRead == 0)
+			break;
+
+		// Floating point files require no special handling other than deinterleaving
+		if(mode & MODE_FLOAT) {
+			for(UInt32 channel = 0; channel < channelCount; ++channel) {
+				const float *input = reinterpret_cast<const float *>(mBuffer.get()) + channel;
+				float *output = static_cast<float *>(bufferList->mBuffers[channel].mData) + framesDecoded;
+				for(uint32_t sample = 0; sample < samplesRead; ++sample) {
+					*output++ = *input;
+					input += channelCount;
+				}
+			}
+		}
+		// Lossless files will be handed off as integers
+		else if(mode & MODE_LOSSLESS) {
+			// WavPack hands us 32-bit signed integers with the samples low-aligned
+			int shift = 8 * (4 - bytesPerSample);
+
+			// Deinterleave the 32-bit samples, shifting to high alignment
+			for(UInt32 channel = 0; channel < channelCount; ++channel) {
+				const int32_t *input = mBuffer.get() + channel;
+				int32_t *output = static_cast<int32_t *>(bufferList->mBuffers[channel].mData) + framesDecoded;
+				for(uint32_t sample = 0; sample < samplesRead; ++sample) {
+					*output++ = static_cast<int32_t>(static_cast<uint32_t>(*input) << shift);
+					input += channelCount;
+				}
+			}
+		}
+		// Convert lossy files to float
+		else {
+			float scaleFactor = static_cast<float>(static_cast<uint32_t>(1) << ((bytesPerSample * 8) - 1));
+
+			// Deinterleave the 32-bit samples and convert to float
+			for(UInt32 channel = 0; channel < channelCount; ++channel) {
+				const int32_t *input = mBuffer.get() + channel;
+				float *output = static_cast<float *>(bufferList->mBuffers[channel].mData) + framesDecoded;
+				for(uint32_t sample = 0; sample < samplesRead; ++sample) {
+					*output++ = *input / scaleFactor;
+					input += channelCount;
+				}
+			}
+		}
+
+		framesDecoded += samplesRead;
+	}
+
+	SetBufferListFrameLength(bufferList, framesDecoded);
+	mFramePosition += framesDecoded;
+
+	return true;
+}
+
+#pragma mark Seeking
+
+bool SFB::Audio::WavPackDecoder::SeekToFrame(int64_t frame) noexcept
+{
+	assert(frame >= 0);
+
+	if(!WavpackSeekSample64(mWPC.get(), frame))
+		return Fail(Error::InternalError);
+
+	mFramePosition = frame;
+	return true;
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#pragma once
+
+#include <memory>
+
+#include <wavpack/wavpack.h>
+
+#include "AudioDecoder.h"
+
+/*! @file WavPackDecoder.h @brief A WavPack \c Decoder */
+
+/*! @brief \c SFBAudioEngine's encompassing namespace */
+namespace SFB {
+
+	/*! @brief %Audio functionality */
+	namespace Audio {
+
+		/*! @brief A \c Decoder for WavPack */
+		class WavPackDecoder : public Decoder
+		{
+		public:
+			/*!
+			 * @brief Create a new \c WavPackDecoder
+			 * @param inputSource The source of encoded audio
+			 */
+			explicit WavPackDecoder(InputSource::unique_ptr inputSource) noexcept;
+
+			/*! @brief Destroy the \c WavPackDecoder */
+			~WavPackDecoder();
+
+			bool Open() noexcept override;
+			bool Close() noexcept override;
+			inline bool IsOpen() const noexcept override				{ return mWPC != nullptr; }
+
+			bool DecodingIsLossless() const noexcept override;
+
+			inline int64_t FramePosition() const noexcept override		{ return mFramePosition; }
+			inline int64_t FrameLength() const noexcept override		{ return mFrameLength; }
+
+			bool Decode(AudioBufferList * const bufferList, uint32_t frameCount, uint32_t& framesDecoded) noexcept override;
+
+			bool SeekToFrame(int64_t frame) noexcept override;
+
+		private:
+
+			/*! @internal Deleter for \c WavpackContext */
+			struct ContextDeleter {
+				inline void operator()(WavpackContext *wpc) const noexcept { WavpackCloseFile(wpc); }
+			};
+
+			static int32_t ReadBytesCallback(void *id, void *data, int32_t bcount);
+			static int64_t GetPosCallback(void *id);
+			static int SetPosAbsCallback(void *id, int64_t pos);
+			static int SetPosRelCallback(void *id, int64_t delta, int mode);
+			static int PushBackByteCallback(void *id, int c);
+			static int64_t GetLengthCallback(void *id);
+			static int CanSeekCallback(void *id);
+
+			WavpackStreamReader64						mStreamReader;
+			std::unique_ptr<WavpackContext, ContextDeleter>	mWPC;
+			std::unique_ptr<int32_t []>					mBuffer;				// Interleaved samples from WavpackUnpackSamples
+			int64_t										mFramePosition;
+			int64_t										mFrameLength;
+		};
+
+	}
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020 Stephen F. Booth <me@sbooth.org>
+ * Copyright (c) 2020 - 2021 Stephen F. Booth <me@sbooth.org>
  * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
  */
 
@@ -139,12 +139,38 @@ typedef NS_ERROR_ENUM(SFBAudioEncoderErrorDomain, SFBAudioEncoderErrorCode) {
 	SFBAudioEncoderErrorCodeInvalidFormat	= 2
 } NS_SWIFT_NAME(AudioEncoder.ErrorCode);
 
+#pragma mark - Dither Settings
+
+/// Dither applied when \c SFBAudioConverter reduces audio to a bit depth of 24 or less (\c SFBAudioEncodingSettingsValueDither)
+///
+/// Dither is applied only when the decoder's audio is floating point or has a greater bit depth than the encoder's
+/// integer processing format. If this key is absent, \c SFBAudioEncodingSettingsValueDitherTPDF is used.
+extern SFBAudioEncodingSettingsKey const SFBAudioEncodingSettingsKeyDither;
+
+/// Constant type for dither and noise shaping
+typedef SFBAudioEncodingSettingsValue SFBAudioEncodingSettingsValueDither NS_TYPED_ENUM NS_SWIFT_NAME(Dither);
+
+/// No dither; the audio is requantized by \c AVAudioConverter using its default rounding
+extern SFBAudioEncodingSettingsValueDither const SFBAudioEncodingSettingsValueDitherNone;
+/// Triangular probability density function dither without noise shaping
+extern SFBAudioEncodingSettingsValueDither const SFBAudioEncodingSettingsValueDitherTPDF;
+/// TPDF dither with first-order highpass noise shaping
+extern SFBAudioEncodingSettingsValueDither const SFBAudioEncodingSettingsValueDitherTPDFHighpass;
+/// TPDF dither with Lipshitz five-tap E-weighted noise shaping
+/// @note Highpass noise shaping is used at sample rates other than 44.1 kHz and 48 kHz
+extern SFBAudioEncodingSettingsValueDither const SFBAudioEncodingSettingsValueDitherLipshitz;
+/// TPDF dither with Wannamaker nine-tap F-weighted noise shaping
+/// @note Highpass noise shaping is used at sample rates other than 44.1 kHz and 48 kHz
+extern SFBAudioEncodingSettingsValueDither const SFBAudioEncodingSettingsValueDitherWannamaker;
+
 #pragma mark - FLAC Encoder Settings
 
 /// FLAC compression level (\c NSNumber from 1 (lowest) to 8 (highest))
 extern SFBAudioEncodingSettingsKey const SFBAudioEncodingSettingsKeyFLACCompressionLevel;
 /// Set to nonzero to verify FLAC encoding (\c NSNumber)
 extern SFBAudioEncodingSettingsKey const SFBAudioEncodingSettingsKeyFLACVerifyEncoding;
+/// Number of threads to use for FLAC encoding (\c NSNumber, 0 to use all active processors)
+extern SFBAudioEncodingSettingsKey const SFBAudioEncodingSettingsKeyFLACThreads;
 
 #pragma mark - Monkey's Audio Encoder Settings
 
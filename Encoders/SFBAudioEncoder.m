@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020 Stephen F. Booth <me@sbooth.org>
+ * Copyright (c) 2020 - 2021 Stephen F. Booth <me@sbooth.org>
  * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
  */
 
@@ -13,6 +13,14 @@
 // NSError domain for AudioEncoder and subclasses
 NSErrorDomain const SFBAudioEncoderErrorDomain = @"org.sbooth.AudioEngine.AudioEncoder";
 
+SFBAudioEncodingSettingsKey const SFBAudioEncodingSettingsKeyDither = @"Dither";
+
+SFBAudioEncodingSettingsValueDither const SFBAudioEncodingSettingsValueDitherNone = @"None";
+SFBAudioEncodingSettingsValueDither const SFBAudioEncodingSettingsValueDitherTPDF = @"TPDF";
+SFBAudioEncodingSettingsValueDither const SFBAudioEncodingSettingsValueDitherTPDFHighpass = @"TPDF Highpass";
+SFBAudioEncodingSettingsValueDither const SFBAudioEncodingSettingsValueDitherLipshitz = @"Lipshitz";
+SFBAudioEncodingSettingsValueDither const SFBAudioEncodingSettingsValueDitherWannamaker = @"Wannamaker";
+
 os_log_t gSFBAudioEncoderLog = NULL;
 
 static void SFBCreateAudioEncoderLog(void) __attribute__ ((constructor));
@@ -1,11 +1,16 @@
 /*
- * Copyright (c) 2020 Stephen F. Booth <me@sbooth.org>
+ * Copyright (c) 2020 - 2021 Stephen F. Booth <me@sbooth.org>
  * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
  */
 
 #import <os/log.h>
 
+#import <algorithm>
+#import <atomic>
 #import <memory>
+#import <vector>
+
+#import <CommonCrypto/CommonDigest.h>
 
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wquoted-include-in-framework-header"
@@ -18,11 +23,13 @@
 #import "SFBFLACEncoder.h"
 
 #define DEFAULT_PADDING 8192
+#define FRAMES_PER_CHUNK 32
 
 SFBAudioEncoderName const SFBAudioEncoderNameFLAC = @"org.sbooth.AudioEngine.Encoder.FLAC";
 
 SFBAudioEncodingSettingsKey const SFBAudioEncodingSettingsKeyFLACCompressionLevel = @"Compression Level";
 SFBAudioEncodingSettingsKey const SFBAudioEncodingSettingsKeyFLACVerifyEncoding = @"Verify Encoding";
+SFBAudioEncodingSettingsKey const SFBAudioEncodingSettingsKeyFLACThreads = @"Threads";
 
 template <>
 struct ::std::default_delete<FLAC__StreamEncoder> {
@@ -40,6 +47,281 @@ struct ::std::default_delete<FLAC__StreamMetadata> {
 	void operator()(FLAC__StreamMetadata *metadata) const noexcept { FLAC__metadata_object_delete(metadata); }
 };
 
+namespace {
+
+	/// Encoder parameters shared by all chunks in a frame-parallel encode
+	struct ChunkConfiguration {
+		uint32_t mSampleRate;
+		uint32_t mChannels;
+		uint32_t mBitsPerSample;
+		uint32_t mBlocksize;
+		int mCompressionLevel;		// -1 for the libFLAC default
+		bool mVerify;
+	};
+
+	/// The location of an encoded frame in \c Chunk::mData
+	struct ChunkFrame {
+		size_t mOffset;
+		uint32_t mSize;
+		uint32_t mSamples;
+	};
+
+	/// A run of audio encoded independently of the rest of the stream
+	///
+	/// Every chunk except the last holds exactly \c FRAMES_PER_CHUNK blocks so the frames of all chunks may be concatenated
+	struct Chunk {
+		std::vector<FLAC__int32> mSamples;		// Interleaved input
+		uint32_t mFrameLength;					// Number of audio frames in mSamples
+		uint32_t mFirstFrameNumber;				// FLAC frame number of the chunk's first encoded frame
+		std::vector<FLAC__byte> mMD5Input;		// mSamples packed for the STREAMINFO MD5
+		std::vector<FLAC__byte> mData;			// Encoded frames, renumbered for their position in the stream
+		std::vector<ChunkFrame> mFrames;		// Encoded frame locations
+		bool mSucceeded;
+	};
+
+	/// Lookup tables for the FLAC frame header CRC-8 (polynomial 0x07) and frame CRC-16 (polynomial 0x8005)
+	struct CRCTables {
+		uint8_t mCRC8 [256];
+		uint16_t mCRC16 [256];
+
+		CRCTables() noexcept
+		{
+			for(unsigned i = 0; i < 256; ++i) {
+				unsigned crc8 = i;
+				unsigned crc16 = i << 8;
+				for(int bit = 0; bit < 8; ++bit) {
+					crc8 = crc8 & 0x80 ? (crc8 << 1) ^ 0x07 : crc8 << 1;
+					crc16 = crc16 & 0x8000 ? (crc16 << 1) ^ 0x8005 : crc16 << 1;
+				}
+				mCRC8[i] = static_cast<uint8_t>(crc8);
+				mCRC16[i] = static_cast<uint16_t>(crc16);
+			}
+		}
+	};
+
+	const CRCTables& SharedCRCTables() noexcept
+	{
+		static const CRCTables tables;
+		return tables;
+	}
+
+	uint8_t CRC8(const FLAC__byte *data, size_t length) noexcept
+	{
+		const auto& table = SharedCRCTables().mCRC8;
+		uint8_t crc = 0;
+		while(length--)
+			crc = table[crc ^ *data++];
+		return crc;
+	}
+
+	uint16_t CRC16(const FLAC__byte *data, size_t length) noexcept
+	{
+		const auto& table = SharedCRCTables().mCRC16;
+		uint16_t crc = 0;
+		while(length--)
+			crc = static_cast<uint16_t>((crc << 8) ^ table[(crc >> 8) ^ *data++]);
+		return crc;
+	}
+
+	/// Returns the length of the UTF-8 style coded number beginning with \c leadingByte or 0 if invalid
+	size_t CodedNumberLength(FLAC__byte leadingByte) noexcept
+	{
+		if(!(leadingByte & 0x80))
+			return 1;
+		else if((leadingByte & 0xe0) == 0xc0)
+			return 2;
+		else if((leadingByte & 0xf0) == 0xe0)
+			return 3;
+		else if((leadingByte & 0xf8) == 0xf0)
+			return 4;
+		else if((leadingByte & 0xfc) == 0xf8)
+			return 5;
+		else if((leadingByte & 0xfe) == 0xfc)
+			return 6;
+		else if(leadingByte == 0xfe)
+			return 7;
+		return 0;
+	}
+
+	void AppendCodedNumber(std::vector<FLAC__byte>& buffer, FLAC__uint64 value)
+	{
+		if(value < 0x80) {
+			buffer.push_back(static_cast<FLAC__byte>(value));
+			return;
+		}
+
+		size_t continuationBytes;
+		FLAC__byte leadingByte;
+		if(value < 0x800)				{ continuationBytes = 1; leadingByte = 0xc0; }
+		else if(value < 0x10000)		{ continuationBytes = 2; leadingByte = 0xe0; }
+		else if(value < 0x200000)		{ continuationBytes = 3; leadingByte = 0xf0; }
+		else if(value < 0x4000000)		{ continuationBytes = 4; leadingByte = 0xf8; }
+		else if(value < 0x80000000)		{ continuationBytes = 5; leadingByte = 0xfc; }
+		else							{ continuationBytes = 6; leadingByte = 0xfe; }
+
+		buffer.push_back(static_cast<FLAC__byte>(leadingByte | (value >> (6 * continuationBytes))));
+		while(continuationBytes--)
+			buffer.push_back(static_cast<FLAC__byte>(0x80 | ((value >> (6 * continuationBytes)) & 0x3f)));
+	}
+
+	/// Appends \c frame to \c buffer with its frame number replaced by \c frameNumber and its CRCs recomputed
+	bool AppendRenumberedFrame(std::vector<FLAC__byte>& buffer, const FLAC__byte *frame, size_t length, FLAC__uint64 frameNumber)
+	{
+		// The header is sync code and flags (4 bytes), the coded frame number, optional block size and sample rate, and CRC-8
+		if(length < 5)
+			return false;
+
+		auto codedNumberLength = CodedNumberLength(frame[4]);
+		if(codedNumberLength == 0)
+			return false;
+
+		auto blocksizeCode = frame[2] >> 4;
+		auto sampleRateCode = frame[2] & 0x0f;
+
+		size_t optionalFieldsLength = 0;
+		if(blocksizeCode == 6)
+			optionalFieldsLength += 1;
+		else if(blocksizeCode == 7)
+			optionalFieldsLength += 2;
+		if(sampleRateCode == 12)
+			optionalFieldsLength += 1;
+		else if(sampleRateCode == 13 || sampleRateCode == 14)
+			optionalFieldsLength += 2;
+
+		auto optionalFieldsOffset = 4 + codedNumberLength;
+		auto crc8Offset = optionalFieldsOffset + optionalFieldsLength;
+		if(crc8Offset + 1 + 2 > length)
+			return false;
+
+		auto start = buffer.size();
+		buffer.insert(buffer.end(), frame, frame + 4);
+		AppendCodedNumber(buffer, frameNumber);
+		buffer.insert(buffer.end(), frame + optionalFieldsOffset, frame + crc8Offset);
+		buffer.push_back(CRC8(buffer.data() + start, buffer.size() - start));
+
+		// Subframes and zero padding, excluding the original CRC-16
+		buffer.insert(buffer.end(), frame + crc8Offset + 1, frame + length - 2);
+		auto crc16 = CRC16(buffer.data() + start, buffer.size() - start);
+		buffer.push_back(static_cast<FLAC__byte>(crc16 >> 8));
+		buffer.push_back(static_cast<FLAC__byte>(crc16));
+
+		return true;
+	}
+
+	/// Packs \c count samples as little-endian signed integers of \c bytesPerSample bytes, as used by the STREAMINFO MD5
+	void PackSamplesForMD5(const FLAC__int32 *src, FLAC__byte *dst, size_t count, uint32_t bytesPerSample) noexcept
+	{
+		for(size_t i = 0; i < count; ++i) {
+			auto sample = static_cast<uint32_t>(src[i]);
+			for(uint32_t j = 0; j < bytesPerSample; ++j)
+				*dst++ = static_cast<FLAC__byte>(sample >> (8 * j));
+		}
+	}
+
+	void AppendBigEndian(std::vector<FLAC__byte>& buffer, FLAC__uint64 value, size_t bytes)
+	{
+		while(bytes--)
+			buffer.push_back(static_cast<FLAC__byte>(value >> (8 * bytes)));
+	}
+
+	void AppendMetadataBlockHeader(std::vector<FLAC__byte>& buffer, FLAC__MetadataType type, bool isLast, uint32_t length)
+	{
+		buffer.push_back(static_cast<FLAC__byte>((isLast ? 0x80 : 0) | type));
+		AppendBigEndian(buffer, length, 3);
+	}
+
+	/// Appends the body of a STREAMINFO metadata block
+	void AppendStreamInfo(std::vector<FLAC__byte>& buffer, const FLAC__StreamMetadata_StreamInfo& streamInfo)
+	{
+		AppendBigEndian(buffer, streamInfo.min_blocksize, 2);
+		AppendBigEndian(buffer, streamInfo.max_blocksize, 2);
+		AppendBigEndian(buffer, streamInfo.min_framesize, 3);
+		AppendBigEndian(buffer, streamInfo.max_framesize, 3);
+		// Sample rate (20 bits), channels - 1 (3 bits), bits per sample - 1 (5 bits), and total samples (36 bits)
+		FLAC__uint64 packed = static_cast<FLAC__uint64>(streamInfo.sample_rate) << 44;
+		packed |= static_cast<FLAC__uint64>(streamInfo.channels - 1) << 41;
+		packed |= static_cast<FLAC__uint64>(streamInfo.bits_per_sample - 1) << 36;
+		packed |= streamInfo.total_samples & 0xfffffffff;
+		AppendBigEndian(buffer, packed, 8);
+		buffer.insert(buffer.end(), streamInfo.md5sum, streamInfo.md5sum + 16);
+	}
+
+	/// Appends the body of a SEEKTABLE metadata block
+	void AppendSeekTable(std::vector<FLAC__byte>& buffer, const FLAC__StreamMetadata_SeekTable& seekTable)
+	{
+		for(uint32_t i = 0; i < seekTable.num_points; ++i) {
+			AppendBigEndian(buffer, seekTable.points[i].sample_number, 8);
+			AppendBigEndian(buffer, seekTable.points[i].stream_offset, 8);
+			AppendBigEndian(buffer, seekTable.points[i].frame_samples, 2);
+		}
+	}
+
+	FLAC__StreamEncoderWriteStatus chunk_write_callback(const FLAC__StreamEncoder *encoder, const FLAC__byte buffer[], size_t bytes, uint32_t samples, uint32_t current_frame, void *client_data)
+	{
+#pragma unused(encoder)
+		NSCParameterAssert(client_data != nullptr);
+
+		auto chunk = static_cast<Chunk *>(client_data);
+
+		// The stream marker and metadata are written separately
+		if(samples == 0)
+			return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
+
+		auto offset = chunk->mData.size();
+		if(chunk->mFirstFrameNumber == 0)
+			chunk->mData.insert(chunk->mData.end(), buffer, buffer + bytes);
+		else if(!AppendRenumberedFrame(chunk->mData, buffer, bytes, static_cast<FLAC__uint64>(chunk->mFirstFrameNumber) + current_frame))
+			return FLAC__STREAM_ENCODER_WRITE_STATUS_FATAL_ERROR;
+
+		chunk->mFrames.push_back({ offset, static_cast<uint32_t>(chunk->mData.size() - offset), samples });
+
+		return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
+	}
+
+	/// Encodes \c chunk with a dedicated encoder
+	bool EncodeChunk(Chunk& chunk, const ChunkConfiguration& configuration)
+	{
+		auto bytesPerSample = configuration.mBitsPerSample / 8;
+		auto sampleCount = static_cast<size_t>(chunk.mFrameLength) * configuration.mChannels;
+		chunk.mMD5Input.resize(sampleCount * bytesPerSample);
+		PackSamplesForMD5(chunk.mSamples.data(), chunk.mMD5Input.data(), sampleCount, bytesPerSample);
+
+		auto flac = std::unique_ptr<FLAC__StreamEncoder>(FLAC__stream_encoder_new());
+		if(!flac)
+			return false;
+
+		FLAC__stream_encoder_set_sample_rate(flac.get(), configuration.mSampleRate);
+		FLAC__stream_encoder_set_channels(flac.get(), configuration.mChannels);
+		FLAC__stream_encoder_set_bits_per_sample(flac.get(), configuration.mBitsPerSample);
+		if(configuration.mCompressionLevel >= 0)
+			FLAC__stream_encoder_set_compression_level(flac.get(), static_cast<uint32_t>(configuration.mCompressionLevel));
+		FLAC__stream_encoder_set_blocksize(flac.get(), configuration.mBlocksize);
+		FLAC__stream_encoder_set_verify(flac.get(), configuration.mVerify);
+		FLAC__stream_encoder_set_do_md5(flac.get(), false);
+
+		if(FLAC__stream_encoder_init_stream(flac.get(), chunk_write_callback, nullptr, nullptr, nullptr, &chunk) != FLAC__STREAM_ENCODER_INIT_STATUS_OK) {
+			os_log_error(gSFBAudioEncoderLog, "FLAC__stream_encoder_init_stream failed: %{public}s", FLAC__stream_encoder_get_resolved_state_string(flac.get()));
+			return false;
+		}
+
+		if(!FLAC__stream_encoder_process_interleaved(flac.get(), chunk.mSamples.data(), chunk.mFrameLength)) {
+			os_log_error(gSFBAudioEncoderLog, "FLAC__stream_encoder_process_interleaved failed: %{public}s", FLAC__stream_encoder_get_resolved_state_string(flac.get()));
+			return false;
+		}
+
+		if(!FLAC__stream_encoder_finish(flac.get())) {
+			os_log_error(gSFBAudioEncoderLog, "FLAC__stream_encoder_finish failed: %{public}s", FLAC__stream_encoder_get_resolved_state_string(flac.get()));
+			return false;
+		}
+
+		// The input is no longer needed
+		chunk.mSamples = std::vector<FLAC__int32>();
+
+		return true;
+	}
+
+}
+
 @interface SFBFLACEncoder ()
 {
 @private
@@ -47,6 +329,21 @@ struct ::std::default_delete<FLAC__StreamMetadata> {
 	std::unique_ptr<FLAC__StreamMetadata> _seektable;
 	std::unique_ptr<FLAC__StreamMetadata> _padding;
 	FLAC__StreamMetadata *_metadata [2];
+	// Frame-parallel encoding, used when multiple threads are requested but libFLAC can't provide them
+	BOOL _frameParallel;
+	ChunkConfiguration _chunkConfiguration;
+	std::shared_ptr<Chunk> _chunk;
+	uint32_t _chunksDispatched;
+	dispatch_queue_t _writeQueue;
+	dispatch_semaphore_t _chunkSemaphore;
+	std::atomic<bool> _pipelineFailed;
+	// Accessed only on _writeQueue while encoding
+	CC_MD5_CTX _md5;
+	FLAC__StreamMetadata_StreamInfo _streamInfo;
+	FLAC__uint64 _bytesWritten;
+	uint32_t _firstSeekPointToCheck;
+	NSInteger _streamInfoOffset;
+	NSInteger _seekTableOffset;
 @package
 	AVAudioFramePosition _framePosition;
 }
@@ -243,6 +540,7 @@ static void metadata_callback(const FLAC__StreamEncoder *encoder, const FLAC__St
 	}
 
 	// Encoder compression level
+	int resolvedCompressionLevel = -1;
 	NSNumber *compressionLevel = [_settings objectForKey:SFBAudioEncodingSettingsKeyFLACCompressionLevel];
 	if(compressionLevel != nil) {
 		unsigned int value = compressionLevel.unsignedIntValue;
@@ -254,6 +552,7 @@ static void metadata_callback(const FLAC__StreamEncoder *encoder, const FLAC__St
 						*error = [NSError errorWithDomain:SFBAudioEncoderErrorDomain code:SFBAudioEncoderErrorCodeInternalError userInfo:nil];
 					return NO;
 				}
+				resolvedCompressionLevel = (int)value;
 				break;
 			default:
 				os_log_info(gSFBAudioEncoderLog, "Ignoring invalid FLAC compression level: %d", value);
@@ -273,6 +572,28 @@ static void metadata_callback(const FLAC__StreamEncoder *encoder, const FLAC__St
 
 	}
 
+	// Multithreaded encoding
+	NSUInteger threadCount = 1;
+	NSNumber *threads = [_settings objectForKey:SFBAudioEncodingSettingsKeyFLACThreads];
+	if(threads != nil) {
+		threadCount = threads.unsignedIntegerValue;
+		if(threadCount == 0)
+			threadCount = NSProcessInfo.processInfo.activeProcessorCount;
+	}
+
+	BOOL frameParallel = NO;
+	if(threadCount > 1) {
+#if defined(FLAC_API_VERSION_CURRENT) && FLAC_API_VERSION_CURRENT >= 14
+		uint32_t status = FLAC__stream_encoder_set_num_threads(flac.get(), (uint32_t)threadCount);
+		if(status != FLAC__STREAM_ENCODER_SET_NUM_THREADS_OK) {
+			os_log_info(gSFBAudioEncoderLog, "FLAC__stream_encoder_set_num_threads(%u) failed (%u); using frame-parallel encoding", (uint32_t)threadCount, status);
+			frameParallel = YES;
+		}
+#else
+		frameParallel = YES;
+#endif
+	}
+
 	// Create the padding metadata block
 	auto padding = std::unique_ptr<FLAC__StreamMetadata>(FLAC__metadata_object_new(FLAC__METADATA_TYPE_PADDING));
 	if(!padding) {
@@ -316,22 +637,62 @@ static void metadata_callback(const FLAC__StreamEncoder *encoder, const FLAC__St
 	if(seektable)
 		_metadata[1] = seektable.get();
 
-	if(!FLAC__stream_encoder_set_metadata(flac.get(), _metadata, seektable ? 2 : 1)) {
-		os_log_error(gSFBAudioEncoderLog, "FLAC__stream_encoder_set_metadata failed: %{public}s", FLAC__stream_encoder_get_resolved_state_string(flac.get()));
-		if(error)
-			*error = [NSError errorWithDomain:SFBAudioEncoderErrorDomain code:SFBAudioEncoderErrorCodeInternalError userInfo:nil];
-		return NO;
+	if(frameParallel) {
+		// Chunks are encoded by independent encoders configured identically to flac, which is never initialized
+		_chunkConfiguration.mSampleRate = (uint32_t)_processingFormat.sampleRate;
+		_chunkConfiguration.mChannels = _processingFormat.channelCount;
+		_chunkConfiguration.mBitsPerSample = _processingFormat.streamDescription->mBitsPerChannel;
+		_chunkConfiguration.mBlocksize = FLAC__stream_encoder_get_blocksize(flac.get());
+		_chunkConfiguration.mCompressionLevel = resolvedCompressionLevel;
+		_chunkConfiguration.mVerify = FLAC__stream_encoder_get_verify(flac.get());
+
+		_streamInfo = {};
+		_streamInfo.min_blocksize = _chunkConfiguration.mBlocksize;
+		_streamInfo.max_blocksize = _chunkConfiguration.mBlocksize;
+		_streamInfo.sample_rate = _chunkConfiguration.mSampleRate;
+		_streamInfo.channels = _chunkConfiguration.mChannels;
+		_streamInfo.bits_per_sample = _chunkConfiguration.mBitsPerSample;
+
+		if(![self writeStreamHeaderWithPadding:padding.get() seekTable:seektable.get() error:error])
+			return NO;
+
+		CC_MD5_Init(&_md5);
+		_bytesWritten = 0;
+		_firstSeekPointToCheck = 0;
+		_chunksDispatched = 0;
+		_pipelineFailed = false;
+
+		_writeQueue = dispatch_queue_create("org.sbooth.AudioEngine.Encoder.FLAC.Writer", DISPATCH_QUEUE_SERIAL);
+		// Bound the number of chunks held in memory
+		_chunkSemaphore = dispatch_semaphore_create((long)threadCount + 1);
+		if(!_writeQueue || !_chunkSemaphore) {
+			os_log_error(gSFBAudioEncoderLog, "Unable to create frame-parallel encoding resources");
+			if(error)
+				*error = [NSError errorWithDomain:SFBAudioEncoderErrorDomain code:SFBAudioEncoderErrorCodeInternalError userInfo:nil];
+			return NO;
+		}
 	}
+	else {
+		if(!FLAC__stream_encoder_set_metadata(flac.get(), _metadata, seektable ? 2 : 1)) {
+			os_log_error(gSFBAudioEncoderLog, "FLAC__stream_encoder_set_metadata failed: %{public}s", FLAC__stream_encoder_get_resolved_state_string(flac.get()));
+			if(error)
+				*error = [NSError errorWithDomain:SFBAudioEncoderErrorDomain code:SFBAudioEncoderErrorCodeInternalError userInfo:nil];
+			return NO;
+		}
 
-	// Initialize the FLAC encoder
-	FLAC__StreamEncoderInitStatus encoderStatus = FLAC__stream_encoder_init_stream(flac.get(), write_callback, seek_callback, tell_callback, metadata_callback, (__bridge void *)self);
-	if(encoderStatus != FLAC__STREAM_ENCODER_INIT_STATUS_OK) {
-		os_log_error(gSFBAudioEncoderLog, "FLAC__stream_encoder_init_stream failed: %{public}s", FLAC__stream_encoder_get_resolved_state_string(flac.get()));
-		if(error)
-			*error = [NSError errorWithDomain:SFBAudioEncoderErrorDomain code:SFBAudioEncoderErrorCodeInternalError userInfo:nil];
-		return NO;
+		// Initialize the FLAC encoder
+		FLAC__StreamEncoderInitStatus encoderStatus = FLAC__stream_encoder_init_stream(flac.get(), write_callback, seek_callback, tell_callback, metadata_callback, (__bridge void *)self);
+		if(encoderStatus != FLAC__STREAM_ENCODER_INIT_STATUS_OK) {
+			os_log_error(gSFBAudioEncoderLog, "FLAC__stream_encoder_init_stream failed: %{public}s", FLAC__stream_encoder_get_resolved_state_string(flac.get()));
+			if(error)
+				*error = [NSError errorWithDomain:SFBAudioEncoderErrorDomain code:SFBAudioEncoderErrorCodeInternalError userInfo:nil];
+			return NO;
+		}
 	}
 
+	_frameParallel = frameParallel;
+	_framePosition = 0;
+
 	AudioStreamBasicDescription outputStreamDescription{};
 	outputStreamDescription.mFormatID			= kAudioFormatFLAC;
 	outputStreamDescription.mSampleRate			= _processingFormat.sampleRate;
@@ -363,6 +724,18 @@ static void metadata_callback(const FLAC__StreamEncoder *encoder, const FLAC__St
 
 - (BOOL)closeReturningError:(NSError **)error
 {
+	if(_frameParallel) {
+		// Wait for outstanding chunks and return the permit held by a partially filled chunk
+		dispatch_sync(_writeQueue, ^{});
+		if(_chunk) {
+			_chunk.reset();
+			dispatch_semaphore_signal(_chunkSemaphore);
+		}
+		_writeQueue = nil;
+		_chunkSemaphore = nil;
+		_frameParallel = NO;
+	}
+
 	_flac.reset();
 	_seektable.reset();
 	_padding.reset();
@@ -391,6 +764,41 @@ static void metadata_callback(const FLAC__StreamEncoder *encoder, const FLAC__St
 	if(frameLength == 0)
 		return YES;
 
+	if(_frameParallel) {
+		const auto channels = _chunkConfiguration.mChannels;
+		const auto chunkCapacity = _chunkConfiguration.mBlocksize * FRAMES_PER_CHUNK;
+		auto input = (const FLAC__int32 *)buffer.audioBufferList->mBuffers[0].mData;
+		AVAudioFrameCount framesRemaining = frameLength;
+
+		while(framesRemaining > 0) {
+			if(_pipelineFailed) {
+				if(error)
+					*error = [NSError errorWithDomain:SFBAudioEncoderErrorDomain code:SFBAudioEncoderErrorCodeInternalError userInfo:nil];
+				return NO;
+			}
+
+			if(!_chunk) {
+				dispatch_semaphore_wait(_chunkSemaphore, DISPATCH_TIME_FOREVER);
+				_chunk = std::make_shared<Chunk>();
+				_chunk->mSamples.reserve(static_cast<size_t>(chunkCapacity) * channels);
+				_chunk->mFrameLength = 0;
+			}
+
+			auto framesToCopy = std::min(framesRemaining, chunkCapacity - _chunk->mFrameLength);
+			_chunk->mSamples.insert(_chunk->mSamples.end(), input, input + static_cast<size_t>(framesToCopy) * channels);
+			_chunk->mFrameLength += framesToCopy;
+
+			input += static_cast<size_t>(framesToCopy) * channels;
+			framesRemaining -= framesToCopy;
+
+			if(_chunk->mFrameLength == chunkCapacity)
+				[self dispatchChunk];
+		}
+
+		_framePosition += frameLength;
+		return YES;
+	}
+
 	if(!FLAC__stream_encoder_process_interleaved(_flac.get(), (const FLAC__int32 *)buffer.audioBufferList->mBuffers[0].mData, frameLength)) {
 		os_log_error(gSFBAudioEncoderLog, "FLAC__stream_encoder_process_interleaved failed: %{public}s", FLAC__stream_encoder_get_resolved_state_string(_flac.get()));
 		if(error)
@@ -403,6 +811,9 @@ static void metadata_callback(const FLAC__StreamEncoder *encoder, const FLAC__St
 
 - (BOOL)finishEncodingReturningError:(NSError **)error
 {
+	if(_frameParallel)
+		return [self finishFrameParallelEncodingReturningError:error];
+
 	if(!FLAC__stream_encoder_finish(_flac.get())) {
 		os_log_error(gSFBAudioEncoderLog, "FLAC__stream_encoder_finish failed: %{public}s", FLAC__stream_encoder_get_resolved_state_string(_flac.get()));
 		if(error)
@@ -412,4 +823,165 @@ static void metadata_callback(const FLAC__StreamEncoder *encoder, const FLAC__St
 	return YES;
 }
 
+#pragma mark Frame-Parallel Encoding
+
+- (BOOL)writeStreamHeaderWithPadding:(const FLAC__StreamMetadata *)padding seekTable:(const FLAC__StreamMetadata *)seekTable error:(NSError **)error
+{
+	std::vector<FLAC__byte> header;
+	header.reserve(FLAC__STREAM_SYNC_LENGTH + 4 + FLAC__STREAM_METADATA_STREAMINFO_LENGTH + 4 + padding->length);
+
+	header.insert(header.end(), FLAC__STREAM_SYNC_STRING, FLAC__STREAM_SYNC_STRING + FLAC__STREAM_SYNC_LENGTH);
+
+	AppendMetadataBlockHeader(header, FLAC__METADATA_TYPE_STREAMINFO, false, FLAC__STREAM_METADATA_STREAMINFO_LENGTH);
+	_streamInfoOffset = (NSInteger)header.size();
+	AppendStreamInfo(header, _streamInfo);
+
+	AppendMetadataBlockHeader(header, FLAC__METADATA_TYPE_PADDING, seekTable == nullptr, padding->length);
+	header.insert(header.end(), padding->length, 0);
+
+	_seekTableOffset = 0;
+	if(seekTable) {
+		AppendMetadataBlockHeader(header, FLAC__METADATA_TYPE_SEEKTABLE, true, seekTable->length);
+		_seekTableOffset = (NSInteger)header.size();
+		AppendSeekTable(header, seekTable->data.seek_table);
+	}
+
+	NSInteger bytesWritten;
+	if(![_outputSource writeBytes:header.data() length:(NSInteger)header.size() bytesWritten:&bytesWritten error:error] || bytesWritten != (NSInteger)header.size()) {
+		os_log_error(gSFBAudioEncoderLog, "Error writing FLAC stream header");
+		return NO;
+	}
+
+	return YES;
+}
+
+- (void)dispatchChunk
+{
+	auto chunk = std::move(_chunk);
+	chunk->mFirstFrameNumber = _chunksDispatched++ * FRAMES_PER_CHUNK;
+	const auto configuration = _chunkConfiguration;
+
+	dispatch_group_t group = dispatch_group_create();
+	dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+		chunk->mSucceeded = EncodeChunk(*chunk, configuration);
+	});
+
+	// Chunks are written in the order they were dispatched
+	dispatch_async(_writeQueue, ^{
+		dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+		[self writeChunk:*chunk];
+		dispatch_semaphore_signal(self->_chunkSemaphore);
+	});
+}
+
+- (void)writeChunk:(Chunk&)chunk
+{
+	if(_pipelineFailed)
+		return;
+
+	if(!chunk.mSucceeded) {
+		_pipelineFailed = true;
+		return;
+	}
+
+	CC_MD5_Update(&_md5, chunk.mMD5Input.data(), (CC_LONG)chunk.mMD5Input.size());
+
+	// Fill seek points using the same rules as libFLAC
+	FLAC__StreamMetadata_SeekTable *seekTable = _seektable ? &_seektable->data.seek_table : nullptr;
+	for(const auto& frame : chunk.mFrames) {
+		if(_streamInfo.min_framesize == 0 || frame.mSize < _streamInfo.min_framesize)
+			_streamInfo.min_framesize = frame.mSize;
+		if(frame.mSize > _streamInfo.max_framesize)
+			_streamInfo.max_framesize = frame.mSize;
+
+		if(seekTable) {
+			const FLAC__uint64 firstSample = _streamInfo.total_samples;
+			const FLAC__uint64 lastSample = firstSample + frame.mSamples - 1;
+			while(_firstSeekPointToCheck < seekTable->num_points) {
+				auto& point = seekTable->points[_firstSeekPointToCheck];
+				if(point.sample_number > lastSample)
+					break;
+				if(point.sample_number >= firstSample) {
+					point.sample_number = firstSample;
+					point.stream_offset = _bytesWritten + frame.mOffset;
+					point.frame_samples = frame.mSamples;
+				}
+				++_firstSeekPointToCheck;
+			}
+		}
+
+		_streamInfo.total_samples += frame.mSamples;
+	}
+
+	NSInteger bytesWritten;
+	if(![_outputSource writeBytes:chunk.mData.data() length:(NSInteger)chunk.mData.size() bytesWritten:&bytesWritten error:nil] || bytesWritten != (NSInteger)chunk.mData.size()) {
+		os_log_error(gSFBAudioEncoderLog, "Error writing FLAC frames");
+		_pipelineFailed = true;
+		return;
+	}
+
+	_bytesWritten += chunk.mData.size();
+}
+
+- (BOOL)finishFrameParallelEncodingReturningError:(NSError **)error
+{
+	// The final chunk may be partial
+	if(_chunk)
+		[self dispatchChunk];
+
+	dispatch_sync(_writeQueue, ^{});
+
+	if(_pipelineFailed) {
+		if(error)
+			*error = [NSError errorWithDomain:SFBAudioEncoderErrorDomain code:SFBAudioEncoderErrorCodeInternalError userInfo:nil];
+		return NO;
+	}
+
+	CC_MD5_Final(_streamInfo.md5sum, &_md5);
+
+	// Without seeking the STREAMINFO and SEEKTABLE blocks remain as initially written, as with libFLAC
+	if(!_outputSource.supportsSeeking)
+		return YES;
+
+	NSInteger endOffset;
+	if(![_outputSource getOffset:&endOffset error:error])
+		return NO;
+
+	std::vector<FLAC__byte> streamInfo;
+	AppendStreamInfo(streamInfo, _streamInfo);
+
+	NSInteger bytesWritten;
+	if(![_outputSource seekToOffset:_streamInfoOffset error:error] || ![_outputSource writeBytes:streamInfo.data() length:(NSInteger)streamInfo.size() bytesWritten:&bytesWritten error:error] || bytesWritten != (NSInteger)streamInfo.size()) {
+		os_log_error(gSFBAudioEncoderLog, "Error rewriting FLAC STREAMINFO");
+		return NO;
+	}
+
+	if(_seektable) {
+		// Seek points not reached during encoding become placeholders
+		auto& seekTable = _seektable->data.seek_table;
+		for(auto i = _firstSeekPointToCheck; i < seekTable.num_points; ++i) {
+			seekTable.points[i].sample_number = FLAC__STREAM_METADATA_SEEKPOINT_PLACEHOLDER;
+			seekTable.points[i].stream_offset = 0;
+			seekTable.points[i].frame_samples = 0;
+		}
+
+		if(!FLAC__metadata_object_seektable_template_sort(_seektable.get(), false)) {
+			os_log_error(gSFBAudioEncoderLog, "FLAC__metadata_object_seektable_template_sort failed");
+			if(error)
+				*error = [NSError errorWithDomain:SFBAudioEncoderErrorDomain code:SFBAudioEncoderErrorCodeInternalError userInfo:nil];
+			return NO;
+		}
+
+		std::vector<FLAC__byte> points;
+		AppendSeekTable(points, seekTable);
+
+		if(![_outputSource seekToOffset:_seekTableOffset error:error] || ![_outputSource writeBytes:points.data() length:(NSInteger)points.size() bytesWritten:&bytesWritten error:error] || bytesWritten != (NSInteger)points.size()) {
+			os_log_error(gSFBAudioEncoderLog, "Error rewriting FLAC SEEKTABLE");
+			return NO;
+		}
+	}
+
+	return [_outputSource seekToOffset:endOffset error:error];
+}
+
 @end
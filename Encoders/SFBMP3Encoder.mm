@@ -1,11 +1,12 @@
 /*
- * Copyright (c) 2020 Stephen F. Booth <me@sbooth.org>
+ * Copyright (c) 2020 - 2021 Stephen F. Booth <me@sbooth.org>
  * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
  */
 
 #import <os/log.h>
 
 #import <memory>
+#import <new>
 
 #include <lame/lame.h>
 
@@ -13,6 +14,9 @@
 
 #import "SFBCStringForOSType.h"
 
+// The output buffer is initially sized for this many frames and grown as needed
+#define DEFAULT_OUTPUT_BUFFER_FRAMES 4096
+
 SFBAudioEncoderName const SFBAudioEncoderNameMP3 = @"org.sbooth.AudioEngine.Encoder.MP3";
 
 SFBAudioEncodingSettingsKey const SFBAudioEncodingSettingsKeyMP3TargetIsBitrate = @"Encoding Target is Bitrate";
@@ -40,10 +44,19 @@ struct ::std::default_delete<lame_global_flags> {
 {
 @private
 	std::unique_ptr<lame_global_flags> _gfp;
+	std::unique_ptr<unsigned char []> _outputBuffer;
+	size_t _outputBufferSize;
 	AVAudioFramePosition _framePosition;
 }
+- (BOOL)reserveOutputBufferForFrameLength:(AVAudioFrameCount)frameLength error:(NSError **)error;
 @end
 
+/// Returns the worst-case size of the MP3 data produced by encoding \c frameLength frames, as documented in lame.h
+static size_t MaximumOutputSize(AVAudioChannelCount channelCount, AVAudioFrameCount frameLength)
+{
+	return (size_t)(1.25 * (channelCount * frameLength)) + 7200;
+}
+
 @implementation SFBMP3Encoder
 
 + (void)load
@@ -79,7 +92,8 @@ struct ::std::default_delete<lame_global_flags> {
 	if(sourceFormat.channelCount < 1 || sourceFormat.channelCount > 2)
 		return nil;
 
-	return [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat32 sampleRate:sourceFormat.sampleRate channels:(AVAudioChannelCount)sourceFormat.channelCount interleaved:YES];
+	// LAME accepts both interleaved and non-interleaved float input, so avoid interleaving non-interleaved audio
+	return [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat32 sampleRate:sourceFormat.sampleRate channels:(AVAudioChannelCount)sourceFormat.channelCount interleaved:sourceFormat.isInterleaved];
 }
 
 - (BOOL)openReturningError:(NSError **)error
@@ -236,6 +250,9 @@ struct ::std::default_delete<lame_global_flags> {
 	outputStreamDescription.mChannelsPerFrame	= _processingFormat.channelCount;
 	_outputFormat = [[AVAudioFormat alloc] initWithStreamDescription:&outputStreamDescription];
 
+	if(![self reserveOutputBufferForFrameLength:DEFAULT_OUTPUT_BUFFER_FRAMES error:error])
+		return NO;
+
 	_gfp = std::move(gfp);
 
 	return YES;
@@ -244,6 +261,8 @@ struct ::std::default_delete<lame_global_flags> {
 - (BOOL)closeReturningError:(NSError **)error
 {
 	_gfp.reset();
+	_outputBuffer.reset();
+	_outputBufferSize = 0;
 
 	return [super closeReturningError:error];
 }
@@ -269,25 +288,33 @@ struct ::std::default_delete<lame_global_flags> {
 	if(frameLength == 0)
 		return YES;
 
-	const size_t bufsize = (size_t)(1.25 * (_processingFormat.channelCount * frameLength)) + 7200;
-	auto buf = std::make_unique<unsigned char[]>(bufsize);
-	if(!buf) {
-		if(error)
-			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+	if(![self reserveOutputBufferForFrameLength:frameLength error:error])
 		return NO;
+
+	int result;
+	const AudioBufferList *abl = buffer.audioBufferList;
+	if(_processingFormat.isInterleaved)
+		result = lame_encode_buffer_interleaved_ieee_float(_gfp.get(), (const float *)abl->mBuffers[0].mData, (int)frameLength, _outputBuffer.get(), (int)_outputBufferSize);
+	else {
+		// The right channel is ignored for mono input
+		const float *left = (const float *)abl->mBuffers[0].mData;
+		const float *right = abl->mNumberBuffers > 1 ? (const float *)abl->mBuffers[1].mData : left;
+		result = lame_encode_buffer_ieee_float(_gfp.get(), left, right, (int)frameLength, _outputBuffer.get(), (int)_outputBufferSize);
 	}
 
-	auto result = lame_encode_buffer_interleaved_ieee_float(_gfp.get(), (const float *)buffer.audioBufferList->mBuffers[0].mData, (int)frameLength, buf.get(), (int)bufsize);
-	if(result == -1) {
-		os_log_error(gSFBAudioEncoderLog, "lame_encode_buffer_interleaved_ieee_float failed");
+	if(result < 0) {
+		os_log_error(gSFBAudioEncoderLog, "LAME encoding failed: %d", result);
 		if(error)
 			*error = [NSError errorWithDomain:SFBAudioEncoderErrorDomain code:SFBAudioEncoderErrorCodeInternalError userInfo:nil];
 		return NO;
 	}
 
-	NSInteger bytesWritten;
-	if(![_outputSource writeBytes:buf.get() length:result bytesWritten:&bytesWritten error:error] || bytesWritten != result)
-		return NO;
+	// LAME buffers input internally and may not produce output for small buffers
+	if(result > 0) {
+		NSInteger bytesWritten;
+		if(![_outputSource writeBytes:_outputBuffer.get() length:result bytesWritten:&bytesWritten error:error] || bytesWritten != result)
+			return NO;
+	}
 
 	_framePosition += frameLength;
 
@@ -296,15 +323,8 @@ struct ::std::default_delete<lame_global_flags> {
 
 - (BOOL)finishEncodingReturningError:(NSError **)error
 {
-	const size_t bufsize = 7200;
-	auto buf = std::make_unique<unsigned char[]>(bufsize);
-	if(!buf) {
-		if(error)
-			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
-		return NO;
-	}
-
-	auto result = lame_encode_flush(_gfp.get(), buf.get(), bufsize);
+	// The output buffer always holds at least the 7200 bytes recommended for lame_encode_flush
+	auto result = lame_encode_flush(_gfp.get(), _outputBuffer.get(), (int)_outputBufferSize);
 	if(result == -1) {
 		os_log_error(gSFBAudioEncoderLog, "lame_encode_flush failed");
 		if(error)
@@ -313,10 +333,28 @@ struct ::std::default_delete<lame_global_flags> {
 	}
 
 	NSInteger bytesWritten;
-	if(![_outputSource writeBytes:buf.get() length:result bytesWritten:&bytesWritten error:error] || bytesWritten != result)
+	if(![_outputSource writeBytes:_outputBuffer.get() length:result bytesWritten:&bytesWritten error:error] || bytesWritten != result)
 		return NO;
 
 	return YES;
 }
 
+- (BOOL)reserveOutputBufferForFrameLength:(AVAudioFrameCount)frameLength error:(NSError **)error
+{
+	const size_t bufsize = MaximumOutputSize(_processingFormat.channelCount, frameLength);
+	if(bufsize <= _outputBufferSize)
+		return YES;
+
+	_outputBuffer.reset(new (std::nothrow) unsigned char [bufsize]);
+	if(!_outputBuffer) {
+		_outputBufferSize = 0;
+		if(error)
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+		return NO;
+	}
+
+	_outputBufferSize = bufsize;
+	return YES;
+}
+
 @end
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020 Stephen F. Booth <me@sbooth.org>
+ * Copyright (c) 2020 - 2021 Stephen F. Booth <me@sbooth.org>
  * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
  */
 
@@ -21,6 +21,62 @@ SFBAudioEncodingSettingsValueWavPackCompressionLevel const SFBAudioEncodingSetti
 SFBAudioEncodingSettingsValueWavPackCompressionLevel const SFBAudioEncodingSettingsValueWavPackCompressionLevelHigh = @"High";
 SFBAudioEncodingSettingsValueWavPackCompressionLevel const SFBAudioEncodingSettingsValueWavPackCompressionLevelVeryHigh = @"Very High";
 
+#if !__LITTLE_ENDIAN__
+#error "PackSamplesForMD5 requires a little-endian host"
+#endif
+
+typedef int32_t SFBInt32x8 __attribute__((ext_vector_type(8)));
+typedef int16_t SFBInt16x8 __attribute__((ext_vector_type(8)));
+typedef int8_t SFBInt8x8 __attribute__((ext_vector_type(8)));
+typedef uint8_t SFBUInt8x16 __attribute__((ext_vector_type(16)));
+typedef uint8_t SFBUInt8x12 __attribute__((ext_vector_type(12)));
+
+/// Narrows \c count low-aligned samples in \c src to \c bytesPerSample little-endian bytes in \c dst, as hashed by WavPack
+static void PackSamplesForMD5(const int32_t * restrict src, uint8_t * restrict dst, size_t count, int bytesPerSample)
+{
+	size_t i = 0;
+	switch(bytesPerSample) {
+		case 1:
+			for(; i + 8 <= count; i += 8) {
+				SFBInt32x8 v;
+				memcpy(&v, src + i, sizeof v);
+				SFBInt8x8 n = __builtin_convertvector(v, SFBInt8x8);
+				memcpy(dst + i, &n, sizeof n);
+			}
+			for(; i < count; ++i)
+				dst[i] = (uint8_t)src[i];
+			break;
+
+		case 2:
+			for(; i + 8 <= count; i += 8) {
+				SFBInt32x8 v;
+				memcpy(&v, src + i, sizeof v);
+				SFBInt16x8 n = __builtin_convertvector(v, SFBInt16x8);
+				memcpy(dst + 2 * i, &n, sizeof n);
+			}
+			for(; i < count; ++i) {
+				dst[2 * i] = (uint8_t)src[i];
+				dst[2 * i + 1] = (uint8_t)(src[i] >> 8);
+			}
+			break;
+
+		case 3:
+			// Drop the high byte of each of four samples
+			for(; i + 4 <= count; i += 4) {
+				SFBUInt8x16 v;
+				memcpy(&v, src + i, sizeof v);
+				SFBUInt8x12 n = __builtin_shufflevector(v, v, 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14);
+				memcpy(dst + 3 * i, &n, 12);
+			}
+			for(; i < count; ++i) {
+				dst[3 * i] = (uint8_t)src[i];
+				dst[3 * i + 1] = (uint8_t)(src[i] >> 8);
+				dst[3 * i + 2] = (uint8_t)(src[i] >> 16);
+			}
+			break;
+	}
+}
+
 @interface SFBWavPackEncoder ()
 {
 @package
@@ -29,6 +85,9 @@ SFBAudioEncodingSettingsValueWavPackCompressionLevel const SFBAudioEncodingSetti
 	WavpackContext *_wpc;
 	WavpackConfig _config;
 	CC_MD5_CTX _md5;
+	uint8_t *_md5Buffer;
+	size_t _md5BufferSize;
+	dispatch_group_t _md5Group;
 	AVAudioFramePosition _framePosition;
 }
 @end
@@ -187,6 +246,8 @@ static int wavpack_block_output(void *id, void *data, int32_t bcount)
 	CC_MD5_Init(&_md5);
 #pragma clang diagnostic pop
 
+	_md5Group = dispatch_group_create();
+
 	AudioStreamBasicDescription outputStreamDescription = {0};
 	outputStreamDescription.mFormatID			= kSFBAudioFormatWavPack;
 	outputStreamDescription.mBitsPerChannel		= _processingFormat.streamDescription->mBitsPerChannel;
@@ -206,6 +267,15 @@ static int wavpack_block_output(void *id, void *data, int32_t bcount)
 
 	_firstBlock = NULL;
 
+	if(_md5Group) {
+		dispatch_group_wait(_md5Group, DISPATCH_TIME_FOREVER);
+		_md5Group = nil;
+	}
+
+	free(_md5Buffer);
+	_md5Buffer = NULL;
+	_md5BufferSize = 0;
+
 	return [super closeReturningError:error];
 }
 
@@ -230,62 +300,47 @@ static int wavpack_block_output(void *id, void *data, int32_t bcount)
 	if(frameLength == 0)
 		return YES;
 
-	if(!WavpackPackSamples(_wpc, (int32_t *)buffer.audioBufferList->mBuffers[0].mData, frameLength)) {
-		os_log_error(gSFBAudioEncoderLog, "WavpackPackSamples failed: %{public}s", WavpackGetErrorMessage(_wpc));
-		if(error)
-			*error = [NSError errorWithDomain:SFBAudioEncoderErrorDomain code:SFBAudioEncoderErrorCodeInternalError userInfo:nil];
-		return NO;
-	}
-
-	// Update the MD5
 	const int32_t *buf = buffer.audioBufferList->mBuffers[0].mData;
-	switch(_config.bytes_per_sample) {
-		case 1:
-			for(AVAudioFrameCount i = 0; i < frameLength; ++i) {
-				for(AVAudioFrameCount j = 0; j < _processingFormat.channelCount; ++j) {
-					int8_t i8 = (int8_t)*buf;
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wdeprecated"
-					CC_MD5_Update(&_md5, &i8, 1);
-#pragma clang diagnostic pop
-					++buf;
-				}
-			}
-			break;
-		case 2:
-			for(AVAudioFrameCount i = 0; i < frameLength; ++i) {
-				for(AVAudioFrameCount j = 0; j < _processingFormat.channelCount; ++j) {
-					int16_t i16 = (int16_t)*buf;
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wdeprecated"
-					CC_MD5_Update(&_md5, &i16, 2);
-#pragma clang diagnostic pop
-					++buf;
-				}
-			}
-			break;
-		case 3:
-			for(AVAudioFrameCount i = 0; i < frameLength; ++i) {
-				for(AVAudioFrameCount j = 0; j < _processingFormat.channelCount; ++j) {
-					uint8_t hi = (uint8_t)((*buf >> 16) & 0xff);
-					uint8_t mid = (uint8_t)((*buf >> 8) & 0xff);
-					uint8_t lo = (uint8_t)(*buf & 0xff);
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wdeprecated"
-					CC_MD5_Update(&_md5, &lo, 1);
-					CC_MD5_Update(&_md5, &mid, 1);
-					CC_MD5_Update(&_md5, &hi, 1);
-#pragma clang diagnostic pop
-					++buf;
-				}
+	size_t sampleCount = (size_t)frameLength * _processingFormat.channelCount;
+
+	// Narrow the samples to the bytes hashed by WavPack
+	const void *md5Data = buf;
+	size_t md5Length = sampleCount * 4;
+	if(_config.bytes_per_sample != 4) {
+		md5Length = sampleCount * (size_t)_config.bytes_per_sample;
+		if(md5Length > _md5BufferSize) {
+			uint8_t *md5Buffer = realloc(_md5Buffer, md5Length);
+			if(!md5Buffer) {
+				if(error)
+					*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+				return NO;
 			}
-			break;
-		case 4:
+			_md5Buffer = md5Buffer;
+			_md5BufferSize = md5Length;
+		}
+		PackSamplesForMD5(buf, _md5Buffer, sampleCount, _config.bytes_per_sample);
+		md5Data = _md5Buffer;
+	}
+
+	// Update the MD5 while WavPack compresses the block
+	CC_MD5_CTX *md5 = &_md5;
+	dispatch_group_async(_md5Group, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wdeprecated"
-			CC_MD5_Update(&_md5, buf, frameLength * 4);
+		CC_MD5_Update(md5, md5Data, (CC_LONG)md5Length);
 #pragma clang diagnostic pop
-			break;
+	});
+
+	BOOL packed = WavpackPackSamples(_wpc, (int32_t *)buf, frameLength);
+
+	// The buffers must not be modified until the MD5 update completes
+	dispatch_group_wait(_md5Group, DISPATCH_TIME_FOREVER);
+
+	if(!packed) {
+		os_log_error(gSFBAudioEncoderLog, "WavpackPackSamples failed: %{public}s", WavpackGetErrorMessage(_wpc));
+		if(error)
+			*error = [NSError errorWithDomain:SFBAudioEncoderErrorDomain code:SFBAudioEncoderErrorCodeInternalError userInfo:nil];
+		return NO;
 	}
 
 	_framePosition += frameLength;
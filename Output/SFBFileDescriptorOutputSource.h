@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import "SFBOutputSource.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SFBFileDescriptorOutputSource : SFBOutputSource
++ (instancetype)new NS_UNAVAILABLE;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithFileDescriptor:(int)fileDescriptor NS_DESIGNATED_INITIALIZER;
+@end
+
+NS_ASSUME_NONNULL_END
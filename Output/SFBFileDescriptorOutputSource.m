@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#import <stdio.h>
+#import <unistd.h>
+
+#import "SFBFileDescriptorOutputSource.h"
+#import "SFBOutputSource+Internal.h"
+
+// Pipes are written in large blocks to minimize system calls
+#define STREAM_BUFFER_SIZE_BYTES 65536
+
+@interface SFBFileDescriptorOutputSource ()
+{
+@private
+	int _fileDescriptor;
+	FILE *_file;
+	BOOL _supportsSeeking;
+}
+@end
+
+@implementation SFBFileDescriptorOutputSource
+
+- (instancetype)initWithFileDescriptor:(int)fileDescriptor
+{
+	NSParameterAssert(fileDescriptor >= 0);
+
+	if((self = [super init]))
+		_fileDescriptor = fileDescriptor;
+	return self;
+}
+
+- (BOOL)openReturningError:(NSError **)error
+{
+	// The caller retains ownership of the file descriptor
+	int fd = dup(_fileDescriptor);
+	if(fd == -1) {
+		os_log_error(gSFBOutputSourceLog, "dup failed: %{public}s (%d)", strerror(errno), errno);
+		if(error)
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+		return NO;
+	}
+
+	_file = fdopen(fd, "w");
+	if(!_file) {
+		os_log_error(gSFBOutputSourceLog, "fdopen failed: %{public}s (%d)", strerror(errno), errno);
+		if(error)
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+		close(fd);
+		return NO;
+	}
+
+	if(setvbuf(_file, NULL, _IOFBF, STREAM_BUFFER_SIZE_BYTES))
+		os_log_info(gSFBOutputSourceLog, "setvbuf failed: %{public}s (%d)", strerror(errno), errno);
+
+	// Pipes, sockets, and terminals fail with ESPIPE
+	_supportsSeeking = lseek(fd, 0, SEEK_CUR) != -1;
+
+	return YES;
+}
+
+- (BOOL)closeReturningError:(NSError **)error
+{
+	if(_file) {
+		int result = fclose(_file);
+		_file = NULL;
+		if(result) {
+			os_log_error(gSFBOutputSourceLog, "fclose failed: %{public}s (%d)", strerror(errno), errno);
+			if(error)
+				*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+			return NO;
+		}
+	}
+	return YES;
+}
+
+- (BOOL)isOpen
+{
+	return _file != NULL;
+}
+
+- (BOOL)readBytes:(void *)buffer length:(NSInteger)length bytesRead:(NSInteger *)bytesRead error:(NSError **)error
+{
+	NSParameterAssert(buffer != NULL);
+	NSParameterAssert(length >= 0);
+	NSParameterAssert(bytesRead != NULL);
+
+	os_log_error(gSFBOutputSourceLog, "File descriptor output sources do not support reading");
+	if(error)
+		*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EBADF userInfo:nil];
+	return NO;
+}
+
+- (BOOL)writeBytes:(const void *)buffer length:(NSInteger)length bytesWritten:(NSInteger *)bytesWritten error:(NSError **)error
+{
+	NSParameterAssert(buffer != NULL);
+	NSParameterAssert(length > 0);
+	NSParameterAssert(bytesWritten != NULL);
+
+	size_t written = fwrite(buffer, 1, (size_t)length, _file);
+	if(written != (size_t)length) {
+		os_log_error(gSFBOutputSourceLog, "fwrite error: %{public}s (%d)", strerror(errno), errno);
+		if(error)
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+		return NO;
+	}
+	*bytesWritten = (NSInteger)written;
+	return YES;
+}
+
+- (BOOL)atEOF
+{
+	return feof(_file) != 0;
+}
+
+- (BOOL)getOffset:(NSInteger *)offset error:(NSError **)error
+{
+	NSParameterAssert(offset != NULL);
+	off_t result = ftello(_file);
+	if(result == -1) {
+		os_log_error(gSFBOutputSourceLog, "ftello failed: %{public}s (%d)", strerror(errno), errno);
+		if(error)
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+		return NO;
+	}
+	*offset = result;
+	return YES;
+}
+
+- (BOOL)getLength:(NSInteger *)length error:(NSError **)error
+{
+	NSParameterAssert(length != NULL);
+
+	if(!_supportsSeeking) {
+		if(error)
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ESPIPE userInfo:nil];
+		return NO;
+	}
+
+	off_t offset = ftello(_file);
+	if(offset == -1 || fseeko(_file, 0, SEEK_END)) {
+		os_log_error(gSFBOutputSourceLog, "fseeko(0, SEEK_END) error: %{public}s (%d)", strerror(errno), errno);
+		if(error)
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+		return NO;
+	}
+
+	off_t len = ftello(_file);
+	if(len == -1 || fseeko(_file, offset, SEEK_SET)) {
+		os_log_error(gSFBOutputSourceLog, "fseeko(%ld, SEEK_SET) error: %{public}s (%d)", (long)offset, strerror(errno), errno);
+		if(error)
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+		return NO;
+	}
+
+	*length = len;
+
+	return YES;
+}
+
+- (BOOL)supportsSeeking
+{
+	return _supportsSeeking;
+}
+
+- (BOOL)seekToOffset:(NSInteger)offset error:(NSError **)error
+{
+	if(!_supportsSeeking || fseeko(_file, offset, SEEK_SET)) {
+		const int err = _supportsSeeking ? errno : ESPIPE;
+		os_log_error(gSFBOutputSourceLog, "fseeko(%ld, SEEK_SET) error: %{public}s (%d)", (long)offset, strerror(err), err);
+		if(error)
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:err userInfo:nil];
+		return NO;
+	}
+	return YES;
+}
+
+@end
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020 Stephen F. Booth <me@sbooth.org>
+ * Copyright (c) 2020 - 2021 Stephen F. Booth <me@sbooth.org>
  * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
  */
 
@@ -25,6 +25,14 @@ NS_SWIFT_NAME(OutputSource) @interface SFBOutputSource : NSObject
 /// @return An initialized \c SFBOutputSource object
 + (instancetype)outputSourceWithBuffer:(void *)buffer capacity:(NSInteger)capacity;
 
+/// Returns an initialized \c SFBOutputSource writing to the given file descriptor
+///
+/// This may be used to write to pipes, sockets, or standard output. The output source supports seeking only if \c fileDescriptor does.
+/// @note The output source writes to a duplicate of \c fileDescriptor, which remains owned by the caller
+/// @param fileDescriptor An open file descriptor
+/// @return An initialized \c SFBOutputSource object
++ (instancetype)outputSourceWithFileDescriptor:(int)fileDescriptor;
+
 //+ (instancetype)new NS_UNAVAILABLE;
 //- (instancetype)init NS_UNAVAILABLE;
 
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020 Stephen F. Booth <me@sbooth.org>
+ * Copyright (c) 2020 - 2021 Stephen F. Booth <me@sbooth.org>
  * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
  */
 
@@ -7,6 +7,7 @@
 #import "SFBOutputSource+Internal.h"
 
 #import "SFBBufferOutputSource.h"
+#import "SFBFileDescriptorOutputSource.h"
 #import "SFBFileOutputSource.h"
 #import "SFBMutableDataOutputSource.h"
 
@@ -62,6 +63,12 @@ static void SFBCreateOutputSourceLog()
 	return [[SFBBufferOutputSource alloc] initWithBuffer:buffer capacity:(size_t)capacity];
 }
 
++ (instancetype)outputSourceWithFileDescriptor:(int)fileDescriptor
+{
+	NSParameterAssert(fileDescriptor >= 0);
+	return [[SFBFileDescriptorOutputSource alloc] initWithFileDescriptor:fileDescriptor];
+}
+
 - (void)dealloc
 {
 	if(self.isOpen)
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2006 - 2020 Stephen F. Booth <me@sbooth.org>
+ * Copyright (c) 2006 - 2021 Stephen F. Booth <me@sbooth.org>
  * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
  */
 
@@ -32,8 +32,9 @@ typedef NS_ENUM(NSUInteger, SFBAudioPlayerPlaybackState) {
 
 /// An audio player wrapping an \c AVAudioEngine processing graph supplied by \c SFBAudioPlayerNode
 ///
-/// \c SFBAudioPlayer supports gapless playback for audio with the same sample rate and number of channels.
-/// For audio with different sample rates or channels, the audio processing graph is automatically reconfigured.
+/// \c SFBAudioPlayer supports gapless playback for audio with the same number of channels.
+/// Enqueued audio at a different sample rate is resampled to the current rate, while audio played immediately is rendered at its own rate.
+/// For audio with different channels, the audio processing graph is automatically reconfigured.
 ///
 /// An \c SFBAudioPlayer may be in one of three playback states: playing, paused, or stopped. These states are
 /// based on whether the underlying \c AVAudioEngine is running (\c SFBAudioPlayer.engineIsRunning)
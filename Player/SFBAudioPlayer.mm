@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2006 - 2020 Stephen F. Booth <me@sbooth.org>
+ * Copyright (c) 2006 - 2021 Stephen F. Booth <me@sbooth.org>
  * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
  */
 
@@ -116,6 +116,8 @@ namespace {
 	SFBAudioDecoder *decoder = [[SFBAudioDecoder alloc] initWithURL:url error:error];
 	if(!decoder)
 		return NO;
+	// Produce audio in the rendering format when possible so no conversion is required
+	decoder.settings = @{ SFBAudioDecodingSettingsKeyOggOpusNonInterleaved: @YES };
 	return [self enqueueDecoder:decoder forImmediatePlayback:forImmediatePlayback error:error];
 }
 
@@ -597,8 +599,9 @@ namespace {
 
 		// If the current SFBAudioPlayerNode doesn't support the decoder's format (required for gapless join),
 		// reconfigure AVAudioEngine with a new SFBAudioPlayerNode with the correct format
+		// Audio for immediate playback is rendered at its native sample rate instead of being resampled
 		AVAudioFormat *format = decoder.processingFormat;
-		if(![_playerNode supportsFormat:format]) {
+		if(![_playerNode supportsFormat:format] || (forImmediatePlayback && format.sampleRate != _playerNode.renderingFormat.sampleRate)) {
 			success = [self configureEngineForGaplessPlaybackOfFormat:format forceUpdate:NO];
 			playbackStateChanged = _engineIsRunning;
 		}
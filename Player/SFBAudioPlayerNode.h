@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2006 - 2020 Stephen F. Booth <me@sbooth.org>
+ * Copyright (c) 2006 - 2021 Stephen F. Booth <me@sbooth.org>
  * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
  */
 
@@ -32,6 +32,12 @@ struct SFBAudioPlayerNodePlaybackTime {
 } /*NS_SWIFT_UNAVAILABLE("Use AudioPlayerNode.PlaybackTime instead")*/;
 typedef struct SFBAudioPlayerNodePlaybackTime SFBAudioPlayerNodePlaybackTime;
 
+#pragma mark - Tap
+
+/// A block receiving audio rendered by \c SFBAudioPlayerNode
+/// @param buffer The rendered audio in the rendering format, which is reused once the block returns
+typedef void (^SFBAudioPlayerNodeTapBlock)(AVAudioPCMBuffer *buffer) NS_SWIFT_NAME(AudioPlayerNode.TapBlock);
+
 #pragma mark - SFBAudioPlayerNode
 
 /// An \c AVAudioSourceNode supporting gapless playback for PCM formats
@@ -39,8 +45,9 @@ typedef struct SFBAudioPlayerNodePlaybackTime SFBAudioPlayerNodePlaybackTime;
 /// The output format of \c SFBAudioPlayerNode is specified at object initialization and cannot be changed. The output format must be
 /// the standard format, deinterleaved native-endian 32-bit floating point PCM, at any sample rate with any number of channels.
 ///
-/// \c SFBAudioPlayerNode is supplied by objects implementing \c SFBPCMDecoding (decoders) and supports audio at the same sample rate
-/// and with the same number of channels as the output format. \c SFBAudioPlayerNode supports seeking when supported by the decoder.
+/// \c SFBAudioPlayerNode is supplied by objects implementing \c SFBPCMDecoding (decoders) and supports audio with the same number of
+/// channels as the output format. Audio at other sample rates is resampled to the output sample rate, so decoders with mixed sample rates
+/// play gaplessly. \c SFBAudioPlayerNode supports seeking when supported by the decoder.
 ///
 /// \c SFBAudioPlayerNode maintains a current decoder and a queue of pending decoders. The current decoder is the decoder
 /// that will supply the earliest audio frame in the next render cycle when playing. Pending decoders are automatically dequeued and become current when
@@ -89,7 +96,8 @@ NS_SWIFT_NAME(AudioPlayerNode ) @interface SFBAudioPlayerNode : AVAudioSourceNod
 @property (nonatomic, readonly) AVAudioFormat * renderingFormat;
 /// Returns \c YES if audio with \c format can be played
 /// @param format A format to test for support
-/// @return \c YES if \c format has the same number of channels and sample rate as the rendering format
+/// @note Audio at a sample rate other than the rendering format's is resampled
+/// @return \c YES if \c format has the same number of channels as the rendering format
 - (BOOL)supportsFormat:(AVAudioFormat *)format;
 
 #pragma mark - Queue Management
@@ -192,6 +200,22 @@ NS_SWIFT_NAME(AudioPlayerNode ) @interface SFBAudioPlayerNode : AVAudioSourceNod
 /// Returns \c YES if the current decoder supports seeking
 @property (nonatomic, readonly) BOOL supportsSeeking;
 
+#pragma mark - Tap
+
+/// Installs a tap receiving the audio rendered by the node, replacing any existing tap
+///
+/// The render block copies rendered audio to a preallocated ring buffer without allocating memory or taking locks.
+/// \c block is called on a private serial queue with buffers of exactly \c bufferSize frames, so audio reaches the tap
+/// at most \c bufferSize frames after it is rendered. Silence output while the node is stopped, muted, or starved is not
+/// passed to the tap. If \c block falls behind rendering by more than 16384 frames the excess audio is dropped.
+/// @param bufferSize The number of frames in each buffer passed to \c block, from \c 1 to \c 8192
+/// @param block The block receiving the rendered audio
+/// @return \c NO if \c bufferSize is invalid
+- (BOOL)installTapWithBufferSize:(AVAudioFrameCount)bufferSize block:(SFBAudioPlayerNodeTapBlock)block NS_SWIFT_NAME(installTap(bufferSize:block:));
+/// Removes the tap
+/// @note \c block may be called once more after this method returns
+- (void)removeTap;
+
 #pragma mark - Delegate
 
 /// An optional delegate
@@ -253,7 +277,9 @@ extern NSErrorDomain const SFBAudioPlayerNodeErrorDomain NS_SWIFT_NAME(AudioPlay
 /// Possible \c NSError error codes used by \c SFBAudioPlayerNode
 typedef NS_ERROR_ENUM(SFBAudioPlayerNodeErrorDomain, SFBAudioPlayerNodeErrorCode) {
 	/// Format not supported
-	SFBAudioPlayerNodeErrorFormatNotSupported	= 0
+	SFBAudioPlayerNodeErrorFormatNotSupported	= 0,
+	/// Internal or unspecified error
+	SFBAudioPlayerNodeErrorInternalError		= 1
 } NS_SWIFT_NAME(AudioPlayerNode.ErrorCode);
 
 NS_ASSUME_NONNULL_END
@@ -9,16 +9,20 @@
 #import <mutex>
 #import <queue>
 #import <thread>
+#import <vector>
 
 #import <mach/mach_time.h>
 #import <os/log.h>
 
 #import "SFBAudioPlayerNode.h"
 
+#import "AudioPCMConverter.h"
+#import "AudioResampler.h"
 #import "AudioRingBuffer.h"
 #import "NSError+SFBURLPresentation.h"
 #import "RingBuffer.h"
 #import "SFBAudioDecoder.h"
+#import "SFBCoreDecoding.h"
 #import "UnfairLock.h"
 
 const NSTimeInterval SFBUnknownTime = -1;
@@ -41,7 +45,8 @@ namespace {
 		eAudioPlayerNodeFlagMuteRequested				= 1u << 2,
 		eAudioPlayerNodeFlagRingBufferNeedsReset		= 1u << 3,
 		eAudioPlayerNodeFlagStopDecoderThread			= 1u << 4,
-		eAudioPlayerNodeFlagStopNotifierThread			= 1u << 5
+		eAudioPlayerNodeFlagStopNotifierThread			= 1u << 5,
+		eAudioPlayerNodeFlagTapInstalled				= 1u << 6
 	};
 
 	enum eAudioPlayerNodeRenderEventRingBufferCommands : uint32_t {
@@ -74,6 +79,7 @@ namespace {
 
 	const AVAudioFrameCount 	kRingBufferFrameCapacity 	= 16384;
 	const AVAudioFrameCount 	kRingBufferChunkSize 		= 2048;
+	const AVAudioFrameCount 	kTapRingBufferFrameCapacity	= 16384;
 	const size_t 				kDecoderStateArraySize		= 8;
 	const int64_t				kInvalidFramePosition 		= -1;
 
@@ -101,11 +107,11 @@ namespace {
 		std::atomic_uint 		mFlags;
 		/// The number of frames decoded
 		std::atomic_int64_t 	mFramesDecoded;
-		/// The number of frames converted
+		/// The number of frames converted, at the rendering sample rate
 		std::atomic_int64_t 	mFramesConverted;
-		/// The number of frames rendered
+		/// The number of frames rendered, at the rendering sample rate
 		std::atomic_int64_t 	mFramesRendered;
-		/// The total number of audio frames
+		/// The total number of audio frames, at the decoder's sample rate
 		std::atomic_int64_t 	mFrameLength;
 		/// The desired seek offset
 		std::atomic_int64_t 	mFrameToSeek;
@@ -114,34 +120,121 @@ namespace {
 		/// Decodes audio from the source representation to PCM
 		id <SFBPCMDecoding> 	mDecoder;
 		/// Converts audio from the decoder's processing format to another PCM variant at the same sample rate
+		/// @note \c nil if no conversion is performed or \c mPCMConverter performs the conversion
 		AVAudioConverter 		*mConverter;
 	private:
-		/// Buffer used internally for buffering during conversion
+		/// The decoder's \c SFB::Audio::Decoder, used to decode without Objective-C message sends, or \c nullptr
+		SFB::Audio::Decoder		*mCoreDecoder;
+		/// Converts audio between PCM variants differing only in sample encoding, byte order, or interleaving
+		SFB::Audio::PCMConverter mPCMConverter;
+		/// Buffer used internally for buffering during conversion or \c nil if no conversion is performed
 		AVAudioPCMBuffer 		*mDecodeBuffer;
+		/// \c true if the decoder's sample rate differs from the rendering sample rate
+		bool 					mResampling;
+		/// Converts audio from the decoder's sample rate to the rendering sample rate
+		SFB::Audio::Resampler 	mResampler;
+		/// Resampler input at the decoder's sample rate or \c nil if no resampling is performed
+		AVAudioPCMBuffer 		*mResamplerBuffer;
+		/// The number of frames in \c mResamplerBuffer already supplied to \c mResampler
+		AVAudioFrameCount 		mResamplerBufferOffset;
+		/// \c true once the decoder is exhausted and \c mResampler is producing its final frames
+		bool 					mResamplerDraining;
+		/// Channel pointers for \c mResampler's input and output
+		std::vector<float *> 	mResamplerInput;
+		std::vector<float *> 	mResamplerOutput;
 		/// Next sequence number to use
 		static uint64_t			sSequenceNumber;
 
 	public:
 		DecoderStateData(id <SFBPCMDecoding> decoder, AVAudioFormat *format, AVAudioFrameCount frameCapacity = kDefaultBufferSize)
-			: mSequenceNumber(sSequenceNumber++), mFlags(0), mFramesDecoded(0), mFramesConverted(0), mFramesRendered(0), mFrameLength(decoder.frameLength), mFrameToSeek(kInvalidFramePosition), mDecoder(decoder), mConverter(nil), mDecodeBuffer(nil)
+			: mSequenceNumber(sSequenceNumber++), mFlags(0), mFramesDecoded(0), mFramesConverted(0), mFramesRendered(0), mFrameLength(decoder.frameLength), mFrameToSeek(kInvalidFramePosition), mDecoder(decoder), mConverter(nil), mCoreDecoder(nullptr), mDecodeBuffer(nil), mResampling(false), mResamplerBuffer(nil), mResamplerBufferOffset(0), mResamplerDraining(false)
 		{
-			mConverter = [[AVAudioConverter alloc] initFromFormat:mDecoder.processingFormat toFormat:format];
+			if([mDecoder conformsToProtocol:@protocol(SFBCoreDecoding)])
+				mCoreDecoder = ((id <SFBCoreDecoding>)mDecoder).coreDecoder;
+
+			AVAudioFormat *processingFormat = mDecoder.processingFormat;
+			if(processingFormat.sampleRate != format.sampleRate) {
+				// Audio at other sample rates is converted to deinterleaved float at the decoder's
+				// sample rate, then resampled directly into the ring buffer's chunks
+				assert(format.isStandard);
+				mResampling = true;
+				if(mResampler.Initialize(processingFormat.sampleRate, format.sampleRate, format.channelCount)) {
+					AVAudioFormat *resamplerFormat = nil;
+					if(format.channelLayout)
+						resamplerFormat = [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat32 sampleRate:processingFormat.sampleRate interleaved:NO channelLayout:format.channelLayout];
+					else
+						resamplerFormat = [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat32 sampleRate:processingFormat.sampleRate channels:format.channelCount interleaved:NO];
+
+					mResamplerBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:resamplerFormat frameCapacity:frameCapacity];
+					mResamplerInput.resize(format.channelCount);
+					mResamplerOutput.resize(format.channelCount);
+
+					if(![processingFormat isEqual:resamplerFormat])
+						PrepareConversion(processingFormat, resamplerFormat, frameCapacity);
+				}
+				else {
+					// Nothing will be rendered for the decoder
+					os_log_error(_audioPlayerNodeLog, "SFB::Audio::Resampler::Initialize() failed");
+					mResamplerDraining = true;
+				}
+			}
+			// Decoders producing audio in the rendering format decode directly into the ring buffer's chunks
+			else if(![processingFormat isEqual:format])
+				PrepareConversion(processingFormat, format, frameCapacity);
+
 			// The logic in this class assumes no SRC is performed by mConverter
-			assert(mConverter.inputFormat.sampleRate == mConverter.outputFormat.sampleRate);
-			mDecodeBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:mConverter.inputFormat frameCapacity:frameCapacity];
+			assert(!mConverter || mConverter.inputFormat.sampleRate == mConverter.outputFormat.sampleRate);
 
 			AVAudioFramePosition framePosition = decoder.framePosition;
 			if(framePosition != 0) {
 				mFramesDecoded.store(framePosition);
-				mFramesConverted.store(framePosition);
-				mFramesRendered.store(framePosition);
+				mFramesConverted.store(RenderingFrameForDecoderFrame(framePosition));
+				mFramesRendered.store(RenderingFrameForDecoderFrame(framePosition));
 			}
 		}
 
+		/// Creates \c mDecodeBuffer and the converter used to convert its contents from \c sourceFormat to \c destinationFormat
+		void PrepareConversion(AVAudioFormat *sourceFormat, AVAudioFormat *destinationFormat, AVAudioFrameCount frameCapacity)
+		{
+			// AVAudioConverter is only required for channel mapping or non-PCM formats
+			BOOL channelLayoutsMatch = !sourceFormat.channelLayout || !destinationFormat.channelLayout || [sourceFormat.channelLayout isEqual:destinationFormat.channelLayout];
+			if(!channelLayoutsMatch || !mPCMConverter.Initialize(SFB::Audio::Format(sourceFormat.streamDescription), SFB::Audio::Format(destinationFormat.streamDescription)))
+				mConverter = [[AVAudioConverter alloc] initFromFormat:sourceFormat toFormat:destinationFormat];
+			mDecodeBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:sourceFormat frameCapacity:frameCapacity];
+		}
+
+		/// Converts the contents of \c mDecodeBuffer into \c buffer
+		bool ConvertDecodedAudio(AVAudioPCMBuffer *buffer, NSError **error)
+		{
+			if(mPCMConverter.IsInitialized()) {
+				if(!mPCMConverter.Convert(mDecodeBuffer.audioBufferList, buffer.mutableAudioBufferList, mDecodeBuffer.frameLength)) {
+					if(error)
+						*error = [NSError errorWithDomain:SFBAudioPlayerNodeErrorDomain code:SFBAudioPlayerNodeErrorInternalError userInfo:nil];
+					return false;
+				}
+				buffer.frameLength = mDecodeBuffer.frameLength;
+				return true;
+			}
+
+			return [mConverter convertToBuffer:buffer fromBuffer:mDecodeBuffer error:error];
+		}
+
+		/// Converts a frame position at the decoder's sample rate to the rendering sample rate
+		inline AVAudioFramePosition RenderingFrameForDecoderFrame(AVAudioFramePosition frame) const
+		{
+			return mResampling ? mResampler.OutputFramesForInputFrames(frame) : frame;
+		}
+
+		/// Converts a frame position at the rendering sample rate to the decoder's sample rate
+		inline AVAudioFramePosition DecoderFrameForRenderingFrame(AVAudioFramePosition frame) const
+		{
+			return mResampling ? mResampler.InputFramesForOutputFrames(frame) : frame;
+		}
+
 		inline AVAudioFramePosition FramePosition() const
 		{
 			int64_t seek = mFrameToSeek.load();
-			return seek == kInvalidFramePosition ? mFramesRendered.load() : seek;
+			return seek == kInvalidFramePosition ? DecoderFrameForRenderingFrame(mFramesRendered.load()) : seek;
 		}
 
 		inline AVAudioFramePosition FrameLength() const
@@ -151,11 +244,29 @@ namespace {
 
 		bool DecodeAudio(AVAudioPCMBuffer *buffer, NSError **error = nullptr)
 		{
+			if(mResampling)
+				return ResampleAudio(buffer, error);
+
+			if(!mDecodeBuffer) {
+				if(!DecodeIntoBuffer(buffer, error))
+					return false;
+
+				if(buffer.frameLength == 0) {
+					mFlags.fetch_or(eDecodingCompleteFlag);
+					return true;
+				}
+
+				this->mFramesDecoded.fetch_add(buffer.frameLength);
+				mFramesConverted.fetch_add(buffer.frameLength);
+
+				return true;
+			}
+
 #if DEBUG
 			assert(buffer.frameCapacity == mDecodeBuffer.frameCapacity);
 #endif
 
-			if(![mDecoder decodeIntoBuffer:mDecodeBuffer frameLength:mDecodeBuffer.frameCapacity error:error])
+			if(!DecodeIntoBuffer(mDecodeBuffer, error))
 				return false;
 
 			if(mDecodeBuffer.frameLength == 0) {
@@ -166,13 +277,93 @@ namespace {
 			this->mFramesDecoded.fetch_add(mDecodeBuffer.frameLength);
 
 			// Only PCM to PCM conversions are performed
-			if(![mConverter convertToBuffer:buffer fromBuffer:mDecodeBuffer error:error])
+			if(!ConvertDecodedAudio(buffer, error))
 				return false;
 			mFramesConverted.fetch_add(buffer.frameLength);
 
 			return true;
 		}
 
+		/// Fills \c buffer with audio resampled to the rendering sample rate
+		bool ResampleAudio(AVAudioPCMBuffer *buffer, NSError **error)
+		{
+			const AVAudioFrameCount frameCapacity = buffer.frameCapacity;
+			const AVAudioChannelCount channelCount = buffer.format.channelCount;
+			float * const *output = buffer.floatChannelData;
+
+			AVAudioFrameCount framesProduced = 0;
+			while(framesProduced < frameCapacity) {
+				for(AVAudioChannelCount i = 0; i < channelCount; ++i)
+					mResamplerOutput[i] = output[i] + framesProduced;
+
+				if(mResamplerDraining) {
+					auto framesDrained = mResampler.Drain(mResamplerOutput.data(), frameCapacity - framesProduced);
+					if(framesDrained == 0)
+						break;
+					framesProduced += framesDrained;
+					continue;
+				}
+
+				// Decode more audio once the resampler has consumed all buffered input
+				if(mResamplerBufferOffset == mResamplerBuffer.frameLength) {
+					mResamplerBufferOffset = 0;
+					if(mDecodeBuffer) {
+						if(!DecodeIntoBuffer(mDecodeBuffer, error))
+							return false;
+						if(mDecodeBuffer.frameLength == 0)
+							mResamplerBuffer.frameLength = 0;
+						else if(!ConvertDecodedAudio(mResamplerBuffer, error))
+							return false;
+					}
+					else if(!DecodeIntoBuffer(mResamplerBuffer, error))
+						return false;
+
+					if(mResamplerBuffer.frameLength == 0) {
+						mResamplerDraining = true;
+						continue;
+					}
+
+					this->mFramesDecoded.fetch_add(mResamplerBuffer.frameLength);
+				}
+
+				float * const *input = mResamplerBuffer.floatChannelData;
+				for(AVAudioChannelCount i = 0; i < channelCount; ++i)
+					mResamplerInput[i] = input[i] + mResamplerBufferOffset;
+
+				size_t framesConsumed = 0;
+				framesProduced += mResampler.Process(mResamplerInput.data(), mResamplerBuffer.frameLength - mResamplerBufferOffset, framesConsumed, mResamplerOutput.data(), frameCapacity - framesProduced);
+				mResamplerBufferOffset += framesConsumed;
+			}
+
+			buffer.frameLength = framesProduced;
+
+			if(framesProduced == 0) {
+				mFlags.fetch_or(eDecodingCompleteFlag);
+				return true;
+			}
+
+			mFramesConverted.fetch_add(framesProduced);
+
+			return true;
+		}
+
+		/// Fills \c buffer using the core decoder if available and the Objective-C decoder otherwise
+		bool DecodeIntoBuffer(AVAudioPCMBuffer *buffer, NSError **error)
+		{
+			if(!mCoreDecoder)
+				return [mDecoder decodeIntoBuffer:buffer frameLength:buffer.frameCapacity error:error];
+
+			uint32_t framesDecoded = 0;
+			if(!mCoreDecoder->Decode(buffer.mutableAudioBufferList, buffer.frameCapacity, framesDecoded)) {
+				if(error)
+					*error = [NSError errorWithDomain:SFBAudioDecoderErrorDomain code:SFBAudioDecoderErrorCodeInternalError userInfo:nil];
+				return false;
+			}
+
+			buffer.frameLength = framesDecoded;
+			return true;
+		}
+
 		/// Seeks to the frame specified by \c mFrameToSeek
 		bool PerformSeek()
 		{
@@ -180,9 +371,16 @@ namespace {
 
 			os_log_debug(_audioPlayerNodeLog, "Seeking to frame %lld", seekOffset);
 
-			if([mDecoder seekToFrame:seekOffset error:nil])
-				// Reset the converter to flush any buffers
+			if([mDecoder seekToFrame:seekOffset error:nil]) {
+				// Reset the converter and resampler to flush any buffers
 				[mConverter reset];
+				if(mResampling && mResampler.IsInitialized()) {
+					mResampler.Reset();
+					mResamplerBuffer.frameLength = 0;
+					mResamplerBufferOffset = 0;
+					mResamplerDraining = false;
+				}
+			}
 			else
 				os_log_debug(_audioPlayerNodeLog, "Error seeking to frame %lld", seekOffset);
 
@@ -199,8 +397,8 @@ namespace {
 			// A seek is handled in essentially the same way as initial playback
 			if(newFrame != kInvalidFramePosition) {
 				mFramesDecoded.store(newFrame);
-				mFramesConverted.store(seekOffset);
-				mFramesRendered.store(seekOffset);
+				mFramesConverted.store(RenderingFrameForDecoderFrame(seekOffset));
+				mFramesRendered.store(RenderingFrameForDecoderFrame(seekOffset));
 			}
 
 			return newFrame != kInvalidFramePosition;
@@ -340,10 +538,19 @@ namespace {
 	// Collector
 	dispatch_source_t				_collector;
 
+	// Tap variables
+	dispatch_queue_t				_tapQueue;
+	dispatch_source_t				_tapSource;
+	/// The buffer passed to \c _tapBlock, accessed only on \c _tapQueue
+	AVAudioPCMBuffer 				*_tapBuffer;
+	/// The tap block, accessed only on \c _tapQueue
+	SFBAudioPlayerNodeTapBlock		_tapBlock;
+
 	// Shared state accessed from multiple threads/queues
 	std::atomic_uint 				_flags;
 	SFB::Audio::RingBuffer			_audioRingBuffer;
 	SFB::RingBuffer					_renderEventsRingBuffer;
+	SFB::Audio::RingBuffer			_tapRingBuffer;
 	DecoderStateData::atomic_ptr 	_decoderStateArray [kDecoderStateArraySize];
 }
 - (BOOL)performEnqueue:(id <SFBPCMDecoding>)decoder reset:(BOOL)reset error:(NSError **)error;
@@ -434,7 +641,17 @@ namespace {
 			return noErr;
 
 		// ========================================
-		// 7. Perform bookkeeping to apportion the rendered frames appropriately
+		// 7. Copy the rendered audio to the tap
+		//
+		// Audio that doesn't fit in the tap ring buffer is dropped
+		if(self->_flags.load() & eAudioPlayerNodeFlagTapInstalled) {
+			size_t framesWritten = self->_tapRingBuffer.Write(outputData, framesRead);
+			if(framesWritten > 0)
+				dispatch_source_merge_data(self->_tapSource, framesWritten);
+		}
+
+		// ========================================
+		// 8. Perform bookkeeping to apportion the rendered frames appropriately
 		//
 		// framesRead contains the number of valid frames that were rendered
 		// However, these could have come from any number of decoders depending on buffer sizes
@@ -489,7 +706,7 @@ namespace {
 		}
 
 		// ========================================
-		// 8. If there are no active decoders schedule the end of audio notification
+		// 9. If there are no active decoders schedule the end of audio notification
 
 		decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(self->_decoderStateArray, kDecoderStateArraySize);
 		if(!decoderState) {
@@ -526,6 +743,11 @@ namespace {
 
 		_renderEventsRingBuffer.Allocate(256);
 
+		if(!_tapRingBuffer.Allocate(_renderingFormat.streamDescription, kTapRingBufferFrameCapacity)) {
+			os_log_error(_audioPlayerNodeLog, "SFB::Audio::RingBuffer::Allocate() failed");
+			return nil;
+		}
+
 #if 0
 		// See the comments in SFBAudioPlayer -configureEngineForGaplessPlaybackOfFormat:
 		// 512 is the nominal "standard" value for kAudioUnitProperty_MaximumFramesPerSlice while 1156 is AVAudioSourceNode's default
@@ -577,6 +799,33 @@ namespace {
 		// Start collecting
 		dispatch_resume(_collector);
 
+		// Set up the tap
+		_tapQueue = dispatch_queue_create("org.sbooth.AudioEngine.AudioPlayerNode.TapQueue", attr);
+		if(!_tapQueue) {
+			os_log_error(_audioPlayerNodeLog, "dispatch_queue_create failed");
+			return nil;
+		}
+
+		_tapSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_DATA_ADD, 0, 0, _tapQueue);
+		if(!_tapSource) {
+			os_log_error(_audioPlayerNodeLog, "dispatch_source_create failed");
+			return nil;
+		}
+
+		dispatch_source_set_event_handler(_tapSource, ^{
+			AVAudioPCMBuffer *buffer = self->_tapBuffer;
+			if(!buffer)
+				return;
+
+			// Audio is passed to the tap in buffers of the requested size
+			while(self->_tapRingBuffer.FramesAvailableToRead() >= buffer.frameCapacity) {
+				buffer.frameLength = static_cast<AVAudioFrameCount>(self->_tapRingBuffer.Read(buffer.mutableAudioBufferList, buffer.frameCapacity));
+				self->_tapBlock(buffer);
+			}
+		});
+
+		dispatch_resume(_tapSource);
+
 		// Launch the threads
 		try {
 			_decodingThread = std::thread(DecoderThreadEntry, (__bridge void *)self);
@@ -613,8 +862,9 @@ namespace {
 
 - (BOOL)supportsFormat:(AVAudioFormat *)format
 {
-	// Gapless playback requires the same number of channels at the same sample rate
-	return format.channelCount == _renderingFormat.channelCount && format.sampleRate == _renderingFormat.sampleRate;
+	// Gapless playback requires the same number of channels
+	// Audio at other sample rates is resampled to the rendering sample rate
+	return format.channelCount == _renderingFormat.channelCount;
 }
 
 #pragma mark - Queue Management
@@ -626,6 +876,8 @@ namespace {
 	SFBAudioDecoder *decoder = [[SFBAudioDecoder alloc] initWithURL:url error:error];
 	if(!decoder)
 		return NO;
+	// Produce audio in the rendering format when possible so no conversion is required
+	decoder.settings = @{ SFBAudioDecodingSettingsKeyOggOpusNonInterleaved: @YES };
 
 	return [self resetAndEnqueueDecoder:decoder error:error];
 }
@@ -643,6 +895,8 @@ namespace {
 	SFBAudioDecoder *decoder = [[SFBAudioDecoder alloc] initWithURL:url error:error];
 	if(!decoder)
 		return NO;
+	// Produce audio in the rendering format when possible so no conversion is required
+	decoder.settings = @{ SFBAudioDecodingSettingsKeyOggOpusNonInterleaved: @YES };
 
 	return [self enqueueDecoder:decoder error:error];
 }
@@ -757,7 +1011,7 @@ namespace {
 	int64_t framePosition = decoderState->FramePosition();
 	int64_t frameLength = decoderState->FrameLength();
 
-	double sampleRate = decoderState->mConverter.outputFormat.sampleRate;
+	double sampleRate = decoderState->mDecoder.processingFormat.sampleRate;
 	if(sampleRate > 0) {
 		if(framePosition != SFBUnknownFramePosition)
 			playbackTime.currentTime = framePosition / sampleRate;
@@ -785,7 +1039,7 @@ namespace {
 
 	if(playbackTime) {
 		SFBAudioPlayerNodePlaybackTime currentPlaybackTime = { .currentTime = SFBUnknownTime, .totalTime = SFBUnknownTime };
-		double sampleRate = decoderState->mConverter.outputFormat.sampleRate;
+		double sampleRate = decoderState->mDecoder.processingFormat.sampleRate;
 		if(sampleRate > 0) {
 			if(currentPlaybackPosition.framePosition != SFBUnknownFramePosition)
 				currentPlaybackTime.currentTime = currentPlaybackPosition.framePosition / sampleRate;
@@ -809,7 +1063,7 @@ namespace {
 	if(!decoderState)
 		return NO;
 
-	double sampleRate = decoderState->mConverter.outputFormat.sampleRate;
+	double sampleRate = decoderState->mDecoder.processingFormat.sampleRate;
 	AVAudioFramePosition framePosition = decoderState->FramePosition();
 	AVAudioFramePosition targetFrame = framePosition + (AVAudioFramePosition)(secondsToSkip * sampleRate);
 
@@ -828,7 +1082,7 @@ namespace {
 	if(!decoderState)
 		return NO;
 
-	double sampleRate = decoderState->mConverter.outputFormat.sampleRate;
+	double sampleRate = decoderState->mDecoder.processingFormat.sampleRate;
 	AVAudioFramePosition framePosition = decoderState->FramePosition();
 	AVAudioFramePosition targetFrame = framePosition - (AVAudioFramePosition)(secondsToSkip * sampleRate);
 
@@ -847,7 +1101,7 @@ namespace {
 	if(!decoderState)
 		return NO;
 
-	double sampleRate = decoderState->mConverter.outputFormat.sampleRate;
+	double sampleRate = decoderState->mDecoder.processingFormat.sampleRate;
 	AVAudioFramePosition targetFrame = (AVAudioFramePosition)(timeInSeconds * sampleRate);
 
 	if(targetFrame >= decoderState->FrameLength())
@@ -895,6 +1149,49 @@ namespace {
 	return decoderState ? decoderState->mDecoder.supportsSeeking : NO;
 }
 
+#pragma mark - Tap
+
+- (BOOL)installTapWithBufferSize:(AVAudioFrameCount)bufferSize block:(SFBAudioPlayerNodeTapBlock)block
+{
+	NSParameterAssert(block != nil);
+
+	if(bufferSize == 0 || bufferSize > kTapRingBufferFrameCapacity / 2) {
+		os_log_error(_audioPlayerNodeLog, "Invalid tap buffer size: %u", bufferSize);
+		return NO;
+	}
+
+	AVAudioPCMBuffer *buffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:_renderingFormat frameCapacity:bufferSize];
+	if(!buffer) {
+		os_log_error(_audioPlayerNodeLog, "Unable to create AVAudioPCMBuffer with format %{public}@ and frame capacity %u", _renderingFormat, bufferSize);
+		return NO;
+	}
+
+	_flags.fetch_and(~eAudioPlayerNodeFlagTapInstalled);
+
+	dispatch_sync(_tapQueue, ^{
+		// Discard audio rendered for the previous tap
+		while(self->_tapRingBuffer.FramesAvailableToRead() > 0)
+			self->_tapRingBuffer.Read(buffer.mutableAudioBufferList, buffer.frameCapacity);
+
+		self->_tapBuffer = buffer;
+		self->_tapBlock = [block copy];
+	});
+
+	_flags.fetch_or(eAudioPlayerNodeFlagTapInstalled);
+
+	return YES;
+}
+
+- (void)removeTap
+{
+	_flags.fetch_and(~eAudioPlayerNodeFlagTapInstalled);
+
+	dispatch_async(_tapQueue, ^{
+		self->_tapBuffer = nil;
+		self->_tapBlock = nil;
+	});
+}
+
 #pragma mark - Internals
 
 - (BOOL)performEnqueue:(id <SFBPCMDecoding>)decoder reset:(BOOL)reset error:(NSError **)error
@@ -1008,6 +1305,7 @@ namespace {
 
 			// In the event the render block output format and decoder processing
 			// format don't match, conversion will be performed in DecoderStateData::DecodeAudio()
+			// Otherwise audio is decoded directly into the buffer
 
 			os_log_debug(_audioPlayerNodeLog, "Dequeued decoder for \"%{public}@\"", [[NSFileManager defaultManager] displayNameAtPath:decoderState->mDecoder.inputSource.url.path]);
 			os_log_debug(_audioPlayerNodeLog, "Processing format: %{public}@", decoderState->mDecoder.processingFormat);
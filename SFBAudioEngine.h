@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2006 - 2020 Stephen F. Booth <me@sbooth.org>
+ * Copyright (c) 2006 - 2021 Stephen F. Booth <me@sbooth.org>
  * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
  */
 
@@ -23,6 +23,7 @@ FOUNDATION_EXPORT const unsigned char SFBAudioEngineVersionString [];
 #import <SFBAudioEngine/SFBDSDPCMDecoder.h>
 #import <SFBAudioEngine/SFBDoPDecoder.h>
 #import <SFBAudioEngine/SFBLoopableRegionDecoder.h>
+#import <SFBAudioEngine/SFBPrefetchingDecoder.h>
 
 #import <SFBAudioEngine/SFBOutputSource.h>
 
@@ -38,7 +39,16 @@ FOUNDATION_EXPORT const unsigned char SFBAudioEngineVersionString [];
 #import <SFBAudioEngine/SFBAudioMetadata.h>
 #import <SFBAudioEngine/SFBAudioFile.h>
 
+#import <SFBAudioEngine/SFBAudioAnalysisCache.h>
+#import <SFBAudioEngine/SFBAudioAnalysisPlugIn.h>
+#import <SFBAudioEngine/SFBAudioAnalysisPipeline.h>
 #import <SFBAudioEngine/SFBReplayGainAnalyzer.h>
+#import <SFBAudioEngine/SFBLoudnessAnalyzer.h>
+#import <SFBAudioEngine/SFBTruePeakMeter.h>
+#import <SFBAudioEngine/SFBWaveformOverview.h>
+#import <SFBAudioEngine/SFBSilenceAnalyzer.h>
+#import <SFBAudioEngine/SFBSpectrumAnalyzer.h>
 
 #import <SFBAudioEngine/SFBAudioExporter.h>
+#import <SFBAudioEngine/SFBAudioBatchConverter.h>
 #import <SFBAudioEngine/SFBAudioConverter.h>
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <new>
+
+#include "AudioDither.h"
+
+namespace {
+
+	/// Four \c float lanes
+	typedef float vfloat4 __attribute__((vector_size(16)));
+	/// Four \c int32_t lanes
+	typedef int32_t vint4 __attribute__((vector_size(16)));
+	/// Four \c uint32_t lanes
+	typedef uint32_t vuint4 __attribute__((vector_size(16)));
+
+	/// Returns a vector with all lanes set to \c value
+	inline vfloat4 Splat(float value) noexcept
+	{
+		return vfloat4{ value, value, value, value };
+	}
+
+	/// Returns \c a where \c mask is set and \c b elsewhere
+	inline vfloat4 Select(vint4 mask, vfloat4 a, vfloat4 b) noexcept
+	{
+		return (vfloat4)((mask & (vint4)a) | (~mask & (vint4)b));
+	}
+
+	/// Advances the four xorshift32 generators in \c state and returns uniform values in [-0.5, 0.5)
+	inline vfloat4 Uniform(vuint4& state) noexcept
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return __builtin_convertvector((vint4)state, vfloat4) * Splat(1.f / 4294967296.f);
+	}
+
+	/// Returns \c v rounded to the nearest integer, with halves rounded away from zero
+	/// @note \c v must be within the range of \c int32_t
+	inline vfloat4 Round(vfloat4 v) noexcept
+	{
+		const vint4 signMask = { INT32_MIN, INT32_MIN, INT32_MIN, INT32_MIN };
+		const vfloat4 half = (vfloat4)(((vint4)v & signMask) | (vint4)Splat(0.5f));
+		return __builtin_convertvector(__builtin_convertvector(v + half, vint4), vfloat4);
+	}
+
+	// Lipshitz, Vanderkooy, and Wannamaker, "Minimally Audible Noise Shaping" (1991)
+	const float kLipshitzCoefficients [] = { 2.033f, -2.165f, 1.959f, -1.590f, 0.6149f };
+	// Wannamaker, "Psychoacoustically Optimal Noise Shaping" (1992)
+	const float kWannamakerCoefficients [] = { 2.412f, -3.370f, 3.937f, -4.174f, 3.353f, -2.205f, 1.281f, -0.569f, 0.0847f };
+
+	/// The largest requantization error fed back, in LSBs, preventing runaway feedback after clipping
+	const float kMaximumError = 2;
+
+}
+
+/// Generator and error history for four channels
+struct SFB::Audio::Dither::GroupState {
+	/// One generator per lane
+	vuint4 mGenerator;
+	/// Previous requantization errors, most recent first
+	vfloat4 mErrors [kMaximumTapCount];
+};
+
+#pragma mark Creation and Destruction
+
+SFB::Audio::Dither::Dither() noexcept
+	: mChannelCount(0), mBitDepth(0), mNoiseShaping(NoiseShaping::None), mTapCount(0), mCoefficients{}, mState(nullptr)
+{}
+
+SFB::Audio::Dither::~Dither()
+{
+	delete [] mState;
+}
+
+#pragma mark Configuration
+
+bool SFB::Audio::Dither::Initialize(uint32_t channelCount, unsigned bitDepth, NoiseShaping noiseShaping, double sampleRate) noexcept
+{
+	if(channelCount == 0 || bitDepth < 8 || bitDepth > 24)
+		return false;
+
+	delete [] mState;
+	mState = new (std::nothrow) GroupState [(channelCount + 3) / 4];
+	if(!mState)
+		return false;
+
+	// The psychoacoustic curves move noise to frequencies that are only high enough at 44.1 and 48 kHz
+	if((noiseShaping == NoiseShaping::Lipshitz || noiseShaping == NoiseShaping::Wannamaker) && std::fabs(sampleRate - 44100) > 1 && std::fabs(sampleRate - 48000) > 1)
+		noiseShaping = NoiseShaping::Highpass;
+
+	std::memset(mCoefficients, 0, sizeof mCoefficients);
+	switch(noiseShaping) {
+		case NoiseShaping::None:
+			mTapCount = 0;
+			break;
+		case NoiseShaping::Highpass:
+			mTapCount = 1;
+			mCoefficients[0] = 1;
+			break;
+		case NoiseShaping::Lipshitz:
+			mTapCount = std::end(kLipshitzCoefficients) - std::begin(kLipshitzCoefficients);
+			std::copy(std::begin(kLipshitzCoefficients), std::end(kLipshitzCoefficients), mCoefficients);
+			break;
+		case NoiseShaping::Wannamaker:
+			mTapCount = std::end(kWannamakerCoefficients) - std::begin(kWannamakerCoefficients);
+			std::copy(std::begin(kWannamakerCoefficients), std::end(kWannamakerCoefficients), mCoefficients);
+			break;
+	}
+
+	mChannelCount = channelCount;
+	mBitDepth = bitDepth;
+	mNoiseShaping = noiseShaping;
+
+	Reset();
+
+	return true;
+}
+
+void SFB::Audio::Dither::Reset() noexcept
+{
+	if(!mState)
+		return;
+
+	for(uint32_t group = 0; group < (mChannelCount + 3) / 4; ++group) {
+		// Any nonzero seed is valid; distinct seeds decorrelate the channels
+		for(uint32_t lane = 0; lane < 4; ++lane)
+			mState[group].mGenerator[lane] = 0x9E3779B9u * (4 * group + lane + 1);
+		std::memset(mState[group].mErrors, 0, sizeof mState[group].mErrors);
+	}
+}
+
+#pragma mark Processing
+
+void SFB::Audio::Dither::Process(float * const *buffers, size_t frameCount) noexcept
+{
+	if(!mState || !buffers)
+		return;
+
+	const float scale = static_cast<float>(1u << (mBitDepth - 1));
+	const vfloat4 vscale = Splat(scale);
+	const vfloat4 vinverseScale = Splat(1 / scale);
+	const vfloat4 minimum = Splat(-scale);
+	const vfloat4 maximum = Splat(scale - 1);
+	const vfloat4 errorMinimum = Splat(-kMaximumError);
+	const vfloat4 errorMaximum = Splat(kMaximumError);
+
+	for(uint32_t group = 0; group < (mChannelCount + 3) / 4; ++group) {
+		auto& state = mState[group];
+		const uint32_t firstChannel = 4 * group;
+		const uint32_t laneCount = std::min(4u, mChannelCount - firstChannel);
+
+		for(size_t frame = 0; frame < frameCount; ++frame) {
+			vfloat4 x = Splat(0);
+			for(uint32_t lane = 0; lane < laneCount; ++lane)
+				x[lane] = buffers[firstChannel + lane][frame];
+
+			// Subtract the filtered error history from the scaled input
+			vfloat4 v = x * vscale;
+			for(unsigned tap = 0; tap < mTapCount; ++tap)
+				v -= Splat(mCoefficients[tap]) * state.mErrors[tap];
+
+			// The sum of two uniform variables has a triangular distribution spanning ±1 LSB
+			const vfloat4 dither = Uniform(state.mGenerator) + Uniform(state.mGenerator);
+
+			vfloat4 q = v + dither;
+			q = Select(q < minimum, minimum, q);
+			q = Select(q > maximum, maximum, q);
+			q = Round(q);
+			q = Select(q > maximum, maximum, q);
+
+			if(mTapCount) {
+				vfloat4 error = q - v;
+				error = Select(error < errorMinimum, errorMinimum, error);
+				error = Select(error > errorMaximum, errorMaximum, error);
+				std::memmove(state.mErrors + 1, state.mErrors, (mTapCount - 1) * sizeof(vfloat4));
+				state.mErrors[0] = error;
+			}
+
+			const vfloat4 y = q * vinverseScale;
+			for(uint32_t lane = 0; lane < laneCount; ++lane)
+				buffers[firstChannel + lane][frame] = y[lane];
+		}
+	}
+}
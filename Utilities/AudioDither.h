@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/*! @file AudioDither.h @brief Dither and noise shaping for bit depth reduction */
+
+/*! @brief \c SFBAudioEngine's encompassing namespace */
+namespace SFB {
+
+	/*! @brief %Audio functionality */
+	namespace Audio {
+
+		/*!
+		 * @brief Requantizes non-interleaved \c float audio to a lower bit depth using TPDF dither and optional noise shaping.
+		 *
+		 * Processed samples lie exactly on the grid of the target bit depth and are clipped to its range, so a subsequent
+		 * conversion to integers of that depth is exact.
+		 *
+		 * Dither is generated by a four-lane xorshift generator and channels are processed four at a time, one per vector lane,
+		 * through an error feedback filter. The noise shaping curves other than \c Highpass were designed for 44.1 kHz; at sample
+		 * rates other than 44.1 kHz and 48 kHz \c Highpass is used instead.
+		 *
+		 * This class is not thread safe.
+		 */
+		class Dither
+		{
+		public:
+			/*! @brief Noise shaping curves applied to the requantization error */
+			enum class NoiseShaping {
+				/*! Flat TPDF dither */
+				None,
+				/*! First-order highpass, moving noise toward the Nyquist frequency */
+				Highpass,
+				/*! Lipshitz five-tap E-weighted curve */
+				Lipshitz,
+				/*! Wannamaker nine-tap F-weighted curve */
+				Wannamaker
+			};
+
+			/*! @brief The maximum number of error feedback taps */
+			static constexpr unsigned kMaximumTapCount = 12;
+
+			// ========================================
+			/*! @name Creation and Destruction */
+			//@{
+
+			/*! @brief A \c std::unique_ptr for \c Dither objects */
+			using unique_ptr = std::unique_ptr<Dither>;
+
+			/*!
+			 * @brief Create a new \c Dither
+			 * @note Initialize() must be called before the object may be used.
+			 */
+			Dither() noexcept;
+
+			/*! @brief Destroy the \c Dither and release all associated resources. */
+			~Dither();
+
+			/*! @cond */
+
+			/*! @internal This class is non-copyable */
+			Dither(const Dither& rhs) = delete;
+
+			/*! @internal This class is non-assignable */
+			Dither& operator=(const Dither& rhs) = delete;
+
+			/*! @endcond */
+
+			//@}
+
+
+			// ========================================
+			/*! @name Configuration */
+			//@{
+
+			/*!
+			 * @brief Prepare to requantize audio
+			 * @param channelCount The number of channels
+			 * @param bitDepth The target bit depth, from 8 to 24
+			 * @param noiseShaping The noise shaping curve
+			 * @param sampleRate The sample rate of the audio
+			 * @return \c true on success, \c false on error
+			 */
+			bool Initialize(uint32_t channelCount, unsigned bitDepth, NoiseShaping noiseShaping, double sampleRate) noexcept;
+
+			/*! @brief Clear the error feedback history */
+			void Reset() noexcept;
+
+			/*! @brief Returns \c true if this \c Dither has been initialized */
+			inline bool IsInitialized() const noexcept				{ return mState != nullptr; }
+
+			/*! @brief Returns the target bit depth */
+			inline unsigned BitDepth() const noexcept				{ return mBitDepth; }
+
+			/*! @brief Returns the noise shaping curve in use */
+			inline NoiseShaping Shaping() const noexcept			{ return mNoiseShaping; }
+
+			//@}
+
+
+			// ========================================
+			/*! @name Processing */
+			//@{
+
+			/*!
+			 * @brief Requantize audio in place
+			 * @param buffers An array of pointers to the non-interleaved samples of each channel
+			 * @param frameCount The number of frames to process
+			 */
+			void Process(float * const *buffers, size_t frameCount) noexcept;
+
+			//@}
+
+		private:
+
+			/*! @internal Per-group state, one channel per lane */
+			struct GroupState;
+
+			uint32_t			mChannelCount;			// The number of channels
+			unsigned			mBitDepth;				// The target bit depth
+			NoiseShaping		mNoiseShaping;			// The noise shaping curve
+			unsigned			mTapCount;				// The number of error feedback taps
+			float				mCoefficients [kMaximumTapCount];	// Error feedback coefficients
+			GroupState			*mState;				// One entry per four channels
+		};
+
+	}
+}
@@ -123,6 +123,7 @@ bool SFB::Audio::Format::GetStandardEquivalent(Format& format) const noexcept
 	return true;
 }
 
+#if defined(__APPLE__)
 // Most of this is stolen from Apple's CAStreamBasicDescription::Print()
 SFB::CFString SFB::Audio::Format::Description() const noexcept
 {
@@ -190,3 +191,4 @@ SFB::CFString SFB::Audio::Format::Description() const noexcept
 
 	return CFString((CFStringRef)result.Relinquish());
 }
+#endif
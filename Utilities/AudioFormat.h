@@ -5,9 +5,16 @@
 
 #pragma once
 
+#include <cassert>
+#include <cstring>
+
+#include "Portability.h"
+
+#if defined(__APPLE__)
 #import <SFBAudioEngine/SFBAudioEngineTypes.h>
 
 #import "CFWrapper.h"
+#endif
 
 /*! @file AudioFormat.h @brief A Core %Audio \c AudioStreamBasicDescription wrapper */
 
@@ -18,7 +25,7 @@ namespace SFB {
 	namespace Audio {
 
 		/*! @brief Common PCM audio formats */
-		typedef CF_ENUM(uint32_t, CommonPCMFormat) {
+		enum CommonPCMFormat : uint32_t {
 			kCommonPCMFormatFloat32 			= 1, 		/*!< Native-endian \c float */
 			kCommonPCMFormatFloat64 			= 2, 		/*!< Native-endian \c double */
 			kCommonPCMFormatInt16 				= 3, 		/*!< Native-endian signed 16-bit integers */
@@ -125,8 +132,10 @@ namespace SFB {
 			//@}
 
 
+#if defined(__APPLE__)
 			/*! @brief Returns a string representation of this format suitable for logging */
 			CFString Description() const noexcept;
+#endif
 
 		};
 
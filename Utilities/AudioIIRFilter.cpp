@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+
+#include "AudioIIRFilter.h"
+
+namespace {
+
+	/// Two \c double lanes
+	typedef double vdouble2 __attribute__((vector_size(16)));
+	/// Four \c double lanes
+	typedef double vdouble4 __attribute__((vector_size(32)));
+
+	/// Applies a section of order \c Order to \c x, updating the delay elements in \c state, and returns the output
+	template <typename V, unsigned Order>
+	inline V FilterFrame(const double *b, const double *a, V *state, V x) noexcept
+	{
+		const V y = b[0] * x + state[0];
+		for(unsigned i = 1; i < Order; ++i)
+			state[i - 1] = state[i] + b[i] * x - a[i] * y;
+		state[Order - 1] = b[Order] * x - a[Order] * y;
+		return y;
+	}
+
+	/// Applies a section of runtime order \c order to \c x, updating the delay elements in \c state, and returns the output
+	template <typename V>
+	inline V FilterFrame(const double *b, const double *a, unsigned order, V *state, V x) noexcept
+	{
+		// Dispatching to a fixed order allows the tap loop to be unrolled
+		switch(order) {
+			case 1:		return FilterFrame<V, 1>(b, a, state, x);
+			case 2:		return FilterFrame<V, 2>(b, a, state, x);
+			case 3:		return FilterFrame<V, 3>(b, a, state, x);
+			case 4:		return FilterFrame<V, 4>(b, a, state, x);
+			case 5:		return FilterFrame<V, 5>(b, a, state, x);
+			case 6:		return FilterFrame<V, 6>(b, a, state, x);
+			case 7:		return FilterFrame<V, 7>(b, a, state, x);
+			case 8:		return FilterFrame<V, 8>(b, a, state, x);
+			case 9:		return FilterFrame<V, 9>(b, a, state, x);
+			case 10:	return FilterFrame<V, 10>(b, a, state, x);
+			case 11:	return FilterFrame<V, 11>(b, a, state, x);
+			case 12:	return FilterFrame<V, 12>(b, a, state, x);
+			default:	return x;
+		}
+	}
+
+	/// The cutoff frequency of the anti-aliasing filter as a fraction of the decimated sample rate
+	constexpr double kDecimationFilterCutoff = 0.47;
+
+	/// The maximum length of the anti-aliasing filter
+	constexpr unsigned kMaximumDecimationFilterLength = SFB::Audio::IIRFilter::kMaximumDecimation * SFB::Audio::IIRFilter::kDecimationFilterPeriods;
+
+}
+
+/// Delay elements for four channels
+struct SFB::Audio::IIRFilter::GroupState {
+	/// Transposed direct form II state for each section, one channel per lane
+	vdouble4 mState [kMaximumSections * kMaximumOrder];
+	/// Anti-aliasing filter input history, stored twice so the most recent frames are always contiguous
+	vdouble4 mHistory [2 * kMaximumDecimationFilterLength];
+	/// The position in \c mHistory of the oldest frame
+	unsigned mHistoryPosition;
+};
+
+namespace {
+
+	/// The parameters of a call to \c FilterGroup()
+	template <typename Section>
+	struct FilterParameters {
+		/// The sections
+		const Section *mSections;
+		/// The number of sections
+		unsigned mSectionCount;
+		/// The decimation factor
+		unsigned mDecimation;
+		/// The anti-aliasing filter taps
+		const double *mDecimationFilter;
+		/// The number of input frames since the last output frame
+		unsigned mPhase;
+	};
+
+	/// Filters \c LaneCount channels through a cascade of sections using vectors of type \c V
+	template <typename V, uint32_t LaneCount, typename Section, typename GroupState>
+	void FilterGroup(const FilterParameters<Section>& parameters, GroupState& state, const float * const *input, float * const *output, size_t frameCount, float *peaks) noexcept
+	{
+		constexpr unsigned maximumOrder = SFB::Audio::IIRFilter::kMaximumOrder;
+		const unsigned sectionCount = parameters.mSectionCount;
+		const unsigned decimation = parameters.mDecimation;
+		const unsigned decimationFilterLength = decimation > 1 ? decimation * SFB::Audio::IIRFilter::kDecimationFilterPeriods : 0;
+
+		// Two-lane groups use the narrower vector to avoid wasted work on targets without 256-bit registers.
+		// Unused lanes are zeroed to keep them free of denormals and NaNs.
+		V s [SFB::Audio::IIRFilter::kMaximumSections * maximumOrder] = {};
+		for(unsigned i = 0; i < sectionCount * maximumOrder; ++i)
+			for(uint32_t lane = 0; lane < LaneCount; ++lane)
+				s[i][lane] = state.mState[i][lane];
+
+		V h [2 * kMaximumDecimationFilterLength] = {};
+		for(unsigned i = 0; i < 2 * decimationFilterLength; ++i)
+			for(uint32_t lane = 0; lane < LaneCount; ++lane)
+				h[i][lane] = state.mHistory[i][lane];
+		unsigned historyPosition = state.mHistoryPosition;
+
+		float peak [LaneCount];
+		for(uint32_t lane = 0; lane < LaneCount; ++lane)
+			peak[lane] = peaks ? peaks[lane] : 0;
+
+		unsigned phase = parameters.mPhase;
+		size_t outputFrame = 0;
+		for(size_t frame = 0; frame < frameCount; ++frame) {
+			V x = {};
+			for(uint32_t lane = 0; lane < LaneCount; ++lane) {
+				const float sample = input[lane][frame];
+				peak[lane] = std::max(peak[lane], std::fabs(sample));
+				x[lane] = sample;
+			}
+
+			if(decimationFilterLength) {
+				h[historyPosition] = x;
+				h[historyPosition + decimationFilterLength] = x;
+				if(++historyPosition == decimationFilterLength)
+					historyPosition = 0;
+
+				if(++phase < decimation)
+					continue;
+				phase = 0;
+
+				// The filter is symmetric with an even length so mirrored frames share a tap
+				x = V{};
+				const V *history = h + historyPosition;
+				for(unsigned i = 0, j = decimationFilterLength - 1; i < j; ++i, --j)
+					x += parameters.mDecimationFilter[i] * (history[i] + history[j]);
+			}
+
+			for(unsigned section = 0; section < sectionCount; ++section)
+				x = FilterFrame(parameters.mSections[section].mB, parameters.mSections[section].mA, parameters.mSections[section].mOrder, s + section * maximumOrder, x);
+
+			for(uint32_t lane = 0; lane < LaneCount; ++lane)
+				output[lane][outputFrame] = static_cast<float>(x[lane]);
+			++outputFrame;
+		}
+
+		for(unsigned i = 0; i < sectionCount * maximumOrder; ++i)
+			for(uint32_t lane = 0; lane < LaneCount; ++lane)
+				state.mState[i][lane] = s[i][lane];
+
+		for(unsigned i = 0; i < 2 * decimationFilterLength; ++i)
+			for(uint32_t lane = 0; lane < LaneCount; ++lane)
+				state.mHistory[i][lane] = h[i][lane];
+		state.mHistoryPosition = historyPosition;
+
+		if(peaks)
+			for(uint32_t lane = 0; lane < LaneCount; ++lane)
+				peaks[lane] = peak[lane];
+	}
+
+}
+
+#pragma mark Creation and Destruction
+
+SFB::Audio::IIRFilter::IIRFilter() noexcept
+	: mChannelCount(0), mSectionCount(0), mSections{}, mDecimation(1), mPhase(0), mDecimationFilter{}, mState(nullptr)
+{}
+
+SFB::Audio::IIRFilter::~IIRFilter()
+{
+	delete [] mState;
+}
+
+#pragma mark Configuration
+
+bool SFB::Audio::IIRFilter::Initialize(uint32_t channelCount) noexcept
+{
+	if(channelCount == 0)
+		return false;
+
+	delete [] mState;
+	mState = new (std::nothrow) GroupState [(channelCount + 3) / 4];
+	if(!mState)
+		return false;
+
+	mChannelCount = channelCount;
+	mSectionCount = 0;
+	mDecimation = 1;
+
+	Reset();
+
+	return true;
+}
+
+bool SFB::Audio::IIRFilter::AddSection(const double *b, const double *a, unsigned order) noexcept
+{
+	if(!mState || mSectionCount == kMaximumSections || !b || !a || order == 0 || order > kMaximumOrder || a[0] == 0)
+		return false;
+
+	auto& section = mSections[mSectionCount];
+	std::memset(&section, 0, sizeof section);
+	section.mOrder = order;
+	for(unsigned i = 0; i <= order; ++i) {
+		section.mB[i] = b[i] / a[0];
+		section.mA[i] = a[i] / a[0];
+	}
+
+	++mSectionCount;
+
+	Reset();
+
+	return true;
+}
+
+bool SFB::Audio::IIRFilter::SetDecimation(unsigned factor) noexcept
+{
+	if(!mState || factor == 0 || factor > kMaximumDecimation)
+		return false;
+
+	mDecimation = factor;
+
+	std::memset(mDecimationFilter, 0, sizeof mDecimationFilter);
+	if(factor > 1) {
+		// Blackman-windowed sinc with its cutoff below the decimated Nyquist frequency so the transition band is
+		// attenuated before it aliases
+		const unsigned length = factor * kDecimationFilterPeriods;
+		const double center = (length - 1) / 2.;
+		double sum = 0;
+		for(unsigned i = 0; i < length; ++i) {
+			const double t = 2 * kDecimationFilterCutoff * (i - center) / factor;
+			const double sinc = t == 0 ? 1 : std::sin(M_PI * t) / (M_PI * t);
+			const double phi = 2 * M_PI * i / (length - 1);
+			const double window = 0.42 - 0.5 * std::cos(phi) + 0.08 * std::cos(2 * phi);
+			mDecimationFilter[i] = sinc * window;
+			sum += mDecimationFilter[i];
+		}
+
+		// Normalize for unity gain at DC
+		for(unsigned i = 0; i < length; ++i)
+			mDecimationFilter[i] /= sum;
+	}
+
+	Reset();
+
+	return true;
+}
+
+void SFB::Audio::IIRFilter::Reset() noexcept
+{
+	mPhase = 0;
+	if(!mState)
+		return;
+	std::memset(mState, 0, ((mChannelCount + 3) / 4) * sizeof(GroupState));
+}
+
+#pragma mark Processing
+
+size_t SFB::Audio::IIRFilter::Process(const float * const *input, float * const *output, size_t frameCount, float *peaks) noexcept
+{
+	if(!mState || !mSectionCount || !input || !output)
+		return 0;
+
+	const FilterParameters<Section> parameters = { mSections, mSectionCount, mDecimation, mDecimationFilter, mPhase };
+
+	for(uint32_t group = 0; group < (mChannelCount + 3) / 4; ++group) {
+		const uint32_t firstChannel = 4 * group;
+		auto& state = mState[group];
+		const auto groupInput = input + firstChannel;
+		const auto groupOutput = output + firstChannel;
+		const auto groupPeaks = peaks ? peaks + firstChannel : nullptr;
+		switch(std::min(4u, mChannelCount - firstChannel)) {
+			case 1:		FilterGroup<vdouble2, 1>(parameters, state, groupInput, groupOutput, frameCount, groupPeaks);		break;
+			case 2:		FilterGroup<vdouble2, 2>(parameters, state, groupInput, groupOutput, frameCount, groupPeaks);		break;
+			case 3:		FilterGroup<vdouble4, 3>(parameters, state, groupInput, groupOutput, frameCount, groupPeaks);		break;
+			case 4:		FilterGroup<vdouble4, 4>(parameters, state, groupInput, groupOutput, frameCount, groupPeaks);		break;
+		}
+	}
+
+	const size_t outputFrameCount = (mPhase + frameCount) / mDecimation;
+	mPhase = static_cast<unsigned>((mPhase + frameCount) % mDecimation);
+	return outputFrameCount;
+}
@@ -0,0 +1,414 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include <AudioToolbox/AudioToolbox.h>
+
+#include "AudioLoudnessMeter.h"
+
+namespace {
+
+	/// Four \c float lanes
+	typedef float vfloat4 __attribute__((vector_size(16)));
+
+	/// Returns the sum of the squares of \c count samples
+	inline double SumOfSquares(const float *samples, size_t count) noexcept
+	{
+		vfloat4 sum = {};
+		size_t i = 0;
+		for(; i + 4 <= count; i += 4) {
+			vfloat4 x;
+			std::memcpy(&x, samples + i, sizeof x);
+			sum += x * x;
+		}
+
+		double result = static_cast<double>(sum[0]) + sum[1] + sum[2] + sum[3];
+		for(; i < count; ++i)
+			result += static_cast<double>(samples[i]) * samples[i];
+		return result;
+	}
+
+	/// Returns the loudness in LUFS corresponding to the weighted mean square \c z
+	inline double LoudnessForMeanSquare(double z) noexcept
+	{
+		return z > 0 ? -0.691 + 10 * std::log10(z) : SFB::Audio::LoudnessMeter::kSilence;
+	}
+
+	/// Returns the weighted mean square corresponding to the loudness \c loudness in LUFS
+	inline double MeanSquareForLoudness(double loudness) noexcept
+	{
+		return std::pow(10, (loudness + 0.691) / 10);
+	}
+
+	/// The absolute gate, in LUFS
+	constexpr double kAbsoluteGate = -70;
+	/// The relative gate for integrated loudness, in LU
+	constexpr double kIntegratedRelativeGate = -10;
+	/// The relative gate for loudness range, in LU
+	constexpr double kLoudnessRangeRelativeGate = -20;
+
+	/// Returns the channel labels in \c channelLayout or an empty vector if they could not be determined
+	std::vector<AudioChannelLabel> ChannelLabelsForLayout(const AudioChannelLayout *channelLayout)
+	{
+		std::unique_ptr<uint8_t []> expandedLayout;
+
+		if(channelLayout->mChannelLayoutTag != kAudioChannelLayoutTag_UseChannelDescriptions) {
+			AudioFormatPropertyID property = kAudioFormatProperty_ChannelLayoutForTag;
+			const void *specifier = &channelLayout->mChannelLayoutTag;
+			UInt32 specifierSize = sizeof(channelLayout->mChannelLayoutTag);
+			if(channelLayout->mChannelLayoutTag == kAudioChannelLayoutTag_UseChannelBitmap) {
+				property = kAudioFormatProperty_ChannelLayoutForBitmap;
+				specifier = &channelLayout->mChannelBitmap;
+				specifierSize = sizeof(channelLayout->mChannelBitmap);
+			}
+
+			UInt32 size = 0;
+			OSStatus result = AudioFormatGetPropertyInfo(property, specifierSize, specifier, &size);
+			if(result != noErr)
+				return {};
+
+			expandedLayout.reset(new uint8_t [size]);
+			result = AudioFormatGetProperty(property, specifierSize, specifier, &size, expandedLayout.get());
+			if(result != noErr)
+				return {};
+
+			channelLayout = reinterpret_cast<const AudioChannelLayout *>(expandedLayout.get());
+		}
+
+		std::vector<AudioChannelLabel> channelLabels;
+		for(UInt32 i = 0; i < channelLayout->mNumberChannelDescriptions; ++i)
+			channelLabels.push_back(channelLayout->mChannelDescriptions[i].mChannelLabel);
+		return channelLabels;
+	}
+
+}
+
+#pragma mark Channel Weights
+
+float SFB::Audio::LoudnessMeter::ChannelWeightForLabel(AudioChannelLabel channelLabel) noexcept
+{
+	switch(channelLabel) {
+		case kAudioChannelLabel_LFEScreen:
+		case kAudioChannelLabel_LFE2:
+			return 0;
+
+		case kAudioChannelLabel_LeftSurround:
+		case kAudioChannelLabel_RightSurround:
+		case kAudioChannelLabel_CenterSurround:
+		case kAudioChannelLabel_LeftSurroundDirect:
+		case kAudioChannelLabel_RightSurroundDirect:
+		case kAudioChannelLabel_RearSurroundLeft:
+		case kAudioChannelLabel_RearSurroundRight:
+			return 1.41f;
+
+		default:
+			return 1;
+	}
+}
+
+std::vector<float> SFB::Audio::LoudnessMeter::ChannelWeightsForLayout(const AudioChannelLayout *channelLayout, uint32_t channelCount)
+{
+	std::vector<float> channelWeights(channelCount, 1);
+
+	std::vector<AudioChannelLabel> channelLabels;
+	if(channelLayout)
+		channelLabels = ChannelLabelsForLayout(channelLayout);
+
+	if(channelLabels.size() == channelCount) {
+		for(uint32_t i = 0; i < channelCount; ++i)
+			channelWeights[i] = ChannelWeightForLabel(channelLabels[i]);
+	}
+	// Unlabeled 5.1 and 7.1 audio is assumed to use the WAVE channel order (L R C LFE followed by the surrounds)
+	else if(channelCount == 6 || channelCount == 8) {
+		channelWeights[3] = 0;
+		for(uint32_t i = 4; i < channelCount; ++i)
+			channelWeights[i] = ChannelWeightForLabel(kAudioChannelLabel_LeftSurround);
+	}
+
+	return channelWeights;
+}
+
+#pragma mark Creation and Destruction
+
+SFB::Audio::LoudnessMeter::LoudnessMeter() noexcept
+	: mChannelCount(0), mSampleRate(0), mIntervalLength(0), mIntervalFramesProcessed(0), mIntervalSum(0), mIntervals{}, mIntervalPosition(0), mIntervalCount(0), mFramesProcessed(0), mMaximumMomentaryLoudness(kSilence), mMaximumShortTermLoudness(kSilence)
+{}
+
+SFB::Audio::LoudnessMeter::~LoudnessMeter() = default;
+
+#pragma mark Configuration
+
+bool SFB::Audio::LoudnessMeter::Initialize(uint32_t channelCount, double sampleRate, const float *channelWeights) noexcept
+{
+	if(channelCount == 0 || !(sampleRate >= 1000))
+		return false;
+
+	mScratch.reset();
+
+	if(!mFilter.Initialize(channelCount))
+		return false;
+
+	// The K-weighting pre-filter and RLB highpass, with the analog prototypes of ITU-R BS.1770 realized at any sample rate
+	{
+		const double f0 = 1681.974450955533;
+		const double G = 3.999843853973347;
+		const double Q = 0.7071752369554196;
+
+		const double K = std::tan(M_PI * f0 / sampleRate);
+		const double Vh = std::pow(10, G / 20);
+		const double Vb = std::pow(Vh, 0.4996667741545416);
+
+		const double a0 = 1 + K / Q + K * K;
+		const double b [] = { (Vh + Vb * K / Q + K * K) / a0, 2 * (K * K - Vh) / a0, (Vh - Vb * K / Q + K * K) / a0 };
+		const double a [] = { 1, 2 * (K * K - 1) / a0, (1 - K / Q + K * K) / a0 };
+		if(!mFilter.AddSection(b, a, 2))
+			return false;
+	}
+
+	{
+		const double f0 = 38.13547087602444;
+		const double Q = 0.5003270373238773;
+
+		const double K = std::tan(M_PI * f0 / sampleRate);
+
+		const double a0 = 1 + K / Q + K * K;
+		const double b [] = { 1, -2, 1 };
+		const double a [] = { 1, 2 * (K * K - 1) / a0, (1 - K / Q + K * K) / a0 };
+		if(!mFilter.AddSection(b, a, 2))
+			return false;
+	}
+
+	std::unique_ptr<float []> weights(new (std::nothrow) float [channelCount]);
+	std::unique_ptr<float []> scratch(new (std::nothrow) float [channelCount * kScratchFrameCount]);
+	std::unique_ptr<float * []> scratchBuffers(new (std::nothrow) float * [channelCount]);
+	std::unique_ptr<const float * []> inputBuffers(new (std::nothrow) const float * [channelCount]);
+	std::unique_ptr<uint32_t []> blockCounts(new (std::nothrow) uint32_t [kBinCount]);
+	std::unique_ptr<double []> blockSums(new (std::nothrow) double [kBinCount]);
+	std::unique_ptr<uint32_t []> shortTermCounts(new (std::nothrow) uint32_t [kBinCount]);
+	std::unique_ptr<double []> shortTermSums(new (std::nothrow) double [kBinCount]);
+	if(!weights || !scratch || !scratchBuffers || !inputBuffers || !blockCounts || !blockSums || !shortTermCounts || !shortTermSums)
+		return false;
+
+	for(uint32_t i = 0; i < channelCount; ++i) {
+		weights[i] = channelWeights ? channelWeights[i] : 1;
+		scratchBuffers[i] = scratch.get() + i * kScratchFrameCount;
+	}
+
+	mChannelCount = channelCount;
+	mSampleRate = sampleRate;
+	mIntervalLength = static_cast<uint32_t>(std::llround(sampleRate / 10));
+
+	mChannelWeights = std::move(weights);
+	mScratch = std::move(scratch);
+	mScratchBuffers = std::move(scratchBuffers);
+	mInputBuffers = std::move(inputBuffers);
+	mBlockCounts = std::move(blockCounts);
+	mBlockSums = std::move(blockSums);
+	mShortTermCounts = std::move(shortTermCounts);
+	mShortTermSums = std::move(shortTermSums);
+
+	Reset();
+
+	return true;
+}
+
+void SFB::Audio::LoudnessMeter::Reset() noexcept
+{
+	mFilter.Reset();
+
+	mIntervalFramesProcessed = 0;
+	mIntervalSum = 0;
+	std::fill_n(mIntervals, kShortTermIntervals, 0);
+	mIntervalPosition = 0;
+	mIntervalCount = 0;
+	mFramesProcessed = 0;
+
+	mMaximumMomentaryLoudness = kSilence;
+	mMaximumShortTermLoudness = kSilence;
+
+	if(!mScratch)
+		return;
+
+	std::fill_n(mBlockCounts.get(), kBinCount, 0);
+	std::fill_n(mBlockSums.get(), kBinCount, 0);
+	std::fill_n(mShortTermCounts.get(), kBinCount, 0);
+	std::fill_n(mShortTermSums.get(), kBinCount, 0);
+}
+
+#pragma mark Processing
+
+void SFB::Audio::LoudnessMeter::Process(const float * const *buffers, size_t frameCount) noexcept
+{
+	if(!mScratch || !buffers)
+		return;
+
+	size_t framesRemaining = frameCount;
+	while(framesRemaining > 0) {
+		const size_t offset = frameCount - framesRemaining;
+		const size_t framesToFilter = std::min(framesRemaining, static_cast<size_t>(kScratchFrameCount));
+
+		for(uint32_t i = 0; i < mChannelCount; ++i)
+			mInputBuffers[i] = buffers[i] + offset;
+		mFilter.Process(mInputBuffers.get(), mScratchBuffers.get(), framesToFilter);
+
+		// Divide the filtered audio at interval boundaries
+		size_t framesFiltered = 0;
+		while(framesFiltered < framesToFilter) {
+			const size_t framesToAccumulate = std::min(framesToFilter - framesFiltered, static_cast<size_t>(mIntervalLength - mIntervalFramesProcessed));
+			Accumulate(framesFiltered, framesToAccumulate);
+			framesFiltered += framesToAccumulate;
+			mIntervalFramesProcessed += framesToAccumulate;
+			if(mIntervalFramesProcessed == mIntervalLength)
+				FinishInterval();
+		}
+
+		framesRemaining -= framesToFilter;
+	}
+
+	mFramesProcessed += frameCount;
+}
+
+void SFB::Audio::LoudnessMeter::Accumulate(size_t offset, size_t frameCount) noexcept
+{
+	for(uint32_t i = 0; i < mChannelCount; ++i) {
+		if(mChannelWeights[i] != 0)
+			mIntervalSum += mChannelWeights[i] * SumOfSquares(mScratchBuffers[i] + offset, frameCount);
+	}
+}
+
+void SFB::Audio::LoudnessMeter::FinishInterval() noexcept
+{
+	mIntervals[mIntervalPosition] = mIntervalSum;
+	mIntervalPosition = (mIntervalPosition + 1) % kShortTermIntervals;
+	++mIntervalCount;
+
+	mIntervalSum = 0;
+	mIntervalFramesProcessed = 0;
+
+	// Each gating block and short-term value is stored in the bin containing its loudness
+	auto record = [](uint32_t *counts, double *sums, double meanSquare) noexcept {
+		const double loudness = LoudnessForMeanSquare(meanSquare);
+		if(loudness < kAbsoluteGate)
+			return;
+		const auto bin = std::min(static_cast<unsigned>((loudness - kAbsoluteGate) * kBinsPerLU), kBinCount - 1);
+		++counts[bin];
+		sums[bin] += meanSquare;
+	};
+
+	if(mIntervalCount >= 4) {
+		const double meanSquare = MeanSquare(4);
+		mMaximumMomentaryLoudness = std::max(mMaximumMomentaryLoudness, LoudnessForMeanSquare(meanSquare));
+		record(mBlockCounts.get(), mBlockSums.get(), meanSquare);
+	}
+
+	if(mIntervalCount >= kShortTermIntervals) {
+		const double meanSquare = MeanSquare(kShortTermIntervals);
+		mMaximumShortTermLoudness = std::max(mMaximumShortTermLoudness, LoudnessForMeanSquare(meanSquare));
+		record(mShortTermCounts.get(), mShortTermSums.get(), meanSquare);
+	}
+}
+
+double SFB::Audio::LoudnessMeter::MeanSquare(unsigned count) const noexcept
+{
+	double sum = 0;
+	for(unsigned i = 1; i <= count; ++i)
+		sum += mIntervals[(mIntervalPosition + kShortTermIntervals - i) % kShortTermIntervals];
+	return sum / (static_cast<double>(count) * mIntervalLength);
+}
+
+#pragma mark Measurements
+
+double SFB::Audio::LoudnessMeter::MomentaryLoudness() const noexcept
+{
+	if(mIntervalCount < 4)
+		return kSilence;
+	return LoudnessForMeanSquare(MeanSquare(4));
+}
+
+double SFB::Audio::LoudnessMeter::ShortTermLoudness() const noexcept
+{
+	if(mIntervalCount < kShortTermIntervals)
+		return kSilence;
+	return LoudnessForMeanSquare(MeanSquare(kShortTermIntervals));
+}
+
+double SFB::Audio::LoudnessMeter::IntegratedLoudness() const noexcept
+{
+	if(!mScratch)
+		return kSilence;
+
+	// All stored blocks passed the absolute gate
+	uint64_t count = 0;
+	double sum = 0;
+	for(unsigned bin = 0; bin < kBinCount; ++bin) {
+		count += mBlockCounts[bin];
+		sum += mBlockSums[bin];
+	}
+
+	if(count == 0)
+		return kSilence;
+
+	const double relativeGate = LoudnessForMeanSquare(sum / count) + kIntegratedRelativeGate;
+	const double relativeGateMeanSquare = MeanSquareForLoudness(relativeGate);
+
+	// The bin containing the relative gate is split by comparing the mean square of its blocks to the gate
+	count = 0;
+	sum = 0;
+	const auto firstBin = static_cast<unsigned>(std::max(0., (relativeGate - kAbsoluteGate) * kBinsPerLU));
+	for(unsigned bin = firstBin; bin < kBinCount; ++bin) {
+		if(!mBlockCounts[bin] || (bin == firstBin && mBlockSums[bin] / mBlockCounts[bin] < relativeGateMeanSquare))
+			continue;
+		count += mBlockCounts[bin];
+		sum += mBlockSums[bin];
+	}
+
+	if(count == 0)
+		return kSilence;
+
+	return LoudnessForMeanSquare(sum / count);
+}
+
+double SFB::Audio::LoudnessMeter::LoudnessRange() const noexcept
+{
+	if(!mScratch)
+		return 0;
+
+	uint64_t count = 0;
+	double sum = 0;
+	for(unsigned bin = 0; bin < kBinCount; ++bin) {
+		count += mShortTermCounts[bin];
+		sum += mShortTermSums[bin];
+	}
+
+	if(count == 0)
+		return 0;
+
+	const double relativeGate = LoudnessForMeanSquare(sum / count) + kLoudnessRangeRelativeGate;
+	const auto firstBin = static_cast<unsigned>(std::max(0., std::ceil((relativeGate - kAbsoluteGate) * kBinsPerLU)));
+
+	count = 0;
+	for(unsigned bin = firstBin; bin < kBinCount; ++bin)
+		count += mShortTermCounts[bin];
+
+	if(count == 0)
+		return 0;
+
+	// The loudness range is the difference between the 10th and 95th percentiles of the gated short-term loudness distribution
+	auto percentile = [&](double p) noexcept {
+		const auto target = static_cast<uint64_t>(std::llround(p * (count - 1)));
+		uint64_t seen = 0;
+		for(unsigned bin = firstBin; bin < kBinCount; ++bin) {
+			seen += mShortTermCounts[bin];
+			if(seen > target)
+				return kAbsoluteGate + (bin + 0.5) / kBinsPerLU;
+		}
+		return kAbsoluteGate + static_cast<double>(kBinCount) / kBinsPerLU;
+	};
+
+	return percentile(0.95) - percentile(0.10);
+}
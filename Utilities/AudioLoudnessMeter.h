@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <CoreAudio/CoreAudioTypes.h>
+
+#include "AudioIIRFilter.h"
+
+/*! @file AudioLoudnessMeter.h @brief ITU-R BS.1770 loudness measurement */
+
+/*! @brief \c SFBAudioEngine's encompassing namespace */
+namespace SFB {
+
+	/*! @brief %Audio functionality */
+	namespace Audio {
+
+		/*!
+		 * @brief Measures the loudness of non-interleaved \c float audio as specified in ITU-R BS.1770 and EBU R 128.
+		 *
+		 * Audio is K-weighted and the weighted mean square of each 100 ms interval is recorded. Momentary loudness is measured
+		 * over the most recent 400 ms and short-term loudness over the most recent 3 s, both updated every 100 ms.
+		 *
+		 * Gating blocks and short-term values are accumulated into histograms with a resolution of 0.01 LU, so memory use is
+		 * constant and the integrated loudness and loudness range may be queried at any time.
+		 *
+		 * Processing performs no allocation. This class is not thread safe.
+		 */
+		class LoudnessMeter
+		{
+		public:
+			/*! @brief The loudness reported when insufficient audio has been processed */
+			static constexpr double kSilence = -HUGE_VAL;
+
+			// ========================================
+			/*! @name Channel Weights */
+			//@{
+
+			/*! @brief Returns the weight of a channel with label \c channelLabel */
+			static float ChannelWeightForLabel(AudioChannelLabel channelLabel) noexcept;
+
+			/*!
+			 * @brief Returns the weight of each channel in \c channelLayout
+			 *
+			 * LFE channels are excluded and surround channels are weighted by 1.41. If the channel labels cannot be determined
+			 * 6 and 8 channel audio is assumed to use the WAVE channel order and other channels are given equal weight.
+			 * @param channelLayout The channel layout or \c nullptr if unknown
+			 * @param channelCount The number of channels
+			 * @return The channel weights
+			 */
+			static std::vector<float> ChannelWeightsForLayout(const AudioChannelLayout *channelLayout, uint32_t channelCount);
+
+			//@}
+
+
+			// ========================================
+			/*! @name Creation and Destruction */
+			//@{
+
+			/*! @brief A \c std::unique_ptr for \c LoudnessMeter objects */
+			using unique_ptr = std::unique_ptr<LoudnessMeter>;
+
+			/*!
+			 * @brief Create a new \c LoudnessMeter
+			 * @note Initialize() must be called before the object may be used.
+			 */
+			LoudnessMeter() noexcept;
+
+			/*! @brief Destroy the \c LoudnessMeter and release all associated resources. */
+			~LoudnessMeter();
+
+			/*! @cond */
+
+			/*! @internal This class is non-copyable */
+			LoudnessMeter(const LoudnessMeter& rhs) = delete;
+
+			/*! @internal This class is non-assignable */
+			LoudnessMeter& operator=(const LoudnessMeter& rhs) = delete;
+
+			/*! @endcond */
+
+			//@}
+
+
+			// ========================================
+			/*! @name Configuration */
+			//@{
+
+			/*!
+			 * @brief Prepare to measure audio
+			 * @param channelCount The number of channels
+			 * @param sampleRate The sample rate of the audio
+			 * @param channelWeights An array of \c channelCount channel weights or \c nullptr to weight all channels equally
+			 * @return \c true on success, \c false on error
+			 */
+			bool Initialize(uint32_t channelCount, double sampleRate, const float *channelWeights = nullptr) noexcept;
+
+			/*! @brief Discard all measurements */
+			void Reset() noexcept;
+
+			/*! @brief Returns \c true if this \c LoudnessMeter has been initialized */
+			inline bool IsInitialized() const noexcept				{ return mScratch != nullptr; }
+
+			/*! @brief Returns the number of channels */
+			inline uint32_t ChannelCount() const noexcept			{ return mChannelCount; }
+
+			/*! @brief Returns the sample rate */
+			inline double SampleRate() const noexcept				{ return mSampleRate; }
+
+			//@}
+
+
+			// ========================================
+			/*! @name Processing */
+			//@{
+
+			/*!
+			 * @brief Measure audio
+			 * @param buffers An array of pointers to the non-interleaved samples of each channel
+			 * @param frameCount The number of frames to process
+			 */
+			void Process(const float * const *buffers, size_t frameCount) noexcept;
+
+			/*! @brief Returns the number of frames processed */
+			inline uint64_t FramesProcessed() const noexcept		{ return mFramesProcessed; }
+
+			//@}
+
+
+			// ========================================
+			/*! @name Measurements */
+			//@{
+
+			/*! @brief Returns the momentary loudness in LUFS or \c kSilence if less than 400 ms has been processed */
+			double MomentaryLoudness() const noexcept;
+
+			/*! @brief Returns the short-term loudness in LUFS or \c kSilence if less than 3 s has been processed */
+			double ShortTermLoudness() const noexcept;
+
+			/*! @brief Returns the largest momentary loudness in LUFS */
+			inline double MaximumMomentaryLoudness() const noexcept	{ return mMaximumMomentaryLoudness; }
+
+			/*! @brief Returns the largest short-term loudness in LUFS */
+			inline double MaximumShortTermLoudness() const noexcept	{ return mMaximumShortTermLoudness; }
+
+			/*! @brief Returns the gated integrated loudness in LUFS or \c kSilence if no gating block exceeds the absolute gate */
+			double IntegratedLoudness() const noexcept;
+
+			/*! @brief Returns the loudness range in LU as specified in EBU Tech 3342 */
+			double LoudnessRange() const noexcept;
+
+			//@}
+
+		private:
+
+			/*! @internal The number of 100 ms intervals in the short-term window */
+			static constexpr unsigned kShortTermIntervals = 30;
+
+			/*! @internal The number of histogram bins per LU */
+			static constexpr unsigned kBinsPerLU = 100;
+
+			/*! @internal The number of histogram bins, spanning the absolute gate at -70 LUFS to +10 LUFS */
+			static constexpr unsigned kBinCount = 80 * kBinsPerLU;
+
+			/*! @internal The number of frames filtered at once */
+			static constexpr uint32_t kScratchFrameCount = 1024;
+
+			/*! @internal Adds the weighted sum of squares of \c frameCount frames of filtered audio starting at \c offset to the current interval */
+			void Accumulate(size_t offset, size_t frameCount) noexcept;
+
+			/*! @internal Records the completion of an interval */
+			void FinishInterval() noexcept;
+
+			/*! @internal Returns the weighted mean square of the most recent \c count intervals */
+			double MeanSquare(unsigned count) const noexcept;
+
+			uint32_t				mChannelCount;							// The number of channels
+			double					mSampleRate;							// The sample rate
+			std::unique_ptr<float []>	mChannelWeights;					// The weight of each channel
+			IIRFilter				mFilter;								// The K-weighting filter
+			std::unique_ptr<float []>	mScratch;							// Filtered audio
+			std::unique_ptr<float * []>	mScratchBuffers;					// Pointers to the filtered audio of each channel
+			std::unique_ptr<const float * []>	mInputBuffers;				// Pointers to the unfiltered audio of each channel
+
+			uint32_t				mIntervalLength;						// The number of frames in 100 ms
+			uint32_t				mIntervalFramesProcessed;				// The number of frames in the current interval
+			double					mIntervalSum;							// The weighted sum of squares of the current interval
+			double					mIntervals [kShortTermIntervals];		// The weighted sums of squares of recent intervals
+			unsigned				mIntervalPosition;						// The position in mIntervals of the next interval
+			uint64_t				mIntervalCount;							// The number of completed intervals
+			uint64_t				mFramesProcessed;						// The number of frames processed
+
+			double					mMaximumMomentaryLoudness;				// The largest momentary loudness
+			double					mMaximumShortTermLoudness;				// The largest short-term loudness
+
+			std::unique_ptr<uint32_t []>	mBlockCounts;					// Gating block counts by loudness
+			std::unique_ptr<double []>		mBlockSums;						// Gating block mean squares by loudness
+			std::unique_ptr<uint32_t []>	mShortTermCounts;				// Short-term loudness counts by loudness
+			std::unique_ptr<double []>		mShortTermSums;					// Short-term mean squares by loudness
+		};
+
+	}
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#include "AudioPCMConverter.h"
+
+namespace {
+
+	/// Returns the size of one sample in \c format in bytes
+	inline size_t BytesPerSample(const SFB::Audio::Format& format) noexcept
+	{
+		return format.mBytesPerFrame / format.InterleavedChannelCount();
+	}
+
+	/// Returns the number of buffers required to hold \c format
+	inline UInt32 BufferCount(const SFB::Audio::Format& format) noexcept
+	{
+		return format.IsInterleaved() ? 1 : format.mChannelsPerFrame;
+	}
+
+}
+
+#pragma mark Creation
+
+SFB::Audio::PCMConverter::PCMConverter() noexcept
+	: mKernel(nullptr)
+{}
+
+#pragma mark Configuration
+
+SFB::Audio::SampleEncoding SFB::Audio::PCMConverter::SampleEncodingForFormat(const Format& format) noexcept
+{
+	if(!format.IsPCM() || format.mChannelsPerFrame == 0 || format.mFramesPerPacket != 1 || format.mBytesPerFrame == 0 || format.mBytesPerFrame % format.InterleavedChannelCount())
+		return SampleEncoding::Unknown;
+
+	const auto bytesPerSample = BytesPerSample(format);
+	const auto bitsPerChannel = format.mBitsPerChannel;
+
+	if(format.IsFloat()) {
+		if(bytesPerSample == 4 && bitsPerChannel == 32)
+			return SampleEncoding::Float32;
+		if(bytesPerSample == 8 && bitsPerChannel == 64)
+			return SampleEncoding::Float64;
+		return SampleEncoding::Unknown;
+	}
+
+	if(bitsPerChannel == 0 || bitsPerChannel > 8 * bytesPerSample)
+		return SampleEncoding::Unknown;
+
+	switch(bytesPerSample) {
+		case 1:
+			if(bitsPerChannel != 8)
+				return SampleEncoding::Unknown;
+			return format.IsSignedInteger() ? SampleEncoding::Int8 : SampleEncoding::UInt8;
+		case 2:
+			return format.IsSignedInteger() && bitsPerChannel == 16 ? SampleEncoding::Int16 : SampleEncoding::Unknown;
+		case 3:
+			return format.IsSignedInteger() && bitsPerChannel == 24 ? SampleEncoding::Int24 : SampleEncoding::Unknown;
+		case 4:
+			if(!format.IsSignedInteger())
+				return SampleEncoding::Unknown;
+			if(bitsPerChannel == 32)
+				return SampleEncoding::Int32;
+			// Audio aligned high is left-justified; of the low-aligned variants only 24 bits is supported
+			if(format.IsAlignedHigh())
+				return SampleEncoding::Int32;
+			return bitsPerChannel == 24 ? SampleEncoding::Int32Low24 : SampleEncoding::Unknown;
+		default:
+			return SampleEncoding::Unknown;
+	}
+}
+
+bool SFB::Audio::PCMConverter::CanConvert(const Format& sourceFormat, const Format& destinationFormat) noexcept
+{
+	if(sourceFormat.mChannelsPerFrame != destinationFormat.mChannelsPerFrame)
+		return false;
+
+	// Writing fewer significant bits aligned high would leave garbage in the low bits
+	if(destinationFormat.IsAlignedHigh() && !destinationFormat.IsFloat() && destinationFormat.mBitsPerChannel != 8 * BytesPerSample(destinationFormat))
+		return false;
+
+	return SampleEncodingForFormat(sourceFormat) != SampleEncoding::Unknown && SampleEncodingForFormat(destinationFormat) != SampleEncoding::Unknown;
+}
+
+bool SFB::Audio::PCMConverter::Initialize(const Format& sourceFormat, const Format& destinationFormat) noexcept
+{
+	mKernel = nullptr;
+
+	if(!CanConvert(sourceFormat, destinationFormat))
+		return false;
+
+	mKernel = GetSampleConversionKernel(SampleEncodingForFormat(sourceFormat), sourceFormat.IsBigEndian(), SampleEncodingForFormat(destinationFormat), destinationFormat.IsBigEndian());
+	if(!mKernel)
+		return false;
+
+	mSourceFormat = sourceFormat;
+	mDestinationFormat = destinationFormat;
+
+	return true;
+}
+
+#pragma mark Conversion
+
+bool SFB::Audio::PCMConverter::Convert(const AudioBufferList * const source, AudioBufferList * const destination, size_t frameCount) const noexcept
+{
+	if(!mKernel || !source || !destination)
+		return false;
+
+	if(source->mNumberBuffers != BufferCount(mSourceFormat) || destination->mNumberBuffers != BufferCount(mDestinationFormat))
+		return false;
+
+	const auto sourceBytesPerSample = BytesPerSample(mSourceFormat);
+	const auto destinationBytesPerSample = BytesPerSample(mDestinationFormat);
+
+	// Interleaved channels are addressed by offset into the single buffer and advance by the frame size
+	const auto sourceStride = static_cast<ptrdiff_t>(mSourceFormat.IsInterleaved() ? mSourceFormat.mBytesPerFrame : sourceBytesPerSample);
+	const auto destinationStride = static_cast<ptrdiff_t>(mDestinationFormat.IsInterleaved() ? mDestinationFormat.mBytesPerFrame : destinationBytesPerSample);
+
+	for(UInt32 channel = 0; channel < mSourceFormat.mChannelsPerFrame; ++channel) {
+		const uint8_t *src = mSourceFormat.IsInterleaved() ? static_cast<const uint8_t *>(source->mBuffers[0].mData) + channel * sourceBytesPerSample : static_cast<const uint8_t *>(source->mBuffers[channel].mData);
+		uint8_t *dst = mDestinationFormat.IsInterleaved() ? static_cast<uint8_t *>(destination->mBuffers[0].mData) + channel * destinationBytesPerSample : static_cast<uint8_t *>(destination->mBuffers[channel].mData);
+		mKernel(src, sourceStride, dst, destinationStride, frameCount);
+	}
+
+	const auto byteSize = static_cast<UInt32>(mDestinationFormat.FrameCountToByteCount(frameCount));
+	for(UInt32 i = 0; i < destination->mNumberBuffers; ++i)
+		destination->mBuffers[i].mDataByteSize = byteSize;
+
+	return true;
+}
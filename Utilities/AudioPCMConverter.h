@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "AudioFormat.h"
+#include "Portability.h"
+#include "SampleConversion.h"
+
+/*! @file AudioPCMConverter.h @brief A PCM format converter */
+
+/*! @brief \c SFBAudioEngine's encompassing namespace */
+namespace SFB {
+
+	/*! @brief %Audio functionality */
+	namespace Audio {
+
+		/*!
+		 * @brief Converts audio between PCM formats with the same number of channels
+		 *
+		 * Sample encoding, byte order, and interleaving may differ between the source and destination formats.
+		 * The conversion kernel is selected once by Initialize() and conversion performs no allocation.
+		 * No sample rate conversion, channel mapping, or dithering is performed.
+		 */
+		class PCMConverter
+		{
+		public:
+			// ========================================
+			/*! @name Creation and Destruction */
+			//@{
+
+			/*! @brief A \c std::unique_ptr for \c PCMConverter objects */
+			using unique_ptr = std::unique_ptr<PCMConverter>;
+
+			/*!
+			 * @brief Create a new \c PCMConverter
+			 * @note Initialize() must be called before the object may be used.
+			 */
+			PCMConverter() noexcept;
+
+			/*! @cond */
+
+			/*! @internal This class is non-copyable */
+			PCMConverter(const PCMConverter& rhs) = delete;
+
+			/*! @internal This class is non-assignable */
+			PCMConverter& operator=(const PCMConverter& rhs) = delete;
+
+			/*! @endcond */
+
+			//@}
+
+
+			// ========================================
+			/*! @name Configuration */
+			//@{
+
+			/*! @brief Returns the sample encoding of \c format or \c SampleEncoding::Unknown if \c format is not supported */
+			static SampleEncoding SampleEncodingForFormat(const Format& format) noexcept;
+
+			/*! @brief Returns \c true if audio can be converted from \c sourceFormat to \c destinationFormat */
+			static bool CanConvert(const Format& sourceFormat, const Format& destinationFormat) noexcept;
+
+			/*!
+			 * @brief Prepare to convert audio from \c sourceFormat to \c destinationFormat
+			 * @param sourceFormat The format of the input audio
+			 * @param destinationFormat The desired format
+			 * @return \c true on success, \c false if the conversion is not supported
+			 */
+			bool Initialize(const Format& sourceFormat, const Format& destinationFormat) noexcept;
+
+			/*! @brief Returns \c true if this \c PCMConverter has been initialized */
+			inline bool IsInitialized() const noexcept					{ return mKernel != nullptr; }
+
+			/*! @brief Returns the source format */
+			inline const Format& SourceFormat() const noexcept			{ return mSourceFormat; }
+
+			/*! @brief Returns the destination format */
+			inline const Format& DestinationFormat() const noexcept		{ return mDestinationFormat; }
+
+			//@}
+
+
+			// ========================================
+			/*! @name Conversion */
+			//@{
+
+			/*!
+			 * @brief Convert audio
+			 * @note The \c mDataByteSize of each buffer in \c destination is set to the size of the converted audio
+			 * @param source An \c AudioBufferList in the source format
+			 * @param destination An \c AudioBufferList in the destination format with space for \c frameCount frames
+			 * @param frameCount The number of frames to convert
+			 * @return \c true on success, \c false on error
+			 */
+			bool Convert(const AudioBufferList * const source, AudioBufferList * const destination, size_t frameCount) const noexcept;
+
+			//@}
+
+		private:
+
+			Format					mSourceFormat;			// The format of the input audio
+			Format					mDestinationFormat;		// The format of the output audio
+			SampleConversionKernel	mKernel;				// The conversion kernel
+
+		};
+
+	}
+}
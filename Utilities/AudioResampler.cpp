@@ -0,0 +1,381 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "AudioResampler.h"
+
+namespace {
+
+	/// Four \c float lanes, usable with SSE and NEON
+	typedef float vfloat4 __attribute__((vector_size(16)));
+	/// Four \c float lanes without an alignment requirement
+	typedef float vfloat4_u __attribute__((vector_size(16), aligned(4)));
+
+	/// Filter design parameters for a quality preset
+	struct FilterParameters {
+		/// The number of taps when not decimating
+		uint32_t mTapCount;
+		/// The Kaiser window shape parameter
+		double mBeta;
+		/// The passband edge as a fraction of the output Nyquist frequency
+		double mRolloff;
+		/// The number of phases for the interpolated path
+		uint32_t mPhaseCount;
+	};
+
+	FilterParameters ParametersForQuality(SFB::Audio::Resampler::Quality quality) noexcept
+	{
+		switch(quality) {
+			case SFB::Audio::Resampler::Quality::Low:		return { 16, 6, 0.85, 64 };
+			case SFB::Audio::Resampler::Quality::Medium:	return { 32, 8, 0.90, 256 };
+			case SFB::Audio::Resampler::Quality::High:		return { 64, 10, 0.94, 512 };
+			case SFB::Audio::Resampler::Quality::Best:		return { 128, 12, 0.96, 1024 };
+		}
+		return { 64, 10, 0.94, 512 };
+	}
+
+	/// Returns the zeroth-order modified Bessel function of the first kind evaluated at \c x
+	double BesselI0(double x) noexcept
+	{
+		double sum = 1;
+		double term = 1;
+		const double halfX = x / 2;
+		for(int k = 1; k < 64; ++k) {
+			term *= halfX / k;
+			const double termSquared = term * term;
+			sum += termSquared;
+			if(termSquared < sum * 1e-21)
+				break;
+		}
+		return sum;
+	}
+
+	/// Returns <tt>sin(πx) / πx</tt>
+	inline double NormalizedSinc(double x) noexcept
+	{
+		if(std::fabs(x) < 1e-12)
+			return 1;
+		return std::sin(M_PI * x) / (M_PI * x);
+	}
+
+	/// Returns the greatest common divisor of \c a and \c b
+	uint64_t GreatestCommonDivisor(uint64_t a, uint64_t b) noexcept
+	{
+		while(b) {
+			auto t = a % b;
+			a = b;
+			b = t;
+		}
+		return a;
+	}
+
+	/// Returns the sum of the element-wise product of \c x and \c h
+	/// @param x The input samples, with no alignment requirement
+	/// @param h The coefficients, aligned to 16 bytes
+	/// @param count The number of elements, a multiple of 8
+	inline float DotProduct(const float *x, const float *h, uint32_t count) noexcept
+	{
+		vfloat4 a0 = { 0, 0, 0, 0 };
+		vfloat4 a1 = { 0, 0, 0, 0 };
+		for(uint32_t i = 0; i < count; i += 8) {
+			a0 += *reinterpret_cast<const vfloat4_u *>(x + i) * *reinterpret_cast<const vfloat4 *>(h + i);
+			a1 += *reinterpret_cast<const vfloat4_u *>(x + i + 4) * *reinterpret_cast<const vfloat4 *>(h + i + 4);
+		}
+		const vfloat4 s = a0 + a1;
+		return (s[0] + s[1]) + (s[2] + s[3]);
+	}
+
+	/// Stores <tt>a + t * (b - a)</tt> in \c result
+	/// @param count The number of elements, a multiple of 8
+	inline void Interpolate(float *result, const float *a, const float *b, float t, uint32_t count) noexcept
+	{
+		const vfloat4 vt = { t, t, t, t };
+		for(uint32_t i = 0; i < count; i += 4) {
+			const vfloat4 va = *reinterpret_cast<const vfloat4 *>(a + i);
+			const vfloat4 vb = *reinterpret_cast<const vfloat4 *>(b + i);
+			*reinterpret_cast<vfloat4 *>(result + i) = va + vt * (vb - va);
+		}
+	}
+
+	/// The number of input frames buffered beyond the filter length
+	const size_t kHistoryBlockFrames = 4096;
+
+}
+
+#pragma mark Creation and Destruction
+
+SFB::Audio::Resampler::Resampler() noexcept
+	: mInputRate(0), mOutputRate(0), mChannelCount(0), mFilter(nullptr), mTapCount(0), mPhaseCount(0), mInterpolation(0), mDecimation(0), mPhase(0), mStep(0), mFraction(0), mHistory(nullptr), mHistoryCapacity(0), mHistoryFrames(0), mReadIndex(0), mInputFramesTotal(0), mOutputFramesTotal(0)
+{}
+
+SFB::Audio::Resampler::~Resampler()
+{
+	Deallocate();
+}
+
+#pragma mark Configuration
+
+bool SFB::Audio::Resampler::Initialize(double inputRate, double outputRate, uint32_t channelCount, Quality quality) noexcept
+{
+	if(!(inputRate > 0) || !(outputRate > 0) || channelCount == 0)
+		return false;
+
+	Deallocate();
+
+	const auto parameters = ParametersForQuality(quality);
+
+	// Widen the filter when decimating so the transition band keeps its width relative to the output Nyquist frequency
+	const double ratio = outputRate / inputRate;
+	const double cutoff = parameters.mRolloff * std::min(1.0, ratio);
+	double tapCount = parameters.mTapCount / std::min(1.0, ratio);
+	tapCount = std::min(tapCount, static_cast<double>(parameters.mTapCount * 8));
+	mTapCount = (static_cast<uint32_t>(std::ceil(tapCount)) + 7) & ~7u;
+
+	// Integer rates with a small reduced interpolation factor use one phase per output position
+	mInterpolation = 0;
+	if(inputRate == std::floor(inputRate) && outputRate == std::floor(outputRate) && inputRate < UINT32_MAX && outputRate < UINT32_MAX) {
+		const auto input = static_cast<uint64_t>(inputRate);
+		const auto output = static_cast<uint64_t>(outputRate);
+		const auto gcd = GreatestCommonDivisor(input, output);
+		if(output / gcd <= kMaximumRationalPhaseCount) {
+			mInterpolation = static_cast<uint32_t>(output / gcd);
+			mDecimation = static_cast<uint32_t>(input / gcd);
+		}
+	}
+
+	mPhaseCount = mInterpolation ? mInterpolation : parameters.mPhaseCount;
+	mStep = static_cast<uint64_t>(std::llround(inputRate / outputRate * 4294967296.0));
+
+	// Allocate the phases, a guard phase for interpolation, and scratch space for interpolated coefficients
+	const size_t filterSize = (mPhaseCount + 2) * mTapCount * sizeof(float);
+	void *filter = nullptr;
+	if(posix_memalign(&filter, 16, filterSize))
+		return false;
+	mFilter = static_cast<float *>(filter);
+
+	// Phase p is centered between taps halfTaps - 1 and halfTaps, offset p / mPhaseCount toward the latter
+	const int halfTaps = static_cast<int>(mTapCount / 2);
+	const double betaI0 = BesselI0(parameters.mBeta);
+	for(uint32_t phase = 0; phase <= mPhaseCount; ++phase) {
+		const double offset = static_cast<double>(phase) / mPhaseCount;
+		float *coefficients = mFilter + phase * mTapCount;
+
+		double sum = 0;
+		for(uint32_t tap = 0; tap < mTapCount; ++tap) {
+			const double distance = static_cast<double>(static_cast<int>(tap) - (halfTaps - 1)) - offset;
+			const double x = distance / halfTaps;
+			const double window = std::fabs(x) < 1 ? BesselI0(parameters.mBeta * std::sqrt(1 - x * x)) / betaI0 : 0;
+			const double value = cutoff * NormalizedSinc(cutoff * distance) * window;
+			coefficients[tap] = static_cast<float>(value);
+			sum += value;
+		}
+
+		// Normalize each phase to unity gain at DC to avoid modulating the output level
+		const float scale = static_cast<float>(1 / sum);
+		for(uint32_t tap = 0; tap < mTapCount; ++tap)
+			coefficients[tap] *= scale;
+	}
+
+	// Allocate the channel pointers and history in one chunk
+	mHistoryCapacity = mTapCount + kHistoryBlockFrames + 2 * static_cast<size_t>(std::ceil(inputRate / outputRate));
+	const size_t historyBytes = mHistoryCapacity * sizeof(float);
+	const size_t allocationSize = (historyBytes + sizeof(float *)) * channelCount;
+	mHistory = static_cast<float **>(std::malloc(allocationSize));
+	if(!mHistory) {
+		Deallocate();
+		return false;
+	}
+
+	auto memoryStart = reinterpret_cast<uint8_t *>(mHistory);
+	auto historyStart = memoryStart + channelCount * sizeof(float *);
+	for(uint32_t i = 0; i < channelCount; ++i) {
+		mHistory[i] = reinterpret_cast<float *>(historyStart);
+		historyStart += historyBytes;
+	}
+
+	mInputRate = inputRate;
+	mOutputRate = outputRate;
+	mChannelCount = channelCount;
+
+	Reset();
+
+	return true;
+}
+
+void SFB::Audio::Resampler::Deallocate() noexcept
+{
+	if(mFilter) {
+		std::free(mFilter);
+		mFilter = nullptr;
+	}
+
+	if(mHistory) {
+		std::free(mHistory);
+		mHistory = nullptr;
+	}
+
+	mInputRate = 0;
+	mOutputRate = 0;
+	mChannelCount = 0;
+	mTapCount = 0;
+	mPhaseCount = 0;
+	mInterpolation = 0;
+	mDecimation = 0;
+	mHistoryCapacity = 0;
+	mHistoryFrames = 0;
+	mReadIndex = 0;
+}
+
+void SFB::Audio::Resampler::Reset() noexcept
+{
+	if(!mHistory)
+		return;
+
+	// Prime the history so the first output frame is centered on the first input frame
+	mHistoryFrames = mTapCount / 2 - 1;
+	for(uint32_t i = 0; i < mChannelCount; ++i)
+		std::memset(mHistory[i], 0, mHistoryFrames * sizeof(float));
+
+	mReadIndex = 0;
+	mPhase = 0;
+	mFraction = 0;
+	mInputFramesTotal = 0;
+	mOutputFramesTotal = 0;
+}
+
+int64_t SFB::Audio::Resampler::OutputFramesForInputFrames(int64_t inputFrames) const noexcept
+{
+	if(inputFrames <= 0 || !mFilter)
+		return 0;
+	if(mInterpolation)
+		return (inputFrames * mInterpolation + mDecimation - 1) / mDecimation;
+	return static_cast<int64_t>(std::ceil(static_cast<double>(inputFrames) * 4294967296.0 / mStep));
+}
+
+int64_t SFB::Audio::Resampler::InputFramesForOutputFrames(int64_t outputFrames) const noexcept
+{
+	if(outputFrames <= 0 || !mFilter)
+		return 0;
+	if(mInterpolation)
+		return outputFrames * mDecimation / mInterpolation;
+	return static_cast<int64_t>(std::floor(static_cast<double>(outputFrames) * mStep / 4294967296.0));
+}
+
+#pragma mark Conversion
+
+size_t SFB::Audio::Resampler::Process(const float * const *input, size_t inputFrames, size_t& framesConsumed, float * const *output, size_t outputCapacity) noexcept
+{
+	framesConsumed = 0;
+	if(!mFilter)
+		return 0;
+
+	size_t framesProduced = 0;
+	for(;;) {
+		framesProduced += Generate(output, framesProduced, outputCapacity - framesProduced);
+		if(framesProduced == outputCapacity || framesConsumed == inputFrames)
+			break;
+
+		const auto framesAppended = Append(input, framesConsumed, inputFrames - framesConsumed);
+		framesConsumed += framesAppended;
+		mInputFramesTotal += static_cast<int64_t>(framesAppended);
+	}
+
+	return framesProduced;
+}
+
+size_t SFB::Audio::Resampler::Drain(float * const *output, size_t outputCapacity) noexcept
+{
+	if(!mFilter)
+		return 0;
+
+	const auto totalFrames = OutputFramesForInputFrames(mInputFramesTotal);
+
+	size_t framesProduced = 0;
+	while(framesProduced < outputCapacity && mOutputFramesTotal < totalFrames) {
+		const auto framesRemaining = static_cast<size_t>(totalFrames - mOutputFramesTotal);
+		const auto framesGenerated = Generate(output, framesProduced, std::min(outputCapacity - framesProduced, framesRemaining));
+		framesProduced += framesGenerated;
+
+		// Pad the input with silence to complete the final filter windows
+		if(framesGenerated == 0)
+			Append(nullptr, 0, mHistoryCapacity);
+	}
+
+	return framesProduced;
+}
+
+size_t SFB::Audio::Resampler::Append(const float * const *input, size_t offset, size_t frameCount) noexcept
+{
+	// Discard input that has passed out of the filter window
+	if(mHistoryFrames + frameCount > mHistoryCapacity && mReadIndex > 0) {
+		if(mReadIndex >= mHistoryFrames) {
+			mReadIndex -= mHistoryFrames;
+			mHistoryFrames = 0;
+		}
+		else {
+			const auto framesToKeep = mHistoryFrames - mReadIndex;
+			for(uint32_t i = 0; i < mChannelCount; ++i)
+				std::memmove(mHistory[i], mHistory[i] + mReadIndex, framesToKeep * sizeof(float));
+			mHistoryFrames = framesToKeep;
+			mReadIndex = 0;
+		}
+	}
+
+	const auto framesToAppend = std::min(frameCount, mHistoryCapacity - mHistoryFrames);
+	for(uint32_t i = 0; i < mChannelCount; ++i) {
+		if(input)
+			std::memcpy(mHistory[i] + mHistoryFrames, input[i] + offset, framesToAppend * sizeof(float));
+		else
+			std::memset(mHistory[i] + mHistoryFrames, 0, framesToAppend * sizeof(float));
+	}
+
+	mHistoryFrames += framesToAppend;
+	return framesToAppend;
+}
+
+size_t SFB::Audio::Resampler::Generate(float * const *output, size_t outputOffset, size_t outputCapacity) noexcept
+{
+	size_t framesGenerated = 0;
+
+	if(mInterpolation) {
+		while(framesGenerated < outputCapacity && mReadIndex + mTapCount <= mHistoryFrames) {
+			const float *coefficients = mFilter + mPhase * mTapCount;
+			for(uint32_t i = 0; i < mChannelCount; ++i)
+				output[i][outputOffset + framesGenerated] = DotProduct(mHistory[i] + mReadIndex, coefficients, mTapCount);
+
+			mPhase += mDecimation;
+			mReadIndex += mPhase / mInterpolation;
+			mPhase %= mInterpolation;
+			++framesGenerated;
+		}
+	}
+	else {
+		float *coefficients = mFilter + (mPhaseCount + 1) * mTapCount;
+		while(framesGenerated < outputCapacity && mReadIndex + mTapCount <= mHistoryFrames) {
+			// The upper 32 bits of the scaled fraction select the phase and the lower 32 bits weight its neighbor
+			const uint64_t scaled = static_cast<uint64_t>(mFraction) * mPhaseCount;
+			const auto phase = static_cast<uint32_t>(scaled >> 32);
+			const auto weight = static_cast<float>(static_cast<uint32_t>(scaled) * (1.0 / 4294967296.0));
+			const float *lower = mFilter + phase * mTapCount;
+			Interpolate(coefficients, lower, lower + mTapCount, weight, mTapCount);
+
+			for(uint32_t i = 0; i < mChannelCount; ++i)
+				output[i][outputOffset + framesGenerated] = DotProduct(mHistory[i] + mReadIndex, coefficients, mTapCount);
+
+			const uint64_t position = static_cast<uint64_t>(mFraction) + mStep;
+			mReadIndex += static_cast<size_t>(position >> 32);
+			mFraction = static_cast<uint32_t>(position);
+			++framesGenerated;
+		}
+	}
+
+	mOutputFramesTotal += static_cast<int64_t>(framesGenerated);
+	return framesGenerated;
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/*! @file AudioResampler.h @brief A polyphase sample rate converter */
+
+/*! @brief \c SFBAudioEngine's encompassing namespace */
+namespace SFB {
+
+	/*! @brief %Audio functionality */
+	namespace Audio {
+
+		/*!
+		 * @brief A windowed-sinc polyphase sample rate converter for non-interleaved \c float audio.
+		 *
+		 * When both sample rates are integers whose reduced ratio L/M has L no larger than \c kMaximumRationalPhaseCount
+		 * (for example 44.1 kHz ↔ 48 kHz, where L/M is 160/147) one filter phase is computed per output position
+		 * and no interpolation is performed. Other ratios step a 32.32 fixed-point input position and interpolate
+		 * linearly between adjacent filter phases.
+		 *
+		 * Output frame \c n corresponds exactly to input time <tt>n * inputRate / outputRate</tt>, so the converter
+		 * introduces no delay. After all input has been supplied, \c Drain() produces the remaining
+		 * <tt>ceil(inputFrames * outputRate / inputRate)</tt> output frames, allowing resampled audio to be
+		 * concatenated without gaps.
+		 *
+		 * This class is not thread safe.
+		 */
+		class Resampler
+		{
+		public:
+			/*! @brief Filter quality presets, trading stopband attenuation and passband width for processing time */
+			enum class Quality {
+				/*! 16 taps, approximately 60 dB stopband attenuation */
+				Low,
+				/*! 32 taps, approximately 80 dB stopband attenuation */
+				Medium,
+				/*! 64 taps, approximately 100 dB stopband attenuation */
+				High,
+				/*! 128 taps, approximately 120 dB stopband attenuation */
+				Best
+			};
+
+			/*! @brief The largest interpolation factor for which the rational path is used */
+			static constexpr uint32_t kMaximumRationalPhaseCount = 1024;
+
+			// ========================================
+			/*! @name Creation and Destruction */
+			//@{
+
+			/*! @brief A \c std::unique_ptr for \c Resampler objects */
+			using unique_ptr = std::unique_ptr<Resampler>;
+
+			/*!
+			 * @brief Create a new \c Resampler
+			 * @note Initialize() must be called before the object may be used.
+			 */
+			Resampler() noexcept;
+
+			/*! @brief Destroy the \c Resampler and release all associated resources. */
+			~Resampler();
+
+			/*! @cond */
+
+			/*! @internal This class is non-copyable */
+			Resampler(const Resampler& rhs) = delete;
+
+			/*! @internal This class is non-assignable */
+			Resampler& operator=(const Resampler& rhs) = delete;
+
+			/*! @endcond */
+
+			//@}
+
+
+			// ========================================
+			/*! @name Configuration */
+			//@{
+
+			/*!
+			 * @brief Prepare to convert audio from \c inputRate to \c outputRate
+			 * @note Any previously buffered audio is discarded
+			 * @param inputRate The sample rate of the input audio
+			 * @param outputRate The desired sample rate
+			 * @param channelCount The number of channels
+			 * @param quality The filter quality
+			 * @return \c true on success, \c false on error
+			 */
+			bool Initialize(double inputRate, double outputRate, uint32_t channelCount, Quality quality = Quality::High) noexcept;
+
+			/*! @brief Free the resources used by this \c Resampler */
+			void Deallocate() noexcept;
+
+			/*! @brief Discard buffered audio and return to the state following Initialize() */
+			void Reset() noexcept;
+
+			/*! @brief Returns \c true if this \c Resampler has been initialized */
+			inline bool IsInitialized() const noexcept				{ return mFilter != nullptr; }
+
+			/*! @brief Returns the input sample rate */
+			inline double InputRate() const noexcept				{ return mInputRate; }
+
+			/*! @brief Returns the output sample rate */
+			inline double OutputRate() const noexcept				{ return mOutputRate; }
+
+			/*! @brief Returns the number of channels */
+			inline uint32_t ChannelCount() const noexcept			{ return mChannelCount; }
+
+			/*! @brief Returns the number of filter taps per phase */
+			inline uint32_t TapCount() const noexcept				{ return mTapCount; }
+
+			/*! @brief Returns \c true if the rational fast path is in use */
+			inline bool IsRational() const noexcept					{ return mInterpolation != 0; }
+
+			/*! @brief Returns the number of output frames corresponding to \c inputFrames input frames, rounded up */
+			int64_t OutputFramesForInputFrames(int64_t inputFrames) const noexcept;
+
+			/*! @brief Returns the number of input frames corresponding to \c outputFrames output frames, rounded down */
+			int64_t InputFramesForOutputFrames(int64_t outputFrames) const noexcept;
+
+			//@}
+
+
+			// ========================================
+			/*! @name Conversion */
+			//@{
+
+			/*!
+			 * @brief Convert audio
+			 *
+			 * Input is consumed until either \c outputCapacity frames have been produced or all of \c input has been consumed.
+			 * @param input An array of \c ChannelCount() pointers to non-interleaved input samples
+			 * @param inputFrames The number of frames in \c input
+			 * @param framesConsumed Receives the number of frames consumed from \c input
+			 * @param output An array of \c ChannelCount() pointers to non-interleaved output buffers
+			 * @param outputCapacity The capacity of each buffer in \c output, in frames
+			 * @return The number of frames written to \c output
+			 */
+			size_t Process(const float * const *input, size_t inputFrames, size_t& framesConsumed, float * const *output, size_t outputCapacity) noexcept;
+
+			/*!
+			 * @brief Produce the output remaining after all input has been supplied
+			 * @note Call repeatedly until \c 0 is returned; Reset() must be called before additional input is supplied
+			 * @param output An array of \c ChannelCount() pointers to non-interleaved output buffers
+			 * @param outputCapacity The capacity of each buffer in \c output, in frames
+			 * @return The number of frames written to \c output
+			 */
+			size_t Drain(float * const *output, size_t outputCapacity) noexcept;
+
+			//@}
+
+		private:
+
+			/*! @internal Appends up to \c frameCount frames from \c input, or silence if \c input is \c nullptr, returning the number of frames appended */
+			size_t Append(const float * const *input, size_t offset, size_t frameCount) noexcept;
+
+			/*! @internal Produces up to \c outputCapacity frames from buffered input */
+			size_t Generate(float * const *output, size_t outputOffset, size_t outputCapacity) noexcept;
+
+			double				mInputRate;				// The input sample rate
+			double				mOutputRate;			// The output sample rate
+			uint32_t			mChannelCount;			// The number of channels
+
+			float				*mFilter;				// Filter phases, mTapCount coefficients each
+			uint32_t			mTapCount;				// Coefficients per phase, a multiple of 8
+			uint32_t			mPhaseCount;			// The number of phases in mFilter, excluding the guard phase
+
+			uint32_t			mInterpolation;			// L for the rational path, 0 otherwise
+			uint32_t			mDecimation;			// M for the rational path
+			uint32_t			mPhase;					// The current phase for the rational path
+			uint64_t			mStep;					// The input increment per output frame in 32.32 fixed point
+			uint32_t			mFraction;				// The fractional input position in 0.32 fixed point
+
+			float				**mHistory;				// Buffered input per channel, allocated in one chunk of memory
+			size_t				mHistoryCapacity;		// Frame capacity per channel
+			size_t				mHistoryFrames;			// Frames currently buffered
+			size_t				mReadIndex;				// Index of the first tap's sample for the next output frame
+
+			int64_t				mInputFramesTotal;		// Input frames consumed since the last reset
+			int64_t				mOutputFramesTotal;		// Output frames produced since the last reset
+		};
+
+	}
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "AudioSilenceDetector.h"
+
+namespace {
+
+	/// Four \c float lanes
+	typedef float vfloat4 __attribute__((vector_size(16)));
+	/// Four \c int32_t lanes, the result of comparing \c vfloat4 values
+	typedef int32_t vint4 __attribute__((vector_size(16)));
+
+	/// The number of samples examined per iteration
+	constexpr size_t kBlockSize = 16;
+
+	/// Returns \c true if any of the sixteen samples starting at \c samples has a magnitude exceeding \c threshold
+	inline bool AnyAudible(const float *samples, vfloat4 threshold) noexcept
+	{
+		vfloat4 a, b, c, d;
+		std::memcpy(&a, samples, sizeof a);
+		std::memcpy(&b, samples + 4, sizeof b);
+		std::memcpy(&c, samples + 8, sizeof c);
+		std::memcpy(&d, samples + 12, sizeof d);
+
+		const vfloat4 negativeThreshold = -threshold;
+		const vint4 m = (a > threshold) | (a < negativeThreshold) | (b > threshold) | (b < negativeThreshold) | (c > threshold) | (c < negativeThreshold) | (d > threshold) | (d < negativeThreshold);
+		return (m[0] | m[1] | m[2] | m[3]) != 0;
+	}
+
+}
+
+#pragma mark Scanning
+
+size_t SFB::Audio::SilenceDetector::FirstAudibleSample(const float *samples, size_t count, float threshold) noexcept
+{
+	const vfloat4 t = { threshold, threshold, threshold, threshold };
+
+	size_t i = 0;
+	while(i + kBlockSize <= count && !AnyAudible(samples + i, t))
+		i += kBlockSize;
+
+	for(; i < count; ++i) {
+		if(std::fabs(samples[i]) > threshold)
+			return i;
+	}
+
+	return count;
+}
+
+size_t SFB::Audio::SilenceDetector::AudibleSampleEnd(const float *samples, size_t start, size_t count, float threshold) noexcept
+{
+	const vfloat4 t = { threshold, threshold, threshold, threshold };
+
+	size_t i = count;
+	while(i >= start + kBlockSize && !AnyAudible(samples + i - kBlockSize, t))
+		i -= kBlockSize;
+
+	for(; i > start; --i) {
+		if(std::fabs(samples[i - 1]) > threshold)
+			return i;
+	}
+
+	return start;
+}
+
+#pragma mark Creation and Destruction
+
+SFB::Audio::SilenceDetector::SilenceDetector() noexcept
+	: mChannelCount(0), mThreshold(0), mFramePosition(0), mFirstAudibleFrame(kNoAudibleFrames), mAudibleFrameEnd(0)
+{}
+
+SFB::Audio::SilenceDetector::~SilenceDetector() = default;
+
+#pragma mark Configuration
+
+bool SFB::Audio::SilenceDetector::Initialize(uint32_t channelCount, float threshold) noexcept
+{
+	if(channelCount == 0 || !(threshold >= 0))
+		return false;
+
+	mChannelCount = channelCount;
+	mThreshold = threshold;
+
+	Reset();
+
+	return true;
+}
+
+void SFB::Audio::SilenceDetector::Reset() noexcept
+{
+	mFramePosition = 0;
+	mFirstAudibleFrame = kNoAudibleFrames;
+	mAudibleFrameEnd = 0;
+}
+
+#pragma mark Processing
+
+void SFB::Audio::SilenceDetector::Process(const float * const *buffers, size_t frameCount) noexcept
+{
+	if(mChannelCount == 0 || !buffers || frameCount == 0)
+		return;
+
+	// Each channel's scan stops where an earlier channel found audio
+	size_t end = 0;
+	if(!HasAudibleFrames()) {
+		size_t first = frameCount;
+		for(uint32_t channel = 0; channel < mChannelCount; ++channel)
+			first = FirstAudibleSample(buffers[channel], first, mThreshold);
+
+		if(first == frameCount) {
+			mFramePosition += frameCount;
+			return;
+		}
+
+		mFirstAudibleFrame = mFramePosition + first;
+		end = first + 1;
+	}
+
+	for(uint32_t channel = 0; channel < mChannelCount; ++channel)
+		end = AudibleSampleEnd(buffers[channel], end, frameCount, mThreshold);
+
+	if(end > 0)
+		mAudibleFrameEnd = mFramePosition + end;
+
+	mFramePosition += frameCount;
+}
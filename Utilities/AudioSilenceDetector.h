@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/*! @file AudioSilenceDetector.h @brief Leading and trailing silence detection */
+
+/*! @brief \c SFBAudioEngine's encompassing namespace */
+namespace SFB {
+
+	/*! @brief %Audio functionality */
+	namespace Audio {
+
+		/*!
+		 * @brief Finds the first and last audible frames of non-interleaved \c float audio
+		 *
+		 * A frame is audible if the magnitude of any of its samples exceeds the threshold. Until the first audible frame is
+		 * found each buffer is scanned forward; afterward each buffer is scanned backward from its end. Both scans examine
+		 * sixteen samples per iteration using vector operations and stop at the first audible sample, so audio that is not
+		 * silent is barely examined. Processing performs no allocation. This class is not thread safe.
+		 */
+		class SilenceDetector
+		{
+		public:
+			/*! @brief The value returned by FirstAudibleFrame() when no audible frames have been found */
+			static constexpr uint64_t kNoAudibleFrames = UINT64_MAX;
+
+			/*!
+			 * @brief Returns the offset of the first sample in \c samples whose magnitude exceeds \c threshold
+			 * @param samples The samples to scan
+			 * @param count The number of samples to scan
+			 * @param threshold The largest magnitude considered silent
+			 * @return The offset of the first audible sample, or \c count if all samples are silent
+			 */
+			static size_t FirstAudibleSample(const float *samples, size_t count, float threshold) noexcept;
+
+			/*!
+			 * @brief Returns one past the offset of the last sample in \c samples whose magnitude exceeds \c threshold
+			 * @param samples The samples to scan
+			 * @param start The offset of the first sample to scan
+			 * @param count The offset one past the last sample to scan
+			 * @param threshold The largest magnitude considered silent
+			 * @return One past the offset of the last audible sample, or \c start if all samples are silent
+			 */
+			static size_t AudibleSampleEnd(const float *samples, size_t start, size_t count, float threshold) noexcept;
+
+			// ========================================
+			/*! @name Creation and Destruction */
+			//@{
+
+			/*! @brief A \c std::unique_ptr for \c SilenceDetector objects */
+			using unique_ptr = std::unique_ptr<SilenceDetector>;
+
+			/*!
+			 * @brief Create a new \c SilenceDetector
+			 * @note Initialize() must be called before the object may be used.
+			 */
+			SilenceDetector() noexcept;
+
+			/*! @brief Destroy the \c SilenceDetector and release all associated resources. */
+			~SilenceDetector();
+
+			/*! @cond */
+
+			/*! @internal This class is non-copyable */
+			SilenceDetector(const SilenceDetector& rhs) = delete;
+
+			/*! @internal This class is non-assignable */
+			SilenceDetector& operator=(const SilenceDetector& rhs) = delete;
+
+			/*! @endcond */
+
+			//@}
+
+
+			// ========================================
+			/*! @name Configuration */
+			//@{
+
+			/*!
+			 * @brief Prepare to scan audio
+			 * @param channelCount The number of channels
+			 * @param threshold The largest sample magnitude considered silent, as a fraction of full scale
+			 * @return \c true on success, \c false on error
+			 */
+			bool Initialize(uint32_t channelCount, float threshold = 0) noexcept;
+
+			/*! @brief Forget all audible frames and set the frame position to \c 0 */
+			void Reset() noexcept;
+
+			/*! @brief Returns the number of channels */
+			inline uint32_t ChannelCount() const noexcept			{ return mChannelCount; }
+
+			/*! @brief Returns the threshold */
+			inline float Threshold() const noexcept				{ return mThreshold; }
+
+			//@}
+
+
+			// ========================================
+			/*! @name Processing */
+			//@{
+
+			/*!
+			 * @brief Scan audio
+			 * @param buffers An array of pointers to the non-interleaved samples of each channel
+			 * @param frameCount The number of frames to process
+			 */
+			void Process(const float * const *buffers, size_t frameCount) noexcept;
+
+			/*! @brief Returns the position of the next frame to be processed */
+			inline uint64_t FramePosition() const noexcept			{ return mFramePosition; }
+
+			/*!
+			 * @brief Set the position of the next frame to be processed
+			 * @note This allows discontiguous regions to be scanned, for example from the end of a file toward its start
+			 */
+			inline void SetFramePosition(uint64_t framePosition) noexcept	{ mFramePosition = framePosition; }
+
+			//@}
+
+
+			// ========================================
+			/*! @name Results */
+			//@{
+
+			/*! @brief Returns \c true if an audible frame has been found */
+			inline bool HasAudibleFrames() const noexcept			{ return mFirstAudibleFrame != kNoAudibleFrames; }
+
+			/*! @brief Returns the position of the first audible frame or \c kNoAudibleFrames */
+			inline uint64_t FirstAudibleFrame() const noexcept		{ return mFirstAudibleFrame; }
+
+			/*! @brief Returns one past the position of the last audible frame, or \c 0 if no audible frames have been found */
+			inline uint64_t AudibleFrameEnd() const noexcept			{ return mAudibleFrameEnd; }
+
+			//@}
+
+		private:
+
+			uint32_t		mChannelCount;			// The number of channels
+			float			mThreshold;				// The largest magnitude considered silent
+			uint64_t		mFramePosition;			// The position of the next frame
+			uint64_t		mFirstAudibleFrame;		// The position of the first audible frame
+			uint64_t		mAudibleFrameEnd;		// One past the position of the last audible frame
+		};
+
+	}
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+
+#include <Accelerate/Accelerate.h>
+
+#include "AudioSpectrumAnalyzer.h"
+
+#pragma mark Creation and Destruction
+
+void SFB::Audio::SpectrumAnalyzer::FFTSetupDeleter::operator()(OpaqueFFTSetup *setup) const noexcept
+{
+	vDSP_destroy_fftsetup(setup);
+}
+
+SFB::Audio::SpectrumAnalyzer::SpectrumAnalyzer() noexcept
+	: mChannelCount(0), mSampleRate(0), mFFTSize(0), mLog2FFTSize(0), mHopSize(0), mBandCount(0), mFramesBuffered(0), mFramePosition(0), mScale(0)
+{}
+
+SFB::Audio::SpectrumAnalyzer::~SpectrumAnalyzer() = default;
+
+#pragma mark Configuration
+
+bool SFB::Audio::SpectrumAnalyzer::Initialize(uint32_t channelCount, double sampleRate, size_t fftSize, size_t hopSize, size_t bandCount, double minimumFrequency) noexcept
+{
+	if(channelCount == 0 || !(sampleRate > 0) || fftSize < kMinimumFFTSize || fftSize > kMaximumFFTSize || (fftSize & (fftSize - 1)) || hopSize == 0 || hopSize > fftSize || bandCount == 0 || !(minimumFrequency > 0) || minimumFrequency >= sampleRate / 2)
+		return false;
+
+	size_t log2FFTSize = 0;
+	while((size_t{1} << log2FFTSize) < fftSize)
+		++log2FFTSize;
+
+	const size_t binCount = fftSize / 2 + 1;
+
+	std::unique_ptr<OpaqueFFTSetup, FFTSetupDeleter> fftSetup(vDSP_create_fftsetup(static_cast<vDSP_Length>(log2FFTSize), kFFTRadix2));
+	std::unique_ptr<float []> window(new (std::nothrow) float [fftSize]);
+	std::unique_ptr<float []> windowInput(new (std::nothrow) float [fftSize]);
+	std::unique_ptr<float []> transform(new (std::nothrow) float [2 * fftSize]);
+	std::unique_ptr<float []> binPowers(new (std::nothrow) float [binCount]);
+	std::unique_ptr<float []> bandEdges(new (std::nothrow) float [bandCount + 1]);
+	std::unique_ptr<size_t []> bandBins(new (std::nothrow) size_t [2 * bandCount]);
+	std::unique_ptr<float []> bandLevels(new (std::nothrow) float [bandCount]);
+	if(!fftSetup || !window || !windowInput || !transform || !binPowers || !bandEdges || !bandBins || !bandLevels)
+		return false;
+
+	// The periodic Hann window
+	vDSP_hann_window(window.get(), static_cast<vDSP_Length>(fftSize), vDSP_HANN_DENORM);
+
+	// vDSP's real FFT produces twice the DFT, and a full scale sine wave's DFT peaks at half the sum of the window
+	float windowSum = 0;
+	vDSP_sve(window.get(), 1, &windowSum, static_cast<vDSP_Length>(fftSize));
+
+	// Bands are spaced logarithmically from minimumFrequency to the Nyquist frequency. Each band contains at least one bin,
+	// so narrow bands at low frequencies may share a bin. The DC bin is excluded.
+	const double nyquist = sampleRate / 2;
+	for(size_t band = 0; band <= bandCount; ++band)
+		bandEdges[band] = static_cast<float>(minimumFrequency * std::pow(nyquist / minimumFrequency, static_cast<double>(band) / bandCount));
+	bandEdges[bandCount] = static_cast<float>(nyquist);
+
+	for(size_t band = 0; band < bandCount; ++band) {
+		size_t first = std::min(std::max(static_cast<size_t>(std::lround(bandEdges[band] * fftSize / sampleRate)), size_t{1}), binCount - 1);
+		size_t end = band + 1 < bandCount ? static_cast<size_t>(std::lround(bandEdges[band + 1] * fftSize / sampleRate)) : binCount;
+		bandBins[2 * band] = first;
+		bandBins[2 * band + 1] = std::min(std::max(end, first + 1), binCount);
+	}
+
+	mChannelCount = channelCount;
+	mSampleRate = sampleRate;
+	mFFTSize = fftSize;
+	mLog2FFTSize = log2FFTSize;
+	mHopSize = hopSize;
+	mBandCount = bandCount;
+	mScale = 1 / (windowSum * windowSum);
+
+	mFFTSetup = std::move(fftSetup);
+	mWindow = std::move(window);
+	mWindowInput = std::move(windowInput);
+	mTransform = std::move(transform);
+	mBinPowers = std::move(binPowers);
+	mBandEdges = std::move(bandEdges);
+	mBandBins = std::move(bandBins);
+	mBandLevels = std::move(bandLevels);
+
+	Reset();
+
+	return true;
+}
+
+void SFB::Audio::SpectrumAnalyzer::Reset() noexcept
+{
+	mFramesBuffered = 0;
+	mFramePosition = 0;
+
+	if(IsInitialized()) {
+		std::fill_n(mBinPowers.get(), BinCount(), 0.f);
+		std::fill_n(mBandLevels.get(), mBandCount, kSilenceLevel);
+	}
+}
+
+#pragma mark Results
+
+void SFB::Audio::SpectrumAnalyzer::GetBandLevels(const float *binPowers, float *bandLevels) const noexcept
+{
+	if(!IsInitialized() || !binPowers || !bandLevels)
+		return;
+
+	for(size_t band = 0; band < mBandCount; ++band) {
+		float energy = 0;
+		vDSP_sve(binPowers + mBandBins[2 * band], 1, &energy, static_cast<vDSP_Length>(mBandBins[2 * band + 1] - mBandBins[2 * band]));
+		bandLevels[band] = energy > 0 ? std::max(10 * std::log10(energy), kSilenceLevel) : kSilenceLevel;
+	}
+}
+
+#pragma mark Processing
+
+size_t SFB::Audio::SpectrumAnalyzer::Append(const float * const *buffers, size_t frameOffset, size_t frameCount) noexcept
+{
+	const size_t framesToCopy = std::min(frameCount, mFFTSize - mFramesBuffered);
+	if(!buffers || framesToCopy == 0)
+		return framesToCopy;
+
+	float *input = mWindowInput.get() + mFramesBuffered;
+
+	std::memcpy(input, buffers[0] + frameOffset, framesToCopy * sizeof(float));
+	if(mChannelCount > 1) {
+		for(uint32_t channel = 1; channel < mChannelCount; ++channel)
+			vDSP_vadd(input, 1, buffers[channel] + frameOffset, 1, input, 1, static_cast<vDSP_Length>(framesToCopy));
+		const float scale = 1.f / mChannelCount;
+		vDSP_vsmul(input, 1, &scale, input, 1, static_cast<vDSP_Length>(framesToCopy));
+	}
+
+	mFramesBuffered += framesToCopy;
+	return framesToCopy;
+}
+
+void SFB::Audio::SpectrumAnalyzer::Transform() noexcept
+{
+	const vDSP_Length halfSize = static_cast<vDSP_Length>(mFFTSize / 2);
+
+	float *windowed = mTransform.get();
+	DSPSplitComplex split = { mTransform.get() + mFFTSize, mTransform.get() + mFFTSize + halfSize };
+
+	vDSP_vmul(mWindowInput.get(), 1, mWindow.get(), 1, windowed, 1, static_cast<vDSP_Length>(mFFTSize));
+	vDSP_ctoz(reinterpret_cast<const DSPComplex *>(windowed), 2, &split, 1, halfSize);
+	vDSP_fft_zrip(mFFTSetup.get(), &split, 1, static_cast<vDSP_Length>(mLog2FFTSize), FFT_FORWARD);
+
+	// The real parts of the DC and Nyquist bins are packed into the first element
+	const float dc = split.realp[0];
+	const float nyquist = split.imagp[0];
+
+	float *binPowers = mBinPowers.get();
+	vDSP_zvmags(&split, 1, binPowers, 1, halfSize);
+	binPowers[0] = dc * dc / 4;
+	binPowers[halfSize] = nyquist * nyquist / 4;
+	vDSP_vsmul(binPowers, 1, &mScale, binPowers, 1, halfSize + 1);
+
+	GetBandLevels(binPowers, mBandLevels.get());
+}
+
+void SFB::Audio::SpectrumAnalyzer::Advance() noexcept
+{
+	std::memmove(mWindowInput.get(), mWindowInput.get() + mHopSize, (mFFTSize - mHopSize) * sizeof(float));
+	mFramesBuffered -= mHopSize;
+	mFramePosition += mHopSize;
+}
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/*! @file AudioSpectrumAnalyzer.h @brief Streaming short-time Fourier transform spectrum analysis */
+
+/*! @cond */
+struct OpaqueFFTSetup;
+/*! @endcond */
+
+/*! @brief \c SFBAudioEngine's encompassing namespace */
+namespace SFB {
+
+	/*! @brief %Audio functionality */
+	namespace Audio {
+
+		/*!
+		 * @brief Computes the power spectrum of non-interleaved \c float audio using a short-time Fourier transform
+		 *
+		 * The channels are averaged and buffered until a window of \c FFTSize() frames is available. The window is weighted
+		 * by a Hann window and transformed by a real FFT, then advanced by \c HopSize() frames. The power of each bin and
+		 * the energy of logarithmically-spaced bands are computed for each window. Power is scaled so a full scale sine
+		 * wave has a peak of \c 1 (0 dB).
+		 *
+		 * The transform is performed by the vector-optimized real FFT in Accelerate's vDSP. Processing performs no
+		 * allocation. This class is not thread safe.
+		 */
+		class SpectrumAnalyzer
+		{
+		public:
+			/*! @brief The smallest supported FFT size */
+			static constexpr size_t kMinimumFFTSize = 32;
+
+			/*! @brief The largest supported FFT size */
+			static constexpr size_t kMaximumFFTSize = 65536;
+
+			/*! @brief The level reported for bands containing no energy, in dB */
+			static constexpr float kSilenceLevel = -200;
+
+			// ========================================
+			/*! @name Creation and Destruction */
+			//@{
+
+			/*! @brief A \c std::unique_ptr for \c SpectrumAnalyzer objects */
+			using unique_ptr = std::unique_ptr<SpectrumAnalyzer>;
+
+			/*!
+			 * @brief Create a new \c SpectrumAnalyzer
+			 * @note Initialize() must be called before the object may be used.
+			 */
+			SpectrumAnalyzer() noexcept;
+
+			/*! @brief Destroy the \c SpectrumAnalyzer and release all associated resources. */
+			~SpectrumAnalyzer();
+
+			/*! @cond */
+
+			/*! @internal This class is non-copyable */
+			SpectrumAnalyzer(const SpectrumAnalyzer& rhs) = delete;
+
+			/*! @internal This class is non-assignable */
+			SpectrumAnalyzer& operator=(const SpectrumAnalyzer& rhs) = delete;
+
+			/*! @endcond */
+
+			//@}
+
+
+			// ========================================
+			/*! @name Configuration */
+			//@{
+
+			/*!
+			 * @brief Prepare to analyze audio
+			 * @param channelCount The number of channels
+			 * @param sampleRate The sample rate of the audio
+			 * @param fftSize The number of frames in each window, a power of two from \c kMinimumFFTSize to \c kMaximumFFTSize
+			 * @param hopSize The number of frames between the starts of consecutive windows, from \c 1 to \c fftSize
+			 * @param bandCount The number of bands
+			 * @param minimumFrequency The lower edge of the first band in Hz
+			 * @return \c true on success, \c false on error
+			 */
+			bool Initialize(uint32_t channelCount, double sampleRate, size_t fftSize, size_t hopSize, size_t bandCount, double minimumFrequency = 20) noexcept;
+
+			/*! @brief Discard buffered audio and set the frame position to \c 0 */
+			void Reset() noexcept;
+
+			/*! @brief Returns \c true if this \c SpectrumAnalyzer has been initialized */
+			inline bool IsInitialized() const noexcept				{ return mBinPowers != nullptr; }
+
+			/*! @brief Returns the number of channels */
+			inline uint32_t ChannelCount() const noexcept			{ return mChannelCount; }
+
+			/*! @brief Returns the sample rate */
+			inline double SampleRate() const noexcept				{ return mSampleRate; }
+
+			/*! @brief Returns the number of frames in each window */
+			inline size_t FFTSize() const noexcept					{ return mFFTSize; }
+
+			/*! @brief Returns the number of frames between the starts of consecutive windows */
+			inline size_t HopSize() const noexcept					{ return mHopSize; }
+
+			/*! @brief Returns the number of bins, from DC to the Nyquist frequency */
+			inline size_t BinCount() const noexcept					{ return mFFTSize / 2 + 1; }
+
+			/*! @brief Returns the center frequency of \c bin in Hz */
+			inline double BinFrequency(size_t bin) const noexcept	{ return bin * mSampleRate / mFFTSize; }
+
+			/*! @brief Returns the number of bands */
+			inline size_t BandCount() const noexcept				{ return mBandCount; }
+
+			/*! @brief Returns the \c BandCount() + 1 band edges in Hz, ascending */
+			inline const float * BandEdges() const noexcept			{ return mBandEdges.get(); }
+
+			//@}
+
+
+			// ========================================
+			/*! @name Processing */
+			//@{
+
+			/*!
+			 * @brief Analyze audio
+			 * @param buffers An array of pointers to the non-interleaved samples of each channel
+			 * @param frameCount The number of frames to process
+			 * @param handler A callable invoked as \c handler(*this) each time a spectrum is computed; it must not throw
+			 */
+			template <typename Handler>
+			void Process(const float * const *buffers, size_t frameCount, Handler&& handler) noexcept
+			{
+				if(!IsInitialized())
+					return;
+
+				for(size_t offset = 0; offset < frameCount;) {
+					offset += Append(buffers, offset, frameCount - offset);
+					if(mFramesBuffered == mFFTSize) {
+						Transform();
+						handler(*this);
+						Advance();
+					}
+				}
+			}
+
+			/*! @brief Returns the position of the first frame of the most recent window */
+			inline uint64_t FramePosition() const noexcept			{ return mFramePosition; }
+
+			//@}
+
+
+			// ========================================
+			/*! @name Results */
+			//@{
+
+			/*! @brief Returns the \c BinCount() bin powers of the most recent window */
+			inline const float * BinPowers() const noexcept			{ return mBinPowers.get(); }
+
+			/*! @brief Returns the \c BandCount() band energies of the most recent window in dB, no less than \c kSilenceLevel */
+			inline const float * BandLevels() const noexcept		{ return mBandLevels.get(); }
+
+			/*!
+			 * @brief Computes band energies in dB from bin powers
+			 * @param binPowers \c BinCount() bin powers, for example an average of several windows
+			 * @param bandLevels An array of \c BandCount() values to receive the band energies
+			 */
+			void GetBandLevels(const float *binPowers, float *bandLevels) const noexcept;
+
+			//@}
+
+		private:
+
+			/*! @internal Appends up to \c frameCount frames starting at \c frameOffset to the window; returns the number appended */
+			size_t Append(const float * const *buffers, size_t frameOffset, size_t frameCount) noexcept;
+
+			/*! @internal Computes the spectrum of the full window */
+			void Transform() noexcept;
+
+			/*! @internal Discards the oldest \c mHopSize frames of the window */
+			void Advance() noexcept;
+
+			/*! @internal Releases an \c FFTSetup */
+			struct FFTSetupDeleter {
+				void operator()(OpaqueFFTSetup *setup) const noexcept;
+			};
+
+			uint32_t		mChannelCount;		// The number of channels
+			double			mSampleRate;		// The sample rate
+			size_t			mFFTSize;			// The number of frames in each window
+			size_t			mLog2FFTSize;		// log2(mFFTSize)
+			size_t			mHopSize;			// The number of frames between windows
+			size_t			mBandCount;			// The number of bands
+			size_t			mFramesBuffered;	// The number of frames in mWindowInput
+			uint64_t		mFramePosition;		// The position of the first frame of mWindowInput
+			float			mScale;				// The factor normalizing bin powers
+
+			std::unique_ptr<OpaqueFFTSetup, FFTSetupDeleter>	mFFTSetup;	// The vDSP FFT weights
+			std::unique_ptr<float []>	mWindow;			// The Hann window
+			std::unique_ptr<float []>	mWindowInput;		// The averaged channels of the current window
+			std::unique_ptr<float []>	mTransform;			// The windowed input followed by the real and imaginary parts of its transform
+			std::unique_ptr<float []>	mBinPowers;			// The power of each bin
+			std::unique_ptr<float []>	mBandEdges;			// The edges of each band in Hz
+			std::unique_ptr<size_t []>	mBandBins;			// The first and one past the last bin of each band
+			std::unique_ptr<float []>	mBandLevels;		// The energy of each band in dB
+		};
+
+	}
+}
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include "AudioTruePeakMeter.h"
+
+namespace {
+
+	/// Four \c float lanes
+	typedef float vfloat4 __attribute__((vector_size(16)));
+
+	/// Returns the zeroth-order modified Bessel function of the first kind evaluated at \c x
+	double BesselI0(double x) noexcept
+	{
+		double sum = 1;
+		double term = 1;
+		for(unsigned k = 1; k < 32; ++k) {
+			term *= (x / (2 * k)) * (x / (2 * k));
+			sum += term;
+		}
+		return sum;
+	}
+
+	/// The Kaiser window shape parameter of the interpolation filter
+	constexpr double kKaiserBeta = 8;
+
+	/// The cutoff of the interpolation filter as a fraction of the input Nyquist frequency
+	constexpr double kCutoff = 0.9;
+
+	/// Returns the largest magnitude of \c count samples
+	inline float SamplePeak(const float *samples, size_t count) noexcept
+	{
+		vfloat4 peak = {};
+		size_t i = 0;
+		for(; i + 4 <= count; i += 4) {
+			vfloat4 x;
+			std::memcpy(&x, samples + i, sizeof x);
+			const vfloat4 y = -x;
+			peak = peak > x ? peak : x;
+			peak = peak > y ? peak : y;
+		}
+
+		float result = std::max(std::max(peak[0], peak[1]), std::max(peak[2], peak[3]));
+		for(; i < count; ++i)
+			result = std::max(result, std::fabs(samples[i]));
+		return result;
+	}
+
+	/// Returns the largest magnitude of one phase of the interpolated signal for \c count frames of \c samples
+	/// @param samples The input preceded by \c kTapsPerPhase - 1 frames of history
+	/// @param coefficients The phase's time-reversed taps
+	inline float InterpolatedPeak(const float *samples, size_t count, const float *coefficients) noexcept
+	{
+		constexpr unsigned taps = SFB::Audio::TruePeakMeter::kTapsPerPhase;
+
+		vfloat4 peak = {};
+		size_t i = 0;
+		for(; i + 4 <= count; i += 4) {
+			vfloat4 y = {};
+			for(unsigned k = 0; k < taps; ++k) {
+				vfloat4 x;
+				std::memcpy(&x, samples + i + k, sizeof x);
+				y += coefficients[k] * x;
+			}
+			const vfloat4 z = -y;
+			peak = peak > y ? peak : y;
+			peak = peak > z ? peak : z;
+		}
+
+		float result = std::max(std::max(peak[0], peak[1]), std::max(peak[2], peak[3]));
+		for(; i < count; ++i) {
+			float y = 0;
+			for(unsigned k = 0; k < taps; ++k)
+				y += coefficients[k] * samples[i + k];
+			result = std::max(result, std::fabs(y));
+		}
+		return result;
+	}
+
+}
+
+#pragma mark Creation and Destruction
+
+SFB::Audio::TruePeakMeter::TruePeakMeter() noexcept
+	: mChannelCount(0), mOversampling(kDefaultOversampling), mCoefficients{}
+{}
+
+SFB::Audio::TruePeakMeter::~TruePeakMeter() = default;
+
+#pragma mark Configuration
+
+bool SFB::Audio::TruePeakMeter::Initialize(uint32_t channelCount, double sampleRate, unsigned oversampling) noexcept
+{
+	if(channelCount == 0 || !(sampleRate > 0) || oversampling < kMinimumOversampling || oversampling > kMaximumOversampling)
+		return false;
+
+	std::unique_ptr<float []> scratch(new (std::nothrow) float [kTapsPerPhase - 1 + kScratchFrameCount]);
+	std::unique_ptr<float []> history(new (std::nothrow) float [channelCount * (kTapsPerPhase - 1)]);
+	std::unique_ptr<float []> peaks(new (std::nothrow) float [channelCount]);
+	if(!scratch || !history || !peaks)
+		return false;
+
+	mChannelCount = channelCount;
+	mOversampling = oversampling;
+
+	// Kaiser-windowed sinc interpolator
+	std::memset(mCoefficients, 0, sizeof mCoefficients);
+	// The filter is centered on an input frame so each phase interpolates at a multiple of 1/oversampling frames,
+	// including midway between frames when oversampling is even. The symmetric filter's final tap is omitted.
+	const unsigned length = oversampling * kTapsPerPhase;
+	const double center = length / 2;
+	const double i0Beta = BesselI0(kKaiserBeta);
+	for(unsigned n = 0; n < length; ++n) {
+		const double t = (n - center) / oversampling;
+		const double sinc = t == 0 ? kCutoff : std::sin(M_PI * kCutoff * t) / (M_PI * t);
+		const double r = (n - center) / center;
+		const double window = BesselI0(kKaiserBeta * std::sqrt(std::max(0., 1 - r * r))) / i0Beta;
+
+		// Tap n belongs to phase n % oversampling; within a phase taps are stored in time-reversed order
+		const unsigned phase = n % oversampling;
+		const unsigned tap = n / oversampling;
+		mCoefficients[phase * kTapsPerPhase + (kTapsPerPhase - 1 - tap)] = static_cast<float>(sinc * window);
+	}
+
+	// Normalize each phase for unity gain at DC
+	for(unsigned phase = 0; phase < oversampling; ++phase) {
+		float * const coefficients = mCoefficients + phase * kTapsPerPhase;
+		double sum = 0;
+		for(unsigned tap = 0; tap < kTapsPerPhase; ++tap)
+			sum += coefficients[tap];
+		for(unsigned tap = 0; tap < kTapsPerPhase; ++tap)
+			coefficients[tap] = static_cast<float>(coefficients[tap] / sum);
+	}
+
+	mScratch = std::move(scratch);
+	mHistory = std::move(history);
+	mPeaks = std::move(peaks);
+
+	Reset();
+
+	return true;
+}
+
+void SFB::Audio::TruePeakMeter::Reset() noexcept
+{
+	if(!mPeaks)
+		return;
+	std::fill_n(mHistory.get(), mChannelCount * (kTapsPerPhase - 1), 0);
+	ResetPeaks();
+}
+
+void SFB::Audio::TruePeakMeter::ResetPeaks() noexcept
+{
+	if(!mPeaks)
+		return;
+	std::fill_n(mPeaks.get(), mChannelCount, 0);
+}
+
+#pragma mark Processing
+
+void SFB::Audio::TruePeakMeter::Process(const float * const *buffers, size_t frameCount) noexcept
+{
+	if(!mPeaks || !buffers)
+		return;
+
+	constexpr unsigned historyLength = kTapsPerPhase - 1;
+	float * const scratch = mScratch.get();
+
+	for(uint32_t channel = 0; channel < mChannelCount; ++channel) {
+		const float *input = buffers[channel];
+		float * const history = mHistory.get() + channel * historyLength;
+		float peak = std::max(mPeaks[channel], SamplePeak(input, frameCount));
+
+		size_t framesRemaining = frameCount;
+		while(framesRemaining > 0) {
+			const size_t framesToProcess = std::min(framesRemaining, static_cast<size_t>(kScratchFrameCount));
+
+			std::memcpy(scratch, history, historyLength * sizeof(float));
+			std::memcpy(scratch + historyLength, input, framesToProcess * sizeof(float));
+
+			for(unsigned phase = 0; phase < mOversampling; ++phase)
+				peak = std::max(peak, InterpolatedPeak(scratch, framesToProcess, mCoefficients + phase * kTapsPerPhase));
+
+			std::memcpy(history, scratch + framesToProcess, historyLength * sizeof(float));
+
+			input += framesToProcess;
+			framesRemaining -= framesToProcess;
+		}
+
+		mPeaks[channel] = peak;
+	}
+}
+
+#pragma mark Measurements
+
+float SFB::Audio::TruePeakMeter::Peak() const noexcept
+{
+	if(!mPeaks)
+		return 0;
+	return *std::max_element(mPeaks.get(), mPeaks.get() + mChannelCount);
+}
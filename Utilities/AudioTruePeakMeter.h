@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/*! @file AudioTruePeakMeter.h @brief ITU-R BS.1770 true-peak measurement */
+
+/*! @brief \c SFBAudioEngine's encompassing namespace */
+namespace SFB {
+
+	/*! @brief %Audio functionality */
+	namespace Audio {
+
+		/*!
+		 * @brief Measures the true peak of non-interleaved \c float audio as specified in ITU-R BS.1770 Annex 2.
+		 *
+		 * Audio is oversampled by a polyphase FIR interpolator and the largest magnitude of the interpolated signal is recorded
+		 * for each channel. Audio is oversampled four times by default at every sample rate; a factor of two may be chosen to
+		 * reduce processing at high sample rates.
+		 *
+		 * The measured peak of a steady sine is never more than 0.01 dB high but may be low. With four times oversampling
+		 * the underread is at most 0.03 dB below 0.1 fs and 0.18 dB below 0.25 fs, rising to about 0.7 dB between 0.3 fs and
+		 * 0.4 fs as the interpolator rolls off (0.44 dB at 0.40 fs). Two times oversampling may underread by over 1 dB.
+		 *
+		 * Each phase of the interpolator is evaluated for four consecutive frames at once using vector operations. Processing
+		 * performs no allocation. This class is not thread safe.
+		 */
+		class TruePeakMeter
+		{
+		public:
+			/*! @brief The minimum oversampling factor */
+			static constexpr unsigned kMinimumOversampling = 2;
+
+			/*! @brief The maximum oversampling factor */
+			static constexpr unsigned kMaximumOversampling = 4;
+
+			/*! @brief The default oversampling factor */
+			static constexpr unsigned kDefaultOversampling = kMaximumOversampling;
+
+			/*! @brief The number of interpolator taps per phase */
+			static constexpr unsigned kTapsPerPhase = 12;
+
+			/*! @brief Returns \c peak in dBTP */
+			static inline double Decibels(float peak) noexcept		{ return peak > 0 ? 20 * std::log10(peak) : -HUGE_VAL; }
+
+			// ========================================
+			/*! @name Creation and Destruction */
+			//@{
+
+			/*! @brief A \c std::unique_ptr for \c TruePeakMeter objects */
+			using unique_ptr = std::unique_ptr<TruePeakMeter>;
+
+			/*!
+			 * @brief Create a new \c TruePeakMeter
+			 * @note Initialize() must be called before the object may be used.
+			 */
+			TruePeakMeter() noexcept;
+
+			/*! @brief Destroy the \c TruePeakMeter and release all associated resources. */
+			~TruePeakMeter();
+
+			/*! @cond */
+
+			/*! @internal This class is non-copyable */
+			TruePeakMeter(const TruePeakMeter& rhs) = delete;
+
+			/*! @internal This class is non-assignable */
+			TruePeakMeter& operator=(const TruePeakMeter& rhs) = delete;
+
+			/*! @endcond */
+
+			//@}
+
+
+			// ========================================
+			/*! @name Configuration */
+			//@{
+
+			/*!
+			 * @brief Prepare to measure audio
+			 * @param channelCount The number of channels
+			 * @param sampleRate The sample rate of the audio
+			 * @param oversampling The oversampling factor from \c kMinimumOversampling to \c kMaximumOversampling
+			 * @return \c true on success, \c false on error
+			 */
+			bool Initialize(uint32_t channelCount, double sampleRate, unsigned oversampling = kDefaultOversampling) noexcept;
+
+			/*! @brief Clear the interpolator state and the measured peaks */
+			void Reset() noexcept;
+
+			/*! @brief Clear the measured peaks without disturbing the interpolator state */
+			void ResetPeaks() noexcept;
+
+			/*! @brief Returns \c true if this \c TruePeakMeter has been initialized */
+			inline bool IsInitialized() const noexcept				{ return mPeaks != nullptr; }
+
+			/*! @brief Returns the number of channels */
+			inline uint32_t ChannelCount() const noexcept			{ return mChannelCount; }
+
+			/*! @brief Returns the oversampling factor */
+			inline unsigned Oversampling() const noexcept			{ return mOversampling; }
+
+			//@}
+
+
+			// ========================================
+			/*! @name Processing */
+			//@{
+
+			/*!
+			 * @brief Measure audio
+			 * @param buffers An array of pointers to the non-interleaved samples of each channel
+			 * @param frameCount The number of frames to process
+			 */
+			void Process(const float * const *buffers, size_t frameCount) noexcept;
+
+			//@}
+
+
+			// ========================================
+			/*! @name Measurements */
+			//@{
+
+			/*! @brief Returns the true peak of \c channel as a linear magnitude */
+			inline float Peak(uint32_t channel) const noexcept		{ return channel < mChannelCount ? mPeaks[channel] : 0; }
+
+			/*! @brief Returns the largest true peak of all channels as a linear magnitude */
+			float Peak() const noexcept;
+
+			//@}
+
+		private:
+
+			/*! @internal The number of frames interpolated at once */
+			static constexpr uint32_t kScratchFrameCount = 1024;
+
+			uint32_t					mChannelCount;		// The number of channels
+			unsigned					mOversampling;		// The oversampling factor
+			float						mCoefficients [kMaximumOversampling * kTapsPerPhase];	// Interpolator taps by phase, in time-reversed order
+			std::unique_ptr<float []>	mScratch;			// One channel's history followed by its input
+			std::unique_ptr<float []>	mHistory;			// The most recent kTapsPerPhase - 1 samples of each channel
+			std::unique_ptr<float []>	mPeaks;				// The true peak of each channel
+		};
+
+	}
+}
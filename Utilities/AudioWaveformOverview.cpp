@@ -0,0 +1,362 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+
+#include "AudioWaveformOverview.h"
+
+namespace {
+
+	/// Four \c float lanes
+	typedef float vfloat4 __attribute__((vector_size(16)));
+
+	/// The serialized overview header, followed by each level's buckets
+	///
+	/// Fields are stored in the host byte order, which is little-endian on all supported platforms
+	struct Header {
+		char		mMagic [4];
+		uint32_t	mVersion;
+		uint32_t	mChannelCount;
+		uint32_t	mBaseBucketFrames;
+		uint32_t	mLevelCount;
+		uint32_t	mReserved;
+		double		mSampleRate;
+		uint64_t	mFrameCount;
+		uint64_t	mBucketCounts [SFB::Audio::WaveformOverview::kLevelCount];
+	};
+
+	static_assert(sizeof(Header) % 8 == 0, "Header size must preserve level alignment");
+
+	constexpr char kMagic [4] = { 'S', 'F', 'B', 'W' };
+	constexpr uint32_t kVersion = 1;
+
+	/// Returns the number of bytes occupied by \c bucketCount buckets of \c channelCount channels, padded to eight bytes
+	inline size_t LevelLength(size_t bucketCount, uint32_t channelCount) noexcept
+	{
+		const size_t length = bucketCount * channelCount * SFB::Audio::WaveformOverview::kValuesPerBucket * sizeof(int16_t);
+		return (length + 7) & ~static_cast<size_t>(7);
+	}
+
+	/// Converts \c x to a signed 16-bit fraction of full scale
+	inline int16_t Quantize(float x) noexcept
+	{
+		return static_cast<int16_t>(std::lrint(std::min(1.f, std::max(-1.f, x)) * INT16_MAX));
+	}
+
+	/// Converts a signed 16-bit fraction of full scale to \c float
+	inline float Dequantize(int16_t x) noexcept
+	{
+		return static_cast<float>(x) / INT16_MAX;
+	}
+
+	/// Accumulates the minimum, maximum, and sum of squares of \c count samples
+	inline void Measure(const float *samples, size_t count, float& minimum, float& maximum, double& sumOfSquares) noexcept
+	{
+		vfloat4 lo = { HUGE_VALF, HUGE_VALF, HUGE_VALF, HUGE_VALF };
+		vfloat4 hi = -lo;
+		vfloat4 ss = {};
+		size_t i = 0;
+		for(; i + 4 <= count; i += 4) {
+			vfloat4 x;
+			std::memcpy(&x, samples + i, sizeof x);
+			lo = x < lo ? x : lo;
+			hi = x > hi ? x : hi;
+			ss += x * x;
+		}
+
+		float min = std::min(std::min(lo[0], lo[1]), std::min(lo[2], lo[3]));
+		float max = std::max(std::max(hi[0], hi[1]), std::max(hi[2], hi[3]));
+		float sum = (ss[0] + ss[1]) + (ss[2] + ss[3]);
+		for(; i < count; ++i) {
+			min = std::min(min, samples[i]);
+			max = std::max(max, samples[i]);
+			sum += samples[i] * samples[i];
+		}
+
+		minimum = std::min(minimum, min);
+		maximum = std::max(maximum, max);
+		sumOfSquares += sum;
+	}
+
+}
+
+#pragma mark Creation and Destruction
+
+SFB::Audio::WaveformOverview::WaveformOverview() noexcept
+	: mChannelCount(0), mSampleRate(0), mFrameCount(0), mFinished(false), mLevels{}, mBucketCounts{}, mCapacities{}, mBucketFrames{}
+{}
+
+SFB::Audio::WaveformOverview::~WaveformOverview() = default;
+
+#pragma mark Configuration
+
+bool SFB::Audio::WaveformOverview::Initialize(uint32_t channelCount, double sampleRate) noexcept
+{
+	if(channelCount == 0 || channelCount > kMaximumChannelCount || !(sampleRate > 0))
+		return false;
+
+	std::unique_ptr<float []> minimum(new (std::nothrow) float [kLevelCount * channelCount]);
+	std::unique_ptr<float []> maximum(new (std::nothrow) float [kLevelCount * channelCount]);
+	std::unique_ptr<double []> sumOfSquares(new (std::nothrow) double [kLevelCount * channelCount]);
+	if(!minimum || !maximum || !sumOfSquares)
+		return false;
+
+	std::fill_n(minimum.get(), kLevelCount * channelCount, HUGE_VALF);
+	std::fill_n(maximum.get(), kLevelCount * channelCount, -HUGE_VALF);
+	std::fill_n(sumOfSquares.get(), kLevelCount * channelCount, 0);
+
+	mMinimum = std::move(minimum);
+	mMaximum = std::move(maximum);
+	mSumOfSquares = std::move(sumOfSquares);
+
+	for(uint32_t level = 0; level < kLevelCount; ++level) {
+		mStorage[level].reset();
+		mCapacities[level] = 0;
+		mLevels[level] = nullptr;
+		mBucketCounts[level] = 0;
+		mBucketFrames[level] = 0;
+	}
+
+	mChannelCount = channelCount;
+	mSampleRate = sampleRate;
+	mFrameCount = 0;
+	mFinished = false;
+
+	return true;
+}
+
+bool SFB::Audio::WaveformOverview::Initialize(const void *data, size_t length) noexcept
+{
+	if(!data || length < sizeof(Header) || reinterpret_cast<uintptr_t>(data) % alignof(int16_t))
+		return false;
+
+	Header header;
+	std::memcpy(&header, data, sizeof header);
+	if(std::memcmp(header.mMagic, kMagic, sizeof kMagic) || header.mVersion != kVersion || header.mChannelCount == 0 || header.mChannelCount > kMaximumChannelCount || !(header.mSampleRate > 0))
+		return false;
+	if(header.mBaseBucketFrames != kBaseBucketFrames || header.mLevelCount != kLevelCount)
+		return false;
+
+	// The sizes in the header are untrusted, so they are validated using division to avoid overflow
+	const size_t bucketLength = header.mChannelCount * kValuesPerBucket * sizeof(int16_t);
+	size_t offset = sizeof(Header);
+	for(uint32_t level = 0; level < kLevelCount; ++level) {
+		const uint64_t bucketFrames = BucketFrames(level);
+		const uint64_t bucketCount = header.mFrameCount / bucketFrames + (header.mFrameCount % bucketFrames != 0);
+		if(header.mBucketCounts[level] != bucketCount || bucketCount > (length - offset) / bucketLength)
+			return false;
+		const size_t levelLength = LevelLength(static_cast<size_t>(bucketCount), header.mChannelCount);
+		if(levelLength > length - offset)
+			return false;
+		offset += levelLength;
+	}
+
+	mMinimum.reset();
+	mMaximum.reset();
+	mSumOfSquares.reset();
+
+	offset = sizeof(Header);
+	for(uint32_t level = 0; level < kLevelCount; ++level) {
+		mStorage[level].reset();
+		mCapacities[level] = 0;
+		mLevels[level] = reinterpret_cast<const int16_t *>(static_cast<const uint8_t *>(data) + offset);
+		mBucketCounts[level] = static_cast<size_t>(header.mBucketCounts[level]);
+		mBucketFrames[level] = 0;
+		offset += LevelLength(mBucketCounts[level], header.mChannelCount);
+	}
+
+	mChannelCount = header.mChannelCount;
+	mSampleRate = header.mSampleRate;
+	mFrameCount = header.mFrameCount;
+	mFinished = true;
+
+	return true;
+}
+
+#pragma mark Processing
+
+bool SFB::Audio::WaveformOverview::Process(const float * const *buffers, size_t frameCount) noexcept
+{
+	if(!mMinimum || mFinished || !buffers)
+		return false;
+
+	size_t framesProcessed = 0;
+	while(framesProcessed < frameCount) {
+		const uint32_t framesToProcess = static_cast<uint32_t>(std::min(frameCount - framesProcessed, static_cast<size_t>(kBaseBucketFrames - mBucketFrames[0])));
+
+		for(uint32_t channel = 0; channel < mChannelCount; ++channel)
+			Measure(buffers[channel] + framesProcessed, framesToProcess, mMinimum[channel], mMaximum[channel], mSumOfSquares[channel]);
+
+		mBucketFrames[0] += framesToProcess;
+		mFrameCount += framesToProcess;
+		framesProcessed += framesToProcess;
+
+		if(mBucketFrames[0] == kBaseBucketFrames && !FinishBucket(0, true))
+			return false;
+	}
+
+	return true;
+}
+
+bool SFB::Audio::WaveformOverview::Finish() noexcept
+{
+	if(!mMinimum || mFinished)
+		return mFinished;
+
+	// Each partial bucket is merged into the next level before that level's partial bucket is completed
+	for(uint32_t level = 0; level < kLevelCount; ++level) {
+		if(mBucketFrames[level] > 0 && !FinishBucket(level, false))
+			return false;
+	}
+
+	mFinished = true;
+	return true;
+}
+
+#pragma mark Queries
+
+bool SFB::Audio::WaveformOverview::Summarize(uint32_t channel, uint64_t startFrame, uint64_t frameCount, size_t pixelCount, float *minimum, float *maximum, float *rms) const noexcept
+{
+	if(channel >= mChannelCount || frameCount == 0 || pixelCount == 0)
+		return false;
+
+	const double framesPerPixel = static_cast<double>(frameCount) / pixelCount;
+
+	// Use the coarsest level with at least one bucket per pixel
+	uint32_t level = 0;
+	while(level + 1 < kLevelCount && BucketFrames(level + 1) <= framesPerPixel)
+		++level;
+
+	const uint64_t bucketFrames = BucketFrames(level);
+	const size_t bucketCount = mBucketCounts[level];
+	const size_t stride = mChannelCount * kValuesPerBucket;
+	const int16_t *values = mLevels[level] ? mLevels[level] + channel * kValuesPerBucket : nullptr;
+
+	for(size_t pixel = 0; pixel < pixelCount; ++pixel) {
+		const uint64_t first = startFrame + static_cast<uint64_t>(pixel * framesPerPixel);
+		const uint64_t last = startFrame + static_cast<uint64_t>((pixel + 1) * framesPerPixel);
+
+		const size_t firstBucket = static_cast<size_t>(first / bucketFrames);
+		const size_t lastBucket = std::min(bucketCount, std::max(firstBucket + 1, static_cast<size_t>((last + bucketFrames - 1) / bucketFrames)));
+
+		int16_t lo = INT16_MAX, hi = INT16_MIN;
+		float sumOfSquares = 0;
+		for(size_t bucket = firstBucket; bucket < lastBucket; ++bucket) {
+			const int16_t *value = values + bucket * stride;
+			lo = std::min(lo, value[0]);
+			hi = std::max(hi, value[1]);
+			const float r = Dequantize(value[2]);
+			sumOfSquares += r * r;
+		}
+
+		const bool empty = firstBucket >= lastBucket;
+		if(minimum)
+			minimum[pixel] = empty ? 0 : Dequantize(lo);
+		if(maximum)
+			maximum[pixel] = empty ? 0 : Dequantize(hi);
+		if(rms)
+			rms[pixel] = empty ? 0 : std::sqrt(sumOfSquares / (lastBucket - firstBucket));
+	}
+
+	return true;
+}
+
+#pragma mark Serialization
+
+size_t SFB::Audio::WaveformOverview::SerializedLength() const noexcept
+{
+	size_t length = sizeof(Header);
+	for(uint32_t level = 0; level < kLevelCount; ++level)
+		length += LevelLength(mBucketCounts[level], mChannelCount);
+	return length;
+}
+
+bool SFB::Audio::WaveformOverview::Serialize(void *buffer, size_t length) const noexcept
+{
+	if(!mFinished || !buffer || length < SerializedLength())
+		return false;
+
+	Header header{};
+	std::memcpy(header.mMagic, kMagic, sizeof kMagic);
+	header.mVersion = kVersion;
+	header.mChannelCount = mChannelCount;
+	header.mBaseBucketFrames = kBaseBucketFrames;
+	header.mLevelCount = kLevelCount;
+	header.mSampleRate = mSampleRate;
+	header.mFrameCount = mFrameCount;
+	for(uint32_t level = 0; level < kLevelCount; ++level)
+		header.mBucketCounts[level] = mBucketCounts[level];
+
+	uint8_t *output = static_cast<uint8_t *>(buffer);
+	std::memcpy(output, &header, sizeof header);
+	output += sizeof header;
+
+	for(uint32_t level = 0; level < kLevelCount; ++level) {
+		const size_t levelLength = LevelLength(mBucketCounts[level], mChannelCount);
+		const size_t valuesLength = mBucketCounts[level] * mChannelCount * kValuesPerBucket * sizeof(int16_t);
+		if(valuesLength)
+			std::memcpy(output, mLevels[level], valuesLength);
+		std::memset(output + valuesLength, 0, levelLength - valuesLength);
+		output += levelLength;
+	}
+
+	return true;
+}
+
+#pragma mark Internal
+
+bool SFB::Audio::WaveformOverview::FinishBucket(uint32_t level, bool propagate) noexcept
+{
+	const size_t stride = mChannelCount * kValuesPerBucket;
+
+	if(mBucketCounts[level] == mCapacities[level]) {
+		const size_t capacity = std::max(static_cast<size_t>(64), 2 * mCapacities[level]);
+		std::unique_ptr<int16_t []> storage(new (std::nothrow) int16_t [capacity * stride]);
+		if(!storage)
+			return false;
+		if(mBucketCounts[level])
+			std::memcpy(storage.get(), mStorage[level].get(), mBucketCounts[level] * stride * sizeof(int16_t));
+		mStorage[level] = std::move(storage);
+		mCapacities[level] = capacity;
+		mLevels[level] = mStorage[level].get();
+	}
+
+	const uint32_t frames = mBucketFrames[level];
+	int16_t *values = mStorage[level].get() + mBucketCounts[level] * stride;
+	float *minimum = mMinimum.get() + level * mChannelCount;
+	float *maximum = mMaximum.get() + level * mChannelCount;
+	double *sumOfSquares = mSumOfSquares.get() + level * mChannelCount;
+
+	for(uint32_t channel = 0; channel < mChannelCount; ++channel) {
+		values[channel * kValuesPerBucket + 0] = Quantize(minimum[channel]);
+		values[channel * kValuesPerBucket + 1] = Quantize(maximum[channel]);
+		values[channel * kValuesPerBucket + 2] = Quantize(static_cast<float>(std::sqrt(sumOfSquares[channel] / frames)));
+
+		// Merge this bucket into the next level's current bucket
+		if(level + 1 < kLevelCount) {
+			minimum[mChannelCount + channel] = std::min(minimum[mChannelCount + channel], minimum[channel]);
+			maximum[mChannelCount + channel] = std::max(maximum[mChannelCount + channel], maximum[channel]);
+			sumOfSquares[mChannelCount + channel] += sumOfSquares[channel];
+		}
+
+		minimum[channel] = HUGE_VALF;
+		maximum[channel] = -HUGE_VALF;
+		sumOfSquares[channel] = 0;
+	}
+
+	++mBucketCounts[level];
+	mBucketFrames[level] = 0;
+
+	if(level + 1 < kLevelCount) {
+		mBucketFrames[level + 1] += frames;
+		if(propagate && mBucketFrames[level + 1] == BucketFrames(level + 1))
+			return FinishBucket(level + 1, true);
+	}
+
+	return true;
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/*! @file AudioWaveformOverview.h @brief A multi-resolution min/max/RMS waveform summary */
+
+/*! @brief \c SFBAudioEngine's encompassing namespace */
+namespace SFB {
+
+	/*! @brief %Audio functionality */
+	namespace Audio {
+
+		/*!
+		 * @brief A pyramid of per-channel minimum, maximum, and RMS values for drawing waveforms
+		 *
+		 * Level 0 summarizes every \c kBaseBucketFrames frames and each following level summarizes twice as many, up to
+		 * 65536 frames per bucket. All levels are built in a single pass as audio is processed. Values are stored as
+		 * signed 16-bit fractions of full scale, so each bucket of each channel occupies six bytes.
+		 *
+		 * The serialized form is the in-memory form: a small header followed by each level's buckets, interleaved by
+		 * channel. An overview may be used in place from a memory-mapped file without copying or parsing. All values are
+		 * little-endian. This class is not thread safe.
+		 */
+		class WaveformOverview
+		{
+		public:
+			/*! @brief The number of frames summarized by each bucket of level 0 */
+			static constexpr uint32_t kBaseBucketFrames = 256;
+
+			/*! @brief The number of levels; the last summarizes 65536 frames per bucket */
+			static constexpr uint32_t kLevelCount = 9;
+
+			/*! @brief The number of values stored for each bucket of each channel: minimum, maximum, and RMS */
+			static constexpr uint32_t kValuesPerBucket = 3;
+
+			/*! @brief The maximum number of channels */
+			static constexpr uint32_t kMaximumChannelCount = 256;
+
+			/*! @brief Returns the number of frames summarized by each bucket of \c level */
+			static inline uint32_t BucketFrames(uint32_t level) noexcept		{ return kBaseBucketFrames << level; }
+
+			// ========================================
+			/*! @name Creation and Destruction */
+			//@{
+
+			/*! @brief A \c std::unique_ptr for \c WaveformOverview objects */
+			using unique_ptr = std::unique_ptr<WaveformOverview>;
+
+			/*!
+			 * @brief Create a new \c WaveformOverview
+			 * @note Initialize() must be called before the object may be used.
+			 */
+			WaveformOverview() noexcept;
+
+			/*! @brief Destroy the \c WaveformOverview and release all associated resources. */
+			~WaveformOverview();
+
+			/*! @cond */
+
+			/*! @internal This class is non-copyable */
+			WaveformOverview(const WaveformOverview& rhs) = delete;
+
+			/*! @internal This class is non-assignable */
+			WaveformOverview& operator=(const WaveformOverview& rhs) = delete;
+
+			/*! @endcond */
+
+			//@}
+
+
+			// ========================================
+			/*! @name Configuration */
+			//@{
+
+			/*!
+			 * @brief Prepare to summarize audio
+			 * @param channelCount The number of channels
+			 * @param sampleRate The sample rate of the audio
+			 * @return \c true on success, \c false on error
+			 */
+			bool Initialize(uint32_t channelCount, double sampleRate) noexcept;
+
+			/*!
+			 * @brief Use a serialized overview in place
+			 * @note \c data is not copied and must remain valid and unmodified for the lifetime of this object
+			 * @param data The serialized overview, aligned to at least two bytes
+			 * @param length The length of \c data in bytes
+			 * @return \c true on success, \c false if \c data is not a valid overview
+			 */
+			bool Initialize(const void *data, size_t length) noexcept;
+
+			/*! @brief Returns \c true if this \c WaveformOverview has been initialized */
+			inline bool IsInitialized() const noexcept				{ return mChannelCount != 0; }
+
+			/*! @brief Returns the number of channels */
+			inline uint32_t ChannelCount() const noexcept			{ return mChannelCount; }
+
+			/*! @brief Returns the sample rate of the audio */
+			inline double SampleRate() const noexcept				{ return mSampleRate; }
+
+			//@}
+
+
+			// ========================================
+			/*! @name Processing */
+			//@{
+
+			/*!
+			 * @brief Summarize audio
+			 * @param buffers An array of pointers to the non-interleaved samples of each channel
+			 * @param frameCount The number of frames to process
+			 * @return \c true on success, \c false if the overview was loaded from serialized data or memory could not be allocated
+			 */
+			bool Process(const float * const *buffers, size_t frameCount) noexcept;
+
+			/*!
+			 * @brief Summarize any buffered frames that do not fill a complete bucket
+			 * @note No more audio may be processed after this is called
+			 * @return \c true on success, \c false if memory could not be allocated
+			 */
+			bool Finish() noexcept;
+
+			/*! @brief Returns the number of frames summarized */
+			inline uint64_t FrameCount() const noexcept				{ return mFrameCount; }
+
+			//@}
+
+
+			// ========================================
+			/*! @name Queries */
+			//@{
+
+			/*! @brief Returns the number of complete buckets in \c level */
+			inline size_t BucketCount(uint32_t level) const noexcept	{ return level < kLevelCount ? mBucketCounts[level] : 0; }
+
+			/*!
+			 * @brief Summarize a range of frames for display
+			 *
+			 * The coarsest level with at least one bucket per pixel is used, so each pixel examines at most three buckets.
+			 * Pixels narrower than \c kBaseBucketFrames frames repeat the bucket containing them. Pixels beyond the
+			 * summarized audio are set to zero.
+			 * @param channel The channel to summarize
+			 * @param startFrame The first frame of the range
+			 * @param frameCount The number of frames in the range
+			 * @param pixelCount The number of values to produce
+			 * @param minimum An array of \c pixelCount values to receive the minimum of each pixel, or \c nullptr
+			 * @param maximum An array of \c pixelCount values to receive the maximum of each pixel, or \c nullptr
+			 * @param rms An array of \c pixelCount values to receive the RMS of each pixel, or \c nullptr
+			 * @return \c true on success, \c false on error
+			 */
+			bool Summarize(uint32_t channel, uint64_t startFrame, uint64_t frameCount, size_t pixelCount, float *minimum, float *maximum, float *rms) const noexcept;
+
+			//@}
+
+
+			// ========================================
+			/*! @name Serialization */
+			//@{
+
+			/*! @brief Returns the number of bytes required to serialize the overview */
+			size_t SerializedLength() const noexcept;
+
+			/*!
+			 * @brief Serialize the overview
+			 * @param buffer A buffer to receive the serialized overview
+			 * @param length The length of \c buffer in bytes, which must be at least SerializedLength()
+			 * @return \c true on success, \c false on error
+			 */
+			bool Serialize(void *buffer, size_t length) const noexcept;
+
+			//@}
+
+		private:
+
+			/*! @internal Completes the current bucket of \c level */
+			bool FinishBucket(uint32_t level, bool propagate) noexcept;
+
+			uint32_t					mChannelCount;		// The number of channels
+			double						mSampleRate;		// The sample rate
+			uint64_t					mFrameCount;		// The number of frames summarized
+			bool						mFinished;			// True if no more audio may be processed
+
+			const int16_t				*mLevels [kLevelCount];			// Each level's buckets, interleaved by channel
+			size_t						mBucketCounts [kLevelCount];	// The number of complete buckets in each level
+
+			std::unique_ptr<int16_t []>	mStorage [kLevelCount];			// Storage for each level when summarizing audio
+			size_t						mCapacities [kLevelCount];		// The capacity of each level's storage, in buckets
+
+			std::unique_ptr<float []>	mMinimum;			// The minimum of each level's current bucket, by channel
+			std::unique_ptr<float []>	mMaximum;			// The maximum of each level's current bucket, by channel
+			std::unique_ptr<double []>	mSumOfSquares;		// The sum of squares of each level's current bucket, by channel
+			uint32_t					mBucketFrames [kLevelCount];	// The number of frames in each level's current bucket
+		};
+
+	}
+}
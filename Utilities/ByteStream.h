@@ -5,8 +5,8 @@
 
 #pragma once
 
-#import <algorithm>
-#import <type_traits>
+#include <algorithm>
+#include <type_traits>
 
 namespace SFB {
 
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#pragma once
+
+/*! @file Portability.h @brief Core %Audio types, logging, and byte swapping for C++ code built without Apple's SDKs */
+
+#if defined(__APPLE__)
+
+#include <CoreAudioTypes/CoreAudioTypes.h>
+#include <libkern/OSByteOrder.h>
+#include <os/log.h>
+
+#else
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+/*! @cond */
+
+#pragma mark Core Audio Types
+
+// The subset of CoreAudioTypes.h used by the C++ audio code, with identical layouts and values
+
+typedef uint8_t		UInt8;
+typedef int8_t		SInt8;
+typedef uint16_t	UInt16;
+typedef int16_t		SInt16;
+typedef uint32_t	UInt32;
+typedef int32_t		SInt32;
+typedef uint64_t	UInt64;
+typedef int64_t		SInt64;
+typedef float		Float32;
+typedef double		Float64;
+
+typedef UInt32		AudioFormatID;
+typedef UInt32		AudioFormatFlags;
+typedef UInt32		AudioChannelLayoutTag;
+
+struct AudioStreamBasicDescription {
+	Float64				mSampleRate;
+	AudioFormatID		mFormatID;
+	AudioFormatFlags	mFormatFlags;
+	UInt32				mBytesPerPacket;
+	UInt32				mFramesPerPacket;
+	UInt32				mBytesPerFrame;
+	UInt32				mChannelsPerFrame;
+	UInt32				mBitsPerChannel;
+	UInt32				mReserved;
+};
+
+struct AudioBuffer {
+	UInt32	mNumberChannels;
+	UInt32	mDataByteSize;
+	void	*mData;
+};
+
+struct AudioBufferList {
+	UInt32		mNumberBuffers;
+	AudioBuffer	mBuffers [1];
+};
+
+enum : AudioFormatID {
+	kAudioFormatLinearPCM			= 'lpcm',
+	kAudioFormatAppleLossless		= 'alac',
+	kAudioFormatFLAC				= 'flac',
+};
+
+// Flags are constants rather than enumerators so they may be combined with integers in conditional expressions
+
+constexpr AudioFormatFlags kAudioFormatFlagIsFloat						= (1U << 0);
+constexpr AudioFormatFlags kAudioFormatFlagIsBigEndian					= (1U << 1);
+constexpr AudioFormatFlags kAudioFormatFlagIsSignedInteger				= (1U << 2);
+constexpr AudioFormatFlags kAudioFormatFlagIsPacked						= (1U << 3);
+constexpr AudioFormatFlags kAudioFormatFlagIsAlignedHigh				= (1U << 4);
+constexpr AudioFormatFlags kAudioFormatFlagIsNonInterleaved				= (1U << 5);
+constexpr AudioFormatFlags kAudioFormatFlagIsNonMixable					= (1U << 6);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+constexpr AudioFormatFlags kAudioFormatFlagsNativeEndian				= kAudioFormatFlagIsBigEndian;
+#else
+constexpr AudioFormatFlags kAudioFormatFlagsNativeEndian				= 0;
+#endif
+
+constexpr AudioFormatFlags kLinearPCMFormatFlagIsFloat					= kAudioFormatFlagIsFloat;
+constexpr AudioFormatFlags kLinearPCMFormatFlagIsBigEndian				= kAudioFormatFlagIsBigEndian;
+constexpr AudioFormatFlags kLinearPCMFormatFlagIsSignedInteger			= kAudioFormatFlagIsSignedInteger;
+constexpr AudioFormatFlags kLinearPCMFormatFlagIsPacked					= kAudioFormatFlagIsPacked;
+constexpr AudioFormatFlags kLinearPCMFormatFlagIsAlignedHigh			= kAudioFormatFlagIsAlignedHigh;
+constexpr AudioFormatFlags kLinearPCMFormatFlagIsNonInterleaved			= kAudioFormatFlagIsNonInterleaved;
+constexpr AudioFormatFlags kLinearPCMFormatFlagsSampleFractionShift		= 7;
+constexpr AudioFormatFlags kLinearPCMFormatFlagsSampleFractionMask		= (0x3F << kLinearPCMFormatFlagsSampleFractionShift);
+
+enum : AudioChannelLayoutTag {
+	kAudioChannelLayoutTag_Mono					= (100U << 16) | 1,
+	kAudioChannelLayoutTag_Stereo				= (101U << 16) | 2,
+	kAudioChannelLayoutTag_Quadraphonic			= (108U << 16) | 4,
+	kAudioChannelLayoutTag_MPEG_3_0_A			= (113U << 16) | 3,
+	kAudioChannelLayoutTag_MPEG_5_0_A			= (117U << 16) | 5,
+	kAudioChannelLayoutTag_MPEG_5_1_A			= (121U << 16) | 6,
+	kAudioChannelLayoutTag_MPEG_6_1_A			= (125U << 16) | 7,
+	kAudioChannelLayoutTag_MPEG_7_1_A			= (126U << 16) | 8,
+	kAudioChannelLayoutTag_ITU_2_2				= (132U << 16) | 4,
+	kAudioChannelLayoutTag_Unknown				= 0xFFFF0000,
+};
+
+// The values from SFBAudioEngineTypes.h used by the C++ audio code
+
+enum : AudioFormatID {
+	kSFBAudioFormatDSD 				= 'DSD ',
+	kSFBAudioFormatDoP				= 'DoP ',
+	kSFBAudioFormatShorten 			= 'SHN ',
+	kSFBAudioFormatWavPack 			= 'WV  ',
+};
+
+enum : uint32_t {
+	kSFBSampleRateDSD64			= 2822400,
+	kSFBSampleRateDSD128 		= 5644800,
+	kSFBSampleRateDSD256 		= 11289600,
+	kSFBSampleRateDSD512 		= 22579200,
+};
+
+enum : int {
+	kSFBPCMFramesPerDSDPacket 			= 8,
+	kSFBBytesPerDSDPacketPerChannel		= 1,
+};
+
+#pragma mark Byte Swapping
+
+#define OSSwapInt16(x)				__builtin_bswap16(x)
+#define OSSwapInt32(x)				__builtin_bswap32(x)
+#define OSSwapInt64(x)				__builtin_bswap64(x)
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define OSSwapHostToBigInt16(x)		(x)
+#define OSSwapHostToBigInt32(x)		(x)
+#define OSSwapHostToBigInt64(x)		(x)
+#define OSSwapHostToLittleInt16(x)	OSSwapInt16(x)
+#define OSSwapHostToLittleInt32(x)	OSSwapInt32(x)
+#define OSSwapHostToLittleInt64(x)	OSSwapInt64(x)
+#else
+#define OSSwapHostToBigInt16(x)		OSSwapInt16(x)
+#define OSSwapHostToBigInt32(x)		OSSwapInt32(x)
+#define OSSwapHostToBigInt64(x)		OSSwapInt64(x)
+#define OSSwapHostToLittleInt16(x)	(x)
+#define OSSwapHostToLittleInt32(x)	(x)
+#define OSSwapHostToLittleInt64(x)	(x)
+#endif
+
+#define OSSwapBigToHostInt16(x)		OSSwapHostToBigInt16(x)
+#define OSSwapBigToHostInt32(x)		OSSwapHostToBigInt32(x)
+#define OSSwapBigToHostInt64(x)		OSSwapHostToBigInt64(x)
+#define OSSwapLittleToHostInt16(x)	OSSwapHostToLittleInt16(x)
+#define OSSwapLittleToHostInt32(x)	OSSwapHostToLittleInt32(x)
+#define OSSwapLittleToHostInt64(x)	OSSwapHostToLittleInt64(x)
+
+#pragma mark Logging
+
+// Errors and faults are written to stderr; other levels are discarded
+
+typedef struct os_log_s *os_log_t;
+
+#define OS_LOG_DEFAULT				static_cast<os_log_t>(nullptr)
+
+inline os_log_t os_log_create(const char *subsystem, const char *category) noexcept
+{
+	(void)subsystem;
+	(void)category;
+	return nullptr;
+}
+
+namespace SFB {
+
+	/*! @internal Writes an \c os_log message to \c stderr, removing privacy qualifiers such as \c {public} from \c format */
+	inline void WriteLogMessage(const char *format, ...) noexcept
+	{
+		char printfFormat [1024];
+		size_t length = 0;
+		for(const char *p = format; *p && length < sizeof printfFormat - 1; ++p) {
+			printfFormat[length++] = *p;
+			if(*p == '%' && p[1] == '{') {
+				while(*p && *p != '}')
+					++p;
+				if(!*p)
+					break;
+			}
+		}
+		printfFormat[length] = '\0';
+
+		va_list ap;
+		va_start(ap, format);
+		std::vfprintf(stderr, printfFormat, ap);
+		va_end(ap);
+		std::fputc('\n', stderr);
+	}
+
+}
+
+#define os_log_error(log, format, ...)	((void)(log), SFB::WriteLogMessage(format, ##__VA_ARGS__))
+#define os_log_fault(log, format, ...)	((void)(log), SFB::WriteLogMessage(format, ##__VA_ARGS__))
+#define os_log_info(log, format, ...)	((void)(log))
+#define os_log_debug(log, format, ...)	((void)(log))
+#define os_log(log, format, ...)		((void)(log))
+
+/*! @endcond */
+
+#endif /* defined(__APPLE__) */
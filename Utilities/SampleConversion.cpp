@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#include "SampleConversion.h"
+
+namespace {
+
+	using namespace SFB::Audio::SampleConversion;
+
+	/// Returns the kernel converting from \c Source to \c Destination in the specified byte order
+	template <typename Source, template <bool> class Destination>
+	inline SFB::Audio::SampleConversionKernel KernelForByteOrder(bool destinationIsBigEndian) noexcept
+	{
+		return destinationIsBigEndian ? &Convert<Source, Destination<true>> : &Convert<Source, Destination<false>>;
+	}
+
+	/// Returns the kernel converting from \c Source to \c destinationEncoding
+	template <typename Source>
+	SFB::Audio::SampleConversionKernel KernelForDestination(SFB::Audio::SampleEncoding destinationEncoding, bool destinationIsBigEndian) noexcept
+	{
+		switch(destinationEncoding) {
+			case SFB::Audio::SampleEncoding::UInt8: 		return &Convert<Source, UInt8Sample<false>>;
+			case SFB::Audio::SampleEncoding::Int8: 			return &Convert<Source, Int8Sample<false>>;
+			case SFB::Audio::SampleEncoding::Int16: 		return KernelForByteOrder<Source, Int16Sample>(destinationIsBigEndian);
+			case SFB::Audio::SampleEncoding::Int24: 		return KernelForByteOrder<Source, Int24Sample>(destinationIsBigEndian);
+			case SFB::Audio::SampleEncoding::Int32: 		return KernelForByteOrder<Source, Int32Sample>(destinationIsBigEndian);
+			case SFB::Audio::SampleEncoding::Int32Low24: 	return KernelForByteOrder<Source, Int32Low24Sample>(destinationIsBigEndian);
+			case SFB::Audio::SampleEncoding::Float32: 		return KernelForByteOrder<Source, Float32Sample>(destinationIsBigEndian);
+			case SFB::Audio::SampleEncoding::Float64: 		return KernelForByteOrder<Source, Float64Sample>(destinationIsBigEndian);
+			default:										return nullptr;
+		}
+	}
+
+	/// Returns the kernel converting from \c Source in the specified byte order to \c destinationEncoding
+	template <template <bool> class Source>
+	inline SFB::Audio::SampleConversionKernel KernelForSourceByteOrder(bool sourceIsBigEndian, SFB::Audio::SampleEncoding destinationEncoding, bool destinationIsBigEndian) noexcept
+	{
+		if(sourceIsBigEndian)
+			return KernelForDestination<Source<true>>(destinationEncoding, destinationIsBigEndian);
+		return KernelForDestination<Source<false>>(destinationEncoding, destinationIsBigEndian);
+	}
+
+}
+
+size_t SFB::Audio::SampleEncodingSize(SampleEncoding encoding) noexcept
+{
+	switch(encoding) {
+		case SampleEncoding::UInt8:			return 1;
+		case SampleEncoding::Int8:			return 1;
+		case SampleEncoding::Int16:			return 2;
+		case SampleEncoding::Int24:			return 3;
+		case SampleEncoding::Int32:			return 4;
+		case SampleEncoding::Int32Low24:	return 4;
+		case SampleEncoding::Float32:		return 4;
+		case SampleEncoding::Float64:		return 8;
+		default:							return 0;
+	}
+}
+
+SFB::Audio::SampleConversionKernel SFB::Audio::GetSampleConversionKernel(SampleEncoding sourceEncoding, bool sourceIsBigEndian, SampleEncoding destinationEncoding, bool destinationIsBigEndian) noexcept
+{
+	switch(sourceEncoding) {
+		case SampleEncoding::UInt8: 		return KernelForDestination<UInt8Sample<false>>(destinationEncoding, destinationIsBigEndian);
+		case SampleEncoding::Int8: 			return KernelForDestination<Int8Sample<false>>(destinationEncoding, destinationIsBigEndian);
+		case SampleEncoding::Int16: 		return KernelForSourceByteOrder<Int16Sample>(sourceIsBigEndian, destinationEncoding, destinationIsBigEndian);
+		case SampleEncoding::Int24: 		return KernelForSourceByteOrder<Int24Sample>(sourceIsBigEndian, destinationEncoding, destinationIsBigEndian);
+		case SampleEncoding::Int32: 		return KernelForSourceByteOrder<Int32Sample>(sourceIsBigEndian, destinationEncoding, destinationIsBigEndian);
+		case SampleEncoding::Int32Low24: 	return KernelForSourceByteOrder<Int32Low24Sample>(sourceIsBigEndian, destinationEncoding, destinationIsBigEndian);
+		case SampleEncoding::Float32: 		return KernelForSourceByteOrder<Float32Sample>(sourceIsBigEndian, destinationEncoding, destinationIsBigEndian);
+		case SampleEncoding::Float64: 		return KernelForSourceByteOrder<Float64Sample>(sourceIsBigEndian, destinationEncoding, destinationIsBigEndian);
+		default:							return nullptr;
+	}
+}
@@ -0,0 +1,447 @@
+/*
+ * Copyright (c) 2021 Stephen F. Booth <me@sbooth.org>
+ * See https://github.com/sbooth/SFBAudioEngine/blob/master/LICENSE.txt for license information
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/*! @file SampleConversion.h @brief Compile-time specialized PCM sample conversion */
+
+/*! @brief \c SFBAudioEngine's encompassing namespace */
+namespace SFB {
+
+	/*! @brief %Audio functionality */
+	namespace Audio {
+
+		/*! @brief PCM sample encodings supported by the conversion kernels */
+		enum class SampleEncoding {
+			/*! An unsupported encoding */
+			Unknown,
+			/*! Unsigned 8-bit integers offset by 128 */
+			UInt8,
+			/*! Signed 8-bit integers */
+			Int8,
+			/*! Signed 16-bit integers */
+			Int16,
+			/*! Signed 24-bit integers packed in three bytes */
+			Int24,
+			/*! Signed 32-bit integers, or fewer significant bits aligned high in 32 bits */
+			Int32,
+			/*! Signed 24-bit integers aligned low in 32 bits */
+			Int32Low24,
+			/*! \c float */
+			Float32,
+			/*! \c double */
+			Float64
+		};
+
+		/*!
+		 * @brief A function converting samples from one encoding to another
+		 * @param source The first source sample
+		 * @param sourceStride The distance between source samples in bytes
+		 * @param destination The first destination sample
+		 * @param destinationStride The distance between destination samples in bytes
+		 * @param count The number of samples to convert
+		 */
+		using SampleConversionKernel = void (*)(const void *source, ptrdiff_t sourceStride, void *destination, ptrdiff_t destinationStride, size_t count);
+
+		/*! @brief Returns the size of one sample in \c encoding in bytes or \c 0 for \c SampleEncoding::Unknown */
+		size_t SampleEncodingSize(SampleEncoding encoding) noexcept;
+
+		/*!
+		 * @brief Returns a kernel converting samples between two encodings
+		 *
+		 * Integer to integer conversions are performed using 32-bit integers and truncate when reducing bit depth.
+		 * Conversions involving floating point scale integers with \c n bits by <tt>2^(n-1)</tt>, and clip and round
+		 * to nearest when converting to integers.
+		 * @param sourceEncoding The encoding of the source samples
+		 * @param sourceIsBigEndian \c true if the source samples are big-endian
+		 * @param destinationEncoding The encoding of the destination samples
+		 * @param destinationIsBigEndian \c true if the destination samples are big-endian
+		 * @return A kernel or \c nullptr if either encoding is \c SampleEncoding::Unknown
+		 */
+		SampleConversionKernel GetSampleConversionKernel(SampleEncoding sourceEncoding, bool sourceIsBigEndian, SampleEncoding destinationEncoding, bool destinationIsBigEndian) noexcept;
+
+		/*! @brief Sample codecs and conversion kernel templates */
+		namespace SampleConversion {
+
+			/*! @brief \c true if the host is big-endian */
+			constexpr bool kHostIsBigEndian = __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__;
+
+			/*! @brief Returns \c value with its bytes reversed */
+			inline uint16_t ByteSwap(uint16_t value) noexcept			{ return __builtin_bswap16(value); }
+			/*! @brief Returns \c value with its bytes reversed */
+			inline uint32_t ByteSwap(uint32_t value) noexcept			{ return __builtin_bswap32(value); }
+			/*! @brief Returns \c value with its bytes reversed */
+			inline uint64_t ByteSwap(uint64_t value) noexcept			{ return __builtin_bswap64(value); }
+
+			/*! @brief Reads a \c T in byte order \c BigEndian from \c p, which need not be aligned */
+			template <typename T, bool BigEndian>
+			inline T Load(const uint8_t *p) noexcept
+			{
+				T value;
+				std::memcpy(&value, p, sizeof(T));
+				if(BigEndian != kHostIsBigEndian)
+					value = ByteSwap(value);
+				return value;
+			}
+
+			/*! @brief Writes \c value to \c p in byte order \c BigEndian; \c p need not be aligned */
+			template <typename T, bool BigEndian>
+			inline void Store(uint8_t *p, T value) noexcept
+			{
+				if(BigEndian != kHostIsBigEndian)
+					value = ByteSwap(value);
+				std::memcpy(p, &value, sizeof(T));
+			}
+
+			/*! @brief Returns \c value shifted left by \c shift bits */
+			inline int32_t ShiftLeft(int32_t value, unsigned shift) noexcept
+			{
+				return static_cast<int32_t>(static_cast<uint32_t>(value) << shift);
+			}
+
+			/*!
+			 * @brief Common operations for integer samples with \c Bits significant bits
+			 *
+			 * \c Codec must provide \c LoadRaw() returning the sign-extended sample and \c StoreRaw() storing one.
+			 */
+			template <typename Codec, unsigned Bits>
+			struct IntegerSample
+			{
+				/*! @brief \c false for integer samples */
+				static constexpr bool kIsFloat = false;
+				/*! @brief The number of significant bits */
+				static constexpr unsigned kBits = Bits;
+
+				/*! @brief Reads a sample left-justified in 32 bits */
+				static inline int32_t LoadInt(const uint8_t *p) noexcept			{ return ShiftLeft(Codec::LoadRaw(p), 32 - Bits); }
+				/*! @brief Writes a sample left-justified in 32 bits, truncating insignificant bits */
+				static inline void StoreInt(uint8_t *p, int32_t value) noexcept	{ Codec::StoreRaw(p, value >> (32 - Bits)); }
+
+				/*! @brief Reads a sample scaled to [-1, 1) */
+				template <typename T>
+				static inline T LoadFloat(const uint8_t *p) noexcept
+				{
+					return static_cast<T>(Codec::LoadRaw(p)) * (static_cast<T>(1) / static_cast<T>(int64_t(1) << (Bits - 1)));
+				}
+
+				/*! @brief The largest scaled value representable by both \c T and the sample */
+				template <typename T>
+				static constexpr T Maximum() noexcept
+				{
+					// Above 24 bits float can't represent 2^(n-1) - 1 and the nearest smaller value is used
+					return std::is_same<T, float>::value && Bits > 24 ? static_cast<T>((int64_t(1) << (Bits - 1)) - (int64_t(1) << (Bits - 25))) : static_cast<T>((int64_t(1) << (Bits - 1)) - 1);
+				}
+
+				/*! @brief Writes \c value scaled from [-1, 1), clipping and rounding to nearest */
+				template <typename T>
+				static inline void StoreFloat(uint8_t *p, T value) noexcept
+				{
+					const T minimum = -static_cast<T>(int64_t(1) << (Bits - 1));
+					const T maximum = Maximum<T>();
+					value *= static_cast<T>(int64_t(1) << (Bits - 1));
+					value = value < minimum ? minimum : (value > maximum ? maximum : value);
+					value += value < 0 ? static_cast<T>(-0.5) : static_cast<T>(0.5);
+					Codec::StoreRaw(p, static_cast<int32_t>(value));
+				}
+			};
+
+			/*! @brief Unsigned 8-bit samples offset by 128 */
+			template <bool BigEndian>
+			struct UInt8Sample : public IntegerSample<UInt8Sample<BigEndian>, 8>
+			{
+				static constexpr size_t kSize = 1;
+				static inline int32_t LoadRaw(const uint8_t *p) noexcept			{ return static_cast<int32_t>(*p) - 128; }
+				static inline void StoreRaw(uint8_t *p, int32_t value) noexcept	{ *p = static_cast<uint8_t>(value + 128); }
+			};
+
+			/*! @brief Signed 8-bit samples */
+			template <bool BigEndian>
+			struct Int8Sample : public IntegerSample<Int8Sample<BigEndian>, 8>
+			{
+				static constexpr size_t kSize = 1;
+				static inline int32_t LoadRaw(const uint8_t *p) noexcept			{ return static_cast<int8_t>(*p); }
+				static inline void StoreRaw(uint8_t *p, int32_t value) noexcept	{ *p = static_cast<uint8_t>(value); }
+			};
+
+			/*! @brief Signed 16-bit samples */
+			template <bool BigEndian>
+			struct Int16Sample : public IntegerSample<Int16Sample<BigEndian>, 16>
+			{
+				static constexpr size_t kSize = 2;
+				static inline int32_t LoadRaw(const uint8_t *p) noexcept			{ return static_cast<int16_t>(Load<uint16_t, BigEndian>(p)); }
+				static inline void StoreRaw(uint8_t *p, int32_t value) noexcept	{ Store<uint16_t, BigEndian>(p, static_cast<uint16_t>(value)); }
+			};
+
+			/*! @brief Signed 24-bit samples packed in three bytes */
+			template <bool BigEndian>
+			struct Int24Sample : public IntegerSample<Int24Sample<BigEndian>, 24>
+			{
+				static constexpr size_t kSize = 3;
+
+				static inline int32_t LoadRaw(const uint8_t *p) noexcept
+				{
+					const uint32_t value = BigEndian ? (uint32_t(p[0]) << 16) | (uint32_t(p[1]) << 8) | p[2] : (uint32_t(p[2]) << 16) | (uint32_t(p[1]) << 8) | p[0];
+					return static_cast<int32_t>(value << 8) >> 8;
+				}
+
+				static inline void StoreRaw(uint8_t *p, int32_t value) noexcept
+				{
+					const auto v = static_cast<uint32_t>(value);
+					p[BigEndian ? 2 : 0] = static_cast<uint8_t>(v);
+					p[1] = static_cast<uint8_t>(v >> 8);
+					p[BigEndian ? 0 : 2] = static_cast<uint8_t>(v >> 16);
+				}
+			};
+
+			/*! @brief Signed 32-bit samples */
+			template <bool BigEndian>
+			struct Int32Sample : public IntegerSample<Int32Sample<BigEndian>, 32>
+			{
+				static constexpr size_t kSize = 4;
+				static inline int32_t LoadRaw(const uint8_t *p) noexcept			{ return static_cast<int32_t>(Load<uint32_t, BigEndian>(p)); }
+				static inline void StoreRaw(uint8_t *p, int32_t value) noexcept	{ Store<uint32_t, BigEndian>(p, static_cast<uint32_t>(value)); }
+			};
+
+			/*! @brief Signed 24-bit samples aligned low in 32 bits */
+			template <bool BigEndian>
+			struct Int32Low24Sample : public IntegerSample<Int32Low24Sample<BigEndian>, 24>
+			{
+				static constexpr size_t kSize = 4;
+				static inline int32_t LoadRaw(const uint8_t *p) noexcept			{ return ShiftLeft(static_cast<int32_t>(Load<uint32_t, BigEndian>(p)), 8) >> 8; }
+				static inline void StoreRaw(uint8_t *p, int32_t value) noexcept	{ Store<uint32_t, BigEndian>(p, static_cast<uint32_t>(value)); }
+			};
+
+			/*! @brief Floating point samples stored as \c Value, which is bit-compatible with \c Bits */
+			template <typename Value, typename Bits, bool BigEndian>
+			struct FloatSample
+			{
+				static constexpr bool kIsFloat = true;
+				static constexpr size_t kSize = sizeof(Value);
+				static constexpr unsigned kBits = 8 * sizeof(Value);
+
+				template <typename T>
+				static inline T LoadFloat(const uint8_t *p) noexcept
+				{
+					Value value;
+					if(BigEndian == kHostIsBigEndian)
+						std::memcpy(&value, p, sizeof(Value));
+					else {
+						const Bits bits = Load<Bits, BigEndian>(p);
+						std::memcpy(&value, &bits, sizeof(Value));
+					}
+					return static_cast<T>(value);
+				}
+
+				template <typename T>
+				static inline void StoreFloat(uint8_t *p, T value) noexcept
+				{
+					const auto v = static_cast<Value>(value);
+					if(BigEndian == kHostIsBigEndian)
+						std::memcpy(p, &v, sizeof(Value));
+					else {
+						Bits bits;
+						std::memcpy(&bits, &v, sizeof(Value));
+						Store<Bits, BigEndian>(p, bits);
+					}
+				}
+			};
+
+			/*! @brief \c float samples */
+			template <bool BigEndian>
+			using Float32Sample = FloatSample<float, uint32_t, BigEndian>;
+
+			/*! @brief \c double samples */
+			template <bool BigEndian>
+			using Float64Sample = FloatSample<double, uint64_t, BigEndian>;
+
+			/*!
+			 * @brief The type used to hold samples during conversion from \c Source to \c Destination
+			 *
+			 * Integer conversions use left-justified \c int32_t, conversions involving \c double use \c double, and all others use \c float.
+			 */
+			template <typename Source, typename Destination>
+			using Intermediate = typename std::conditional<!Source::kIsFloat && !Destination::kIsFloat, int32_t,
+				typename std::conditional<(Source::kIsFloat && Source::kSize == 8) || (Destination::kIsFloat && Destination::kSize == 8) || (!Source::kIsFloat && Source::kBits > 24) || (!Destination::kIsFloat && Destination::kBits > 24), double, float>::type>::type;
+
+			/*! @brief Converts one sample through \c int32_t */
+			template <typename Source, typename Destination>
+			inline void ConvertSample(const uint8_t *source, uint8_t *destination, std::true_type) noexcept
+			{
+				Destination::StoreInt(destination, Source::LoadInt(source));
+			}
+
+			/*! @brief Converts one sample through a floating point type */
+			template <typename Source, typename Destination>
+			inline void ConvertSample(const uint8_t *source, uint8_t *destination, std::false_type) noexcept
+			{
+				using T = Intermediate<Source, Destination>;
+				Destination::template StoreFloat<T>(destination, Source::template LoadFloat<T>(source));
+			}
+
+			/*!
+			 * @brief Converts contiguous samples
+			 * @note Specializations provide vectorized conversions for common native-endian encodings
+			 */
+			template <typename Source, typename Destination>
+			struct ContiguousKernel
+			{
+				static inline void Convert(const uint8_t *source, uint8_t *destination, size_t count) noexcept
+				{
+					using IsInteger = std::is_same<Intermediate<Source, Destination>, int32_t>;
+					for(size_t i = 0; i < count; ++i)
+						ConvertSample<Source, Destination>(source + i * Source::kSize, destination + i * Destination::kSize, IsInteger());
+				}
+			};
+
+			/*! @brief Four \c float lanes */
+			typedef float vfloat4 __attribute__((vector_size(16)));
+			/*! @brief Four \c double lanes */
+			typedef double vdouble4 __attribute__((vector_size(32)));
+			/*! @brief Four \c int32_t lanes */
+			typedef int32_t vint4 __attribute__((vector_size(16)));
+			/*! @brief Four \c int16_t lanes */
+			typedef int16_t vshort4 __attribute__((vector_size(8)));
+
+			/*! @brief Returns \c v clipped to [\c minimum, \c maximum] and offset by 0.5 away from zero, ready for truncation */
+			inline vfloat4 ClipAndOffset(vfloat4 v, float minimum, float maximum) noexcept
+			{
+				const vfloat4 lo = { minimum, minimum, minimum, minimum };
+				const vfloat4 hi = { maximum, maximum, maximum, maximum };
+				const vfloat4 half = { 0.5f, 0.5f, 0.5f, 0.5f };
+				const vint4 signMask = { INT32_MIN, INT32_MIN, INT32_MIN, INT32_MIN };
+
+				vint4 mask = v < lo;
+				v = (vfloat4)((mask & (vint4)lo) | (~mask & (vint4)v));
+				mask = v > hi;
+				v = (vfloat4)((mask & (vint4)hi) | (~mask & (vint4)v));
+				return v + (vfloat4)(((vint4)v & signMask) | (vint4)half);
+			}
+
+			/*! @brief Native-endian \c int16_t to \c float */
+			template <>
+			struct ContiguousKernel<Int16Sample<kHostIsBigEndian>, Float32Sample<kHostIsBigEndian>>
+			{
+				static inline void Convert(const uint8_t *source, uint8_t *destination, size_t count) noexcept
+				{
+					const vfloat4 scale = { 1.f / 32768.f, 1.f / 32768.f, 1.f / 32768.f, 1.f / 32768.f };
+					size_t i = 0;
+					for(; i + 4 <= count; i += 4) {
+						vshort4 s;
+						std::memcpy(&s, source + i * 2, sizeof s);
+						const vfloat4 f = __builtin_convertvector(s, vfloat4) * scale;
+						std::memcpy(destination + i * 4, &f, sizeof f);
+					}
+					for(; i < count; ++i)
+						ConvertSample<Int16Sample<kHostIsBigEndian>, Float32Sample<kHostIsBigEndian>>(source + i * 2, destination + i * 4, std::false_type());
+				}
+			};
+
+			/*! @brief \c float to native-endian \c int16_t */
+			template <>
+			struct ContiguousKernel<Float32Sample<kHostIsBigEndian>, Int16Sample<kHostIsBigEndian>>
+			{
+				static inline void Convert(const uint8_t *source, uint8_t *destination, size_t count) noexcept
+				{
+					const vfloat4 scale = { 32768.f, 32768.f, 32768.f, 32768.f };
+					size_t i = 0;
+					for(; i + 4 <= count; i += 4) {
+						vfloat4 f;
+						std::memcpy(&f, source + i * 4, sizeof f);
+						const vshort4 s = __builtin_convertvector(__builtin_convertvector(ClipAndOffset(f * scale, -32768.f, 32767.f), vint4), vshort4);
+						std::memcpy(destination + i * 2, &s, sizeof s);
+					}
+					for(; i < count; ++i)
+						ConvertSample<Float32Sample<kHostIsBigEndian>, Int16Sample<kHostIsBigEndian>>(source + i * 4, destination + i * 2, std::false_type());
+				}
+			};
+
+			/*! @brief Native-endian \c int32_t to \c float */
+			template <>
+			struct ContiguousKernel<Int32Sample<kHostIsBigEndian>, Float32Sample<kHostIsBigEndian>>
+			{
+				static inline void Convert(const uint8_t *source, uint8_t *destination, size_t count) noexcept
+				{
+					const vdouble4 scale = { 1. / 2147483648., 1. / 2147483648., 1. / 2147483648., 1. / 2147483648. };
+					size_t i = 0;
+					for(; i + 4 <= count; i += 4) {
+						vint4 s;
+						std::memcpy(&s, source + i * 4, sizeof s);
+						const vfloat4 f = __builtin_convertvector(__builtin_convertvector(s, vdouble4) * scale, vfloat4);
+						std::memcpy(destination + i * 4, &f, sizeof f);
+					}
+					for(; i < count; ++i)
+						ConvertSample<Int32Sample<kHostIsBigEndian>, Float32Sample<kHostIsBigEndian>>(source + i * 4, destination + i * 4, std::false_type());
+				}
+			};
+
+			/*! @brief Native-endian \c float to \c double */
+			template <>
+			struct ContiguousKernel<Float32Sample<kHostIsBigEndian>, Float64Sample<kHostIsBigEndian>>
+			{
+				static inline void Convert(const uint8_t *source, uint8_t *destination, size_t count) noexcept
+				{
+					size_t i = 0;
+					for(; i + 4 <= count; i += 4) {
+						vfloat4 f;
+						std::memcpy(&f, source + i * 4, sizeof f);
+						const vdouble4 d = __builtin_convertvector(f, vdouble4);
+						std::memcpy(destination + i * 8, &d, sizeof d);
+					}
+					for(; i < count; ++i)
+						ConvertSample<Float32Sample<kHostIsBigEndian>, Float64Sample<kHostIsBigEndian>>(source + i * 4, destination + i * 8, std::false_type());
+				}
+			};
+
+			/*! @brief Native-endian \c double to \c float */
+			template <>
+			struct ContiguousKernel<Float64Sample<kHostIsBigEndian>, Float32Sample<kHostIsBigEndian>>
+			{
+				static inline void Convert(const uint8_t *source, uint8_t *destination, size_t count) noexcept
+				{
+					size_t i = 0;
+					for(; i + 4 <= count; i += 4) {
+						vdouble4 d;
+						std::memcpy(&d, source + i * 8, sizeof d);
+						const vfloat4 f = __builtin_convertvector(d, vfloat4);
+						std::memcpy(destination + i * 4, &f, sizeof f);
+					}
+					for(; i < count; ++i)
+						ConvertSample<Float64Sample<kHostIsBigEndian>, Float32Sample<kHostIsBigEndian>>(source + i * 8, destination + i * 4, std::false_type());
+				}
+			};
+
+			/*! @brief Converts samples from \c Source to \c Destination, using \c ContiguousKernel when both are contiguous */
+			template <typename Source, typename Destination>
+			void Convert(const void *source, ptrdiff_t sourceStride, void *destination, ptrdiff_t destinationStride, size_t count) noexcept
+			{
+				auto src = static_cast<const uint8_t *>(source);
+				auto dst = static_cast<uint8_t *>(destination);
+
+				if(sourceStride == static_cast<ptrdiff_t>(Source::kSize) && destinationStride == static_cast<ptrdiff_t>(Destination::kSize)) {
+					if(std::is_same<Source, Destination>::value)
+						std::memmove(dst, src, count * Source::kSize);
+					else
+						ContiguousKernel<Source, Destination>::Convert(src, dst, count);
+					return;
+				}
+
+				using IsInteger = std::is_same<Intermediate<Source, Destination>, int32_t>;
+				for(size_t i = 0; i < count; ++i, src += sourceStride, dst += destinationStride) {
+					if(std::is_same<Source, Destination>::value)
+						std::memcpy(dst, src, Source::kSize);
+					else
+						ConvertSample<Source, Destination>(src, dst, IsInteger());
+				}
+			}
+
+		}
+
+	}
+}